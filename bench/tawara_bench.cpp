@@ -0,0 +1,657 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/filesystem.hpp>
+#include <boost/foreach.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/memory_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/tawara_config.h>
+#include <tawara/tracks.h>
+#include <tawara/track_entry.h>
+#include <vector>
+
+#include "bench_utils.h"
+
+namespace bfs = boost::filesystem;
+namespace bpt = boost::posix_time;
+
+
+// Frame sizes covered by the throughput benchmarks, from 8 B to 8 MB.
+static std::size_t const bench_frame_sizes[] = {8, 64, 512, 4096, 32768,
+    262144, 1048576, 8388608};
+// Frames stored in each block when lacing is used.
+static unsigned int const bench_lace_frames(8);
+// Clusters are closed after this many blocks or bytes, whichever is first.
+static unsigned int const bench_cluster_blocks(1000);
+static std::size_t const bench_cluster_bytes(4 * 1024 * 1024);
+
+
+struct BenchSettings
+{
+    // Seed for all generated data
+    uint64_t seed;
+    // Number of times each throughput case is run
+    unsigned int repeats;
+    // Payload written by each throughput case
+    std::size_t target_bytes;
+    // Upper limit on the frames written by each throughput case
+    std::size_t max_frames;
+    // Clusters in the recordings used for the latency benchmarks
+    unsigned int clusters;
+    // Number of measurements taken by each latency benchmark
+    unsigned int samples;
+    // Directory the recordings are written to
+    bfs::path dir;
+};
+
+
+struct Workload
+{
+    std::size_t frame_size;
+    tawara::Block::LacingType lacing;
+    unsigned int frames_per_block;
+    uint64_t blocks;
+};
+
+
+struct LatencyStats
+{
+    double mean_us;
+    double median_us;
+    double p99_us;
+    double max_us;
+};
+
+
+char const* lacing_name(tawara::Block::LacingType lacing)
+{
+    switch (lacing)
+    {
+        case tawara::Block::LACING_EBML:
+            return "ebml";
+        case tawara::Block::LACING_FIXED:
+            return "fixed";
+        default:
+            return "none";
+    }
+}
+
+
+double median(std::vector<double> values)
+{
+    std::sort(values.begin(), values.end());
+    return values[values.size() / 2];
+}
+
+
+LatencyStats latency_stats(std::vector<double> samples)
+{
+    std::sort(samples.begin(), samples.end());
+    LatencyStats stats;
+    stats.mean_us = 0;
+    BOOST_FOREACH(double s, samples)
+    {
+        stats.mean_us += s;
+    }
+    stats.mean_us /= samples.size();
+    stats.median_us = samples[samples.size() / 2];
+    stats.p99_us = samples[(samples.size() * 99) / 100];
+    stats.max_us = samples.back();
+    return stats;
+}
+
+
+// Makes a small pool of random frames that the writers cycle through. Blocks
+// hold pointers to frames, so large frames need not be copied per block.
+std::vector<tawara::Block::FramePtr> make_frame_pool(std::size_t size,
+        bench_utils::Random& rng)
+{
+    std::vector<tawara::Block::FramePtr> pool;
+    for (int ii(0); ii < 4; ++ii)
+    {
+        tawara::Block::FramePtr frame(new tawara::Block::Frame(size));
+        for (std::size_t jj(0); jj < size; ++jj)
+        {
+            (*frame)[jj] = rng.next() & 0xFF;
+        }
+        pool.push_back(frame);
+    }
+    return pool;
+}
+
+
+Workload make_workload(BenchSettings const& settings, std::size_t frame_size,
+        tawara::Block::LacingType lacing)
+{
+    Workload w;
+    w.frame_size = frame_size;
+    w.lacing = lacing;
+    w.frames_per_block = lacing == tawara::Block::LACING_NONE ? 1 :
+        bench_lace_frames;
+    std::size_t frames(settings.target_bytes / frame_size);
+    frames = std::min(std::max(frames,
+                static_cast<std::size_t>(w.frames_per_block)),
+            settings.max_frames);
+    w.blocks = frames / w.frames_per_block;
+    return w;
+}
+
+
+void write_header(std::iostream& stream, tawara::Segment& segment)
+{
+    tawara::EBMLElement ebml_el;
+    ebml_el.write(stream);
+    segment.write(stream);
+    tawara::Tracks tracks;
+    tracks.insert(tawara::TrackEntry::Ptr(
+                new tawara::TrackEntry(1, 1, "bench")));
+    segment.index.insert(std::make_pair(tracks.id(),
+                segment.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+}
+
+
+// Writes a recording of a single track using the given cluster
+// implementation. Returns the size of the file.
+template<typename ClusterType>
+std::streamsize write_recording(bfs::path const& path, Workload const& w,
+        std::vector<tawara::Block::FramePtr> const& pool)
+{
+    std::fstream stream(path.string().c_str(), std::ios::in | std::ios::out |
+            std::ios::trunc | std::ios::binary);
+    tawara::Segment segment;
+    write_header(stream, segment);
+
+    uint64_t block(0);
+    std::size_t next_frame(0);
+    while (block < w.blocks)
+    {
+        ClusterType cluster(block);
+        if (block == 0)
+        {
+            segment.index.insert(std::make_pair(cluster.id(),
+                        segment.to_segment_offset(stream.tellp())));
+        }
+        cluster.write(stream);
+        std::size_t cluster_bytes(0);
+        for (unsigned int ii(0); ii < bench_cluster_blocks &&
+                block < w.blocks && cluster_bytes < bench_cluster_bytes;
+                ++ii, ++block)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, ii,
+                        w.lacing));
+            for (unsigned int jj(0); jj < w.frames_per_block; ++jj)
+            {
+                b->push_back(pool[next_frame++ % pool.size()]);
+            }
+            cluster.push_back(b);
+            cluster_bytes += w.frame_size * w.frames_per_block;
+        }
+        cluster.finalise(stream);
+    }
+    segment.finalise(stream);
+    std::streamsize size(stream.tellp());
+    stream.close();
+    return size;
+}
+
+
+void open_segment(std::istream& stream, tawara::Segment& segment)
+{
+    tawara::read_tawara_header(stream);
+    if (tawara::ids::read(stream).first != tawara::ids::Segment)
+    {
+        throw tawara::NotTawara();
+    }
+    segment.read(stream);
+}
+
+
+// Reads every frame through the in-memory cluster implementation. Returns
+// the number of frame bytes read.
+uint64_t read_recording_mem(bfs::path const& path)
+{
+    std::ifstream stream(path.string().c_str(),
+            std::ios::in | std::ios::binary);
+    tawara::Segment segment;
+    open_segment(stream, segment);
+    uint64_t bytes(0);
+    for (tawara::Segment::MemClusterIterator
+            cluster(segment.clusters_begin_mem(stream));
+            cluster != segment.clusters_end_mem(stream); ++cluster)
+    {
+        for (tawara::MemoryCluster::Iterator block(cluster->begin());
+                block != cluster->end(); ++block)
+        {
+            for (tawara::Block::iterator frame((*block)->begin());
+                    frame != (*block)->end(); ++frame)
+            {
+                bytes += (*frame)->size();
+            }
+        }
+    }
+    return bytes;
+}
+
+
+// Reads every frame through the in-file cluster implementation. Returns the
+// number of frame bytes read.
+uint64_t read_recording_file(bfs::path const& path)
+{
+    std::ifstream stream(path.string().c_str(),
+            std::ios::in | std::ios::binary);
+    tawara::Segment segment;
+    open_segment(stream, segment);
+    uint64_t bytes(0);
+    for (tawara::Segment::FileBlockIterator
+            block(segment.blocks_begin_file(stream));
+            block != segment.blocks_end_file(stream); ++block)
+    {
+        for (tawara::Block::iterator frame(block->begin());
+                frame != block->end(); ++frame)
+        {
+            bytes += (*frame)->size();
+        }
+    }
+    return bytes;
+}
+
+
+void write_throughput(std::ostream& out, char const* kind, char const* name,
+        Workload const& w, std::streamsize file_bytes,
+        std::vector<double> const& times_us)
+{
+    double payload(static_cast<double>(w.blocks) * w.frames_per_block *
+            w.frame_size);
+    double seconds(median(times_us) / 1e6);
+    double best(*std::min_element(times_us.begin(), times_us.end()) / 1e6);
+    out << "    {\"" << kind << "\": \"" << name << "\", \"lacing\": \"" <<
+        lacing_name(w.lacing) << "\", \"frame_size\": " << w.frame_size <<
+        ", \"blocks\": " << w.blocks << ", \"frames\": " <<
+        w.blocks * w.frames_per_block << ", \"payload_bytes\": " <<
+        static_cast<uint64_t>(payload) << ", \"file_bytes\": " <<
+        file_bytes << std::fixed << std::setprecision(6) <<
+        ", \"seconds\": " << seconds << ", \"best_seconds\": " << best <<
+        std::setprecision(3) << ", \"blocks_per_sec\": " <<
+        w.blocks / seconds << ", \"mb_per_sec\": " << payload / seconds / 1e6 <<
+        '}';
+    out.unsetf(std::ios::fixed);
+}
+
+
+// Runs the write and read throughput cases for every frame size and lacing
+// mode.
+void bench_throughput(std::ostream& write_out, std::ostream& read_out,
+        BenchSettings const& settings)
+{
+    tawara::Block::LacingType const lacings[] = {tawara::Block::LACING_NONE,
+        tawara::Block::LACING_FIXED, tawara::Block::LACING_EBML};
+    bench_utils::Random rng(settings.seed);
+    bfs::path path(settings.dir / "throughput.tawara");
+    bool first(true);
+    BOOST_FOREACH(std::size_t frame_size, bench_frame_sizes)
+    {
+        std::vector<tawara::Block::FramePtr> pool(make_frame_pool(frame_size,
+                    rng));
+        BOOST_FOREACH(tawara::Block::LacingType lacing, lacings)
+        {
+            Workload w(make_workload(settings, frame_size, lacing));
+            std::cerr << "throughput: " << frame_size << " B frames, " <<
+                lacing_name(lacing) << " lacing\n";
+
+            std::streamsize file_bytes(0);
+            std::vector<double> mem_times, file_times;
+            for (unsigned int ii(0); ii < settings.repeats; ++ii)
+            {
+                bpt::ptime start(bpt::microsec_clock::universal_time());
+                file_bytes = write_recording<tawara::MemoryCluster>(path, w,
+                        pool);
+                mem_times.push_back(bench_utils::elapsed_us(start));
+                start = bpt::microsec_clock::universal_time();
+                file_bytes = write_recording<tawara::FileCluster>(path, w,
+                        pool);
+                file_times.push_back(bench_utils::elapsed_us(start));
+            }
+            write_out << (first ? "\n" : ",\n");
+            write_throughput(write_out, "cluster", "memory", w, file_bytes,
+                    mem_times);
+            write_out << ",\n";
+            write_throughput(write_out, "cluster", "file", w, file_bytes,
+                    file_times);
+
+            uint64_t expected(w.blocks * w.frames_per_block * w.frame_size);
+            mem_times.clear();
+            file_times.clear();
+            for (unsigned int ii(0); ii < settings.repeats; ++ii)
+            {
+                bpt::ptime start(bpt::microsec_clock::universal_time());
+                if (read_recording_mem(path) != expected)
+                {
+                    throw tawara::ReadError();
+                }
+                mem_times.push_back(bench_utils::elapsed_us(start));
+                start = bpt::microsec_clock::universal_time();
+                if (read_recording_file(path) != expected)
+                {
+                    throw tawara::ReadError();
+                }
+                file_times.push_back(bench_utils::elapsed_us(start));
+            }
+            read_out << (first ? "\n" : ",\n");
+            write_throughput(read_out, "iterator", "memory", w, file_bytes,
+                    mem_times);
+            read_out << ",\n";
+            write_throughput(read_out, "iterator", "file", w, file_bytes,
+                    file_times);
+            first = false;
+        }
+    }
+    bfs::remove(path);
+}
+
+
+// Writes a recording of many small clusters for the latency benchmarks. If
+// indexed is true, the SeekHead holds the positions of the Tracks, the first
+// Cluster and a Cues element with one cue point per cluster. Otherwise the
+// SeekHead is empty and there are no Cues, so readers must scan.
+void write_latency_recording(bfs::path const& path,
+        BenchSettings const& settings, bool indexed)
+{
+    std::fstream stream(path.string().c_str(), std::ios::in | std::ios::out |
+            std::ios::trunc | std::ios::binary);
+    tawara::Segment segment;
+    write_header(stream, segment);
+    if (!indexed)
+    {
+        segment.index.clear();
+    }
+
+    bench_utils::Random rng(settings.seed);
+    std::vector<tawara::Block::FramePtr> pool(make_frame_pool(64, rng));
+    tawara::Cues cues;
+    for (unsigned int ii(0); ii < settings.clusters; ++ii)
+    {
+        tawara::FileCluster cluster(ii * 1000);
+        std::streamsize pos(segment.to_segment_offset(stream.tellp()));
+        if (indexed && ii == 0)
+        {
+            segment.index.insert(std::make_pair(cluster.id(), pos));
+        }
+        tawara::CuePoint cp(ii * 1000);
+        cp.push_back(tawara::CueTrackPosition(1, pos));
+        cues.insert(cp);
+        cluster.write(stream);
+        for (int jj(0); jj < 16; ++jj)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, jj * 60));
+            b->push_back(pool[jj % pool.size()]);
+            cluster.push_back(b);
+        }
+        cluster.finalise(stream);
+    }
+    if (indexed)
+    {
+        segment.index.insert(std::make_pair(cues.id(),
+                    segment.to_segment_offset(stream.tellp())));
+        cues.write(stream);
+    }
+    segment.finalise(stream);
+}
+
+
+void write_latency(std::ostream& out, char const* key, bool value,
+        BenchSettings const& settings, LatencyStats const& stats)
+{
+    out << "    {\"" << key << "\": " << (value ? "true" : "false") <<
+        ", \"clusters\": " << settings.clusters << ", \"samples\": " <<
+        settings.samples << std::fixed << std::setprecision(1) <<
+        ", \"mean_us\": " << stats.mean_us << ", \"median_us\": " <<
+        stats.median_us << ", \"p99_us\": " << stats.p99_us <<
+        ", \"max_us\": " << stats.max_us << '}';
+    out.unsetf(std::ios::fixed);
+}
+
+
+// Measures the time to open a segment, and the time to find a cluster by
+// time and read its first block, with and without an index.
+void bench_latency(std::ostream& open_out, std::ostream& seek_out,
+        BenchSettings const& settings)
+{
+    bfs::path path(settings.dir / "latency.tawara");
+    bool const indexed[] = {true, false};
+    BOOST_FOREACH(bool index, indexed)
+    {
+        std::cerr << "latency: " << (index ? "with" : "without") <<
+            " index\n";
+        write_latency_recording(path, settings, index);
+
+        std::vector<double> samples;
+        for (unsigned int ii(0); ii < settings.samples; ++ii)
+        {
+            bpt::ptime start(bpt::microsec_clock::universal_time());
+            std::ifstream stream(path.string().c_str(),
+                    std::ios::in | std::ios::binary);
+            tawara::Segment segment;
+            open_segment(stream, segment);
+            samples.push_back(bench_utils::elapsed_us(start));
+        }
+        open_out << (index ? "\n" : ",\n");
+        write_latency(open_out, "seekhead", index, settings,
+                latency_stats(samples));
+
+        std::ifstream stream(path.string().c_str(),
+                std::ios::in | std::ios::binary);
+        tawara::Segment segment;
+        open_segment(stream, segment);
+        bench_utils::Random rng(settings.seed);
+        samples.clear();
+        for (unsigned int ii(0); ii < settings.samples; ++ii)
+        {
+            // Cluster timecodes are in milliseconds
+            int64_t time((rng.next() % (settings.clusters * 1000)) *
+                    segment.info.timecode_scale());
+            bpt::ptime start(bpt::microsec_clock::universal_time());
+            tawara::Segment::FileClusterIterator cluster(
+                    segment.clusters_at_time(stream, time));
+            if (cluster == segment.clusters_end_file(stream) ||
+                    cluster->begin()->count() == 0)
+            {
+                throw tawara::ReadError();
+            }
+            samples.push_back(bench_utils::elapsed_us(start));
+        }
+        seek_out << (index ? "\n" : ",\n");
+        write_latency(seek_out, "cues", index, settings,
+                latency_stats(samples));
+    }
+    bfs::remove(path);
+}
+
+
+void usage(char const* name)
+{
+    std::cerr << "Usage: " << name << " [-o <file>] [-d <dir>] [-r <repeats>]"
+        " [-s <seed>] [-q]\n" <<
+        "Runs the benchmark suite and prints the results as JSON.\n"
+        "  -o  Write the results to a file instead of standard output.\n"
+        "  -d  Directory for the recordings written while benchmarking. By "
+        "default, a new temporary directory is used.\n"
+        "  -r  Number of runs of each throughput case (default 3, or 1 in "
+        "quick mode). The median time is reported.\n"
+        "  -s  Seed for the generated data (default 1).\n"
+        "  -q  Quick mode: smaller workloads, for smoke testing.\n"
+        "Throughput is measured on the page cache; no fsync is performed. "
+        "MB is 10^6 bytes of frame payload.\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    BenchSettings settings;
+    settings.seed = 1;
+    settings.repeats = 3;
+    settings.target_bytes = 64 * 1024 * 1024;
+    settings.max_frames = 1 << 18;
+    settings.clusters = 2048;
+    settings.samples = 200;
+    std::string out_name, dir_name;
+    bool quick(false);
+    int repeats(0);
+    for (int ii(1); ii < argc; ++ii)
+    {
+        if (std::strcmp(argv[ii], "-q") == 0)
+        {
+            quick = true;
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-o") == 0)
+        {
+            out_name = argv[++ii];
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-d") == 0)
+        {
+            dir_name = argv[++ii];
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-r") == 0)
+        {
+            repeats = std::max(1, std::atoi(argv[++ii]));
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-s") == 0)
+        {
+            settings.seed = std::strtoull(argv[++ii], 0, 10);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (quick)
+    {
+        settings.target_bytes = 4 * 1024 * 1024;
+        settings.max_frames = 1 << 14;
+        settings.clusters = 256;
+        settings.samples = 50;
+        settings.repeats = 1;
+    }
+    if (repeats > 0)
+    {
+        settings.repeats = repeats;
+    }
+
+    bool temp_dir(dir_name.empty());
+    try
+    {
+        settings.dir = temp_dir ? bfs::temp_directory_path() /
+            bfs::unique_path("tawara_bench-%%%%-%%%%") : bfs::path(dir_name);
+        if (temp_dir)
+        {
+            bfs::create_directory(settings.dir);
+        }
+    }
+    catch (bfs::filesystem_error& e)
+    {
+        std::cerr << e.what() << '\n';
+        return 1;
+    }
+
+    std::ostringstream write_out, read_out, open_out, seek_out;
+    int result(0);
+    try
+    {
+        bench_throughput(write_out, read_out, settings);
+        bench_latency(open_out, seek_out, settings);
+    }
+    catch (tawara::TawaraError&)
+    {
+        std::cerr << "A benchmark recording could not be written or read "
+            "back.\n";
+        result = 1;
+    }
+    catch (bfs::filesystem_error& e)
+    {
+        std::cerr << e.what() << '\n';
+        result = 1;
+    }
+    if (temp_dir)
+    {
+        boost::system::error_code ec;
+        bfs::remove_all(settings.dir, ec);
+    }
+    if (result != 0)
+    {
+        return result;
+    }
+
+    std::ofstream out_file;
+    if (!out_name.empty())
+    {
+        out_file.open(out_name.c_str());
+        if (!out_file)
+        {
+            std::cerr << "Could not open " << out_name << '\n';
+            return 1;
+        }
+    }
+    std::ostream& out(out_name.empty() ? std::cout : out_file);
+    out << "{\n  \"version\": ";
+    bench_utils::write_json_string(out, tawara::TawaraVersion);
+    out << ",\n  \"seed\": " << settings.seed <<
+        ",\n  \"repeats\": " << settings.repeats <<
+        ",\n  \"quick\": " << (quick ? "true" : "false") <<
+        ",\n  \"write\": [" << write_out.str() << "\n  ]" <<
+        ",\n  \"read\": [" << read_out.str() << "\n  ]" <<
+        ",\n  \"open\": [" << open_out.str() << "\n  ]" <<
+        ",\n  \"seek\": [" << seek_out.str() << "\n  ]\n}\n";
+    return 0;
+}
@@ -0,0 +1,663 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/foreach.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tawara/block_header.h>
+#include <tawara/block_impl.h>
+#include <tawara/date_element.h>
+#include <tawara/ebml_int.h>
+#include <tawara/el_ids.h>
+#include <tawara/float_element.h>
+#include <tawara/simple_block.h>
+#include <tawara/tawara_config.h>
+#include <tawara/vint.h>
+#include <vector>
+
+#include "bench_utils.h"
+
+namespace bpt = boost::posix_time;
+
+
+// Number of inputs generated for each benchmark
+static std::size_t const micro_inputs(4096);
+// Number of blocks generated for each lacing type
+static std::size_t const micro_blocks(1024);
+
+// Checksums of the results are stored here so that no work is optimised away
+volatile uint64_t micro_sink(0);
+
+
+// Pre-generated inputs, shared by all benchmarks.
+struct Fixture
+{
+    // Element sizes and other variable-length integers
+    std::vector<uint64_t> vints;
+    std::vector<std::vector<char> > vints_encoded;
+    std::string vints_stream;
+    // Unsigned and signed element values
+    std::vector<uint64_t> uints;
+    std::vector<std::vector<char> > uints_encoded;
+    std::vector<int64_t> sints;
+    std::vector<std::vector<char> > sints_encoded;
+    // Element IDs, in the proportions they appear in a recording
+    std::vector<tawara::ids::ID> ids;
+    std::string ids_stream;
+    // Float and date element values
+    std::vector<double> floats;
+    std::vector<tawara::EBMLFloatPrec> float_precs;
+    std::vector<int64_t> dates;
+    // Encoded blocks for each lacing type, as bare block bodies (for
+    // BlockImpl) and as SimpleBlock elements (for read_block_header)
+    std::string blocks[3];
+    std::vector<std::streamsize> block_sizes[3];
+    std::string simple_blocks[3];
+    // Scratch stream for the write benchmarks
+    std::stringstream scratch;
+};
+
+
+// Picks an index using a table of weights.
+int pick(bench_utils::Random& rng, int const* weights, int count)
+{
+    int total(0);
+    for (int ii(0); ii < count; ++ii)
+    {
+        total += weights[ii];
+    }
+    int r(rng.next() % total);
+    for (int ii(0); ii < count; ++ii)
+    {
+        if (r < weights[ii])
+        {
+            return ii;
+        }
+        r -= weights[ii];
+    }
+    return count - 1;
+}
+
+
+// Gets a random value that needs the given number of bytes when stored as a
+// variable-length integer.
+uint64_t vint_of_size(bench_utils::Random& rng, int bytes)
+{
+    uint64_t low(bytes == 1 ? 0 : (1ULL << (7 * (bytes - 1))) - 1);
+    uint64_t high((1ULL << (7 * bytes)) - 2);
+    return low + rng.next() % (high - low + 1);
+}
+
+
+// Gets a random value that needs the given number of bytes when stored as an
+// unsigned EBML integer.
+uint64_t uint_of_size(bench_utils::Random& rng, int bytes)
+{
+    if (bytes == 8)
+    {
+        return rng.next() | (1ULL << 63);
+    }
+    uint64_t low(bytes == 1 ? 0 : 1ULL << (8 * (bytes - 1)));
+    uint64_t high((1ULL << (8 * bytes)) - 1);
+    return low + rng.next() % (high - low + 1);
+}
+
+
+// Encodes a block with the given lacing, as a bare block body and as a
+// SimpleBlock element.
+void make_block(bench_utils::Random& rng, tawara::Block::LacingType lacing,
+        std::ostream& body, std::ostream& element,
+        std::vector<std::streamsize>& sizes)
+{
+    tawara::SimpleBlock b(rng.next() % 4 + 1, rng.next() % 32768, lacing);
+    // Laced blocks hold a few small, high-rate frames; unlaced blocks hold
+    // one larger frame.
+    std::size_t frames(lacing == tawara::Block::LACING_NONE ? 1 :
+            2 + rng.next() % 15);
+    std::size_t size(lacing == tawara::Block::LACING_NONE ?
+            16 + rng.next() % 1009 : 16 + rng.next() % 241);
+    for (std::size_t ii(0); ii < frames; ++ii)
+    {
+        if (lacing == tawara::Block::LACING_EBML)
+        {
+            size = 16 + rng.next() % 241;
+        }
+        b.push_back(tawara::Block::FramePtr(new tawara::Block::Frame(size,
+                        static_cast<char>(rng.next()))));
+    }
+    tawara::BlockImpl impl(b.track_number(), b.timecode(), lacing);
+    for (tawara::Block::iterator frame(b.begin()); frame != b.end(); ++frame)
+    {
+        impl.push_back(*frame);
+    }
+    sizes.push_back(impl.write(body, 0));
+    b.write(element);
+}
+
+
+void make_fixture(Fixture& f, uint64_t seed)
+{
+    bench_utils::Random rng(seed);
+    // Most sizes are of small elements; a few are of clusters and large
+    // frames.
+    int const vint_weights[] = {55, 30, 10, 4, 1};
+    // Values are mostly small counts and timecodes, with some 64-bit UIDs.
+    int const uint_weights[] = {50, 25, 8, 7, 0, 0, 0, 10};
+    // Signed values are mostly small timecode offsets.
+    int const sint_weights[] = {60, 35, 0, 5};
+    tawara::ids::ID const id_table[] = {tawara::ids::SimpleBlock,
+        tawara::ids::Timecode, tawara::ids::BlockGroup, tawara::ids::Block,
+        tawara::ids::Cluster, tawara::ids::Void, tawara::ids::CRC32,
+        tawara::ids::CuePoint, tawara::ids::CueTime, tawara::ids::SeekID,
+        tawara::ids::Info, tawara::ids::Tracks};
+    int const id_weights[] = {60, 10, 5, 5, 5, 3, 3, 3, 3, 1, 1, 1};
+
+    std::ostringstream vints_stream, ids_stream;
+    for (std::size_t ii(0); ii < micro_inputs; ++ii)
+    {
+        uint64_t v(vint_of_size(rng, pick(rng, vint_weights, 5) + 1));
+        f.vints.push_back(v);
+        f.vints_encoded.push_back(tawara::vint::encode(v));
+        tawara::vint::write(v, vints_stream);
+
+        uint64_t u(uint_of_size(rng, pick(rng, uint_weights, 8) + 1));
+        f.uints.push_back(u);
+        f.uints_encoded.push_back(tawara::ebml_int::encode_u(u));
+
+        int64_t s(uint_of_size(rng, pick(rng, sint_weights, 4) + 1) >> 1);
+        if (rng.next() & 1)
+        {
+            s = -s;
+        }
+        f.sints.push_back(s);
+        f.sints_encoded.push_back(tawara::ebml_int::encode_s(s));
+
+        tawara::ids::ID id(id_table[pick(rng, id_weights, 12)]);
+        f.ids.push_back(id);
+        tawara::ids::write(id, ids_stream);
+
+        // Rates, durations and scales, mostly stored as doubles
+        f.floats.push_back((rng.next() % 100000000) / 1000.0);
+        f.float_precs.push_back(rng.next() % 5 == 0 ?
+                tawara::EBML_FLOAT_PREC_SINGLE :
+                tawara::EBML_FLOAT_PREC_DOUBLE);
+        // Dates within ten years of 2021, in nanoseconds since 2001
+        f.dates.push_back((630720000LL + static_cast<int64_t>(
+                    rng.next() % 630720000LL) - 315360000LL) * 1000000000LL);
+    }
+    f.vints_stream = vints_stream.str();
+    f.ids_stream = ids_stream.str();
+
+    tawara::Block::LacingType const lacings[] = {tawara::Block::LACING_NONE,
+        tawara::Block::LACING_FIXED, tawara::Block::LACING_EBML};
+    for (int ii(0); ii < 3; ++ii)
+    {
+        std::ostringstream body, element;
+        for (std::size_t jj(0); jj < micro_blocks; ++jj)
+        {
+            make_block(rng, lacings[ii], body, element, f.block_sizes[ii]);
+        }
+        f.blocks[ii] = body.str();
+        f.simple_blocks[ii] = element.str();
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Benchmarks
+// Each benchmark performs its operation once for each of its inputs and
+// returns the number of operations performed.
+///////////////////////////////////////////////////////////////////////////////
+
+std::size_t bench_vint_size(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(uint64_t v, f.vints)
+    {
+        sum += tawara::vint::size(v);
+    }
+    micro_sink = micro_sink + sum;
+    return f.vints.size();
+}
+
+
+std::size_t bench_vint_encode(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(uint64_t v, f.vints)
+    {
+        sum += tawara::vint::encode(v).size();
+    }
+    micro_sink = micro_sink + sum;
+    return f.vints.size();
+}
+
+
+std::size_t bench_vint_decode(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(std::vector<char> const& e, f.vints_encoded)
+    {
+        sum += tawara::vint::decode(e).first;
+    }
+    micro_sink = micro_sink + sum;
+    return f.vints_encoded.size();
+}
+
+
+std::size_t bench_vint_write(Fixture& f)
+{
+    f.scratch.seekp(0);
+    uint64_t sum(0);
+    BOOST_FOREACH(uint64_t v, f.vints)
+    {
+        sum += tawara::vint::write(v, f.scratch);
+    }
+    micro_sink = micro_sink + sum;
+    return f.vints.size();
+}
+
+
+std::size_t bench_vint_read(Fixture& f)
+{
+    std::istringstream input(f.vints_stream);
+    uint64_t sum(0);
+    for (std::size_t ii(0); ii < f.vints.size(); ++ii)
+    {
+        sum += tawara::vint::read(input).first;
+    }
+    micro_sink = micro_sink + sum;
+    return f.vints.size();
+}
+
+
+std::size_t bench_uint_encode(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(uint64_t v, f.uints)
+    {
+        sum += tawara::ebml_int::encode_u(v).size();
+    }
+    micro_sink = micro_sink + sum;
+    return f.uints.size();
+}
+
+
+std::size_t bench_uint_decode(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(std::vector<char> const& e, f.uints_encoded)
+    {
+        sum += tawara::ebml_int::decode_u(e);
+    }
+    micro_sink = micro_sink + sum;
+    return f.uints_encoded.size();
+}
+
+
+std::size_t bench_sint_encode(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(int64_t v, f.sints)
+    {
+        sum += tawara::ebml_int::encode_s(v).size();
+    }
+    micro_sink = micro_sink + sum;
+    return f.sints.size();
+}
+
+
+std::size_t bench_sint_decode(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(std::vector<char> const& e, f.sints_encoded)
+    {
+        sum += tawara::ebml_int::decode_s(e);
+    }
+    micro_sink = micro_sink + sum;
+    return f.sints_encoded.size();
+}
+
+
+std::size_t bench_ids_size(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(tawara::ids::ID id, f.ids)
+    {
+        sum += tawara::ids::size(id);
+    }
+    micro_sink = micro_sink + sum;
+    return f.ids.size();
+}
+
+
+std::size_t bench_ids_write(Fixture& f)
+{
+    f.scratch.seekp(0);
+    uint64_t sum(0);
+    BOOST_FOREACH(tawara::ids::ID id, f.ids)
+    {
+        sum += tawara::ids::write(id, f.scratch);
+    }
+    micro_sink = micro_sink + sum;
+    return f.ids.size();
+}
+
+
+std::size_t bench_ids_read(Fixture& f)
+{
+    std::istringstream input(f.ids_stream);
+    uint64_t sum(0);
+    for (std::size_t ii(0); ii < f.ids.size(); ++ii)
+    {
+        sum += tawara::ids::read(input).first;
+    }
+    micro_sink = micro_sink + sum;
+    return f.ids.size();
+}
+
+
+std::size_t bench_float_round_trip(Fixture& f)
+{
+    uint64_t sum(0);
+    for (std::size_t ii(0); ii < f.floats.size(); ++ii)
+    {
+        f.scratch.seekp(0);
+        f.scratch.seekg(0);
+        tawara::FloatElement out(tawara::ids::Duration, f.floats[ii],
+                f.float_precs[ii]);
+        out.write(f.scratch);
+        tawara::FloatElement in(tawara::ids::Duration, 0);
+        tawara::ids::read(f.scratch);
+        in.read(f.scratch);
+        sum += static_cast<uint64_t>(in.value());
+    }
+    micro_sink = micro_sink + sum;
+    return f.floats.size();
+}
+
+
+std::size_t bench_date_round_trip(Fixture& f)
+{
+    uint64_t sum(0);
+    BOOST_FOREACH(int64_t date, f.dates)
+    {
+        f.scratch.seekp(0);
+        f.scratch.seekg(0);
+        tawara::DateElement out(tawara::ids::DateUTC, date);
+        out.write(f.scratch);
+        tawara::DateElement in(tawara::ids::DateUTC, 0);
+        tawara::ids::read(f.scratch);
+        in.read(f.scratch);
+        sum += in.value();
+    }
+    micro_sink = micro_sink + sum;
+    return f.dates.size();
+}
+
+
+std::size_t bench_block_read(Fixture& f, int lacing)
+{
+    std::istringstream input(f.blocks[lacing]);
+    uint64_t sum(0);
+    BOOST_FOREACH(std::streamsize size, f.block_sizes[lacing])
+    {
+        tawara::BlockImpl b(0, 0);
+        b.read(input, size);
+        sum += b.count();
+    }
+    micro_sink = micro_sink + sum;
+    return f.block_sizes[lacing].size();
+}
+
+
+std::size_t bench_block_header(Fixture& f, int lacing)
+{
+    std::istringstream input(f.simple_blocks[lacing]);
+    uint64_t sum(0);
+    for (std::size_t ii(0); ii < f.block_sizes[lacing].size(); ++ii)
+    {
+        sum += tawara::read_block_header(input).timecode;
+    }
+    micro_sink = micro_sink + sum;
+    return f.block_sizes[lacing].size();
+}
+
+
+std::size_t bench_block_read_none(Fixture& f)
+{
+    return bench_block_read(f, 0);
+}
+
+
+std::size_t bench_block_read_fixed(Fixture& f)
+{
+    return bench_block_read(f, 1);
+}
+
+
+std::size_t bench_block_read_ebml(Fixture& f)
+{
+    return bench_block_read(f, 2);
+}
+
+
+std::size_t bench_block_header_none(Fixture& f)
+{
+    return bench_block_header(f, 0);
+}
+
+
+std::size_t bench_block_header_fixed(Fixture& f)
+{
+    return bench_block_header(f, 1);
+}
+
+
+std::size_t bench_block_header_ebml(Fixture& f)
+{
+    return bench_block_header(f, 2);
+}
+
+
+typedef std::size_t (*BenchFunc)(Fixture&);
+
+struct BenchCase
+{
+    char const* name;
+    BenchFunc func;
+};
+
+static BenchCase const micro_cases[] = {
+    {"vint.size", bench_vint_size},
+    {"vint.encode", bench_vint_encode},
+    {"vint.decode", bench_vint_decode},
+    {"vint.write", bench_vint_write},
+    {"vint.read", bench_vint_read},
+    {"ebml_int.encode_u", bench_uint_encode},
+    {"ebml_int.decode_u", bench_uint_decode},
+    {"ebml_int.encode_s", bench_sint_encode},
+    {"ebml_int.decode_s", bench_sint_decode},
+    {"ids.size", bench_ids_size},
+    {"ids.write", bench_ids_write},
+    {"ids.read", bench_ids_read},
+    {"float_element.round_trip", bench_float_round_trip},
+    {"date_element.round_trip", bench_date_round_trip},
+    {"block_impl.read.none", bench_block_read_none},
+    {"block_impl.read.fixed", bench_block_read_fixed},
+    {"block_impl.read.ebml", bench_block_read_ebml},
+    {"block_header.read.none", bench_block_header_none},
+    {"block_header.read.fixed", bench_block_header_fixed},
+    {"block_header.read.ebml", bench_block_header_ebml}};
+
+
+// Runs a benchmark repeatedly for at least the given time, and returns the
+// time taken per operation in nanoseconds.
+double time_case(BenchCase const& bench, Fixture& f, double min_us)
+{
+    uint64_t ops(0);
+    bpt::ptime start(bpt::microsec_clock::universal_time());
+    double elapsed(0);
+    do
+    {
+        ops += bench.func(f);
+        elapsed = bench_utils::elapsed_us(start);
+    }
+    while (elapsed < min_us);
+    return elapsed * 1000.0 / ops;
+}
+
+
+void usage(char const* name)
+{
+    std::cerr << "Usage: " << name << " [-o <file>] [-f <filter>] "
+        "[-t <ms>] [-r <repeats>] [-s <seed>] [-q]\n" <<
+        "Runs the micro-benchmarks of the primitive codecs and element "
+        "parsers and prints the results as JSON.\n"
+        "  -o  Write the results to a file instead of standard output.\n"
+        "  -f  Only run benchmarks whose name contains the filter.\n"
+        "  -t  Minimum time for each run of a benchmark (default 200 ms).\n"
+        "  -r  Number of runs of each benchmark (default 5). The median "
+        "time is reported.\n"
+        "  -s  Seed for the generated inputs (default 1).\n"
+        "  -q  Quick mode: one short run of each benchmark.\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    std::string out_name, filter;
+    uint64_t seed(1);
+    double min_ms(200);
+    unsigned int repeats(5);
+    bool quick(false);
+    for (int ii(1); ii < argc; ++ii)
+    {
+        if (std::strcmp(argv[ii], "-q") == 0)
+        {
+            quick = true;
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-o") == 0)
+        {
+            out_name = argv[++ii];
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-f") == 0)
+        {
+            filter = argv[++ii];
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-t") == 0)
+        {
+            min_ms = std::max(1.0, std::atof(argv[++ii]));
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-r") == 0)
+        {
+            repeats = std::max(1, std::atoi(argv[++ii]));
+        }
+        else if (ii + 1 < argc && std::strcmp(argv[ii], "-s") == 0)
+        {
+            seed = std::strtoull(argv[++ii], 0, 10);
+        }
+        else
+        {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (quick)
+    {
+        min_ms = 10;
+        repeats = 1;
+    }
+
+    Fixture f;
+    make_fixture(f, seed);
+
+    std::ostringstream results;
+    bool first(true);
+    BOOST_FOREACH(BenchCase const& bench, micro_cases)
+    {
+        if (!filter.empty() &&
+                std::string(bench.name).find(filter) == std::string::npos)
+        {
+            continue;
+        }
+        std::cerr << bench.name << '\n';
+        // One untimed pass to warm the caches
+        bench.func(f);
+        std::vector<double> times;
+        for (unsigned int ii(0); ii < repeats; ++ii)
+        {
+            times.push_back(time_case(bench, f, min_ms * 1000));
+        }
+        std::sort(times.begin(), times.end());
+        results << (first ? "\n" : ",\n") << "    {\"name\": \"" <<
+            bench.name << "\"" << std::fixed << std::setprecision(2) <<
+            ", \"ns_per_op\": " << times[times.size() / 2] <<
+            ", \"best_ns_per_op\": " << times.front() <<
+            ", \"mops_per_sec\": " << 1000.0 / times[times.size() / 2] << '}';
+        first = false;
+    }
+
+    std::ofstream out_file;
+    if (!out_name.empty())
+    {
+        out_file.open(out_name.c_str());
+        if (!out_file)
+        {
+            std::cerr << "Could not open " << out_name << '\n';
+            return 1;
+        }
+    }
+    std::ostream& out(out_name.empty() ? std::cout : out_file);
+    out << "{\n  \"version\": ";
+    bench_utils::write_json_string(out, tawara::TawaraVersion);
+    out << ",\n  \"seed\": " << seed <<
+        ",\n  \"repeats\": " << repeats <<
+        ",\n  \"min_time_ms\": " << min_ms <<
+        ",\n  \"inputs\": " << micro_inputs <<
+        ",\n  \"benchmarks\": [" << results.str() << "\n  ]\n}\n";
+    return 0;
+}
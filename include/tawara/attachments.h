@@ -41,11 +41,14 @@
 
 #include <boost/operators.hpp>
 #include <boost/shared_ptr.hpp>
+#include <iostream>
+#include <string>
 #include <tawara/binary_element.h>
 #include <tawara/master_element.h>
 #include <tawara/string_element.h>
 #include <tawara/uint_element.h>
 #include <tawara/win_dll.h>
+#include <vector>
 
 /// \addtogroup elements Elements
 /// @{
@@ -56,20 +59,126 @@ namespace tawara
      *
      * The data in a single attachment is stored as a binary blob, using an
      * EBML binary element.
+     *
+     * Large attachments do not need to be held in memory. When the data is
+     * taken from a file or a source stream, it is copied to the output in
+     * chunks when written. When lazy reading is turned on, reading the
+     * element only records the position and size of the data, which can then
+     * be read in chunks with read_data() or copy_data(). In both cases,
+     * value() returns an empty vector.
      */
     class TAWARA_EXPORT FileData : public BinaryElement
     {
         public:
             /// \brief Constructor.
-            FileData(std::vector<char> data)
-                : BinaryElement(ids::FileData, data)
-            {
-            }
+            FileData(std::vector<char> data);
+
+            /** \brief Constructor for data stored in a file.
+             *
+             * The file is opened immediately and kept open until the
+             * element is destroyed. Its contents are read when the element
+             * is written.
+             *
+             * \param[in] path The path of the file.
+             * \throw ReadError if the file cannot be opened.
+             */
+            FileData(std::string const& path);
+
+            /** \brief Constructor for data read from a stream.
+             *
+             * The data is read from the stream's current read position when
+             * the element is written.
+             *
+             * \param[in] source The stream holding the data.
+             * \param[in] size The size of the data.
+             * \throw ReadError if the stream is empty.
+             */
+            FileData(boost::shared_ptr<std::istream> source,
+                    std::streamsize size);
 
             /// \brief Type of a pointer to a FileData instance.
             typedef boost::shared_ptr<FileData> Ptr;
             /// \brief Type of a pointer to a const FileData instance.
             typedef boost::shared_ptr<FileData const> ConstPtr;
+
+            /** \brief Check if the data is held in memory.
+             *
+             * If false, the data is in a source stream or was read lazily,
+             * and value() is empty.
+             */
+            bool in_memory() const { return !external_; }
+
+            /// \brief Get the size of the data, wherever it is held.
+            std::streamsize data_size() const
+                { return external_ ? size_ : value_.size(); }
+
+            /** \brief Check if the data is read lazily.
+             *
+             * If true, reading the element skips over the data, recording
+             * its position and size.
+             */
+            bool lazy() const { return lazy_; }
+            /// \brief Set if the data is read lazily.
+            void lazy(bool lazy) { lazy_ = lazy; }
+
+            /** \brief Get the position of lazily-read data.
+             *
+             * This is the position of the start of the data in the stream
+             * the element was read from.
+             */
+            std::streampos data_pos() const { return start_; }
+
+            /** \brief Read part of the data.
+             *
+             * \param[in] input The stream the element was read from. It is
+             * only used if the data was read lazily.
+             * \param[in] pos The offset in the data to read from.
+             * \param[out] buffer The buffer to read into.
+             * \param[in] count The number of bytes to read.
+             * \return The number of bytes read, which is less than count if
+             * the end of the data is reached.
+             * \throw ReadError if the data cannot be read.
+             */
+            std::streamsize read_data(std::istream& input,
+                    std::streamsize pos, char* buffer,
+                    std::streamsize count) const;
+
+            /** \brief Copy the data to an output stream in chunks.
+             *
+             * \param[in] input The stream the element was read from. It is
+             * only used if the data was read lazily.
+             * \param[in] output The stream to copy the data to.
+             * \return The number of bytes copied.
+             * \throw ReadError if the data cannot be read.
+             * \throw WriteError if the data cannot be written.
+             */
+            std::streamsize copy_data(std::istream& input,
+                    std::ostream& output) const;
+
+        protected:
+            boost::shared_ptr<std::istream> source_;
+            std::streampos start_;
+            std::streamsize size_;
+            bool external_;
+            bool lazy_;
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /** \brief Element body loading.
+             *
+             * If the data is read lazily, only its position and size are
+             * recorded.
+             */
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+
+            /** \brief Element body writing.
+             *
+             * \throw NoAttachedData if the data was read lazily, as the
+             * stream it is in is not known.
+             */
+            virtual std::streamsize write_body(std::ostream& output);
     }; // class FileData
 
     /** \brief An attachment is a binary blob attached to a segment.
@@ -139,6 +248,14 @@ namespace tawara
             /// \brief Set the attached file's UID.
             void uid(uint64_t uid);
 
+            /** \brief Check if the file data is read lazily.
+             *
+             * See FileData::lazy().
+             */
+            bool lazy_data() const { return lazy_data_; }
+            /// \brief Set if the file data is read lazily.
+            void lazy_data(bool lazy_data) { lazy_data_ = lazy_data; }
+
             /// \brief Equality operator.
             friend bool operator==(AttachedFile const& lhs,
                     AttachedFile const& rhs);
@@ -149,6 +266,7 @@ namespace tawara
             StringElement mime_;
             FileData::Ptr data_;
             UIntElement uid_;
+            bool lazy_data_;
 
             /////////////////////
             // Element interface
@@ -207,6 +325,15 @@ namespace tawara
             /// \brief Constructor.
             Attachments();
 
+            /** \brief Check if the data of the attached files is read
+             * lazily.
+             *
+             * See FileData::lazy().
+             */
+            bool lazy_data() const { return lazy_data_; }
+            /// \brief Set if the data of the attached files is read lazily.
+            void lazy_data(bool lazy_data) { lazy_data_ = lazy_data; }
+
             /** \brief Get the attachment at the given position, with bounds
              * checking.
              *
@@ -310,6 +437,7 @@ namespace tawara
 
         protected:
             std::vector<AttachedFile> files_;
+            bool lazy_data_;
 
             /////////////////////
             // Element interface
@@ -42,6 +42,7 @@
 #include <boost/operators.hpp>
 #include <boost/shared_ptr.hpp>
 #include <stdint.h>
+#include <tawara/compression.h>
 #include <tawara/win_dll.h>
 #include <vector>
 
@@ -152,6 +153,56 @@ namespace tawara
             /// \brief Set the lacing type in use.
             virtual void lacing(LacingType lacing) = 0;
 
+            /** \brief Get the compression used for the block's frames.
+             *
+             * When a compressed block is written, its lacing header and all
+             * its frames are compressed together. If compression does not
+             * reduce their size, the block is written uncompressed. When a
+             * block is read, this is set to the compression that was used
+             * to store it.
+             *
+             * The frames are compressed when the block's size is first
+             * needed, and the result is kept until the block is changed
+             * through its own members. The data of a frame must not be
+             * changed in place, through a frame pointer held from before,
+             * after that.
+             *
+             * Blocks should use the compression declared by their track's
+             * TrackEntry.
+             */
+            virtual Compression compression() const = 0;
+            /** \brief Set the compression used for the block's frames.
+             *
+             * \exception UnsupportedCompression if the algorithm is not
+             * available.
+             */
+            virtual void compression(Compression compression) = 0;
+
+            /** \brief Get the dictionaries available for compression.
+             *
+             * If the map has a dictionary for the block's track, the block
+             * is compressed using it. When reading, a block compressed using
+             * a dictionary can only be decompressed if the map has the
+             * dictionary for its track, so the map must be set before the
+             * block is read. Clusters read from a segment are given the
+             * segment's dictionaries (see Segment::dictionaries()), and pass
+             * them on to their blocks.
+             */
+            virtual DictionaryMapPtr dictionaries() const = 0;
+            /// \brief Set the dictionaries available for compression.
+            virtual void dictionaries(DictionaryMapPtr dictionaries) = 0;
+
+            /** \brief Get the number of allocations made to hold the frames
+             * when the block was last read.
+             *
+             * This counts the frames, their data and any storage they
+             * share, along with the temporary buffers used to read them: the
+             * lace sizes and, for a compressed block, the compressed and
+             * decompressed data. It is 0 for a block that has not been
+             * read.
+             */
+            virtual std::size_t frame_allocs() const = 0;
+
             /** \brief Get the frame at the given position, with bounds
              * checking.
              *
@@ -238,7 +289,7 @@ namespace tawara
             /** \brief Add a frame to this block.
              *
              * When lacing is enabled, this will append an additional frame to
-             * the block to be stored.
+             * the block to be stored, up to max_count() frames.
              *
              * When lacing is not enabled, the value of frame_count() must be
              * zero or an error will occur.
@@ -252,7 +303,8 @@ namespace tawara
             /** \brief Resizes the frames storage.
              *
              * When lacing is not enabled, the new size must be 1 or an error
-             * will occur.
+             * will occur. When lacing is enabled, it must not be more than
+             * max_count().
              *
              * If the current size is less than the new size, additional empty
              * frames will be added. These should be filled with data before
@@ -117,6 +117,9 @@ namespace tawara
              * block.
              */
             std::vector<int16_t>& ref_blocks() { return ref_blocks_; }
+            /// \brief Get the reference block timecode array.
+            std::vector<int16_t> const& ref_blocks() const
+                { return ref_blocks_; }
 
             /** \brief Get the codec state for this block.
              *
@@ -181,6 +184,34 @@ namespace tawara
             virtual void lacing(LacingType lacing)
                 { block_.lacing(lacing); }
 
+            /** \brief Get the compression used for the block's frames.
+             *
+             * The lacing header and frames of a compressed block are
+             * compressed together. If compression does not reduce their
+             * size, the block is written uncompressed.
+             */
+            virtual Compression compression() const
+                { return block_.compression(); }
+            /// \brief Set the compression used for the block's frames.
+            virtual void compression(Compression compression)
+                { block_.compression(compression); }
+
+            /** \brief Get the dictionaries available for compression.
+             *
+             * A dictionary for the block's track is used to compress it.
+             */
+            virtual DictionaryMapPtr dictionaries() const
+                { return block_.dictionaries(); }
+            /// \brief Set the dictionaries available for compression.
+            virtual void dictionaries(DictionaryMapPtr dictionaries)
+                { block_.dictionaries(dictionaries); }
+
+            /** \brief Get the number of allocations made to hold the frames
+             * when the block was last read.
+             */
+            virtual std::size_t frame_allocs() const
+                { return block_.frame_allocs(); }
+
             /** \brief Get the frame at the given position, with bounds
              * checking.
              *
@@ -0,0 +1,157 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(TAWARA_BLOCK_HEADER_H_)
+#define TAWARA_BLOCK_HEADER_H_
+
+#include <ios>
+#include <stdint.h>
+#include <tawara/block.h>
+#include <tawara/el_ids.h>
+#include <tawara/win_dll.h>
+
+/// \addtogroup implementations Implementations
+/// @{
+
+namespace tawara
+{
+    /** \brief The header values of a SimpleBlock or BlockGroup element.
+     *
+     * This structure holds the values that can be found in a block without
+     * reading its frames: the element's location in the stream, the track
+     * number, the timecode and the flags byte. It is used to decide if a
+     * block is of interest before paying the cost of reading its frame data.
+     */
+    struct TAWARA_EXPORT BlockHeader
+    {
+        /// \brief The ID of the element (SimpleBlock or BlockGroup).
+        ids::ID id;
+        /// \brief The position of the element's ID in the stream.
+        std::streampos offset;
+        /// \brief The total size of the element, including its header.
+        std::streamsize size;
+        /// \brief The track number of the block.
+        uint64_t track_number;
+        /// \brief The timecode of the block, relative to its cluster.
+        int16_t timecode;
+        /** \brief The flags byte of the block.
+         *
+         * For a BlockGroup, these are the flags of the contained Block
+         * element, which do not include the keyframe and discardable bits.
+         */
+        uint8_t flags;
+
+        /// \brief Get the lacing type indicated by the flags.
+        Block::LacingType lacing() const;
+    }; // struct BlockHeader
+
+    /** \brief Read the header of a block element, skipping its frames.
+     *
+     * The read pointer must be placed at the ID of a SimpleBlock or
+     * BlockGroup element. Only the element header and the block header
+     * (track number, timecode and flags) are read. For a BlockGroup, the
+     * children before the Block child are skipped over. When this function
+     * returns, the read pointer is placed after the end of the element, ready
+     * to read the next element, without the frame data having been read.
+     *
+     * \param[in] input The input stream to read from.
+     * \return The header values of the block element.
+     * \exception InvalidChildID if the element is not a SimpleBlock or a
+     * BlockGroup.
+     * \exception MissingChild if a BlockGroup does not contain a Block.
+     * \exception BadBodySize if the element is too small to contain a block
+     * header.
+     * \exception ReadError if an error occurs reading data.
+     */
+    TAWARA_EXPORT BlockHeader read_block_header(std::istream& input);
+
+    /** \brief Copy bytes from one stream to another.
+     *
+     * The bytes are copied through a fixed-size buffer, so the amount of
+     * memory used does not depend on the number of bytes copied.
+     *
+     * \param[in] input The stream to read from, at the first byte to copy.
+     * \param[in] count The number of bytes to copy.
+     * \param[in] output The stream to write to.
+     * \return The number of bytes copied.
+     * \exception ReadError if fewer than count bytes could be read.
+     * \exception WriteError if an error occurs writing the bytes.
+     */
+    TAWARA_EXPORT std::streamsize copy_bytes(std::istream& input,
+            std::streamsize count, std::ostream& output);
+
+    /** \brief Copy an encoded block element between streams.
+     *
+     * The SimpleBlock or BlockGroup element described by the header is
+     * copied from the input stream to the output stream without decoding
+     * its frames. Only the track number and timecode in the block header,
+     * and the element sizes that depend on them, are re-encoded; all other
+     * bytes, including frames and the other children of a BlockGroup, are
+     * copied as they are. If the track number and timecode are unchanged,
+     * the element is copied as a single byte range.
+     *
+     * \param[in] input The stream to read the block from.
+     * \param[in] header The header of the block, as returned by
+     * read_block_header().
+     * \param[in] output The stream to write the block to, at the position to
+     * write it.
+     * \param[in] track_number The track number to give the copied block.
+     * \param[in] timecode The timecode to give the copied block.
+     * \return The size of the copied element.
+     * \exception MissingChild if a BlockGroup does not contain a Block.
+     * \exception ReadError if an error occurs reading data.
+     * \exception WriteError if an error occurs writing data.
+     */
+    TAWARA_EXPORT std::streamsize copy_block(std::istream& input,
+            BlockHeader const& header, std::ostream& output,
+            uint64_t track_number, int16_t timecode);
+
+    /** \brief Copy an encoded block element between streams unchanged.
+     *
+     * \see copy_block(std::istream&, BlockHeader const&, std::ostream&,
+     * uint64_t, int16_t)
+     */
+    TAWARA_EXPORT std::streamsize copy_block(std::istream& input,
+            BlockHeader const& header, std::ostream& output);
+}; // namespace tawara
+
+/// @}
+// group implementations
+
+#endif // TAWARA_BLOCK_HEADER_H_
+
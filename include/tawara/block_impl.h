@@ -62,6 +62,13 @@ namespace tawara
             BlockImpl(uint64_t track_number, int16_t timecode,
                     LacingType lacing=LACING_NONE);
 
+            /** \brief Copy constructor.
+             *
+             * As with assignment, the compressed form of the block's data is
+             * not copied; it is recalculated when next needed.
+             */
+            BlockImpl(BlockImpl const& other);
+
             /// \brief The block's track number.
             uint64_t track_number() const { return track_num_; }
             /// \brief Set the block's track number.
@@ -81,7 +88,27 @@ namespace tawara
             /// \brief Get the lacing type in use.
             LacingType lacing() const { return lacing_; }
             /// \brief Set the lacing type in use.
-            void lacing(LacingType lacing) { lacing_ = lacing; }
+            void lacing(LacingType lacing)
+                { lacing_ = lacing; packed_valid_ = false; }
+
+            /// \brief Get the compression used for the block's frames.
+            Compression compression() const { return compression_; }
+            /// \brief Set the compression used for the block's frames.
+            void compression(Compression compression);
+
+            /// \brief Get the dictionaries available for compression.
+            DictionaryMapPtr dictionaries() const { return dictionaries_; }
+            /// \brief Set the dictionaries available for compression.
+            void dictionaries(DictionaryMapPtr dictionaries)
+            {
+                dictionaries_ = dictionaries;
+                packed_valid_ = false;
+            }
+
+            /** \brief Get the number of allocations made to hold the frames
+             * when the block was last read.
+             */
+            std::size_t frame_allocs() const { return frame_allocs_; }
 
             /// \brief Replace the content of this block with another block.
             BlockImpl& operator=(BlockImpl const& other);
@@ -90,7 +117,7 @@ namespace tawara
              * checking.
              */
             value_type& at(size_type pos)
-                { return frames_.at(pos); }
+                { packed_valid_ = false; return frames_.at(pos); }
             /** \brief Get the frame at the given position, with bounds
              * checking.
              */
@@ -101,7 +128,7 @@ namespace tawara
              * performed.
              */
             value_type& operator[](size_type pos)
-                { return frames_[pos]; }
+                { packed_valid_ = false; return frames_[pos]; }
             /** \brief Get a reference to a frame. No bounds checking is
              * performed.
              */
@@ -109,21 +136,25 @@ namespace tawara
                 { return frames_[pos]; }
 
             /// \brief Get an iterator to the first frame.
-            iterator begin() { return frames_.begin(); }
+            iterator begin()
+                { packed_valid_ = false; return frames_.begin(); }
             /// \brief Get an iterator to the first frame.
             const_iterator begin() const { return frames_.begin(); }
             /// \brief Get an iterator to the position past the last frame.
-            iterator end() { return frames_.end(); }
+            iterator end()
+                { packed_valid_ = false; return frames_.end(); }
             /// \brief Get an iterator to the position past the last frame.
             const_iterator end() const { return frames_.end(); }
             /// \brief Get a reverse iterator to the last frame.
-            reverse_iterator rbegin() { return frames_.rbegin(); }
+            reverse_iterator rbegin()
+                { packed_valid_ = false; return frames_.rbegin(); }
             /// \brief Get a reverse iterator to the last frame.
             const_reverse_iterator rbegin() const { return frames_.rbegin(); }
             /** \brief Get a reverse iterator to the position before the first
              * frame.
              */
-            reverse_iterator rend() { return frames_.rend(); }
+            reverse_iterator rend()
+                { packed_valid_ = false; return frames_.rend(); }
             /** \brief Get a reverse iterator to the position before the first
              * frame.
              */
@@ -137,14 +168,14 @@ namespace tawara
             size_type max_count() const;
 
             /// \brief Remove all frames.
-            void clear() { frames_.clear(); }
+            void clear() { frames_.clear(); packed_valid_ = false; }
 
             /// \brief Erase the frame at the specified iterator.
             void erase(iterator position)
-                { frames_.erase(position); }
+                { frames_.erase(position); packed_valid_ = false; }
             /// \brief Erase a range of frames.
             void erase(iterator first, iterator last)
-                { frames_.erase(first, last); }
+                { frames_.erase(first, last); packed_valid_ = false; }
 
             /// \brief Add a frame to this block.
             void push_back(value_type const& value);
@@ -214,7 +245,63 @@ namespace tawara
             int16_t timecode_;
             bool invisible_;
             LacingType lacing_;
+            Compression compression_;
+            DictionaryMapPtr dictionaries_;
             std::vector<value_type> frames_;
+            // The compressed lacing header and frames, kept between
+            // calculating the size and writing. Empty if the block is
+            // stored uncompressed. Every non-const member that could change
+            // the frames or how they are packed clears packed_valid_.
+            mutable std::vector<char> packed_;
+            mutable bool packed_valid_;
+            // Allocations made by the last read, counted where they are made
+            std::size_t frame_allocs_;
+
+            /// \brief Get the dictionary for this block's track, if any.
+            CompressionDictionary const* dictionary() const;
+            /** \brief Get the compressed form of the block's data.
+             *
+             * The lacing header and frames are compressed if compression is
+             * in use. The result is cached until the frames, the lacing, the
+             * compression or the dictionaries are changed through this
+             * block. Changes made to a frame's data through a frame pointer
+             * held from earlier are not seen while the cache is valid.
+             *
+             * \return The algorithm, uncompressed size and compressed data,
+             * or an empty buffer if the block is to be stored uncompressed.
+             */
+            std::vector<char> const& packed() const;
+            /// \brief Get the size of the lacing header and frames.
+            std::streamsize payload_size() const;
+            /** \brief Write the lacing header and frames.
+             *
+             * \param[in] output The output byte stream to write data to.
+             * \return The number of bytes written.
+             * \exception WriteError if an error occurs writing data.
+             */
+            std::streamsize write_payload(std::ostream& output) const;
+            /** \brief Read the lacing header and frames.
+             *
+             * \param[in] input The input byte stream to read from.
+             * \param[in] size The number of bytes available.
+             * \return The number of bytes read.
+             */
+            std::streamsize read_payload(std::istream& input,
+                    std::streamsize size);
+            /** \brief Read and decompress compressed frames.
+             *
+             * \param[in] input The input byte stream to read from.
+             * \param[in] size The number of bytes available.
+             * \return The number of bytes read.
+             * \exception UnsupportedCompression if the compression algorithm
+             * is not available.
+             * \exception BadCompressedData if the data cannot be
+             * decompressed.
+             * \exception MissingDictionary if the frames were compressed
+             * using a dictionary that is not available.
+             */
+            std::streamsize read_compressed_frames(std::istream& input,
+                    std::streamsize size);
 
             /// \brief Checks that the block is in a good condition to write.
             void validate() const;
@@ -251,6 +338,22 @@ namespace tawara
              */
             std::streamsize read_fixed_frames(std::istream& input,
                     std::streamsize size, unsigned int count);
+
+            /** \brief Reads a run of frames of known sizes.
+             *
+             * An unlaced frame is read straight into its own storage. A laced
+             * run is read with a single read into one buffer, which is then
+             * split into the frames. The frame objects of the run share one
+             * allocation, with each frame pointer aliasing its element of
+             * it, so a run of n frames costs n + 3 allocations rather than
+             * 2n.
+             *
+             * \param[in] input The input byte stream to read from.
+             * \param[in] sizes The size of each frame, in stored order.
+             * \exception ReadError if an error occurs reading data.
+             */
+            void read_frame_run(std::istream& input,
+                    std::vector<std::streamsize> const& sizes);
     }; // class BlockImpl
 
     /// \brief Equality operator for BlockImpl objects.
@@ -0,0 +1,211 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_CHAPTER_INDEX_H_)
+#define TAWARA_CHAPTER_INDEX_H_
+
+#include <boost/unordered_map.hpp>
+#include <iostream>
+#include <string>
+#include <tawara/chapters.h>
+#include <tawara/cues.h>
+#include <tawara/segment.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief A lookup table of the chapters of a segment.
+     *
+     * Finding a chapter in a Chapters element means walking its editions
+     * and nested chapters. A ChapterIndex flattens all chapters into a list
+     * sorted by start time once, so chapters can be found by name in
+     * constant time and by time in logarithmic time.
+     *
+     * If the segment's Cues are given, the position of the cluster to start
+     * reading from is resolved for each chapter when the index is built, so
+     * jumping to a chapter needs no further searching:
+     *
+     * \code
+     * ChapterIndex::Entry const* fault(index.find_name("fault"));
+     * Segment::FileClusterIterator cluster(&segment, stream,
+     *     segment.to_stream_offset(fault->cluster_pos));
+     * \endcode
+     *
+     * The cluster is the one of the last cue point at or before the start of
+     * the chapter, so it may hold some blocks from before the chapter.
+     */
+    class TAWARA_EXPORT ChapterIndex
+    {
+        public:
+            /// \brief A chapter and the values derived from it.
+            struct Entry
+            {
+                /// \brief The chapter UID.
+                uint64_t uid;
+                /// \brief The UID of the edition holding the chapter.
+                uint64_t edition_uid;
+                /// \brief The name of the chapter (see ChapterAtom::name()).
+                std::string name;
+                /// \brief The start time of the chapter, in nanoseconds.
+                uint64_t start;
+                /// \brief If the chapter has an end time.
+                bool has_end;
+                /// \brief The end time of the chapter, in nanoseconds.
+                uint64_t end;
+                /// \brief If the chapter is hidden.
+                bool hidden;
+                /// \brief If the chapter is enabled.
+                bool enabled;
+                /// \brief If the position of the chapter's cluster is known.
+                bool has_cluster;
+                /** \brief The segment offset of the cluster to start reading
+                 * the chapter from.
+                 */
+                uint64_t cluster_pos;
+            }; // struct Entry
+
+            /// \brief The size type of this container.
+            typedef std::vector<Entry>::size_type size_type;
+            /// \brief The constant random access iterator type.
+            typedef std::vector<Entry>::const_iterator const_iterator;
+
+            /** \brief Construct an empty index.
+             *
+             * The index can be filled by assigning another index to it.
+             */
+            ChapterIndex();
+
+            /** \brief Construct an index from a Chapters element.
+             *
+             * \param[in] chapters The chapters to put in the index.
+             * \param[in] cues The cues used to find the cluster of each
+             * chapter. If empty, no cluster positions are resolved.
+             * \param[in] timecode_scale The timecode scale of the segment,
+             * in nanoseconds.
+             */
+            ChapterIndex(Chapters const& chapters, Cues const& cues=Cues(),
+                    uint64_t timecode_scale=1000000);
+
+            /** \brief Construct an index from the chapters of a segment.
+             *
+             * The Chapters and Cues elements are read from the stream using
+             * the segment's index. If the segment has no chapters, the index
+             * is empty.
+             *
+             * \param[in] stream The stream holding the segment. The read
+             * position is restored afterwards.
+             * \param[in] segment The segment, which must have been read.
+             */
+            ChapterIndex(std::istream& stream, Segment const& segment);
+
+            /** \brief Get the chapter with a name.
+             *
+             * Every display string of each chapter is a name for it. If more
+             * than one chapter has the name, the one that starts first is
+             * found.
+             *
+             * \return The entry, or 0 if there is no chapter with that name.
+             */
+            Entry const* find_name(std::string const& name) const
+                { return find_in(names_, name); }
+
+            /** \brief Get the chapter with a UID.
+             *
+             * \return The entry, or 0 if there is no chapter with that UID.
+             */
+            Entry const* find_uid(uint64_t uid) const
+                { return find_in(uids_, uid); }
+
+            /** \brief Get the chapter covering a time.
+             *
+             * Chapters without an end time last until the end of the
+             * segment. If more than one chapter covers the time, such as
+             * nested chapters, the one that starts last is found.
+             *
+             * \param[in] time The time, in nanoseconds.
+             * \return The entry, or 0 if no chapter covers the time.
+             */
+            Entry const* find_time(uint64_t time) const;
+
+            /// \brief Get an iterator to the first entry, in start order.
+            const_iterator begin() const { return entries_.begin(); }
+            /// \brief Get an iterator to the position past the last entry.
+            const_iterator end() const { return entries_.end(); }
+            /// \brief Check if there are no entries.
+            bool empty() const { return entries_.empty(); }
+            /// \brief Get the number of entries.
+            size_type count() const { return entries_.size(); }
+
+        protected:
+            /// \brief The entries, sorted by start time.
+            std::vector<Entry> entries_;
+            /// \brief The index in entries_ of each UID.
+            boost::unordered_map<uint64_t, size_type> uids_;
+            /// \brief The index in entries_ of each name.
+            boost::unordered_map<std::string, size_type> names_;
+
+            /// \brief Fills the index.
+            void build(Chapters const& chapters, Cues const& cues,
+                    uint64_t timecode_scale);
+
+            /// \brief Adds a chapter and its nested chapters to the entries.
+            void add(ChapterAtom const& atom, uint64_t edition_uid,
+                    std::vector<std::vector<std::string> >& names);
+
+            /// \brief Looks up a key in one of the hash tables.
+            template<typename Key>
+            Entry const* find_in(boost::unordered_map<Key, size_type> const&
+                    table, Key const& key) const
+            {
+                typename boost::unordered_map<Key, size_type>::const_iterator
+                    it(table.find(key));
+                return it == table.end() ? 0 : &entries_[it->second];
+            }
+    }; // class ChapterIndex
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_CHAPTER_INDEX_H_
+
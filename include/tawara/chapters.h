@@ -0,0 +1,502 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_CHAPTERS_H_)
+#define TAWARA_CHAPTERS_H_
+
+#include <boost/operators.hpp>
+#include <string>
+#include <tawara/master_element.h>
+#include <tawara/string_element.h>
+#include <tawara/uint_element.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup elements Elements
+/// @{
+
+namespace tawara
+{
+    /** \brief How a chapter is displayed.
+     *
+     * A chapter may have several displays, each giving its name in one or
+     * more languages.
+     */
+    class TAWARA_EXPORT ChapterDisplay : public MasterElement,
+            public boost::equality_comparable<ChapterDisplay>
+    {
+        public:
+            /// \brief Constructor.
+            ChapterDisplay();
+
+            /** \brief Constructor.
+             *
+             * \param[in] string The name of the chapter.
+             * \param[in] language The language of the name, in ISO-639-2
+             * form.
+             */
+            ChapterDisplay(std::string const& string,
+                    std::string const& language="eng");
+
+            /// \brief Get the name of the chapter.
+            std::string string() const { return string_; }
+            /// \brief Set the name of the chapter.
+            void string(std::string const& string) { string_ = string; }
+
+            /** \brief Get the languages of the name.
+             *
+             * The languages are in ISO-639-2 form. The default is "eng".
+             */
+            std::vector<std::string> const& languages() const
+                { return languages_; }
+            /// \brief Set the languages of the name.
+            void languages(std::vector<std::string> const& languages)
+                { languages_ = languages; }
+
+            /** \brief Get the countries of the name.
+             *
+             * The countries are given as Internet domain codes.
+             */
+            std::vector<std::string> const& countries() const
+                { return countries_; }
+            /// \brief Set the countries of the name.
+            void countries(std::vector<std::string> const& countries)
+                { countries_ = countries; }
+
+            /// \brief Equality operator.
+            friend bool operator==(ChapterDisplay const& lhs,
+                    ChapterDisplay const& rhs);
+
+        protected:
+            StringElement string_;
+            std::vector<std::string> languages_;
+            std::vector<std::string> countries_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+    }; // class ChapterDisplay
+
+    /// \brief Equality operator for the ChapterDisplay element.
+    bool operator==(ChapterDisplay const& lhs, ChapterDisplay const& rhs);
+
+
+    /** \brief A single chapter.
+     *
+     * A chapter is a named index point in the segment, covering the time
+     * from its start up to its end. Chapter times are absolute, in
+     * nanoseconds, like the times given to Segment::clusters_at_time().
+     * Chapters may be nested to divide a chapter into smaller ones.
+     *
+     * The ChapterSegmentUID element is not supported and is skipped when
+     * read.
+     */
+    class TAWARA_EXPORT ChapterAtom : public MasterElement,
+            public boost::equality_comparable<ChapterAtom>
+    {
+        public:
+            /// \brief Constructor.
+            ChapterAtom();
+
+            /** \brief Constructor.
+             *
+             * \param[in] uid A unique ID for the chapter. Must not be zero.
+             * \param[in] start The start time of the chapter.
+             * \param[in] name The name of the chapter. If not empty, a
+             * ChapterDisplay is added for it.
+             * \throw ValueOutOfRange if the UID is zero.
+             */
+            ChapterAtom(uint64_t uid, uint64_t start,
+                    std::string const& name="");
+
+            /// \brief Get the chapter's UID.
+            uint64_t uid() const { return uid_; }
+            /** \brief Set the chapter's UID.
+             *
+             * \throw ValueOutOfRange if the UID is zero.
+             */
+            void uid(uint64_t uid);
+
+            /// \brief Get the start time of the chapter.
+            uint64_t start() const { return start_; }
+            /// \brief Set the start time of the chapter.
+            void start(uint64_t start) { start_ = start; }
+
+            /// \brief Check if the chapter has an end time.
+            bool has_end() const { return has_end_; }
+            /** \brief Get the end time of the chapter.
+             *
+             * The end time itself is not part of the chapter.
+             */
+            uint64_t end() const { return end_; }
+            /// \brief Set the end time of the chapter.
+            void end(uint64_t end) { end_ = end; has_end_ = true; }
+            /// \brief Remove the end time of the chapter.
+            void clear_end() { end_ = 0; has_end_ = false; }
+
+            /// \brief Check if the chapter is hidden from the user.
+            bool hidden() const { return hidden_; }
+            /// \brief Set if the chapter is hidden from the user.
+            void hidden(bool hidden) { hidden_ = hidden; }
+
+            /** \brief Check if the chapter is enabled.
+             *
+             * The data covered by a disabled chapter should be skipped
+             * during playback.
+             */
+            bool enabled() const { return enabled_; }
+            /// \brief Set if the chapter is enabled.
+            void enabled(bool enabled) { enabled_ = enabled; }
+
+            /** \brief Get the UIDs of the tracks the chapter applies to.
+             *
+             * If empty, the chapter applies to all tracks.
+             */
+            std::vector<uint64_t> const& tracks() const { return tracks_; }
+            /// \brief Set the UIDs of the tracks the chapter applies to.
+            void tracks(std::vector<uint64_t> const& tracks)
+                { tracks_ = tracks; }
+
+            /// \brief Get the displays of the chapter.
+            std::vector<ChapterDisplay>& displays() { return displays_; }
+            /// \brief Get the displays of the chapter.
+            std::vector<ChapterDisplay> const& displays() const
+                { return displays_; }
+
+            /** \brief Get the name of the chapter.
+             *
+             * This is the string of the first display, or an empty string if
+             * there are no displays.
+             */
+            std::string name() const;
+
+            /// \brief Get the nested chapters.
+            std::vector<ChapterAtom>& children() { return children_; }
+            /// \brief Get the nested chapters.
+            std::vector<ChapterAtom> const& children() const
+                { return children_; }
+
+            /// \brief Equality operator.
+            friend bool operator==(ChapterAtom const& lhs,
+                    ChapterAtom const& rhs);
+
+        protected:
+            UIntElement uid_;
+            UIntElement start_;
+            UIntElement end_;
+            bool has_end_;
+            UIntElement hidden_;
+            UIntElement enabled_;
+            std::vector<uint64_t> tracks_;
+            std::vector<ChapterDisplay> displays_;
+            std::vector<ChapterAtom> children_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+
+            /// \brief Get the size of the ChapterTrack child.
+            std::streamsize tracks_size() const;
+
+            /// \brief Reset the values to their defaults
+            void reset();
+    }; // class ChapterAtom
+
+    /// \brief Equality operator for the ChapterAtom element.
+    bool operator==(ChapterAtom const& lhs, ChapterAtom const& rhs);
+
+
+    /** \brief An edition is a set of chapters.
+     *
+     * Each edition gives one way of playing back the segment, as the
+     * sequence of its chapters.
+     */
+    class TAWARA_EXPORT EditionEntry : public MasterElement,
+            public boost::equality_comparable<EditionEntry>
+    {
+        public:
+            /// \brief Constructor.
+            EditionEntry();
+
+            /** \brief Get the edition's UID.
+             *
+             * Zero means the edition has no UID.
+             */
+            uint64_t uid() const { return uid_; }
+            /// \brief Set the edition's UID.
+            void uid(uint64_t uid) { uid_ = uid; }
+
+            /// \brief Check if the edition is hidden from the user.
+            bool hidden() const { return hidden_; }
+            /// \brief Set if the edition is hidden from the user.
+            void hidden(bool hidden) { hidden_ = hidden; }
+
+            /// \brief Check if this is the default edition.
+            bool default_edition() const { return default_; }
+            /// \brief Set if this is the default edition.
+            void default_edition(bool default_edition)
+                { default_ = default_edition; }
+
+            /// \brief Check if the playback order of the chapters is fixed.
+            bool ordered() const { return ordered_; }
+            /// \brief Set if the playback order of the chapters is fixed.
+            void ordered(bool ordered) { ordered_ = ordered; }
+
+            /** \brief Get the chapters of the edition.
+             *
+             * An edition must have at least one chapter. If this is empty
+             * when write() is called, an error will occur.
+             */
+            std::vector<ChapterAtom>& atoms() { return atoms_; }
+            /// \brief Get the chapters of the edition.
+            std::vector<ChapterAtom> const& atoms() const { return atoms_; }
+
+            /// \brief Equality operator.
+            friend bool operator==(EditionEntry const& lhs,
+                    EditionEntry const& rhs);
+
+        protected:
+            UIntElement uid_;
+            UIntElement hidden_;
+            UIntElement default_;
+            UIntElement ordered_;
+            std::vector<ChapterAtom> atoms_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+    }; // class EditionEntry
+
+    /// \brief Equality operator for the EditionEntry element.
+    bool operator==(EditionEntry const& lhs, EditionEntry const& rhs);
+
+
+    /** \brief The Chapters element stores named index points.
+     *
+     * Tawara uses a simplified version of the Matroska chapters: each
+     * chapter is simply a named span of time in the segment, with no
+     * processing attached. The chapters are grouped into editions. See
+     * ChapterIndex for finding chapters quickly by name or time.
+     */
+    class TAWARA_EXPORT Chapters : public MasterElement,
+            public boost::equality_comparable<Chapters>
+    {
+        public:
+            /// \brief The value type of this container.
+            typedef std::vector<EditionEntry>::value_type value_type;
+            /// \brief The size type of this container.
+            typedef std::vector<EditionEntry>::size_type size_type;
+            /// \brief The reference type.
+            typedef std::vector<EditionEntry>::reference reference;
+            /// \brief The constant reference type.
+            typedef std::vector<EditionEntry>::const_reference
+                const_reference;
+            /// \brief The random access iterator type.
+            typedef std::vector<EditionEntry>::iterator iterator;
+            /// \brief The constant random access iterator type.
+            typedef std::vector<EditionEntry>::const_iterator const_iterator;
+            /// \brief The reversed random access iterator type.
+            typedef std::vector<EditionEntry>::reverse_iterator
+                reverse_iterator;
+            /// \brief The constant reversed random access iterator type.
+            typedef std::vector<EditionEntry>::const_reverse_iterator
+                const_reverse_iterator;
+
+            /// \brief Constructor.
+            Chapters();
+
+            /** \brief Get the edition at the given position, with bounds
+             * checking.
+             *
+             * \return A reference to the specified edition.
+             * \throw std::out_of_range if the position is invalid.
+             */
+            virtual value_type& at(size_type pos)
+                { return editions_.at(pos); }
+            /** \brief Get the edition at the given position, with bounds
+             * checking.
+             *
+             * \return A reference to the specified edition.
+             * \throw std::out_of_range if the position is invalid.
+             */
+            virtual value_type const& at(size_type pos) const
+                { return editions_.at(pos); }
+
+            /** \brief Get a reference to an edition. No bounds checking is
+             * performed.
+             *
+             * \return A reference to the specified edition.
+             */
+            virtual value_type& operator[](size_type pos)
+                { return editions_[pos]; }
+            /** \brief Get a reference to an edition. No bounds checking is
+             * performed.
+             *
+             * \return A reference to the specified edition.
+             */
+            virtual value_type const& operator[](size_type pos) const
+                { return editions_[pos]; }
+
+            /// \brief Get an iterator to the first edition.
+            virtual iterator begin() { return editions_.begin(); }
+            /// \brief Get an iterator to the first edition.
+            virtual const_iterator begin() const { return editions_.begin(); }
+            /// \brief Get an iterator to the position past the last edition.
+            virtual iterator end() { return editions_.end(); }
+            /// \brief Get an iterator to the position past the last edition.
+            virtual const_iterator end() const { return editions_.end(); }
+            /// \brief Get a reverse iterator to the last edition.
+            virtual reverse_iterator rbegin() { return editions_.rbegin(); }
+            /// \brief Get a reverse iterator to the last edition.
+            virtual const_reverse_iterator rbegin() const
+                { return editions_.rbegin(); }
+            /** \brief Get a reverse iterator to the position before the first
+             * edition.
+             */
+            virtual reverse_iterator rend() { return editions_.rend(); }
+            /** \brief Get a reverse iterator to the position before the first
+             * edition.
+             */
+            virtual const_reverse_iterator rend() const
+                { return editions_.rend(); }
+
+            /** \brief Check if there are no editions.
+             *
+             * An empty Chapters element may not occur in a Tawara file. If
+             * this returns true, an error will occur when write() is called.
+             */
+            virtual bool empty() const { return editions_.empty(); }
+            /// \brief Get the number of editions.
+            virtual size_type count() const { return editions_.size(); }
+            /// \brief Get the maximum number of editions.
+            virtual size_type max_count() const
+                { return editions_.max_size(); }
+
+            /// \brief Remove all editions.
+            virtual void clear() { editions_.clear(); }
+
+            /** \brief Erase the edition at the specified iterator.
+             *
+             * \param[in] position The position to erase at.
+             */
+            virtual void erase(iterator position)
+                { editions_.erase(position); }
+            /** \brief Erase a range of editions.
+             *
+             * \param[in] first The start of the range.
+             * \param[in] last The end of the range.
+             */
+            virtual void erase(iterator first, iterator last)
+                { editions_.erase(first, last); }
+
+            /// \brief Add an edition.
+            virtual void push_back(value_type const& value)
+                { editions_.push_back(value); }
+
+            /// \brief Resizes the editions storage.
+            virtual void resize(size_type count) { editions_.resize(count); }
+
+            /** \brief Swaps the contents of this Chapters element with
+             * another.
+             *
+             * \param[in] other The other Chapters element
+             */
+            virtual void swap(Chapters& other)
+                { editions_.swap(other.editions_); }
+
+            /// \brief Equality operator.
+            friend bool operator==(Chapters const& lhs, Chapters const& rhs);
+
+        protected:
+            std::vector<EditionEntry> editions_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+    }; // class Chapters
+
+    /// \brief Equality operator for the Chapters element.
+    bool operator==(Chapters const& lhs, Chapters const& rhs);
+}; // namespace tawara
+
+/// @}
+// group elements
+
+#endif // TAWARA_CHAPTERS_H_
+
@@ -40,6 +40,8 @@
 #define TAWARA_CLUSTER_H_
 
 #include <tawara/block_element.h>
+#include <tawara/cluster_summary.h>
+#include <tawara/io_stats.h>
 #include <tawara/master_element.h>
 #include <tawara/uint_element.h>
 #include <tawara/win_dll.h>
@@ -237,6 +239,12 @@ namespace tawara
              * read from a byte stream.
              */
             uint64_t position() const;
+            /** \brief Check if the cluster stores its position.
+             *
+             * The Position element is only present in clusters read from a
+             * byte stream that contained one.
+             */
+            bool has_position() const { return position_ != 0; }
 
             /** \brief Get the size of the previous cluster in the segment.
              *
@@ -250,6 +258,53 @@ namespace tawara
             /// \brief Set the size of the previous cluster in the segment.
             void previous_size(uint64_t size) { prev_size_ = size; }
 
+            /** \brief Get the space reserved for the cluster summary.
+             *
+             * If this is non-zero, space of this many bytes is reserved
+             * after the cluster's meta-data when the cluster is written. When
+             * the cluster is finalised, a ClusterSummary element describing
+             * the cluster's blocks is written into this space, provided it
+             * fits. Readers can use the summary to skip clusters that hold no
+             * blocks of interest. The space must be at least 2 bytes.
+             *
+             * The default is zero, meaning no summary is written.
+             */
+            std::streamsize summary_pad() const { return summary_pad_; }
+            /// \brief Set the space reserved for the cluster summary.
+            void summary_pad(std::streamsize summary_pad)
+                { summary_pad_ = summary_pad; }
+
+            /// \brief Check if a cluster summary was read with the cluster.
+            bool has_summary() const { return has_summary_; }
+            /** \brief Get the cluster summary.
+             *
+             * For a cluster that has been read, this is only valid if
+             * has_summary() is true.
+             */
+            ClusterSummary const& summary() const { return summary_; }
+
+            /** \brief Get the dictionaries given to blocks read from this
+             * cluster.
+             *
+             * These must be set before the cluster is read if any of its
+             * blocks were compressed using a dictionary (see
+             * Block::dictionaries()).
+             */
+            DictionaryMapPtr dictionaries() const { return dictionaries_; }
+            /// \brief Set the dictionaries for blocks read from this cluster.
+            void dictionaries(DictionaryMapPtr dictionaries)
+                { dictionaries_ = dictionaries; }
+
+            /** \brief Get the statistics updated by this cluster.
+             *
+             * If set, reading and writing the cluster and its blocks is
+             * counted in these statistics (see IOStats). By default, no
+             * statistics are kept.
+             */
+            IOStats::Ptr stats() const { return stats_; }
+            /// \brief Set the statistics updated by this cluster.
+            void stats(IOStats::Ptr stats) { stats_ = stats; }
+
             /// \brief Get the total size of the element.
             std::streamsize size() const;
 
@@ -261,7 +316,16 @@ namespace tawara
              * element has the same UID.
              */
             std::streamsize read(std::istream& input)
-                { return Element::read(input); }
+                { return MasterElement::read(input); }
+
+            /** \brief Element writing.
+             *
+             * Clusters are written incrementally, so if a CRC-32 child is
+             * used, space is reserved for it and its value is written when
+             * the cluster is finalised.
+             */
+            std::streamsize write(std::ostream& output)
+                { return Element::write(output); }
 
             /** \brief Finalise writing of the cluster.
              *
@@ -280,7 +344,14 @@ namespace tawara
             std::vector<SilentTrackNumber> silent_tracks_;
             UIntElement position_;
             UIntElement prev_size_;
+            ClusterSummary summary_;
+            bool has_summary_;
+            std::streamsize summary_pad_;
+            std::streampos summary_pos_;
+            std::streampos crc_pos_;
             bool writing_;
+            DictionaryMapPtr dictionaries_;
+            IOStats::Ptr stats_;
 
             /// \brief Get the size of the meta-data portion of the body of
             //this element.
@@ -333,6 +404,29 @@ namespace tawara
              */
             std::streamsize read_silent_tracks(std::istream& input);
 
+            /** \brief Write the cluster summary into its reserved space.
+             *
+             * The summary is written over the Void element reserved when the
+             * cluster was written, and the remaining space is padded with a
+             * new Void element. If the summary does not fit, the reserved
+             * space is left as it is. The write position is preserved.
+             *
+             * \return True if the summary was written.
+             */
+            bool write_summary(std::ostream& output);
+
+            /** \brief Write the CRC-32 into its reserved space.
+             *
+             * The CRC is calculated by reading the cluster's data back from
+             * the stream, which must therefore also be readable. The write
+             * position is preserved. Nothing is done if crc() is false.
+             *
+             * \param[in] output The stream the cluster is being written to.
+             * \param[in] end The position of the end of the cluster.
+             * \throw ReadError if the stream cannot be read.
+             */
+            void write_cluster_crc(std::ostream& output, std::streampos end);
+
             /// \brief Reset the cluster's members to default values.
             virtual void reset();
     }; // class Cluster
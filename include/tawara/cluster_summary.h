@@ -0,0 +1,270 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(TAWARA_CLUSTER_SUMMARY_H_)
+#define TAWARA_CLUSTER_SUMMARY_H_
+
+#include <boost/operators.hpp>
+#include <map>
+#include <set>
+#include <tawara/block.h>
+#include <tawara/int_element.h>
+#include <tawara/master_element.h>
+#include <tawara/uint_element.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup elements Elements
+/// @{
+
+namespace tawara
+{
+    /** \brief Summary of the blocks of a single track in a cluster.
+     *
+     * This element records how many blocks of a track are stored in a
+     * cluster, and the range of their timecodes (relative to the cluster's
+     * timecode).
+     */
+    class TAWARA_EXPORT TrackSummary : public MasterElement,
+            public boost::equality_comparable<TrackSummary>
+    {
+        public:
+            /** \brief Constructor.
+             *
+             * \param[in] track_number The number of the track summarised.
+             * \exception ValueOutOfRange if the track number is zero.
+             */
+            TrackSummary(uint64_t track_number=1);
+
+            /// \brief Get the number of the track summarised.
+            uint64_t track_number() const { return track_number_; }
+            /** \brief Set the number of the track summarised.
+             *
+             * \exception ValueOutOfRange if the track number is zero.
+             */
+            void track_number(uint64_t track_number);
+
+            /// \brief Get the number of blocks of the track in the cluster.
+            uint64_t block_count() const { return block_count_; }
+            /// \brief Get the lowest block timecode of the track.
+            int16_t min_timecode() const { return min_tc_; }
+            /// \brief Get the highest block timecode of the track.
+            int16_t max_timecode() const { return max_tc_; }
+
+            /** \brief Add a block's timecode to the summary.
+             *
+             * The block count is incremented and the timecode range is
+             * expanded to include the timecode.
+             */
+            void add(int16_t timecode);
+
+            /** \brief Check if any block timecode may fall in a range.
+             *
+             * \param[in] first The start of the range (inclusive).
+             * \param[in] last The end of the range (inclusive).
+             */
+            bool overlaps(int16_t first, int16_t last) const;
+
+            /** \brief Check if every block timecode falls in a range.
+             *
+             * \param[in] first The start of the range (inclusive).
+             * \param[in] last The end of the range (inclusive).
+             * \return False if there are no blocks.
+             */
+            bool within(int16_t first, int16_t last) const;
+
+            /// \brief Equality operator.
+            friend bool operator==(TrackSummary const& lhs,
+                    TrackSummary const& rhs);
+
+        protected:
+            UIntElement track_number_;
+            UIntElement block_count_;
+            IntElement min_tc_;
+            IntElement max_tc_;
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+
+            /// \brief Reset the values to their defaults.
+            void reset();
+    }; // class TrackSummary
+
+    /// \brief Equality operator for the TrackSummary element.
+    bool operator==(TrackSummary const& lhs, TrackSummary const& rhs);
+
+
+    /** \brief Summary of the contents of a cluster.
+     *
+     * The ClusterSummary element is an optional child of a Cluster. It
+     * records which tracks have blocks in the cluster, using a bitmap of
+     * track numbers, and a TrackSummary for each of those tracks giving the
+     * number of blocks and their timecode range. Readers can use it to decide
+     * if a cluster holds any blocks of interest without reading the blocks.
+     *
+     * The bitmap holds one bit for each track number, starting from track 1
+     * in the most significant bit of the first byte. It is not written if
+     * the highest track number is greater than max_map_track().
+     */
+    class TAWARA_EXPORT ClusterSummary : public MasterElement,
+            public boost::equality_comparable<ClusterSummary>
+    {
+        protected:
+            /// \brief The type of the internal storage.
+            typedef std::map<uint64_t, TrackSummary> storage_type_;
+
+        public:
+            /// \brief The key type (Key) of this container.
+            typedef storage_type_::key_type key_type;
+            /// \brief The mapped type (T) of this container.
+            typedef storage_type_::mapped_type mapped_type;
+            /// \brief The value type of this container.
+            typedef storage_type_::value_type value_type;
+            /// \brief The size type of this container.
+            typedef storage_type_::size_type size_type;
+            /// \brief The constant random access iterator type.
+            typedef storage_type_::const_iterator const_iterator;
+
+            /// \brief Constructor.
+            ClusterSummary();
+
+            /// \brief The highest track number stored in the track bitmap.
+            static uint64_t max_map_track() { return 2048; }
+
+            /// \brief Get an iterator to the first TrackSummary.
+            const_iterator begin() const { return tracks_.begin(); }
+            /// \brief Get an iterator to the position past the last
+            /// TrackSummary.
+            const_iterator end() const { return tracks_.end(); }
+            /// \brief Check if there are no tracks summarised.
+            bool empty() const { return tracks_.empty() && map_.empty(); }
+            /// \brief Get the number of tracks summarised.
+            size_type count() const { return tracks_.size(); }
+            /// \brief Remove all summary information.
+            void clear();
+            /// \brief Find the summary for a track.
+            const_iterator find(key_type const& track_number) const
+                { return tracks_.find(track_number); }
+
+            /** \brief Add a block to the summary.
+             *
+             * The block's track is marked as present and the track's
+             * summary is updated with the block's timecode.
+             */
+            void add(Block const& block)
+                { add(block.track_number(), block.timecode()); }
+
+            /** \brief Add a block to the summary by its track number and
+             * timecode.
+             */
+            void add(uint64_t track_number, int16_t timecode);
+
+            /** \brief Check if a track has any blocks in the cluster.
+             *
+             * The track bitmap is used if present, otherwise the track
+             * summaries are used.
+             */
+            bool has_track(uint64_t track_number) const;
+
+            /** \brief Check if the cluster may contain blocks from a set of
+             * tracks within a range of block timecodes.
+             *
+             * \param[in] tracks The track numbers of interest. If empty, all
+             * tracks are of interest.
+             * \param[in] first The lowest block timecode of interest.
+             * \param[in] last The highest block timecode of interest.
+             * \return False if the summary shows that there are no such
+             * blocks in the cluster.
+             */
+            bool may_contain(std::set<uint64_t> const& tracks, int16_t first,
+                    int16_t last) const;
+
+            /** \brief Check if every block in the cluster is from a set of
+             * tracks and within a range of block timecodes.
+             *
+             * Tracks that are only marked in the bitmap have no timecode
+             * information, so a summary holding any of them never matches.
+             *
+             * \param[in] tracks The track numbers of interest. If empty, all
+             * tracks are of interest.
+             * \param[in] first The lowest block timecode of interest.
+             * \param[in] last The highest block timecode of interest.
+             * \return True if the summary shows that there are blocks in the
+             * cluster and all of them are of interest.
+             */
+            bool only_contains(std::set<uint64_t> const& tracks,
+                    int16_t first, int16_t last) const;
+
+            /// \brief Equality operator.
+            friend bool operator==(ClusterSummary const& lhs,
+                    ClusterSummary const& rhs);
+
+        protected:
+            std::vector<char> map_;
+            storage_type_ tracks_;
+
+            /// \brief Build the track bitmap from the track summaries.
+            std::vector<char> make_map() const;
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+    }; // class ClusterSummary
+
+    /// \brief Equality operator for the ClusterSummary element.
+    bool operator==(ClusterSummary const& lhs, ClusterSummary const& rhs);
+}; // namespace tawara
+
+/// @}
+// group elements
+
+#endif // TAWARA_CLUSTER_SUMMARY_H_
+
@@ -0,0 +1,249 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_COMPRESSION_H_)
+#define TAWARA_COMPRESSION_H_
+
+#include <boost/shared_ptr.hpp>
+#include <boost/utility.hpp>
+#include <cstddef>
+#include <map>
+#include <stdint.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup utilities Utilities
+/// @{
+
+namespace tawara
+{
+    /** \brief Frame compression algorithms.
+     *
+     * LZ4 is always available. If the LZ4 library was found when Tawara was
+     * built it is used, otherwise a built-in implementation of the LZ4 block
+     * format is used. The two produce compatible data. Zstandard is only
+     * available if its library was found when Tawara was built.
+     */
+    enum Compression
+    {
+        /// No compression
+        COMPRESSION_NONE,
+        /// LZ4 block format
+        COMPRESSION_LZ4,
+        /// Zstandard
+        COMPRESSION_ZSTD
+    };
+
+    /// \brief Check if a compression algorithm can be used.
+    TAWARA_EXPORT bool compression_available(Compression algorithm);
+
+    /** \brief Get the ContentCompAlgo value of a compression algorithm.
+     *
+     * \exception UnsupportedCompression if the algorithm is
+     * COMPRESSION_NONE.
+     */
+    TAWARA_EXPORT uint64_t compression_to_algo(Compression algorithm);
+
+    /** \brief Get the compression algorithm of a ContentCompAlgo value.
+     *
+     * \exception UnsupportedCompression if the value is not a known
+     * algorithm.
+     */
+    TAWARA_EXPORT Compression algo_to_compression(uint64_t algo);
+
+    /** \brief Compress a buffer.
+     *
+     * \param[in] algorithm The compression algorithm to use.
+     * \param[in] data The data to compress.
+     * \param[in] size The number of bytes of data.
+     * \param[out] output The compressed data. Its contents are replaced.
+     * \exception UnsupportedCompression if the algorithm is not available,
+     * or if the compressor fails.
+     */
+    TAWARA_EXPORT void compress(Compression algorithm, char const* data,
+            std::size_t size, std::vector<char>& output);
+
+    /** \brief Decompress a buffer.
+     *
+     * \param[in] algorithm The compression algorithm the data was compressed
+     * with.
+     * \param[in] data The compressed data.
+     * \param[in] size The number of bytes of compressed data.
+     * \param[out] output The buffer to decompress into.
+     * \param[in] output_size The exact size of the decompressed data.
+     * \exception UnsupportedCompression if the algorithm is not available.
+     * \exception BadCompressedData if the data is corrupt or does not
+     * decompress to exactly output_size bytes.
+     */
+    TAWARA_EXPORT void decompress(Compression algorithm, char const* data,
+            std::size_t size, char* output, std::size_t output_size);
+
+    /** \brief Get the largest size a buffer can decompress to.
+     *
+     * This is a limit of the compressed format, whether or not a dictionary
+     * is used. A decompressed size above it means the data is corrupt.
+     *
+     * \param[in] algorithm The compression algorithm the data was compressed
+     * with.
+     * \param[in] size The number of bytes of compressed data.
+     */
+    TAWARA_EXPORT uint64_t max_decompressed_size(Compression algorithm,
+            std::size_t size);
+
+
+    /** \brief A compression dictionary.
+     *
+     * Frames that are too small to compress well on their own, such as short
+     * status messages, can be compressed against a dictionary of content
+     * that is common to the track's frames. The same dictionary must be used
+     * to decompress them.
+     *
+     * A dictionary is raw content, usually made with train_dictionary(). It
+     * can be used with any compression algorithm. Any state needed by the
+     * algorithms is prepared when the dictionary is constructed, and the
+     * compression contexts are kept between frames, so that compressing and
+     * decompressing each frame does not have to prepare them again.
+     * Dictionaries should therefore be shared, not recreated for each block.
+     * A dictionary can be used by several threads at once; a thread that
+     * finds a kept context in use makes a temporary one. For LZ4, only the
+     * last 64 KiB of a dictionary is used.
+     */
+    class TAWARA_EXPORT CompressionDictionary : private boost::noncopyable
+    {
+        public:
+            /// \brief Pointer to a dictionary.
+            typedef boost::shared_ptr<CompressionDictionary> Ptr;
+            /// \brief Pointer to a constant dictionary.
+            typedef boost::shared_ptr<CompressionDictionary const> ConstPtr;
+
+            /** \brief Create a new dictionary.
+             *
+             * \param[in] data The content of the dictionary.
+             */
+            CompressionDictionary(std::vector<char> const& data);
+
+            /// \brief Destructor.
+            ~CompressionDictionary();
+
+            /// \brief Get the content of the dictionary.
+            std::vector<char> const& data() const { return data_; }
+
+            /// \brief Get an identifier for the dictionary's content.
+            uint32_t id() const { return id_; }
+
+            /** \brief Compress a buffer using this dictionary.
+             *
+             * \param[in] algorithm The compression algorithm to use.
+             * \param[in] data The data to compress.
+             * \param[in] size The number of bytes of data.
+             * \param[out] output The compressed data. Its contents are
+             * replaced.
+             * \exception UnsupportedCompression if the algorithm is not
+             * available, or if the compressor fails.
+             */
+            void compress(Compression algorithm, char const* data,
+                    std::size_t size, std::vector<char>& output) const;
+
+            /** \brief Decompress a buffer that was compressed using this
+             * dictionary.
+             *
+             * \param[in] algorithm The compression algorithm the data was
+             * compressed with.
+             * \param[in] data The compressed data.
+             * \param[in] size The number of bytes of compressed data.
+             * \param[out] output The buffer to decompress into.
+             * \param[in] output_size The exact size of the decompressed data.
+             * \exception UnsupportedCompression if the algorithm is not
+             * available.
+             * \exception BadCompressedData if the data is corrupt or does not
+             * decompress to exactly output_size bytes.
+             */
+            void decompress(Compression algorithm, char const* data,
+                    std::size_t size, char* output,
+                    std::size_t output_size) const;
+
+        private:
+            struct Contexts;
+
+            std::vector<char> data_;
+            uint32_t id_;
+            // Match-finding table for the built-in LZ4 implementation
+            std::vector<uint32_t> lz4_table_;
+            // Stream with the dictionary loaded, for the LZ4 library
+            void* lz4_stream_;
+            // Digested dictionaries for Zstandard
+            void* zstd_cdict_;
+            void* zstd_ddict_;
+            // Zstandard contexts kept between frames
+            Contexts* contexts_;
+    }; // class CompressionDictionary
+
+    /** \brief The dictionaries used by a set of tracks, by track number.
+     *
+     * See Tracks::dictionaries().
+     */
+    typedef std::map<uint64_t, CompressionDictionary::ConstPtr>
+        DictionaryMap;
+
+    /// \brief Pointer to a constant set of dictionaries.
+    typedef boost::shared_ptr<DictionaryMap const> DictionaryMapPtr;
+
+    /** \brief Train a compression dictionary.
+     *
+     * The dictionary is made of the segments of the samples that occur in
+     * the most samples. The most common content is placed at the end of the
+     * dictionary, where it is cheapest to refer to.
+     *
+     * \param[in] samples Sample frames. These should be representative of
+     * the frames the dictionary will be used for. A few thousand samples are
+     * usually enough.
+     * \param[in] max_size The maximum size of the dictionary.
+     * \return The dictionary content. It may be smaller than max_size, or
+     * empty, if the samples have little in common.
+     */
+    TAWARA_EXPORT std::vector<char> train_dictionary(
+            std::vector<std::vector<char> > const& samples,
+            std::size_t max_size=16384);
+}; // namespace tawara
+
+/// @}
+// group utilities
+
+#endif // TAWARA_COMPRESSION_H_
+
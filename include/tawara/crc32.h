@@ -0,0 +1,85 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_CRC32_H_)
+#define TAWARA_CRC32_H_
+
+#include <cstddef>
+#include <iostream>
+#include <stdint.h>
+#include <tawara/win_dll.h>
+
+/// \addtogroup utilities Utilities
+/// @{
+
+namespace tawara
+{
+    /** \brief Calculate the IEEE CRC-32 of a buffer.
+     *
+     * The CRC is calculated eight bytes at a time using the slice-by-8
+     * method. It can be calculated over several buffers by passing the
+     * result for the previous buffer as the starting value.
+     *
+     * \param[in] data The data to calculate the CRC of.
+     * \param[in] size The number of bytes of data.
+     * \param[in] crc The CRC of any preceding data, or 0 to start a new CRC.
+     * \return The CRC of the data.
+     */
+    TAWARA_EXPORT uint32_t crc32(char const* data, std::size_t size,
+            uint32_t crc=0);
+
+    /** \brief Calculate the IEEE CRC-32 of part of a stream.
+     *
+     * The data is read from the current read position in chunks.
+     *
+     * \param[in] input The stream to read the data from.
+     * \param[in] size The number of bytes to read.
+     * \param[in] crc The CRC of any preceding data, or 0 to start a new CRC.
+     * \return The CRC of the data.
+     * \exception ReadError if an error occurs reading the data.
+     */
+    TAWARA_EXPORT uint32_t crc32(std::istream& input, std::streamsize size,
+            uint32_t crc=0);
+}; // namespace tawara
+
+/// @}
+// group utilities
+
+#endif // TAWARA_CRC32_H_
+
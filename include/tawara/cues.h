@@ -510,6 +510,15 @@ namespace tawara
             const_iterator find(key_type const& number) const
                 { return cues_.find(number); }
 
+            /** \brief Search for the first CuePoint after a timecode.
+             *
+             * \param[in] number The timecode to search for.
+             * \return An iterator to the first CuePoint with a timecode
+             * greater than the given timecode, or end() if there is none.
+             */
+            const_iterator upper_bound(key_type const& number) const
+                { return cues_.upper_bound(number); }
+
             /// \brief Equality operator.
             friend bool operator==(Cues const& lhs, Cues const& rhs);
 
@@ -0,0 +1,92 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(TAWARA_CUT_H_)
+#define TAWARA_CUT_H_
+
+#include <iostream>
+#include <stdint.h>
+#include <tawara/file_cluster.h>
+#include <tawara/win_dll.h>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief Extract a range of time from a Tawara document.
+     *
+     * A new document is written containing the blocks of the input with an
+     * absolute timestamp in the range [t_begin, t_end), optionally limited
+     * to a set of tracks. The segment information, the tracks (limited to
+     * the selected tracks) and the attachments of the input are carried
+     * over. Blocks keep their original timecodes. The duration, if the
+     * input has one, is set to the part of the range that the input covers.
+     *
+     * The first cluster is found using clusters_at_time(), so the clusters
+     * should be stored in time order. Runs of clusters whose blocks are all
+     * kept are copied as a single byte range. A cluster with a summary
+     * showing that all of its blocks are kept is copied without reading its
+     * block headers. Clusters at the boundaries of
+     * the range, holding blocks of tracks that were not selected, or
+     * holding a Position or PrevSize value that would be wrong once moved,
+     * are rewritten with only the kept blocks; the blocks themselves are copied
+     * without decoding their frames. If no blocks are in the range, an
+     * empty cluster is written so that the new document can be read.
+     *
+     * \param[in] input The stream to read the document from, at its start.
+     * \param[in] output The stream to write the new document to. It should
+     * be empty.
+     * \param[in] t_begin The start of the range, in nanoseconds.
+     * \param[in] t_end The end of the range, in nanoseconds.
+     * \param[in] tracks The track numbers to keep. If empty, all tracks are
+     * kept.
+     * \exception NotEBML if the input is not an EBML document.
+     * \exception NotTawara if the input is not a Tawara document.
+     * \exception NoTracks if the input has no Tracks element.
+     */
+    TAWARA_EXPORT void cut(std::istream& input, std::iostream& output,
+            int64_t t_begin, int64_t t_end,
+            FileCluster::TrackSet const& tracks=FileCluster::TrackSet());
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_CUT_H_
+
@@ -166,6 +166,23 @@ namespace tawara
             /// \brief Sets all child elements to their default values.
             void set_defaults_();
     }; // class Element
+
+    /** \brief Read and check the EBML header of a Tawara document.
+     *
+     * The read pointer must be placed at the start of the document. When
+     * this function returns, the read pointer is placed after the header,
+     * ready to read the Segment.
+     *
+     * \param[in] input The stream to read the header from.
+     * \return The header that was read.
+     * \exception NotEBML if the document does not begin with an EBML header.
+     * \exception NotTawara if the document is not a Tawara document.
+     * \exception BadReadVersion if the document requires a newer EBML
+     * parser.
+     * \exception BadDocReadVersion if the document requires a newer Tawara
+     * parser.
+     */
+    TAWARA_EXPORT EBMLElement read_tawara_header(std::istream& input);
 }; // namespace tawara
 
 /// @}
@@ -101,6 +101,13 @@ namespace tawara
                     const ID SilentTrackNumber(0x58D7);
                 const ID Position(0xA7);
                 const ID PrevSize(0xAB);
+                const ID ClusterSummary(0x5C50);
+                    const ID SummaryTrackMap(0x5C51);
+                    const ID SummaryTrack(0x5C52);
+                        const ID SummaryTrackNumber(0x5C53);
+                        const ID SummaryBlockCount(0x5C54);
+                        const ID SummaryMinTimecode(0x5C55);
+                        const ID SummaryMaxTimecode(0x5C56);
                 const ID SimpleBlock(0xA3);
                 const ID BlockGroup(0xA0);
                     const ID Block(0xA1);
@@ -137,6 +144,14 @@ namespace tawara
                     const ID TrackOperation(0xE2);
                         const ID TrackJoinBlocks(0xE9);
                             const ID TrackJoinUID(0xED);
+                    const ID ContentEncodings(0x6D80);
+                        const ID ContentEncoding(0x6240);
+                            const ID ContentEncodingOrder(0x5031);
+                            const ID ContentEncodingScope(0x5032);
+                            const ID ContentEncodingType(0x5033);
+                            const ID ContentCompression(0x5034);
+                                const ID ContentCompAlgo(0x4254);
+                                const ID ContentCompSettings(0x4255);
 
             const ID Cues(0x1C53BB6B);
                 const ID CuePoint(0xBB);
@@ -45,6 +45,7 @@
 #include <boost/exception/all.hpp>
 #include <exception>
 #include <stdint.h>
+#include <string>
 #include <vector>
 
 /// \addtogroup exceptions Exceptions
@@ -421,6 +422,20 @@ namespace tawara
      */
     struct NoTracks : virtual TawaraError{};
 
+    /** \brief A block was found for a track that is not in the tracks.
+     *
+     * Every block must belong to a track described by the segment's Tracks
+     * element. If a block's track number is not found there, this error
+     * occurs.
+     *
+     * The err_track_num tag may be included to give the block's track
+     * number.
+     *
+     * The err_pos tag may be included to give the approximate position in the
+     * file where the error occured.
+     */
+    struct UnknownTrack : virtual TawaraError{};
+
     /** \brief A segment was found without at least one cluster.
      *
      * Every Segment element must have at least one Cluster element present. If
@@ -502,6 +517,118 @@ namespace tawara
      */
     struct EmptyCuePointElement : virtual TawaraError{};
 
+    /** \brief There is no room in a document for a new index.
+     *
+     * When adding an index to an existing document, the SeekHead must be
+     * written in place of the existing one, or at the end of the document if
+     * the segment is the last thing in the stream. This error occurs if
+     * neither is possible. It also occurs when new Tags do not fit anywhere
+     * in an existing document.
+     *
+     * The err_reqsize tag may be included to give the required size.
+     */
+    struct NoIndexSpace : virtual TawaraError{};
+
+    /** \brief The CRC-32 of an element does not match its data.
+     *
+     * This error occurs when reading a master element with a CRC-32 child
+     * and verification of CRCs is turned on, if the CRC of the element's
+     * other children differs from the stored value.
+     *
+     * The err_id tag may be included to give the ID of the element. The
+     * err_pos tag may be included to give the position in the file of the
+     * element.
+     */
+    struct BadCRC : virtual TawaraError{};
+
+    /** \brief A compression algorithm is not supported.
+     *
+     * This error occurs when a track or block uses a compression algorithm
+     * that is not known, or that was not available when the library was
+     * built. It also occurs if the compression library fails to compress
+     * data.
+     *
+     * The err_comp_algo tag may be included to give the ContentCompAlgo
+     * value of the algorithm. The err_pos tag may be included to give the
+     * position in the file where the error occured.
+     */
+    struct UnsupportedCompression : virtual TawaraError{};
+
+    /** \brief Compressed data could not be decompressed.
+     *
+     * This error occurs if the compressed data of a block is corrupt, or
+     * does not decompress to the size recorded for it.
+     *
+     * The err_pos tag may be included to give the position in the file of
+     * the compressed data.
+     */
+    struct BadCompressedData : virtual TawaraError{};
+
+    /** \brief Compressed data needs a dictionary that is not available.
+     *
+     * This error occurs when a block compressed using a dictionary is read
+     * without the dictionary for its track (see Block::dictionaries()).
+     *
+     * The err_track_num tag may be included to give the block's track
+     * number. The err_pos tag may be included to give the position in the
+     * file of the compressed data.
+     */
+    struct MissingDictionary : virtual TawaraError{};
+
+    /** \brief A Tags element with no tags was read or written.
+     *
+     * A Tags element must have at least one Tag. If an empty element is read
+     * or written, this error occurs.
+     *
+     * The err_pos tag may be included to give the approximate position in the
+     * file where the error occured.
+     */
+    struct NoTags : virtual TawaraError{};
+
+    /** \brief A Tag element with no SimpleTags was read or written.
+     *
+     * A Tag element must have at least one SimpleTag holding its metadata.
+     * If a Tag without any is read or written, this error occurs.
+     *
+     * The err_pos tag may be included to give the approximate position in the
+     * file where the error occured.
+     */
+    struct NoSimpleTags : virtual TawaraError{};
+
+    /** \brief A SimpleTag has both a string and a binary value.
+     *
+     * The TagString and TagBinary children of a SimpleTag are mutually
+     * exclusive. This error occurs if a SimpleTag with both is read.
+     *
+     * The err_id tag may be included to give the ID of the element. The
+     * err_pos tag may be included to give the position in the file of the
+     * element.
+     */
+    struct TagStringAndBinary : virtual TawaraError{};
+
+    /** \brief An empty Chapters element was read or written.
+     *
+     * The Chapters element must have at least one EditionEntry to be valid.
+     * This error occurs if a Chapters element with no EditionEntry children
+     * is read, or when an empty Chapters element is about to be written.
+     *
+     * The err_pos tag may be included to give the approximate position in the
+     * file where the error occured.
+     */
+    struct EmptyChaptersElement : virtual TawaraError{};
+
+    /** \brief An empty EditionEntry element was read or written.
+     *
+     * The EditionEntry element must have at least one ChapterAtom to be
+     * valid. This error occurs if an EditionEntry element with no ChapterAtom
+     * children is read, or when an empty EditionEntry element is about to be
+     * written.
+     *
+     * The err_pos tag may be included to give the approximate position in the
+     * file where the error occured.
+     */
+    struct EmptyEditionEntry : virtual TawaraError{};
+
 
 ///////////////////////////////////////////////////////////////////////////////
 // Error information tags
@@ -513,6 +640,9 @@ namespace tawara
     /// \brief Position in a Tawara file.
     typedef boost::error_info<struct tag_pos, std::streamsize> err_pos;
 
+    /// \brief The name of a file.
+    typedef boost::error_info<struct tag_name, std::string> err_name;
+
     /// \brief Value of a variable-length integer.
     typedef boost::error_info<struct tag_varint, uint64_t> err_varint;
 
@@ -554,6 +684,9 @@ namespace tawara
     /// \brief The size of a frame.
     typedef boost::error_info<struct tag_frame_size, std::streamsize>
         err_frame_size;
+
+    /// \brief A compression algorithm, as a ContentCompAlgo value.
+    typedef boost::error_info<struct tag_comp_algo, uint64_t> err_comp_algo;
 }; // namespace tawara
 
 /// @}
@@ -0,0 +1,84 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_FASTSTART_H_)
+#define TAWARA_FASTSTART_H_
+
+#include <iostream>
+#include <tawara/win_dll.h>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief Rewrite a Tawara document with its metadata before its
+     * clusters.
+     *
+     * If Segment::finalise() cannot fit the SeekHead into the padding at
+     * the start of the segment, or the Tracks or Cues are written after the
+     * clusters, a reader must seek to the end of the document before it can
+     * read any data. This is slow when the document is being read
+     * progressively, such as over a network.
+     *
+     * A new document is written with the SeekHead and SegmentInfo at the
+     * start of the segment, followed by the Tracks, the Cues and any other
+     * level 1 elements (such as Attachments), and then the clusters. The
+     * cluster positions in the Cues are patched to match the new layout.
+     * The clusters are copied without decoding, in their original order, in
+     * a single sequential pass over the input. A cluster's Position is set
+     * to its new position, with padding taking up any space left over, or
+     * replaced with padding if the new value does not fit in the space of
+     * the old one. Any existing SeekHead and Void elements are dropped.
+     *
+     * \param[in] input The stream to read the document from, at its start.
+     * \param[in] output The stream to write the new document to. It should
+     * be empty.
+     * \exception NotEBML if the input is not an EBML document.
+     * \exception NotTawara if the input is not a Tawara document.
+     * \exception InvalidChildID if the input does not contain a segment.
+     */
+    TAWARA_EXPORT void faststart(std::istream& input, std::iostream& output);
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_FASTSTART_H_
+
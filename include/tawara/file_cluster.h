@@ -39,8 +39,12 @@
 #if !defined(TAWARA_FILE_CLUSTER_H_)
 #define TAWARA_FILE_CLUSTER_H_
 
+#include <boost/iterator/iterator_facade.hpp>
+#include <limits>
+#include <set>
 #include <tawara/block_element.h>
 #include <tawara/block_group.h>
+#include <tawara/block_header.h>
 #include <tawara/cluster.h>
 #include <tawara/simple_block.h>
 #include <tawara/win_dll.h>
@@ -72,6 +76,12 @@ namespace tawara
              */
             FileCluster(uint64_t timecode=0);
 
+            /** \brief A set of track numbers used to filter blocks.
+             *
+             * An empty set means that blocks from all tracks are accepted.
+             */
+            typedef std::set<uint64_t> TrackSet;
+
             //////////////////////////////////////////////////////////////////
             // Iterator types
             //////////////////////////////////////////////////////////////////
@@ -91,7 +101,8 @@ namespace tawara
                      * Constructs an empty iterator.
                      */
                     IteratorBase()
-                        : cluster_(0)
+                        : cluster_(0), first_tc_(0), last_tc_(0),
+                        filtered_(false)
                     {
                     }
 
@@ -104,12 +115,45 @@ namespace tawara
                      */
                     IteratorBase(FileCluster const* cluster,
                             std::istream& stream, std::streampos pos)
-                        : cluster_(cluster), stream_(&stream)
+                        : cluster_(cluster), stream_(&stream), first_tc_(0),
+                        last_tc_(0), filtered_(false)
                     {
                         // Open the block at the provided position
                         load_block(pos);
                     }
 
+                    /** \brief Filtered constructor.
+                     *
+                     * Only blocks belonging to one of the given tracks and
+                     * with a timecode in the given range are loaded. The
+                     * headers of other blocks are read to find their track
+                     * number and timecode, but their frames are skipped
+                     * without being read.
+                     *
+                     * \param[in] cluster The cluster containing the blocks.
+                     * \param[in] stream The stream to read blocks from.
+                     * \param[in] pos The position in the file of the first
+                     * block to consider.
+                     * \param[in] tracks The track numbers to load blocks
+                     * for. If empty, blocks from all tracks are loaded.
+                     * \param[in] first_tc The lowest block timecode to load.
+                     * \param[in] last_tc The highest block timecode to load.
+                     */
+                    IteratorBase(FileCluster const* cluster,
+                            std::istream& stream, std::streampos pos,
+                            TrackSet const& tracks, int16_t first_tc,
+                            int16_t last_tc)
+                        : cluster_(cluster), stream_(&stream), tracks_(tracks),
+                        first_tc_(first_tc), last_tc_(last_tc),
+                        filtered_(!tracks.empty() ||
+                                first_tc != std::numeric_limits<int16_t>::min() ||
+                                last_tc != std::numeric_limits<int16_t>::max())
+                    {
+                        // Open the first matching block at or after the
+                        // provided position
+                        load_block(pos);
+                    }
+
                     /** \brief Templated base constructor.
                      *
                      * Used to provide interoperability with compatible
@@ -118,7 +162,9 @@ namespace tawara
                     template <typename OtherType>
                     IteratorBase(IteratorBase<OtherType> const& other)
                         : cluster_(other.cluster_), stream_(other.stream_),
-                        block_(other.block_)
+                        block_(other.block_), tracks_(other.tracks_),
+                        first_tc_(other.first_tc_), last_tc_(other.last_tc_),
+                        filtered_(other.filtered_)
                     {
                     }
 
@@ -133,8 +179,46 @@ namespace tawara
                     std::istream* stream_;
                     boost::shared_ptr<BlockType> block_;
 
+                    TrackSet tracks_;
+                    int16_t first_tc_;
+                    int16_t last_tc_;
+                    bool filtered_;
+
+                    /// \brief Check if a block header passes the filter.
+                    bool matches(BlockHeader const& header) const
+                    {
+                        if (!tracks_.empty() &&
+                                tracks_.count(header.track_number) == 0)
+                        {
+                            return false;
+                        }
+                        return header.timecode >= first_tc_ &&
+                            header.timecode <= last_tc_;
+                    }
+
                     void load_block(std::streampos pos)
                     {
+                        // Save the current read position
+                        std::streampos cur_read(stream_->tellg());
+                        if (filtered_)
+                        {
+                            // Skip blocks that are not wanted using only
+                            // their headers
+                            stream_->seekg(pos);
+                            while (pos != cluster_->blocks_end_pos_)
+                            {
+                                BlockHeader header(read_block_header(*stream_));
+                                if (cluster_->stats())
+                                {
+                                    ++cluster_->stats()->block_headers_read;
+                                }
+                                if (matches(header))
+                                {
+                                    break;
+                                }
+                                pos = stream_->tellg();
+                            }
+                        }
                         if (pos == cluster_->blocks_end_pos_)
                         {
                             // End of the blocks
@@ -142,8 +226,6 @@ namespace tawara
                         }
                         else
                         {
-                            // Save the current read position
-                            std::streampos cur_read(stream_->tellg());
                             // Jump to the expected block location
                             stream_->seekg(pos);
                             // Read the block
@@ -151,7 +233,13 @@ namespace tawara
                             if (id_res.first == ids::SimpleBlock)
                             {
                                 BlockElement::Ptr new_block(new SimpleBlock(0, 0));
+                                new_block->dictionaries(
+                                        cluster_->dictionaries());
                                 new_block->read(*stream_);
+                                if (cluster_->stats())
+                                {
+                                    cluster_->stats()->block_read(*new_block);
+                                }
                                 // TODO Ick. Needs fixing.
                                 boost::shared_ptr<BlockType> new_const_block(new_block);
                                 block_.swap(new_const_block);
@@ -159,7 +247,13 @@ namespace tawara
                             else if (id_res.first == ids::BlockGroup)
                             {
                                 BlockElement::Ptr new_block(new BlockGroup(0, 0));
+                                new_block->dictionaries(
+                                        cluster_->dictionaries());
                                 new_block->read(*stream_);
+                                if (cluster_->stats())
+                                {
+                                    cluster_->stats()->block_read(*new_block);
+                                }
                                 // TODO Ick. Needs fixing.
                                 boost::shared_ptr<BlockType> new_const_block(new_block);
                                 block_.swap(new_const_block);
@@ -172,9 +266,9 @@ namespace tawara
                                     err_pos(static_cast<std::streamsize>(stream_->tellg()) -
                                             id_res.second);
                             }
-                            // Return to the original read position
-                            stream_->seekg(cur_read);
                         }
+                        // Return to the original read position
+                        stream_->seekg(cur_read);
                     }
 
                     /// \brief Increment the iterator to the next block.
@@ -248,6 +342,25 @@ namespace tawara
              */
             Iterator end();
 
+            /** \brief Access the start of a filtered set of the blocks.
+             *
+             * Gets an iterator pointing to the first block in the cluster
+             * that belongs to one of the given tracks and has a timecode
+             * within the given range. Incrementing the iterator moves to the
+             * next such block. Blocks that do not match have only their
+             * headers read; their frame data is skipped.
+             *
+             * \param[in] tracks The track numbers to iterate over. If empty,
+             * blocks from all tracks are iterated over.
+             * \param[in] first_tc The lowest block timecode, relative to the
+             * cluster's timecode, to iterate over.
+             * \param[in] last_tc The highest block timecode, relative to the
+             * cluster's timecode, to iterate over.
+             */
+            Iterator begin(TrackSet const& tracks,
+                    int16_t first_tc=std::numeric_limits<int16_t>::min(),
+                    int16_t last_tc=std::numeric_limits<int16_t>::max());
+
 
             //////////////////////////////////////////////////////////////////
             // Cluster interface
@@ -289,6 +402,34 @@ namespace tawara
              */
             virtual void push_back(value_type const& value);
 
+            /** \brief Copy an encoded block into this cluster.
+             *
+             * The block element is copied from the input stream without
+             * decoding its frames, giving it a new track number and
+             * timecode. See copy_block(). The cluster must be in the
+             * writable state.
+             *
+             * \param[in] input The stream to read the block from.
+             * \param[in] header The header of the block to copy.
+             * \param[in] track_number The track number to give the block.
+             * \param[in] timecode The timecode to give the block, relative
+             * to this cluster's timecode.
+             */
+            void push_back_copy(std::istream& input, BlockHeader const& header,
+                    uint64_t track_number, int16_t timecode);
+
+            /** \brief Get the position in the stream of the first block.
+             *
+             * Only valid once the cluster has been read or written.
+             */
+            std::streampos blocks_start_pos() const
+                { return blocks_start_pos_; }
+            /** \brief Get the position in the stream after the last block.
+             *
+             * Only valid once the cluster has been read or written.
+             */
+            std::streampos blocks_end_pos() const { return blocks_end_pos_; }
+
             /// \brief Element writing.
             std::streamsize write(std::ostream& output);
 
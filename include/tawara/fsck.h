@@ -0,0 +1,135 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_FSCK_H_)
+#define TAWARA_FSCK_H_
+
+#include <iostream>
+#include <stdint.h>
+#include <string>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief A problem found while checking a Tawara document.
+     *
+     * The check is a short name for the part of the document that failed,
+     * one of "header", "structure", "info", "tracks", "seekhead", "cues",
+     * "cluster", "timecode" or "block". The error is the name of the
+     * exception raised by the check, or a short description.
+     */
+    struct TAWARA_EXPORT FsckProblem
+    {
+        FsckProblem(std::streamsize pos, std::string const& check,
+                std::string const& error)
+            : pos(pos), check(check), error(error)
+        {
+        }
+
+        /// \brief The position in the file of the problem.
+        std::streamsize pos;
+        /// \brief The check that found the problem.
+        std::string check;
+        /// \brief The error found.
+        std::string error;
+    }; // struct FsckProblem
+
+
+    /// \brief The result of checking a Tawara document.
+    struct TAWARA_EXPORT FsckReport
+    {
+        FsckReport()
+            : clusters(0), blocks(0), frames(0), crcs(0)
+        {
+        }
+
+        /// \brief Check if no problems were found.
+        bool ok() const { return problems.empty(); }
+
+        /// \brief The number of clusters checked.
+        uint64_t clusters;
+        /// \brief The number of blocks checked.
+        uint64_t blocks;
+        /// \brief The number of frames in the checked blocks.
+        uint64_t frames;
+        /// \brief The number of CRC-32 elements verified.
+        uint64_t crcs;
+        /// \brief The problems found, in file order.
+        std::vector<FsckProblem> problems;
+    }; // struct FsckReport
+
+
+    /** \brief Check the structure of a Tawara document.
+     *
+     * The following are checked:
+     *  - The EBML header and the sizes of the segment's level 1 elements.
+     *  - The SegmentInfo, Tracks and Cues can be read, including their
+     *    CRC-32 elements if present.
+     *  - Every SeekHead entry points at an element with the correct ID.
+     *  - Every cue point refers to a cluster, a track and a block number that
+     *    exist.
+     *  - Every cluster can be read, its CRC-32 is correct if present, and its
+     *    timecode is not less than the previous cluster's.
+     *  - Every block in every cluster can be read, including its lacing, and
+     *    belongs to a known track.
+     *
+     * The level 1 elements are found by skipping over their bodies, and the
+     * clusters are then checked in parallel. Each thread opens the file
+     * separately. Problems in one cluster do not stop the other clusters
+     * being checked.
+     *
+     * \param[in] path The path of the file to check.
+     * \param[in] threads The number of threads to use. If 0, one thread is
+     * used per processor core.
+     * \return The report of the check.
+     * \exception ReadError if the file cannot be opened.
+     */
+    TAWARA_EXPORT FsckReport fsck(std::string const& path,
+            unsigned int threads=0);
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_FSCK_H_
+
@@ -0,0 +1,284 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_IO_STATS_H_)
+#define TAWARA_IO_STATS_H_
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/shared_ptr.hpp>
+#include <iostream>
+#include <stdint.h>
+#include <streambuf>
+#include <tawara/latency_histogram.h>
+#include <tawara/win_dll.h>
+
+/// \addtogroup utilities Utilities
+/// @{
+
+namespace tawara
+{
+    class Block;
+
+    /** \brief Counters of the I/O and parsing work done by readers and
+     * writers.
+     *
+     * Statistics are opt-in. Give a statistics object to a Segment (see
+     * Segment::stats()) or a Cluster (see Cluster::stats()) and the clusters
+     * and blocks they read and write are counted in it. The clusters opened
+     * by the segment's iterators share the segment's statistics object.
+     *
+     * The byte, call and seek counts come from the stream itself, so the
+     * stream must be given a CountingStreamBuf that updates the same
+     * statistics object.
+     *
+     * The counters are not synchronised. A statistics object must only be
+     * updated by one thread at a time; give each thread its own object and
+     * add them together afterwards.
+     */
+    struct TAWARA_EXPORT IOStats
+    {
+        typedef boost::shared_ptr<IOStats> Ptr;
+
+        IOStats();
+
+        /// \brief Set all the counters to zero.
+        void reset();
+
+        /// \brief Add the counters of another statistics object.
+        IOStats& operator+=(IOStats const& rhs);
+
+        /** \brief Count a block that has been read.
+         *
+         * The allocations the block made to hold its frames are counted
+         * (see Block::frame_allocs()).
+         */
+        void block_read(Block const& block);
+        /// \brief Count a block that has been written.
+        void block_written(Block const& block);
+
+        /// \brief Get the current time, for timing a finalise call.
+        static boost::posix_time::ptime now();
+        /// \brief Count a finalise call that began at the given time.
+        void finalised(boost::posix_time::ptime start);
+        /// \brief Count a sync (see sync()) that began at the given time.
+        void synced(boost::posix_time::ptime start);
+
+        /// \brief The number of bytes read from the stream.
+        uint64_t bytes_read;
+        /// \brief The number of bytes written to the stream.
+        uint64_t bytes_written;
+        /// \brief The number of read calls made on the stream.
+        uint64_t read_calls;
+        /// \brief The number of write calls made on the stream.
+        uint64_t write_calls;
+        /** \brief The number of seeks made on the stream.
+         *
+         * Getting the position (tellg() and tellp()) is not a seek.
+         */
+        uint64_t seeks;
+        /// \brief The number of clusters read, including header-only reads.
+        uint64_t clusters_read;
+        /// \brief The number of clusters written.
+        uint64_t clusters_written;
+        /// \brief The number of blocks read and parsed.
+        uint64_t blocks_read;
+        /** \brief The number of block headers read on their own.
+         *
+         * Filtered cluster iterators read only the headers of the blocks
+         * they skip (see read_block_header()). The header of a block that
+         * is then read in full is also counted.
+         */
+        uint64_t block_headers_read;
+        /// \brief The number of blocks written.
+        uint64_t blocks_written;
+        /// \brief The number of frames in the blocks read.
+        uint64_t frames_read;
+        /// \brief The number of frames in the blocks written.
+        uint64_t frames_written;
+        /// \brief The number of allocations made to read frames.
+        uint64_t frame_allocs;
+        /// \brief The number of cluster and segment finalise calls.
+        uint64_t finalise_calls;
+        /// \brief The total time spent in finalise calls, in microseconds.
+        uint64_t finalise_us;
+        /// \brief The number of syncs.
+        uint64_t sync_calls;
+
+        /** \brief The latency from adding a block to a cluster until it is
+         * written to the stream.
+         *
+         * For a FileCluster, this is the duration of push_back(). For a
+         * MemoryCluster, it runs from push_back() until the block is written
+         * by finalise(); blocks pushed while the cluster had no statistics,
+         * or before a block was erased, are not recorded.
+         */
+        LatencyHistogram write_latency;
+        /// \brief The durations of cluster and segment finalise calls.
+        LatencyHistogram finalise_latency;
+        /// \brief The durations of syncs.
+        LatencyHistogram sync_latency;
+    }; // struct IOStats
+
+    /** \brief Print the statistics, one counter per line.
+     *
+     * Latency histograms are only printed if they hold any latencies.
+     */
+    TAWARA_EXPORT std::ostream& operator<<(std::ostream& output,
+            IOStats const& stats);
+
+
+    /** \brief Flush a stream and, optionally, make its data durable.
+     *
+     * The stream is flushed, handing its bytes to the operating system.
+     * If a file descriptor is given, the file is then synchronised to the
+     * storage device (fsync() or _commit()). Any descriptor open on the
+     * file written by the stream will do.
+     *
+     * \param[in] output The stream to flush.
+     * \param[in] fd A file descriptor of the file, or -1 to only flush.
+     * \param[in] stats If not empty, the sync is counted in these
+     * statistics.
+     * \throw WriteError if flushing or synchronising fails.
+     */
+    TAWARA_EXPORT void sync(std::ostream& output, int fd=-1,
+            IOStats::Ptr stats=IOStats::Ptr());
+
+
+    /** \brief Prints statistics periodically.
+     *
+     * Call poll() regularly from the thread updating the statistics, for
+     * example after each block is written. When the interval has passed
+     * since the last dump, the statistics are printed. The dumper does not
+     * create a thread, so it needs no locking.
+     */
+    class TAWARA_EXPORT StatsDumper
+    {
+        public:
+            /** \brief Constructor.
+             *
+             * \param[in] stats The statistics to print.
+             * \param[in] output The stream to print to.
+             * \param[in] interval The time between dumps.
+             * \param[in] reset If true, the statistics are reset after each
+             * dump, so each dump covers one interval.
+             */
+            StatsDumper(IOStats::Ptr stats, std::ostream& output,
+                    boost::posix_time::time_duration interval,
+                    bool reset=false);
+
+            /** \brief Print the statistics if the interval has passed.
+             *
+             * \return True if the statistics were printed.
+             */
+            bool poll();
+            /// \brief Print the statistics now.
+            void dump();
+
+            /// \brief Get the number of dumps printed.
+            unsigned int dumps() const { return dumps_; }
+
+        private:
+            IOStats::Ptr stats_;
+            std::ostream& output_;
+            boost::posix_time::time_duration interval_;
+            bool reset_;
+            boost::posix_time::ptime last_;
+            unsigned int dumps_;
+    }; // class StatsDumper
+
+
+    /** \brief A stream buffer that counts the I/O passing through it.
+     *
+     * The counting buffer wraps the buffer of a stream, such as a
+     * std::filebuf, and passes every operation through to it. Use it as
+     * the buffer of the stream given to the reader or writer:
+     *
+     * \code
+     * std::fstream file(name, mode);
+     * tawara::IOStats::Ptr stats(new tawara::IOStats);
+     * tawara::CountingStreamBuf counter(file.rdbuf(), stats);
+     * std::iostream stream(&counter);
+     * segment.stats(stats);
+     * \endcode
+     *
+     * The counting buffer has no buffer of its own, so each character
+     * operation is a virtual call. It is intended for diagnosis rather than
+     * for use in every recording.
+     */
+    class TAWARA_EXPORT CountingStreamBuf : public std::streambuf
+    {
+        public:
+            /** \brief Constructor.
+             *
+             * \param[in] buffer The buffer to pass operations through to. It
+             * must outlive the counting buffer.
+             * \param[in] stats The statistics to count in.
+             */
+            CountingStreamBuf(std::streambuf* buffer, IOStats::Ptr stats);
+
+            /// \brief Get the buffer operations are passed through to.
+            std::streambuf* buffer() const { return buffer_; }
+            /// \brief Get the statistics being counted in.
+            IOStats::Ptr stats() const { return stats_; }
+
+        protected:
+            virtual int_type underflow();
+            virtual int_type uflow();
+            virtual std::streamsize xsgetn(char_type* s, std::streamsize n);
+            virtual int_type pbackfail(int_type c);
+            virtual std::streamsize showmanyc();
+            virtual int_type overflow(int_type c);
+            virtual std::streamsize xsputn(char_type const* s,
+                    std::streamsize n);
+            virtual pos_type seekoff(off_type off, std::ios_base::seekdir dir,
+                    std::ios_base::openmode which);
+            virtual pos_type seekpos(pos_type pos,
+                    std::ios_base::openmode which);
+            virtual int sync();
+
+        private:
+            std::streambuf* buffer_;
+            IOStats::Ptr stats_;
+    }; // class CountingStreamBuf
+}; // namespace tawara
+
+/// @}
+// group utilities
+
+#endif // TAWARA_IO_STATS_H_
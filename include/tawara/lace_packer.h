@@ -0,0 +1,187 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_LACE_PACKER_H_)
+#define TAWARA_LACE_PACKER_H_
+
+#include <stdint.h>
+#include <tawara/block.h>
+#include <tawara/block_element.h>
+#include <tawara/track_entry.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup utilities Utilities
+/// @{
+
+namespace tawara
+{
+    /** \brief Packs consecutive frames of a track into laced blocks.
+     *
+     * Storing each frame of a high-rate track, such as a 1 kHz sensor, in
+     * its own SimpleBlock costs a block header and an element header per
+     * frame. The packer groups consecutive frames into a single laced
+     * block instead. Fixed lacing is used when all the frames are the same
+     * size, and EBML lacing otherwise.
+     *
+     * Only the first frame of a laced block has a timecode. The timecodes
+     * of the other frames are derived from the track's default duration
+     * (see TrackEntry::default_duration()), so a frame is only added to the
+     * pending block if its timecode is the one the reader will derive for
+     * it. A frame that arrives early or late starts a new block. If the
+     * track has no default duration, each frame is given its own block.
+     *
+     * Frames are added with their timecodes relative to the cluster the
+     * blocks will be written to. Blocks are returned when they are
+     * complete, ready to be pushed into the cluster. A block is complete
+     * when the next frame does not fit in it: the frame count or size limit
+     * has been reached, the frame's timecode does not follow on, or the
+     * frame is later than the latency limit allows. Call flush() to get the
+     * pending block before changing clusters or finishing, and expire() to
+     * keep the latency bounded when frames stop arriving.
+     *
+     * The blocks use the compression of the track (see
+     * TrackEntry::compression()).
+     */
+    class TAWARA_EXPORT LacePacker
+    {
+        public:
+            /** \brief Constructor.
+             *
+             * \param[in] track The track the frames belong to.
+             * \param[in] timecode_scale The timecode scale of the segment, in
+             * nanoseconds.
+             * \param[in] max_frames The maximum number of frames in a block.
+             * A lace cannot hold more than 255 frames, as the frame count is
+             * stored in a single byte.
+             * \param[in] max_bytes The maximum total size of the frames in a
+             * block. A single frame larger than this gets a block of its own.
+             * \param[in] max_latency The maximum difference, in timecode
+             * units, between the timecodes of the first and last frames in a
+             * block.
+             * \exception ValueOutOfRange if the timecode scale or maximum
+             * frame count is zero, or the maximum frame count is above 255.
+             */
+            LacePacker(TrackEntry const& track, uint64_t timecode_scale,
+                    unsigned int max_frames=32, std::size_t max_bytes=16384,
+                    int16_t max_latency=100);
+
+            /** \brief Add a frame.
+             *
+             * \param[in] frame The frame data.
+             * \param[in] timecode The timecode of the frame, relative to the
+             * cluster.
+             * \return The block that was completed by adding the frame, or an
+             * empty pointer if the pending block was not completed.
+             * \exception EmptyFrame if the frame is empty.
+             */
+            BlockElement::Ptr add(Block::value_type const& frame,
+                    int16_t timecode);
+
+            /** \brief Complete the pending block if it is too old.
+             *
+             * \param[in] timecode The current time, relative to the cluster.
+             * \return The pending block if its first frame is more than the
+             * latency limit before the given time, or an empty pointer.
+             */
+            BlockElement::Ptr expire(int16_t timecode);
+
+            /** \brief Complete the pending block.
+             *
+             * \return The pending block, or an empty pointer if no frames are
+             * pending.
+             */
+            BlockElement::Ptr flush();
+
+            /// \brief Check if no frames are pending.
+            bool empty() const { return frames_.empty(); }
+            /// \brief Get the number of pending frames.
+            std::size_t count() const { return frames_.size(); }
+
+        protected:
+            uint64_t track_number_;
+            uint64_t default_duration_;
+            uint64_t timecode_scale_;
+            Compression compression_;
+            unsigned int max_frames_;
+            std::size_t max_bytes_;
+            int16_t max_latency_;
+            std::vector<Block::value_type> frames_;
+            std::size_t bytes_;
+            int16_t first_timecode_;
+
+            /// \brief Get the timecode a reader will derive for a frame.
+            int64_t expected_timecode(std::size_t index) const;
+    }; // class LacePacker
+
+
+    /// \brief A frame and its time.
+    struct TimedFrame
+    {
+        /// \brief The time of the frame, in nanoseconds.
+        int64_t time;
+        /// \brief The frame data.
+        Block::value_type data;
+    };
+
+    /** \brief Unpack the frames of a block with their times.
+     *
+     * The first frame has the time of the block. Each following frame in a
+     * lace is one default duration of the track after the one before it.
+     *
+     * \param[in] block The block to unpack.
+     * \param[in] cluster_timecode The timecode of the cluster containing the
+     * block.
+     * \param[in] timecode_scale The timecode scale of the segment, in
+     * nanoseconds.
+     * \param[in] default_duration The default duration of the block's track,
+     * in nanoseconds (see TrackEntry::default_duration()).
+     * \return The frames and their times, in nanoseconds from the start of
+     * the segment.
+     */
+    TAWARA_EXPORT std::vector<TimedFrame> unpack_frames(Block const& block,
+            uint64_t cluster_timecode, uint64_t timecode_scale,
+            uint64_t default_duration);
+}; // namespace tawara
+
+/// @}
+// group utilities
+
+#endif // TAWARA_LACE_PACKER_H_
+
@@ -0,0 +1,127 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_LATENCY_HISTOGRAM_H_)
+#define TAWARA_LATENCY_HISTOGRAM_H_
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <iostream>
+#include <stdint.h>
+#include <vector>
+#include <tawara/win_dll.h>
+
+/// \addtogroup utilities Utilities
+/// @{
+
+namespace tawara
+{
+    /** \brief A histogram of latencies, in microseconds.
+     *
+     * The buckets are log-linear, in the style of HDR histograms: latencies
+     * below 64 us are counted exactly, and larger latencies are counted in
+     * buckets no wider than 1/32 of their value, so percentiles are accurate
+     * to about 3%. Latencies above max_value() are counted as max_value().
+     *
+     * Recording a value is an index calculation and an increment, and the
+     * histogram is a fixed size, so it can be left enabled while logging.
+     * Like IOStats, it is not synchronised.
+     */
+    class TAWARA_EXPORT LatencyHistogram
+    {
+        public:
+            /// \brief Constructor.
+            LatencyHistogram();
+
+            /// \brief Record a latency, in microseconds.
+            void record(uint64_t us);
+            /// \brief Record the latency from a start time until now.
+            void record(boost::posix_time::ptime start);
+
+            /// \brief Remove all recorded latencies.
+            void reset();
+            /// \brief Add the latencies recorded in another histogram.
+            LatencyHistogram& operator+=(LatencyHistogram const& rhs);
+
+            /// \brief Get the number of latencies recorded.
+            uint64_t count() const { return count_; }
+            /// \brief Get the smallest latency recorded, or 0 if empty.
+            uint64_t min() const { return count_ == 0 ? 0 : min_; }
+            /// \brief Get the largest latency recorded.
+            uint64_t max() const { return max_; }
+            /// \brief Get the mean of the latencies recorded.
+            double mean() const;
+
+            /** \brief Get a percentile of the latencies recorded.
+             *
+             * \param[in] percent The percentile, from 0 to 100.
+             * \return The largest latency that could have been counted in
+             * the bucket holding the percentile, limited to max(). 0 if the
+             * histogram is empty.
+             */
+            uint64_t percentile(double percent) const;
+
+            /// \brief Get the largest latency that can be told apart.
+            static uint64_t max_value();
+
+        protected:
+            std::vector<uint64_t> counts_;
+            uint64_t count_;
+            uint64_t min_;
+            uint64_t max_;
+            uint64_t total_;
+
+            /// \brief Get the bucket a latency is counted in.
+            static std::size_t bucket(uint64_t us);
+            /// \brief Get the largest latency counted in a bucket.
+            static uint64_t bucket_max(std::size_t index);
+    }; // class LatencyHistogram
+
+    /** \brief Print a summary of the histogram on one line.
+     *
+     * The count, minimum, 50th, 90th, 99th and 99.9th percentiles and
+     * maximum are printed, in microseconds.
+     */
+    TAWARA_EXPORT std::ostream& operator<<(std::ostream& output,
+            LatencyHistogram const& histogram);
+}; // namespace tawara
+
+/// @}
+// group utilities
+
+#endif // TAWARA_LATENCY_HISTOGRAM_H_
@@ -75,8 +75,59 @@ namespace tawara
             /// \brief Destructor
             virtual ~MasterElement() {};
 
-        private:
+            /** \brief Check if the element has a CRC-32 child.
+             *
+             * When reading, this is set to indicate if a CRC-32 element was
+             * present as the first child.
+             */
+            bool crc() const { return crc_; }
+            /// \brief Set if a CRC-32 child will be written.
+            void crc(bool crc) { crc_ = crc; }
+
+            /** \brief Check if the CRC-32 is verified when reading.
+             *
+             * Verifying the CRC requires reading the entire body of the
+             * element an extra time. The default is false.
+             */
+            bool verify_crc() const { return verify_crc_; }
+            /// \brief Set if the CRC-32 is verified when reading.
+            void verify_crc(bool verify_crc) { verify_crc_ = verify_crc; }
+
+            /// \brief Get the total size of the element.
+            virtual std::streamsize size() const;
+
+            /** \brief Element writing.
+             *
+             * If a CRC-32 child is to be written, the body of the element is
+             * written to a buffer first so that its CRC can be calculated.
+             */
+            virtual std::streamsize write(std::ostream& output);
+
+            /** \brief Element reading.
+             *
+             * If the first child is a CRC-32 element, it is read and removed
+             * from the body passed to read_body(). If verify_crc() is true,
+             * the CRC of the rest of the body is checked against it.
+             *
+             * \throw BadCRC if the CRC is being verified and does not match.
+             */
+            virtual std::streamsize read(std::istream& input);
+
+        protected:
+            /// \brief The size of a CRC-32 element.
+            static std::streamsize const crc_size_ = 6;
+
             bool crc_;
+            bool verify_crc_;
+
+            /** \brief Write a CRC-32 element.
+             *
+             * \param[in] value The CRC value.
+             * \param[in] output The stream to write to.
+             * \return The number of bytes written.
+             */
+            static std::streamsize write_crc(uint32_t value,
+                    std::ostream& output);
     }; // class MasterElement
 }; // namespace tawara
 
@@ -203,29 +203,28 @@ namespace tawara
             /// \brief Get the number of blocks.
             virtual size_type count() const { return blocks_.size(); }
             /// \brief Remove all blocks.
-            virtual void clear() { blocks_.clear(); }
+            virtual void clear() { blocks_.clear(); push_times_.clear(); }
 
             /** \brief Erase the block at the specified iterator.
              *
              * \param[in] position The position to erase at.
              */
             virtual void erase(Iterator position)
-                { blocks_.erase(position.iter_); }
+                { blocks_.erase(position.iter_); push_times_.clear(); }
             /** \brief Erase a range of blocks.
              *
              * \param[in] first The start of the range.
              * \param[in] last The end of the range.
              */
             virtual void erase(Iterator first, Iterator last)
-                { blocks_.erase(first.iter_, last.iter_); }
+                { blocks_.erase(first.iter_, last.iter_); push_times_.clear(); }
 
             /** \brief Add a block to this cluster.
              *
              * The cluster must be in the writable state. This means that
              * write() has been called and finalise() has not been called.
              */
-            virtual void push_back(value_type const& value)
-                { blocks_.push_back(value); }
+            virtual void push_back(value_type const& value);
 
             /// \brief Finalise writing of the cluster.
             std::streamsize finalise(std::ostream& output);
@@ -233,6 +232,8 @@ namespace tawara
         protected:
             /// Block storage
             BlockStore blocks_;
+            /// The times the blocks were pushed, if statistics are kept
+            std::vector<boost::posix_time::ptime> push_times_;
 
             /// \brief Get the size of the blocks in this cluster.
             std::streamsize blocks_size() const;
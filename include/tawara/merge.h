@@ -0,0 +1,104 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#if !defined(TAWARA_MERGE_H_)
+#define TAWARA_MERGE_H_
+
+#include <iostream>
+#include <map>
+#include <stdint.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /// \brief A map from the track numbers of a merge input to the track
+    /// numbers in the merged document.
+    typedef std::map<uint64_t, uint64_t> TrackNumberMap;
+
+    /** \brief Merge several Tawara documents into one.
+     *
+     * The blocks of all the input documents are written into a single
+     * segment in order of their absolute timestamp, which is the segment's
+     * date plus the block's time within the segment. The inputs are read in
+     * a single streaming pass: only the header of the next block of each
+     * input is kept in memory, and block data is copied through without
+     * decoding the frames.
+     *
+     * The tracks of all the inputs are renumbered so that track numbers are
+     * unique in the merged document, in the order of the inputs. Track UIDs
+     * are kept, unless a UID has already been used by an earlier input, in
+     * which case a new UID is generated. Track operations that refer to a
+     * changed UID are not updated.
+     *
+     * The merged segment uses the smallest timecode scale and the earliest
+     * date of the inputs, or the time of the earliest block if that is
+     * before it. Block timecodes, and the durations and references of
+     * BlockGroups, are rounded down to the merged timecode scale.
+     *
+     * \param[in] inputs The streams to read the documents to merge from. Each
+     * must be positioned at the start of its document.
+     * \param[in] output The stream to write the merged document to. It should
+     * be empty.
+     * \param[in] cluster_span The maximum time span, in nanoseconds, of the
+     * blocks in each cluster of the merged document.
+     * \return The map from old track numbers to new track numbers for each
+     * input, in the order of the inputs.
+     * \exception NotEBML if an input is not an EBML document.
+     * \exception NotTawara if an input is not a Tawara document.
+     * \exception BadReadVersion if an input requires a newer EBML parser.
+     * \exception BadDocReadVersion if an input requires a newer Tawara
+     * parser.
+     * \exception ValueOutOfRange if a block of an input is before the first
+     * block of every input.
+     * \exception UnknownTrack if a block of an input belongs to a track that
+     * is not in the input's Tracks.
+     */
+    TAWARA_EXPORT std::vector<TrackNumberMap> merge(
+            std::vector<std::istream*> const& inputs, std::iostream& output,
+            int64_t cluster_span=1000000000);
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_MERGE_H_
+
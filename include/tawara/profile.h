@@ -0,0 +1,175 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_PROFILE_H_)
+#define TAWARA_PROFILE_H_
+
+#include <map>
+#include <stdint.h>
+#include <string>
+#include <tawara/block.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief Statistics of the blocks of one track.
+     *
+     * Timecodes are absolute (the cluster timecode plus the block
+     * timecode), in the units of the segment's timecode scale. Gaps are the
+     * differences between the timecodes of consecutive blocks of the track,
+     * in file order. A laced block counts as one block, however many frames
+     * it holds, because the frames are not read.
+     */
+    struct TAWARA_EXPORT TrackProfile
+    {
+        TrackProfile();
+
+        /// \brief Add a block, which follows all blocks already added.
+        void add(int64_t timecode, std::streamsize size,
+                Block::LacingType lacing);
+        /** \brief Add the blocks of another profile of the same track.
+         *
+         * The blocks of the other profile must follow the blocks of this
+         * one in the file. The gap between the two is counted.
+         */
+        TrackProfile& operator+=(TrackProfile const& rhs);
+
+        /// \brief Get the mean gap between blocks, or 0 if no gaps.
+        double mean_gap() const;
+        /// \brief Get the jitter (standard deviation) of the gaps.
+        double jitter() const;
+        /// \brief Get the time from the first to the last block.
+        int64_t span() const { return blocks == 0 ? 0 : last - first; }
+
+        /// \brief The number of blocks.
+        uint64_t blocks;
+        /// \brief The total size of the block elements, in bytes.
+        uint64_t bytes;
+        /// \brief The timecode of the first block.
+        int64_t first;
+        /// \brief The timecode of the last block.
+        int64_t last;
+        /// \brief The number of gaps (one less than the number of blocks).
+        uint64_t gaps;
+        /// \brief The smallest gap. Negative if timecodes went backwards.
+        int64_t min_gap;
+        /// \brief The largest gap.
+        int64_t max_gap;
+        /// \brief The sum of the gaps.
+        double gap_sum;
+        /// \brief The sum of the squares of the gaps.
+        double gap_sq_sum;
+        /// \brief The number of blocks using each lacing type.
+        uint64_t lacing[3];
+    }; // struct TrackProfile
+
+
+    /// \brief The result of profiling a Tawara document.
+    struct TAWARA_EXPORT ProfileReport
+    {
+        ProfileReport()
+            : timecode_scale(0), clusters(0), bad_clusters(0), blocks(0),
+            bytes(0), seconds(0), threads(0)
+        {
+        }
+
+        /// \brief Get the scan throughput, in bytes per second.
+        double throughput() const
+            { return seconds > 0 ? bytes / seconds : 0; }
+
+        /// \brief The segment's timecode scale, in nanoseconds.
+        uint64_t timecode_scale;
+        /// \brief The statistics of each track, by track number.
+        std::map<uint64_t, TrackProfile> tracks;
+        /// \brief The number of clusters scanned.
+        uint64_t clusters;
+        /// \brief The number of clusters that could not be scanned.
+        uint64_t bad_clusters;
+        /** \brief The errors found while scanning, by stream position.
+         *
+         * Each error is named after the type of the exception raised. The
+         * position is that of an unreadable cluster, or of the damaged
+         * element that stopped the search for clusters.
+         */
+        std::map<std::streamsize, std::string> errors;
+        /// \brief The number of blocks scanned.
+        uint64_t blocks;
+        /// \brief The total size of the clusters scanned, in bytes.
+        uint64_t bytes;
+        /** \brief The cluster size histogram.
+         *
+         * Entry n counts the clusters with a size from 2^n up to, but not
+         * including, 2^(n+1) bytes.
+         */
+        std::vector<uint64_t> cluster_sizes;
+        /// \brief The time taken to scan the clusters, in seconds.
+        double seconds;
+        /// \brief The number of threads used.
+        unsigned int threads;
+    }; // struct ProfileReport
+
+
+    /** \brief Gather statistics of the blocks in a Tawara document.
+     *
+     * Only the headers of the clusters and blocks are read (see
+     * read_block_header()); no frame data is loaded. The clusters are found
+     * by skipping over the segment's level 1 elements, and are then scanned
+     * in parallel, with each thread opening the file separately. Clusters
+     * that cannot be read are counted, their errors recorded, and skipped.
+     *
+     * \param[in] path The path of the file to profile.
+     * \param[in] threads The number of threads to use. If 0, one thread is
+     * used per processor core.
+     * \return The statistics.
+     * \exception ReadError if the file cannot be opened.
+     * \exception NotEBML, NotTawara or InvalidChildID if the file is not a
+     * Tawara document.
+     */
+    TAWARA_EXPORT ProfileReport profile(std::string const& path,
+            unsigned int threads=0);
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_PROFILE_H_
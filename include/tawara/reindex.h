@@ -0,0 +1,83 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_REINDEX_H_)
+#define TAWARA_REINDEX_H_
+
+#include <iostream>
+#include <tawara/win_dll.h>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief Add Cues to an existing Tawara document in place.
+     *
+     * The clusters of the document are scanned and a CuePoint is created
+     * for each cluster timecode, with a CueTrackPosition for each track that
+     * has a block in the cluster. The clusters themselves are not changed.
+     *
+     * The new Cues are written, in order of preference, into the padding
+     * after the SeekHead, into another Void element that is large enough,
+     * or at the end of the segment. Any existing Cues are blanked out with
+     * Void elements. The SeekHead is then rewritten in place, along with the
+     * SegmentInfo if it follows the SeekHead. If the SeekHead no longer fits
+     * in its space, it is moved to the end of the segment.
+     *
+     * Writing at the end of the segment is only possible if the segment is
+     * the last thing in the stream. Its size is updated to match.
+     *
+     * \param[in] stream The stream holding the document, opened for reading
+     * and writing, with the read pointer at the start of the document.
+     * \param[in] block_numbers If true, the number of the first block of
+     * each track in the cluster is recorded in the cues.
+     * \exception NotEBML if the stream is not an EBML document.
+     * \exception NotTawara if the stream is not a Tawara document.
+     * \exception NoIndexSpace if there is no room for the new SeekHead.
+     */
+    TAWARA_EXPORT void reindex(std::iostream& stream,
+            bool block_numbers=false);
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_REINDEX_H_
+
@@ -39,12 +39,16 @@
 #if !defined(TAWARA_SEGMENT_H_)
 #define TAWARA_SEGMENT_H_
 
+#include <algorithm>
+#include <limits>
 #include <map>
 #include <tawara/master_element.h>
 #include <tawara/file_cluster.h>
+#include <tawara/io_stats.h>
 #include <tawara/memory_cluster.h>
 #include <tawara/metaseek.h>
 #include <tawara/segment_info.h>
+#include <tawara/trace.h>
 #include <tawara/win_dll.h>
 
 /// \addtogroup elements Elements
@@ -52,6 +56,8 @@
 
 namespace tawara
 {
+    class Cues;
+
     /** \brief The Segment element.
      *
      * A segment makes up the body of a Tawara document. It is the only top-level
@@ -77,6 +83,15 @@ namespace tawara
      * meta-seek element (if present) and filling in the index table. The child
      * elements are then read directly from the file as needed. The segment
      * does not need to be closed once reading is complete.
+     *
+     * If CRC verification is enabled on the segment (see
+     * MasterElement::verify_crc()) before it is read, the segment information
+     * and any clusters read through the cluster iterators will have their
+     * CRC-32 elements verified as they are read.
+     *
+     * If the segment's tracks compress their frames using dictionaries, the
+     * dictionaries are read from the Tracks element the first time a cluster
+     * is read through the cluster or block iterators (see dictionaries()).
      */
     class TAWARA_EXPORT Segment : public MasterElement
     {
@@ -125,6 +140,9 @@ namespace tawara
                         {
                             stream_.seekg(segment_->to_stream_offset(
                                         first_cluster->second));
+                            TAWARA_TRACE(SEEK, ids::Cluster,
+                                    segment_->to_stream_offset(
+                                        first_cluster->second), 0);
                             open_cluster();
                         }
                         // Otherwise there are no clusters so this iterator
@@ -134,6 +152,25 @@ namespace tawara
                         stream_.seekg(current_pos);
                     }
 
+                    /** \brief Positioned constructor.
+                     *
+                     * \param[in] segment The segment containing the clusters.
+                     * \param[in] stream The stream to read clusters from.
+                     * \param[in] pos The position in the stream of the
+                     * cluster to start from.
+                     */
+                    ClusterIteratorBase(Segment const* segment,
+                            std::istream& stream, std::streampos pos)
+                        : segment_(segment), stream_(stream)
+                    {
+                        std::streampos current_pos(stream_.tellg());
+                        stream_.seekg(pos);
+                        TAWARA_TRACE(SEEK, ids::Cluster, pos, 0);
+                        open_cluster();
+                        // Restore the read position
+                        stream_.seekg(current_pos);
+                    }
+
                     /** \brief Templated base constructor.
                      *
                      * Used to provide interoperability with compatible
@@ -170,6 +207,10 @@ namespace tawara
                         }
 
                         boost::shared_ptr<ClusterType> new_cluster(new ClusterType);
+                        new_cluster->verify_crc(segment_->verify_crc());
+                        new_cluster->dictionaries(
+                                segment_->cluster_dictionaries(stream_));
+                        new_cluster->stats(segment_->stats());
                         new_cluster->read(stream_);
 
                         cluster_.swap(new_cluster);
@@ -184,6 +225,8 @@ namespace tawara
                         stream_.seekg(cluster_->offset());
                         // Skip the cluster
                         stream_.seekg(cluster_->size(), std::ios::cur);
+                        TAWARA_TRACE(SEEK, ids::Cluster,
+                                cluster_->offset() + cluster_->size(), 0);
                         // Search for the next cluster
                         while(true)
                         {
@@ -200,7 +243,7 @@ namespace tawara
                                 // Attempt to open a cluster
                                 open_cluster();
                             }
-                            catch (InvalidChildID())
+                            catch (InvalidChildID&)
                             {
                                 // The next element was not a cluster; skip it
                                 skip_read(stream_, false);
@@ -398,6 +441,225 @@ namespace tawara
                     FileCluster::Iterator> FileBlockIterator;
 
 
+            /** \brief File-based, filtered block iterator.
+             *
+             * This iterator provides access to the blocks in the segment that
+             * belong to a set of tracks, stored across all the clusters.
+             * Blocks from other tracks are passed over by reading only their
+             * block headers; their frame data is never read from the stream.
+             *
+             * The iterator may also be limited to a range of time, in which
+             * case only blocks with an absolute timestamp in that range are
+             * provided, and iteration ends when a cluster starting after the
+             * range is reached.
+             */
+            class TAWARA_EXPORT FilteredBlockIterator
+                : public boost::iterator_facade<FilteredBlockIterator,
+                    BlockElement, boost::forward_traversal_tag>
+            {
+                public:
+                    /** \brief Constructor.
+                     *
+                     * \param[in] segment The segment containing the clusters.
+                     * \param[in] cluster The cluster to read blocks from.
+                     * \param[in] tracks The track numbers to iterate over. If
+                     * empty, all blocks are iterated over.
+                     */
+                    FilteredBlockIterator(Segment* segment,
+                            FileClusterIterator const& cluster,
+                            FileCluster::TrackSet const& tracks)
+                        : segment_(segment), cluster_(cluster), tracks_(tracks),
+                        ranged_(false), begin_tc_(0), end_tc_(0)
+                    {
+                        next_cluster_with_blocks();
+                    }
+
+                    /** \brief Time-range constructor.
+                     *
+                     * \param[in] segment The segment containing the clusters.
+                     * \param[in] cluster The cluster to read blocks from.
+                     * \param[in] tracks The track numbers to iterate over. If
+                     * empty, all blocks are iterated over.
+                     * \param[in] t_begin The start of the time range, in
+                     * nanoseconds.
+                     * \param[in] t_end The end of the time range, in
+                     * nanoseconds. Blocks at this time are not included.
+                     */
+                    FilteredBlockIterator(Segment* segment,
+                            FileClusterIterator const& cluster,
+                            FileCluster::TrackSet const& tracks,
+                            int64_t t_begin, int64_t t_end)
+                        : segment_(segment), cluster_(cluster), tracks_(tracks),
+                        ranged_(true),
+                        begin_tc_(segment->to_timecode(t_begin)),
+                        end_tc_(segment->to_timecode(t_end))
+                    {
+                        next_cluster_with_blocks();
+                    }
+
+                    /// \brief Access to the cluster for the current block.
+                    FileClusterIterator cluster() const
+                        { return cluster_; }
+
+                    /// \brief Get the track numbers being iterated over.
+                    FileCluster::TrackSet const& tracks() const
+                        { return tracks_; }
+
+                    /** \brief Get the absolute timestamp of the current
+                     * block.
+                     *
+                     * The timestamp is the sum of the cluster's timecode and
+                     * the block's timecode, scaled by the segment's timecode
+                     * scale, giving nanoseconds.
+                     */
+                    int64_t timestamp() const
+                    {
+                        return (static_cast<int64_t>(cluster_->timecode()) +
+                                block_->timecode()) *
+                            static_cast<int64_t>(segment_->info.timecode_scale());
+                    }
+
+                protected:
+                    // Necessary for Boost::iterator implementation.
+                    friend class boost::iterator_core_access;
+
+                    // Integrate with owning container.
+                    friend class Segment;
+
+                    Segment* segment_;
+                    FileClusterIterator cluster_;
+                    FileCluster::Iterator block_;
+                    FileCluster::TrackSet tracks_;
+                    bool ranged_;
+                    // The time range in the segment's timecode units, with
+                    // end_tc_ not included.
+                    int64_t begin_tc_;
+                    int64_t end_tc_;
+
+                    /** \brief Open the blocks of the current cluster.
+                     *
+                     * \return False if the cluster cannot contain matching
+                     * blocks.
+                     */
+                    bool open_blocks()
+                    {
+                        if (!ranged_)
+                        {
+                            if (cluster_->has_summary() &&
+                                    !cluster_->summary().may_contain(tracks_,
+                                        std::numeric_limits<int16_t>::min(),
+                                        std::numeric_limits<int16_t>::max()))
+                            {
+                                // The summary shows there are no blocks of
+                                // interest, so the blocks need not be read.
+                                return false;
+                            }
+                            block_ = cluster_->begin(tracks_);
+                            return true;
+                        }
+                        int64_t cluster_tc(cluster_->timecode());
+                        if (cluster_tc >= end_tc_)
+                        {
+                            // This cluster and all following it start after
+                            // the time range, so iteration is over.
+                            cluster_.cluster_.reset();
+                            return false;
+                        }
+                        int64_t first(begin_tc_ - cluster_tc);
+                        int64_t last(end_tc_ - 1 - cluster_tc);
+                        if (first > std::numeric_limits<int16_t>::max() ||
+                                last < std::numeric_limits<int16_t>::min())
+                        {
+                            // No block timecode in this cluster can reach
+                            // the range.
+                            return false;
+                        }
+                        first = std::max(first, static_cast<int64_t>(
+                                    std::numeric_limits<int16_t>::min()));
+                        last = std::min(last, static_cast<int64_t>(
+                                    std::numeric_limits<int16_t>::max()));
+                        if (cluster_->has_summary() &&
+                                !cluster_->summary().may_contain(tracks_,
+                                    static_cast<int16_t>(first),
+                                    static_cast<int16_t>(last)))
+                        {
+                            return false;
+                        }
+                        block_ = cluster_->begin(tracks_,
+                                static_cast<int16_t>(first),
+                                static_cast<int16_t>(last));
+                        return true;
+                    }
+
+                    /** \brief Run through clusters from the current cluster
+                     * until one with a matching block is found.
+                     */
+                    void next_cluster_with_blocks()
+                    {
+                        while (cluster_.cluster_)
+                        {
+                            if (open_blocks())
+                            {
+                                if (block_ != cluster_->end())
+                                {
+                                    break;
+                                }
+                            }
+                            else if (!cluster_.cluster_)
+                            {
+                                break;
+                            }
+                            ++cluster_;
+                        }
+                    }
+
+                    /// \brief Increment the iterator to the next block.
+                    void increment()
+                    {
+                        ++block_;
+                        if (block_ == cluster_->end())
+                        {
+                            // The end of the cluster has been reached, so go
+                            // through the clusters to find the next with
+                            // matching blocks.
+                            ++cluster_;
+                            next_cluster_with_blocks();
+                        }
+                    }
+
+                    /** \brief Test for equality with another iterator.
+                     *
+                     * \param[in] other The other iterator.
+                     */
+                    bool equal(FilteredBlockIterator const& other) const
+                    {
+                        if (cluster_ == other.cluster_)
+                        {
+                            if (!cluster_.cluster_)
+                            {
+                                return true;
+                            }
+                            else
+                            {
+                                return block_ == other.block_;
+                            }
+                        }
+                        else
+                        {
+                            return false;
+                        }
+                    }
+
+                    /** \brief Dereference the iterator to get a pointer to the
+                     * block.
+                     */
+                    BlockElement& dereference() const
+                    {
+                        return *block_;
+                    }
+            };
+
+
             //////////////////////////////////////////////////////////////////
             // Iterator access
             //////////////////////////////////////////////////////////////////
@@ -455,6 +717,69 @@ namespace tawara
              */
             FileBlockIterator blocks_end_file(std::istream& stream);
 
+            /** \brief Access the start of the blocks of a set of tracks.
+             *
+             * Gets an iterator pointing to the first block in the segment
+             * that belongs to one of the given tracks, using the file-based
+             * cluster implementation. Only the headers of blocks from other
+             * tracks are read.
+             *
+             * \param[in] stream The stream to read blocks from.
+             * \param[in] tracks The track numbers to iterate over.
+             */
+            FilteredBlockIterator blocks_begin_file(std::istream& stream,
+                    FileCluster::TrackSet const& tracks);
+            /** \brief Access the end of the blocks of a set of tracks.
+             *
+             * Gets an iterator pointing to the last block in the segment,
+             * for use with blocks_begin_file(std::istream&,
+             * FileCluster::TrackSet const&).
+             */
+            FilteredBlockIterator blocks_end_file(std::istream& stream,
+                    FileCluster::TrackSet const& tracks);
+
+            /** \brief Access the clusters from a point in time.
+             *
+             * Gets an iterator pointing to the last cluster in the segment
+             * with a timecode at or before the given time, using the
+             * file-based cluster implementation. If every cluster starts
+             * after the time, the first cluster is used.
+             *
+             * If the segment has a Cues element, it is used to jump to the
+             * cluster of the last cue point at or before the time. The Cues
+             * element is read once and kept for later calls. Only cluster
+             * headers are read while searching, so the clusters should be
+             * stored in time order.
+             *
+             * \param[in] stream The stream to read clusters from.
+             * \param[in] time The time to find, in nanoseconds.
+             */
+            FileClusterIterator clusters_at_time(std::istream& stream,
+                    int64_t time);
+
+            /** \brief Access the blocks within a range of time.
+             *
+             * Gets an iterator pointing to the first block in the segment
+             * that belongs to one of the given tracks and has an absolute
+             * timestamp in the range [t_begin, t_end), using the file-based
+             * cluster implementation. The iterator's timestamp() method gives
+             * the absolute timestamp of each block.
+             *
+             * The first cluster searched is found with clusters_at_time().
+             * Iteration stops once a cluster starting at or after t_end is
+             * reached, so the clusters should be stored in time order. The
+             * end of the range is given by blocks_end_file(stream, tracks).
+             *
+             * \param[in] stream The stream to read blocks from.
+             * \param[in] t_begin The start of the range, in nanoseconds.
+             * \param[in] t_end The end of the range, in nanoseconds.
+             * \param[in] tracks The track numbers to iterate over. If empty,
+             * blocks from all tracks are iterated over.
+             */
+            FilteredBlockIterator blocks_in_range(std::istream& stream,
+                    int64_t t_begin, int64_t t_end,
+                    FileCluster::TrackSet const& tracks);
+
 
             //////////////////////////////////////////////////////////////////
             // Segment interface
@@ -477,6 +802,30 @@ namespace tawara
             /// \brief Set the padding size.
             void pad_size(std::streamsize pad_size) { pad_size_ = pad_size; }
 
+            /** \brief Get the dictionaries given to clusters read through the
+             * iterators.
+             *
+             * These are usually the segment's track dictionaries, from
+             * Tracks::dictionaries(). If none have been set, they are read
+             * from the segment's Tracks element when the first cluster is
+             * read through the iterators.
+             */
+            DictionaryMapPtr dictionaries() const { return dictionaries_; }
+            /// \brief Set the dictionaries given to clusters that are read.
+            void dictionaries(DictionaryMapPtr dictionaries)
+                { dictionaries_ = dictionaries; }
+
+            /** \brief Get the statistics updated by this segment.
+             *
+             * The clusters read through the iterators are given these
+             * statistics, and the time spent finalising the segment is
+             * counted in them. Clusters that are written must be given the
+             * statistics directly (see Cluster::stats()).
+             */
+            IOStats::Ptr stats() const { return stats_; }
+            /// \brief Set the statistics updated by this segment.
+            void stats(IOStats::Ptr stats) { stats_ = stats; }
+
             /// \brief Get the total size of the element.
             std::streamsize size() const;
 
@@ -532,6 +881,24 @@ namespace tawara
              */
             std::streamsize to_stream_offset(std::streamsize seg_offset) const;
 
+            /** \brief Get the dictionaries for clusters read from a stream.
+             *
+             * If no dictionaries have been set, they are read from the
+             * segment's Tracks element the first time this is called. The
+             * read position of the stream is preserved.
+             *
+             * \throw NoTracks if the index does not point at a Tracks
+             * element.
+             */
+            DictionaryMapPtr cluster_dictionaries(std::istream& stream) const;
+
+            /** \brief Convert a time into the segment's timecode units.
+             *
+             * The time, in nanoseconds, is divided by the timecode scale,
+             * rounding up.
+             */
+            int64_t to_timecode(int64_t time) const;
+
         protected:
             /// The size of the padding to place at the start of the file.
             std::streamsize pad_size_;
@@ -539,6 +906,16 @@ namespace tawara
             std::streamsize size_;
             /// If the segment is currently being written.
             bool writing_;
+            /// The dictionaries given to clusters read through the iterators.
+            mutable DictionaryMapPtr dictionaries_;
+            /// If the dictionaries have been looked for in the Tracks element.
+            mutable bool read_dictionaries_;
+            /// The statistics given to clusters read through the iterators.
+            IOStats::Ptr stats_;
+            /// The Cues element, once read by clusters_at_time().
+            boost::shared_ptr<Cues> cues_;
+            /// The segment offset the cached Cues element was read from.
+            std::streamsize cues_pos_;
 
             /** \brief Get the size of the body of this element.
              *
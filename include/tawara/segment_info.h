@@ -201,6 +201,10 @@ namespace tawara
             double duration() const { return duration_.value(); }
             /// \brief Set the segment's duration.
             void duration(double duration);
+            /// \brief Check if the segment's duration is set.
+            bool has_duration() const { return have_duration_; }
+            /// \brief Clear the segment's duration, so that it is not written.
+            void clear_duration() { have_duration_ = false; }
 
             /** \brief Get the segment's date.
              *
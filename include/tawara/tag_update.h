@@ -0,0 +1,110 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_TAG_UPDATE_H_)
+#define TAWARA_TAG_UPDATE_H_
+
+#include <iostream>
+#include <tawara/segment.h>
+#include <tawara/tags.h>
+#include <tawara/win_dll.h>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief Write the Tags of a segment being written, with padding.
+     *
+     * The Tags are written at the current write position, followed by a
+     * Void element of the given size, and their position is recorded in the
+     * segment's index. This should be called after the segment has been
+     * started and before the first cluster is written, so that the tags can
+     * be found and read without scanning the clusters. The padding gives
+     * update_tags() room to change the tags in place later.
+     *
+     * \param[in] output The stream to write to.
+     * \param[in] segment The segment being written.
+     * \param[in] tags The tags to write.
+     * \param[in] padding The size of the Void element to reserve after the
+     * tags. It is increased to 2 bytes, the smallest Void element, if it is
+     * 1 byte.
+     * \return The number of bytes written, including the padding.
+     * \exception NoTags if the tags are empty.
+     */
+    TAWARA_EXPORT std::streamsize write_tags(std::ostream& output,
+            Segment& segment, Tags& tags, std::streamsize padding);
+
+    /** \brief Replace the Tags of an existing Tawara document in place.
+     *
+     * If the new tags fit in the space of the existing Tags and any Void
+     * elements after them, they are written over the existing ones and the
+     * rest of the space is padded with a Void element. Nothing else in the
+     * document is changed.
+     *
+     * Otherwise, the new tags are written, in order of preference, into the
+     * padding after the SeekHead, into another Void element that is large
+     * enough, or at the end of the segment. The existing Tags are blanked
+     * out with a Void element. The SeekHead is then rewritten in place,
+     * along with the SegmentInfo if it follows the SeekHead. If the SeekHead
+     * no longer fits in its space, it is moved to the end of the segment.
+     *
+     * Writing at the end of the segment is only possible if the segment is
+     * the last thing in the stream. Its size is updated to match.
+     *
+     * \param[in] stream The stream holding the document, opened for reading
+     * and writing, with the read pointer at the start of the document.
+     * \param[in] tags The new tags.
+     * \param[in] padding The space to leave free after the tags when they
+     * are moved, for later updates.
+     * \exception NotEBML if the stream is not an EBML document.
+     * \exception NotTawara if the stream is not a Tawara document.
+     * \exception NoTags if the tags are empty.
+     * \exception NoIndexSpace if there is no room for the new tags or the
+     * new SeekHead.
+     */
+    TAWARA_EXPORT void update_tags(std::iostream& stream, Tags& tags,
+            std::streamsize padding=0);
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_TAG_UPDATE_H_
+
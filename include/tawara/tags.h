@@ -0,0 +1,447 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_TAGS_H_)
+#define TAWARA_TAGS_H_
+
+#include <boost/operators.hpp>
+#include <string>
+#include <tawara/binary_element.h>
+#include <tawara/master_element.h>
+#include <tawara/string_element.h>
+#include <tawara/uint_element.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup elements Elements
+/// @{
+
+namespace tawara
+{
+    /** \brief The targets of a tag.
+     *
+     * A tag applies to the tracks, editions, chapters and attachments whose
+     * UIDs are listed in its Targets element. A tag with no targets applies
+     * to the whole segment.
+     */
+    class TAWARA_EXPORT Targets : public MasterElement,
+            public boost::equality_comparable<Targets>
+    {
+        public:
+            /// \brief Constructor.
+            Targets();
+
+            /// \brief Get the UIDs of the tracks the tag applies to.
+            std::vector<uint64_t> const& track_uids() const
+                { return track_uids_; }
+            /// \brief Set the UIDs of the tracks the tag applies to.
+            void track_uids(std::vector<uint64_t> const& uids)
+                { track_uids_ = uids; }
+
+            /// \brief Get the UIDs of the editions the tag applies to.
+            std::vector<uint64_t> const& edition_uids() const
+                { return edition_uids_; }
+            /// \brief Set the UIDs of the editions the tag applies to.
+            void edition_uids(std::vector<uint64_t> const& uids)
+                { edition_uids_ = uids; }
+
+            /// \brief Get the UIDs of the chapters the tag applies to.
+            std::vector<uint64_t> const& chapter_uids() const
+                { return chapter_uids_; }
+            /// \brief Set the UIDs of the chapters the tag applies to.
+            void chapter_uids(std::vector<uint64_t> const& uids)
+                { chapter_uids_ = uids; }
+
+            /// \brief Get the UIDs of the attachments the tag applies to.
+            std::vector<uint64_t> const& attachment_uids() const
+                { return attachment_uids_; }
+            /// \brief Set the UIDs of the attachments the tag applies to.
+            void attachment_uids(std::vector<uint64_t> const& uids)
+                { attachment_uids_ = uids; }
+
+            /// \brief Check if there are no targets.
+            bool empty() const;
+
+            /// \brief Equality operator.
+            friend bool operator==(Targets const& lhs, Targets const& rhs);
+
+        protected:
+            std::vector<uint64_t> track_uids_;
+            std::vector<uint64_t> edition_uids_;
+            std::vector<uint64_t> chapter_uids_;
+            std::vector<uint64_t> attachment_uids_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+    }; // class Targets
+
+    /// \brief Equality operator for the Targets element.
+    bool operator==(Targets const& lhs, Targets const& rhs);
+
+
+    /** \brief A single named value in a tag.
+     *
+     * A SimpleTag holds a name and a value, which is either a string or
+     * binary data. SimpleTags may be nested to give further information
+     * about their parent; a SimpleTag that only groups children may have no
+     * value at all.
+     */
+    class TAWARA_EXPORT SimpleTag : public MasterElement,
+            public boost::equality_comparable<SimpleTag>
+    {
+        public:
+            /// \brief Constructor.
+            SimpleTag();
+
+            /** \brief Constructor.
+             *
+             * \param[in] name The name of the tag.
+             * \param[in] value The string value of the tag.
+             */
+            SimpleTag(std::string const& name, std::string const& value);
+
+            /// \brief Get the name of the tag.
+            std::string name() const { return name_; }
+            /// \brief Set the name of the tag.
+            void name(std::string const& name) { name_ = name; }
+
+            /** \brief Get the language of the tag.
+             *
+             * The language is an ISO-639-2 code. The default is "und".
+             */
+            std::string language() const { return lang_; }
+            /// \brief Set the language of the tag.
+            void language(std::string const& language) { lang_ = language; }
+
+            /** \brief Check if this is the default value for its language.
+             *
+             * When several SimpleTags with the same name are present in
+             * different languages, the default one is used when no language
+             * is preferred. The default is true.
+             */
+            bool default_flag() const { return default_; }
+            /// \brief Set if this is the default value for its language.
+            void default_flag(bool default_flag) { default_ = default_flag; }
+
+            /// \brief Check if the tag has a string value.
+            bool has_string() const { return has_string_; }
+            /// \brief Get the string value of the tag.
+            std::string string() const { return string_; }
+            /** \brief Set the string value of the tag.
+             *
+             * Any binary value is removed.
+             */
+            void string(std::string const& value);
+
+            /// \brief Check if the tag has a binary value.
+            bool has_binary() const { return has_binary_; }
+            /// \brief Get the binary value of the tag.
+            std::vector<char> binary() const { return binary_; }
+            /** \brief Set the binary value of the tag.
+             *
+             * Any string value is removed.
+             */
+            void binary(std::vector<char> const& value);
+
+            /// \brief Remove the value of the tag.
+            void clear_value();
+
+            /// \brief Get the nested SimpleTags.
+            std::vector<SimpleTag>& children() { return children_; }
+            /// \brief Get the nested SimpleTags.
+            std::vector<SimpleTag> const& children() const
+                { return children_; }
+
+            /// \brief Equality operator.
+            friend bool operator==(SimpleTag const& lhs,
+                    SimpleTag const& rhs);
+
+        protected:
+            StringElement name_;
+            StringElement lang_;
+            UIntElement default_;
+            StringElement string_;
+            BinaryElement binary_;
+            bool has_string_;
+            bool has_binary_;
+            std::vector<SimpleTag> children_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+
+            /// \brief Reset the values to their defaults
+            void reset();
+    }; // class SimpleTag
+
+    /// \brief Equality operator for the SimpleTag element.
+    bool operator==(SimpleTag const& lhs, SimpleTag const& rhs);
+
+
+    /** \brief A tag attaches metadata to all or part of a segment.
+     *
+     * Each tag has a set of targets, which say what it applies to, and one
+     * or more SimpleTags holding the metadata itself.
+     */
+    class TAWARA_EXPORT Tag : public MasterElement,
+            public boost::equality_comparable<Tag>
+    {
+        public:
+            /// \brief Constructor.
+            Tag();
+
+            /// \brief Get the targets of the tag.
+            Targets& targets() { return targets_; }
+            /// \brief Get the targets of the tag.
+            Targets const& targets() const { return targets_; }
+
+            /** \brief Get the SimpleTags holding the tag's metadata.
+             *
+             * A tag must have at least one SimpleTag. If this is empty when
+             * write() is called, an error will occur.
+             */
+            std::vector<SimpleTag>& simple_tags() { return simple_tags_; }
+            /// \brief Get the SimpleTags holding the tag's metadata.
+            std::vector<SimpleTag> const& simple_tags() const
+                { return simple_tags_; }
+
+            /// \brief Equality operator.
+            friend bool operator==(Tag const& lhs, Tag const& rhs);
+
+        protected:
+            Targets targets_;
+            std::vector<SimpleTag> simple_tags_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+    }; // class Tag
+
+    /// \brief Equality operator for the Tag element.
+    bool operator==(Tag const& lhs, Tag const& rhs);
+
+
+    /** \brief The Tags element stores metadata about a segment.
+     *
+     * The Tags element holds a set of tags, each of which attaches named
+     * values to the segment or to some of its tracks, chapters or
+     * attachments. Tags are best placed before the clusters, with some
+     * padding after them so that they can be changed in place later (see
+     * write_tags() and update_tags()).
+     */
+    class TAWARA_EXPORT Tags : public MasterElement,
+            public boost::equality_comparable<Tags>
+    {
+        public:
+            /// \brief The value type of this container.
+            typedef std::vector<Tag>::value_type value_type;
+            /// \brief The size type of this container.
+            typedef std::vector<Tag>::size_type size_type;
+            /// \brief The reference type.
+            typedef std::vector<Tag>::reference reference;
+            /// \brief The constant reference type.
+            typedef std::vector<Tag>::const_reference const_reference;
+            /// \brief The random access iterator type.
+            typedef std::vector<Tag>::iterator iterator;
+            /// \brief The constant random access iterator type.
+            typedef std::vector<Tag>::const_iterator const_iterator;
+            /// \brief The reversed random access iterator type.
+            typedef std::vector<Tag>::reverse_iterator reverse_iterator;
+            /// \brief The constant reversed random access iterator type.
+            typedef std::vector<Tag>::const_reverse_iterator
+                const_reverse_iterator;
+
+            /// \brief Constructor.
+            Tags();
+
+            /** \brief Get the tag at the given position, with bounds
+             * checking.
+             *
+             * \return A reference to the specified tag.
+             * \throw std::out_of_range if the position is invalid.
+             */
+            virtual value_type& at(size_type pos)
+                { return tags_.at(pos); }
+            /** \brief Get the tag at the given position, with bounds
+             * checking.
+             *
+             * \return A reference to the specified tag.
+             * \throw std::out_of_range if the position is invalid.
+             */
+            virtual value_type const& at(size_type pos) const
+                { return tags_.at(pos); }
+
+            /** \brief Get a reference to a tag. No bounds checking is
+             * performed.
+             *
+             * \return A reference to the specified tag.
+             */
+            virtual value_type& operator[](size_type pos)
+                { return tags_[pos]; }
+            /** \brief Get a reference to a tag. No bounds checking is
+             * performed.
+             *
+             * \return A reference to the specified tag.
+             */
+            virtual value_type const& operator[](size_type pos) const
+                { return tags_[pos]; }
+
+            /// \brief Get an iterator to the first tag.
+            virtual iterator begin() { return tags_.begin(); }
+            /// \brief Get an iterator to the first tag.
+            virtual const_iterator begin() const { return tags_.begin(); }
+            /// \brief Get an iterator to the position past the last tag.
+            virtual iterator end() { return tags_.end(); }
+            /// \brief Get an iterator to the position past the last tag.
+            virtual const_iterator end() const { return tags_.end(); }
+            /// \brief Get a reverse iterator to the last tag.
+            virtual reverse_iterator rbegin() { return tags_.rbegin(); }
+            /// \brief Get a reverse iterator to the last tag.
+            virtual const_reverse_iterator rbegin() const
+                { return tags_.rbegin(); }
+            /** \brief Get a reverse iterator to the position before the first
+             * tag.
+             */
+            virtual reverse_iterator rend() { return tags_.rend(); }
+            /** \brief Get a reverse iterator to the position before the first
+             * tag.
+             */
+            virtual const_reverse_iterator rend() const { return tags_.rend(); }
+
+            /** \brief Check if there are no tags.
+             *
+             * An empty Tags element may not occur in a Tawara file. If this
+             * returns true, an error will occur when write() is called.
+             */
+            virtual bool empty() const { return tags_.empty(); }
+            /// \brief Get the number of tags.
+            virtual size_type count() const { return tags_.size(); }
+            /// \brief Get the maximum number of tags.
+            virtual size_type max_count() const { return tags_.max_size(); }
+
+            /// \brief Remove all tags.
+            virtual void clear() { tags_.clear(); }
+
+            /** \brief Erase the tag at the specified iterator.
+             *
+             * \param[in] position The position to erase at.
+             */
+            virtual void erase(iterator position) { tags_.erase(position); }
+            /** \brief Erase a range of tags.
+             *
+             * \param[in] first The start of the range.
+             * \param[in] last The end of the range.
+             */
+            virtual void erase(iterator first, iterator last)
+                { tags_.erase(first, last); }
+
+            /// \brief Add a tag.
+            virtual void push_back(value_type const& value)
+                { tags_.push_back(value); }
+
+            /// \brief Resizes the tags storage.
+            virtual void resize(size_type count) { tags_.resize(count); }
+
+            /** \brief Swaps the contents of this Tags element with another.
+             *
+             * \param[in] other The other Tags element
+             */
+            virtual void swap(Tags& other) { tags_.swap(other.tags_); }
+
+            /// \brief Equality operator.
+            friend bool operator==(Tags const& lhs, Tags const& rhs);
+
+        protected:
+            std::vector<Tag> tags_;
+
+            /////////////////////
+            // Element interface
+            /////////////////////
+
+            /// \brief Get the size of the body of this element.
+            virtual std::streamsize body_size() const;
+
+            /// \brief Element body writing.
+            virtual std::streamsize write_body(std::ostream& output);
+
+            /// \brief Element body loading.
+            virtual std::streamsize read_body(std::istream& input,
+                    std::streamsize size);
+    }; // class Tags
+
+    /// \brief Equality operator for the Tags element.
+    bool operator==(Tags const& lhs, Tags const& rhs);
+}; // namespace tawara
+
+/// @}
+// group elements
+
+#endif // TAWARA_TAGS_H_
+
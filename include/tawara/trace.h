@@ -0,0 +1,161 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_TRACE_H_)
+#define TAWARA_TRACE_H_
+
+#include <ios>
+#include <stdint.h>
+#include <tawara/tawara_config.h>
+#include <tawara/win_dll.h>
+
+/// \addtogroup utilities Utilities
+/// @{
+
+namespace tawara
+{
+    /** \brief An event passed to the trace callback.
+     *
+     * Events are only produced when the library is built with tracing
+     * enabled (the USE_TRACING CMake option, which defines TAWARA_TRACING
+     * in tawara_config.h) and a callback has been set with
+     * set_trace_callback().
+     */
+    struct TAWARA_EXPORT TraceEvent
+    {
+        /// \brief The types of trace event.
+        enum Type
+        {
+            /** An element's ID and size have been read and its body is
+             * about to be read. The size is the body size. */
+            ELEMENT_READ_BEGIN,
+            /// An element has been read. The size is the bytes read.
+            ELEMENT_READ_END,
+            /// An element is about to be written. The size is zero.
+            ELEMENT_WRITE_BEGIN,
+            /** An element has been written. The size is the bytes written.
+             * For a cluster, this is only the cluster's header. */
+            ELEMENT_WRITE_END,
+            /** A cluster has been opened for reading or writing. When
+             * reading, the size is the cluster's body size. When writing, it
+             * is zero. */
+            CLUSTER_OPEN,
+            /// A cluster is about to be finalised. The size is zero.
+            CLUSTER_FINALISE_BEGIN,
+            /// A cluster has been finalised. The size is the cluster's size.
+            CLUSTER_FINALISE_END,
+            /** The segment's iterators have moved the read position to
+             * the offset. The ID is the ID of the element expected there
+             * and the size is zero. */
+            SEEK
+        };
+
+        /// \brief The type of the event.
+        Type type;
+        /// \brief The ID of the element the event is about.
+        uint32_t id;
+        /// \brief The offset of the element in the stream.
+        std::streamoff offset;
+        /// \brief The size associated with the event (see Type).
+        std::streamsize size;
+    }; // struct TraceEvent
+
+
+    /** \brief The type of trace callbacks.
+     *
+     * The callback is called synchronously, in the thread doing the I/O, so
+     * it should do as little as possible (e.g. take a timestamp and append
+     * the event to a buffer). It must not throw.
+     *
+     * \param[in] event The event.
+     * \param[in] data The data pointer given to set_trace_callback().
+     */
+    typedef void (*TraceCallback)(TraceEvent const& event, void* data);
+
+
+    /** \brief Set the callback that receives trace events.
+     *
+     * There is one callback for the whole library. It should be set before
+     * any I/O starts and not changed while another thread is reading or
+     * writing. Pass a null callback to stop tracing.
+     *
+     * \param[in] callback The callback, or 0.
+     * \param[in] data A pointer passed unchanged to the callback.
+     */
+    TAWARA_EXPORT void set_trace_callback(TraceCallback callback,
+            void* data=0);
+
+    /// \brief Check if the library was built with the tracing hooks.
+    TAWARA_EXPORT bool tracing_available();
+
+
+    namespace detail
+    {
+        /// \brief The current trace callback; use set_trace_callback().
+        extern TAWARA_EXPORT TraceCallback trace_callback;
+
+        /// \brief Pass an event to the current trace callback.
+        TAWARA_EXPORT void trace(TraceEvent::Type type, uint32_t id,
+                std::streamoff offset, std::streamsize size);
+    }; // namespace detail
+}; // namespace tawara
+
+/** \brief Produce a trace event.
+ *
+ * When tracing is not compiled in, this expands to nothing. When it is, it
+ * costs a test of the callback pointer unless a callback is set.
+ */
+#if defined(TAWARA_TRACING)
+    #define TAWARA_TRACE(type, id, offset, size) \
+        do \
+        { \
+            if (tawara::detail::trace_callback) \
+            { \
+                tawara::detail::trace(tawara::TraceEvent::type, (id), \
+                        (offset), (size)); \
+            } \
+        } while (false)
+#else // defined(TAWARA_TRACING)
+    #define TAWARA_TRACE(type, id, offset, size) do {} while (false)
+#endif // defined(TAWARA_TRACING)
+
+/// @}
+// group utilities
+
+#endif // TAWARA_TRACE_H_
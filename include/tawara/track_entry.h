@@ -43,6 +43,7 @@
 #include <boost/shared_ptr.hpp>
 #include <string>
 #include <tawara/binary_element.h>
+#include <tawara/compression.h>
 #include <tawara/float_element.h>
 #include <tawara/master_element.h>
 #include <tawara/string_element.h>
@@ -289,6 +290,41 @@ namespace tawara
             /// \brief Set if this track's codec can decode damaged data.
             void decode_all(bool decode_all) { decode_all_ = decode_all; }
 
+            /** \brief Get the compression used for this track's frames.
+             *
+             * The compression is declared using a ContentEncodings element.
+             * Each block written for the track should be given the same
+             * compression (see Block::compression()); blocks record the
+             * compression they use, so they can be read without the
+             * TrackEntry.
+             */
+            Compression compression() const { return compression_; }
+            /** \brief Set the compression used for this track's frames.
+             *
+             * \exception UnsupportedCompression if the algorithm is not
+             * available.
+             */
+            void compression(Compression compression);
+
+            /** \brief Get the dictionary used to compress this track's
+             * frames.
+             *
+             * The dictionary is stored in the ContentCompSettings element of
+             * the track's ContentEncodings, so it is only stored if the track
+             * uses compression. When a track is read, its dictionary is
+             * prepared once and shared, so it should be given to the blocks
+             * of the track through Tracks::dictionaries() rather than copied.
+             */
+            CompressionDictionary::ConstPtr dictionary() const
+                { return dictionary_; }
+            /** \brief Set the dictionary used to compress this track's
+             * frames.
+             *
+             * An empty pointer means no dictionary is used.
+             */
+            void dictionary(CompressionDictionary::ConstPtr dictionary)
+                { dictionary_ = dictionary; }
+
             /** \brief Get the UIDs of overlay tracks.
              *
              * When this track has a gap in its data, the first track in the
@@ -304,7 +340,7 @@ namespace tawara
              * data comes from the blocks of its source tracks. If the track is
              * not virtual, it has its own blocks.
              */
-            bool is_virtual() const { return operation_; }
+            bool is_virtual() const { return operation_.get() != 0; }
             /** \brief Get the operation used to create this track.
              *
              * If this track is virtual, this operation specifies how to
@@ -349,6 +385,8 @@ namespace tawara
             UIntElement decode_all_;
             std::vector<UIntElement> overlays_;
             TrackOperationBase::Ptr operation_;
+            Compression compression_;
+            CompressionDictionary::ConstPtr dictionary_;
 
             /// \brief Get the size of the body of this element.
             virtual std::streamsize body_size() const;
@@ -364,6 +402,23 @@ namespace tawara
              * \param[in] input The input stream to read from.
              */
             std::streamsize read_operation(std::istream& input);
+            /// \brief Get the size of the ContentEncodings element.
+            std::streamsize encodings_size() const;
+            /** \brief Writes the ContentEncodings element.
+             *
+             * \param[in] output The output stream to write to.
+             */
+            std::streamsize write_encodings(std::ostream& output) const;
+            /** \brief Reads the ContentEncodings child element.
+             *
+             * Only a single ContentEncoding using one of the supported
+             * compression algorithms on the frames is accepted.
+             *
+             * \param[in] input The input stream to read from.
+             * \exception UnsupportedCompression if the encoding is not
+             * supported.
+             */
+            std::streamsize read_encodings(std::istream& input);
     }; // class TrackEntry
 
     bool operator==(TrackEntry const& lhs, TrackEntry const& rhs);
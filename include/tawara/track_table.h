@@ -0,0 +1,193 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_TRACK_TABLE_H_)
+#define TAWARA_TRACK_TABLE_H_
+
+#include <boost/unordered_map.hpp>
+#include <string>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+#include <tawara/win_dll.h>
+#include <vector>
+
+/// \addtogroup interfaces Interfaces
+/// @{
+
+namespace tawara
+{
+    /** \brief A read-optimised snapshot of a Tracks element.
+     *
+     * Tracks stores its entries in a map, which is convenient for editing
+     * but slow for resolving the track of every block read. A TrackTable is
+     * built once from a Tracks element and cannot be changed afterwards.
+     * Track numbers are looked up in a dense array, with a hash table for
+     * track numbers too large to store densely. Values derived from each
+     * track, such as its effective timecode scale, are calculated when the
+     * table is built.
+     *
+     * The table holds pointers to the TrackEntry elements of the Tracks
+     * element, so changes to those entries are visible through the table,
+     * but the derived values are not updated.
+     */
+    class TAWARA_EXPORT TrackTable
+    {
+        public:
+            /// \brief A track and the values derived from it.
+            struct Entry
+            {
+                /// \brief The track number.
+                uint64_t number;
+                /// \brief The track UID.
+                uint64_t uid;
+                /** \brief The length of one block timecode unit, in
+                 * nanoseconds.
+                 *
+                 * This is the segment's timecode scale multiplied by the
+                 * track's timecode scale.
+                 */
+                double timecode_scale;
+                /** \brief The default duration of blocks in the track, in
+                 * nanoseconds, or 0 if there is none.
+                 */
+                uint64_t default_duration;
+                /// \brief The track entry.
+                TrackEntry::ConstPtr track;
+            }; // struct Entry
+
+            /// \brief The size type of this container.
+            typedef std::vector<Entry>::size_type size_type;
+            /// \brief The constant random access iterator type.
+            typedef std::vector<Entry>::const_iterator const_iterator;
+
+            /** \brief Construct an empty table.
+             *
+             * The table can be filled by assigning another table to it.
+             */
+            TrackTable();
+
+            /** \brief Construct a table from a Tracks element.
+             *
+             * \param[in] tracks The tracks to put in the table.
+             * \param[in] timecode_scale The timecode scale of the segment,
+             * in nanoseconds.
+             */
+            TrackTable(Tracks const& tracks, uint64_t timecode_scale=1000000);
+
+            /** \brief Get the entry for a track number.
+             *
+             * \return The entry, or 0 if there is no track with that number.
+             */
+            Entry const* find(uint64_t number) const
+            {
+                if (number < dense_.size())
+                {
+                    return dense_[number] == npos_ ? 0 :
+                        &entries_[dense_[number]];
+                }
+                return find_in(sparse_, number);
+            }
+
+            /** \brief Get the entry for a track number.
+             *
+             * \return The entry.
+             * \throw std::out_of_range if there is no track with that number.
+             */
+            Entry const& at(uint64_t number) const;
+
+            /** \brief Get the entry for a track UID.
+             *
+             * \return The entry, or 0 if there is no track with that UID.
+             */
+            Entry const* find_uid(uint64_t uid) const
+                { return find_in(uids_, uid); }
+
+            /** \brief Get the entry for a track name.
+             *
+             * If more than one track has the name, the one with the lowest
+             * number is found.
+             *
+             * \return The entry, or 0 if there is no track with that name.
+             */
+            Entry const* find_name(std::string const& name) const
+                { return find_in(names_, name); }
+
+            /// \brief Get an iterator to the first entry, in track order.
+            const_iterator begin() const { return entries_.begin(); }
+            /// \brief Get an iterator to the position past the last entry.
+            const_iterator end() const { return entries_.end(); }
+            /// \brief Check if there are no entries.
+            bool empty() const { return entries_.empty(); }
+            /// \brief Get the number of entries.
+            size_type count() const { return entries_.size(); }
+
+        protected:
+            /// \brief The value marking an unused slot in the dense array.
+            static size_type const npos_ = static_cast<size_type>(-1);
+
+            /// \brief The entries, sorted by track number.
+            std::vector<Entry> entries_;
+            /** \brief The index in entries_ of each track number that is
+             * small enough to be stored densely.
+             */
+            std::vector<size_type> dense_;
+            /// \brief The index in entries_ of the other track numbers.
+            boost::unordered_map<uint64_t, size_type> sparse_;
+            /// \brief The index in entries_ of each UID.
+            boost::unordered_map<uint64_t, size_type> uids_;
+            /// \brief The index in entries_ of each name.
+            boost::unordered_map<std::string, size_type> names_;
+
+            /// \brief Looks up a key in one of the hash tables.
+            template<typename Key>
+            Entry const* find_in(boost::unordered_map<Key, size_type> const&
+                    table, Key const& key) const
+            {
+                typename boost::unordered_map<Key, size_type>::const_iterator
+                    it(table.find(key));
+                return it == table.end() ? 0 : &entries_[it->second];
+            }
+    }; // class TrackTable
+}; // namespace tawara
+
+/// @}
+// group interfaces
+
+#endif // TAWARA_TRACK_TABLE_H_
+
@@ -232,6 +232,17 @@ namespace tawara
             const_iterator find(key_type const& number) const
                 { return entries_.find(number); }
 
+            /** \brief Get the compression dictionaries of the tracks.
+             *
+             * Tracks that do not use a dictionary are not included. The
+             * result is intended to be given to Segment::dictionaries() when
+             * reading, and to each block when writing (see
+             * Block::dictionaries()).
+             *
+             * \return A map from track number to dictionary.
+             */
+            DictionaryMapPtr dictionaries() const;
+
             /// \brief Equality operator.
             friend bool operator==(Tracks const& lhs, Tracks const& rhs);
 
@@ -36,8 +36,8 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
-#if !defined(TAWARA_INT_ELEMENT_H_)
-#define TAWARA_INT_ELEMENT_H_
+#if !defined(TAWARA_VOID_ELEMENT_H_)
+#define TAWARA_VOID_ELEMENT_H_
 
 #include <tawara/el_ids.h>
 #include <tawara/prim_element.h>
@@ -164,5 +164,5 @@ namespace tawara
 /// @}
 // group implementations
 
-#endif // TAWARA_INT_ELEMENT_H_
+#endif // TAWARA_VOID_ELEMENT_H_
 
@@ -38,12 +38,194 @@
 
 #include <tawara/attachments.h>
 
+#include <algorithm>
 #include <boost/foreach.hpp>
+#include <fstream>
 #include <tawara/el_ids.h>
 #include <tawara/exceptions.h>
 
 using namespace tawara;
 
+// The size of the chunks used to copy attachment data between streams.
+static const std::streamsize data_chunk_size(1 << 20);
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// Copies part of a stream to another stream in chunks.
+static std::streamsize copy_data_chunks(std::istream& input,
+        std::streampos start, std::streamsize size, std::ostream& output)
+{
+    std::vector<char> buffer(std::min(size, data_chunk_size));
+    input.clear();
+    input.seekg(start);
+    std::streamsize copied(0);
+    while (copied < size)
+    {
+        std::streamsize count(std::min(size - copied,
+                    static_cast<std::streamsize>(buffer.size())));
+        input.read(&buffer[0], count);
+        if (input.gcount() != count)
+        {
+            throw ReadError() << err_pos(static_cast<std::streamsize>(start) +
+                    copied) << err_reqsize(count);
+        }
+        output.write(&buffer[0], count);
+        if (!output)
+        {
+            throw WriteError() << err_pos(output.tellp());
+        }
+        copied += count;
+    }
+    return copied;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FileData constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+FileData::FileData(std::vector<char> data)
+    : BinaryElement(ids::FileData, data), start_(0), size_(0),
+    external_(false), lazy_(false)
+{
+}
+
+
+FileData::FileData(std::string const& path)
+    : BinaryElement(ids::FileData, std::vector<char>()), start_(0),
+    size_(0), external_(true), lazy_(false)
+{
+    boost::shared_ptr<std::ifstream> file(new std::ifstream(path.c_str(),
+                std::ios::in | std::ios::binary));
+    if (!file->is_open())
+    {
+        throw ReadError() << err_name(path);
+    }
+    file->seekg(0, std::ios::end);
+    size_ = file->tellg();
+    file->seekg(0);
+    if (!*file)
+    {
+        throw ReadError() << err_name(path);
+    }
+    source_ = file;
+}
+
+
+FileData::FileData(boost::shared_ptr<std::istream> source,
+        std::streamsize size)
+    : BinaryElement(ids::FileData, std::vector<char>()), source_(source),
+    start_(0), size_(size), external_(true), lazy_(false)
+{
+    if (!source_)
+    {
+        throw ReadError();
+    }
+    start_ = source_->tellg();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FileData accessors
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize FileData::read_data(std::istream& input, std::streamsize pos,
+        char* buffer, std::streamsize count) const
+{
+    count = std::max(std::min(count, data_size() - pos),
+            static_cast<std::streamsize>(0));
+    if (count == 0)
+    {
+        return 0;
+    }
+    if (!external_)
+    {
+        std::copy(value_.begin() + pos, value_.begin() + pos + count,
+                buffer);
+        return count;
+    }
+    std::istream& data_input(source_ ? *source_ : input);
+    data_input.clear();
+    data_input.seekg(static_cast<std::streamsize>(start_) + pos);
+    data_input.read(buffer, count);
+    if (data_input.gcount() != count)
+    {
+        throw ReadError() << err_pos(static_cast<std::streamsize>(start_) +
+                pos) << err_reqsize(count);
+    }
+    return count;
+}
+
+
+std::streamsize FileData::copy_data(std::istream& input,
+        std::ostream& output) const
+{
+    if (!external_)
+    {
+        if (value_.empty())
+        {
+            return 0;
+        }
+        output.write(&value_[0], value_.size());
+        if (!output)
+        {
+            throw WriteError() << err_pos(output.tellp());
+        }
+        return value_.size();
+    }
+    return copy_data_chunks(source_ ? *source_ : input, start_, size_,
+            output);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// FileData Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize FileData::body_size() const
+{
+    return data_size();
+}
+
+
+std::streamsize FileData::read_body(std::istream& input,
+        std::streamsize size)
+{
+    if (!lazy_)
+    {
+        source_.reset();
+        external_ = false;
+        return BinaryElement::read_body(input, size);
+    }
+    value_.clear();
+    source_.reset();
+    start_ = input.tellg();
+    size_ = size;
+    external_ = true;
+    input.seekg(size, std::ios::cur);
+    if (!input)
+    {
+        throw ReadError() << err_pos(offset_) << err_reqsize(size);
+    }
+    return size;
+}
+
+
+std::streamsize FileData::write_body(std::ostream& output)
+{
+    if (!external_)
+    {
+        return BinaryElement::write_body(output);
+    }
+    if (!source_)
+    {
+        throw NoAttachedData() << err_pos(offset_);
+    }
+    return copy_data_chunks(*source_, start_, size_, output);
+}
+
 ///////////////////////////////////////////////////////////////////////////////
 // AttachedFile constructors and destructors
 ///////////////////////////////////////////////////////////////////////////////
@@ -51,7 +233,7 @@ using namespace tawara;
 AttachedFile::AttachedFile()
     : MasterElement(ids::AttachedFile), desc_(ids::FileDescription, ""),
     name_(ids::FileName, ""), mime_(ids::FileMimeType, ""),
-    uid_(ids::FileUID, 1)
+    uid_(ids::FileUID, 1), lazy_data_(false)
 {
 }
 
@@ -61,14 +243,14 @@ AttachedFile::AttachedFile(std::string const& name,
     : MasterElement(ids::AttachedFile), desc_(ids::FileDescription, ""),
     name_(ids::FileName, name),
     mime_(ids::FileMimeType, mime_type),
-    data_(data), uid_(ids::FileUID, uid)
+    data_(data), uid_(ids::FileUID, uid), lazy_data_(false)
 {
     if (uid_ == 0)
     {
         throw ValueOutOfRange() << err_id(ids::FileUID) << err_par_id(id_);
     }
 
-    if (!data_ || data_->value().empty())
+    if (!data_ || data_->data_size() == 0)
     {
         throw NoAttachedData();
     }
@@ -87,7 +269,7 @@ void AttachedFile::uid(uint64_t uid)
 
 void AttachedFile::data(FileData::Ptr& data)
 {
-    if (!data || data->value().empty())
+    if (!data || data->data_size() == 0)
     {
         throw NoAttachedData();
     }
@@ -138,7 +320,7 @@ std::streamsize AttachedFile::body_size() const
 std::streamsize AttachedFile::write_body(std::ostream& output)
 {
     assert(data_);
-    assert(!data_->value().empty());
+    assert(data_->data_size() != 0);
     assert(uid_ != 0);
 
     std::streamsize written(0);
@@ -185,8 +367,9 @@ std::streamsize AttachedFile::read_body(std::istream& input,
                 break;
             case ids::FileData:
                 data_.reset(new FileData(std::vector<char>()));
+                data_->lazy(lazy_data_);
                 read_bytes += data_->read(input);
-                if (!data_ || data_->value().empty())
+                if (!data_ || data_->data_size() == 0)
                 {
                     throw NoAttachedData();
                 }
@@ -258,7 +441,7 @@ void AttachedFile::reset()
 ///////////////////////////////////////////////////////////////////////////////
 
 Attachments::Attachments()
-    : MasterElement(ids::Attachments)
+    : MasterElement(ids::Attachments), lazy_data_(false)
 {
 }
 
@@ -327,6 +510,7 @@ std::streamsize Attachments::read_body(std::istream& input,
                         id_res.second);
         }
         AttachedFile file;
+        file.lazy_data(lazy_data_);
         read_bytes += file.read(input);
         files_.push_back(file);
     }
@@ -100,15 +100,17 @@ std::streamsize BinaryElement::write_body(std::ostream& output)
 std::streamsize BinaryElement::read_body(std::istream& input,
         std::streamsize size)
 {
-    // Read the binary data
-    std::vector<char> tmp(size);
-    input.read(&tmp[0], size);
+    // Read the binary data straight into the value, reusing its storage
+    value_.resize(size);
+    if (size > 0)
+    {
+        input.read(&value_[0], size);
+    }
     if (!input)
     {
         throw ReadError() << err_pos(offset_) <<
             err_reqsize(size);
     }
-    tmp.swap(value_);
     return value_.size();
 }
 
@@ -243,7 +243,7 @@ std::streamsize BlockGroup::read_body(std::istream& input,
 void BlockGroup::reset()
 {
     additions_.clear();
-    duration_.value(duration_.get_default());
+    duration_.value(0);
     ref_priority_.value(ref_priority_.get_default());
     ref_blocks_.clear();
     codec_state_.value(std::vector<char>());
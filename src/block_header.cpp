@@ -0,0 +1,287 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tawara/block_header.h>
+
+#include <algorithm>
+#include <tawara/element.h>
+#include <tawara/exceptions.h>
+#include <tawara/vint.h>
+#include <vector>
+
+using namespace tawara;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Accessors
+///////////////////////////////////////////////////////////////////////////////
+
+Block::LacingType BlockHeader::lacing() const
+{
+    if ((flags & 0x60) == 0x60)
+    {
+        return Block::LACING_EBML;
+    }
+    else if ((flags & 0x60) == 0x40)
+    {
+        return Block::LACING_FIXED;
+    }
+    return Block::LACING_NONE;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// I/O
+///////////////////////////////////////////////////////////////////////////////
+
+// Reads the track number, timecode and flags from the start of a block.
+static void read_header_values(std::istream& input, std::streamsize size,
+        BlockHeader& header)
+{
+    std::streampos start_pos(input.tellg());
+    if (size < 4)
+    {
+        // The block data must be at least 4 bytes, which is the size of
+        // the smallest possible header.
+        throw BadBodySize() << err_el_size(size) << err_pos(start_pos);
+    }
+
+    vint::ReadResult res = vint::read(input);
+    header.track_number = res.first;
+    char buffer[3];
+    input.read(buffer, 3);
+    if (input.fail())
+    {
+        throw tawara::ReadError() << tawara::err_pos(input.tellg());
+    }
+    header.timecode = static_cast<int16_t>(
+            (static_cast<unsigned char>(buffer[0]) << 8) |
+            static_cast<unsigned char>(buffer[1]));
+    header.flags = buffer[2];
+    if (res.second + 3 >= size)
+    {
+        // There must be at least one byte of frame data
+        throw BadBodySize() << err_el_size(size) << err_pos(start_pos);
+    }
+}
+
+
+BlockHeader tawara::read_block_header(std::istream& input)
+{
+    BlockHeader result;
+    result.offset = input.tellg();
+
+    ids::ReadResult id_res = ids::read(input);
+    result.id = id_res.first;
+    if (result.id != ids::SimpleBlock && result.id != ids::BlockGroup)
+    {
+        throw InvalidChildID() << err_id(result.id) <<
+            // The cast here makes Apple's LLVM compiler happy
+            err_pos(static_cast<std::streamsize>(result.offset));
+    }
+    vint::ReadResult size_res = vint::read(input);
+    result.size = id_res.second + size_res.second + size_res.first;
+    std::streampos body_end(static_cast<std::streamsize>(result.offset) +
+            result.size);
+
+    if (result.id == ids::SimpleBlock)
+    {
+        read_header_values(input, size_res.first, result);
+    }
+    else
+    {
+        // Search the BlockGroup's children for the Block element, skipping
+        // over any that come before it.
+        bool have_block(false);
+        while (input.tellg() < body_end)
+        {
+            ids::ReadResult child_id = ids::read(input);
+            if (child_id.first == ids::Block)
+            {
+                vint::ReadResult child_size = vint::read(input);
+                read_header_values(input, child_size.first, result);
+                have_block = true;
+                break;
+            }
+            skip_read(input, false);
+        }
+        if (!have_block)
+        {
+            throw MissingChild() << err_id(ids::Block) <<
+                err_par_id(ids::BlockGroup) << err_pos(result.offset);
+        }
+    }
+
+    // Skip the frames and any remaining children
+    input.seekg(body_end);
+    return result;
+}
+
+
+
+// The size of the buffer used to copy bytes between streams.
+static const std::streamsize copy_buffer_size(65536);
+
+std::streamsize tawara::copy_bytes(std::istream& input, std::streamsize count,
+        std::ostream& output)
+{
+    std::vector<char> buffer(std::min(count, copy_buffer_size));
+    std::streamsize remaining(count);
+    while (remaining > 0)
+    {
+        std::streamsize chunk(std::min(remaining, copy_buffer_size));
+        input.read(&buffer[0], chunk);
+        if (input.gcount() != chunk)
+        {
+            throw ReadError() << err_pos(input.tellg());
+        }
+        output.write(&buffer[0], chunk);
+        if (!output)
+        {
+            throw WriteError() << err_pos(output.tellp());
+        }
+        remaining -= chunk;
+    }
+    return count;
+}
+
+
+// Writes the track number and timecode at the start of a block.
+static std::streamsize write_header_values(uint64_t track_number,
+        int16_t timecode, std::ostream& output)
+{
+    std::streamsize written(vint::write(track_number, output));
+    output.put(static_cast<char>((timecode >> 8) & 0xFF));
+    output.put(static_cast<char>(timecode & 0xFF));
+    if (!output)
+    {
+        throw WriteError() << err_pos(output.tellp());
+    }
+    return written + 2;
+}
+
+
+std::streamsize tawara::copy_block(std::istream& input,
+        BlockHeader const& header, std::ostream& output,
+        uint64_t track_number, int16_t timecode)
+{
+    input.seekg(header.offset);
+    if (track_number == header.track_number && timecode == header.timecode)
+    {
+        // Nothing needs to be changed
+        return copy_bytes(input, header.size, output);
+    }
+
+    // Skip the ID; the header already holds it
+    ids::read(input);
+    vint::ReadResult size_res = vint::read(input);
+    std::streampos body_start(input.tellg());
+    std::streamsize written(0);
+
+    if (header.id == ids::SimpleBlock)
+    {
+        vint::ReadResult track_res = vint::read(input);
+        std::streamsize body_size(size_res.first - track_res.second +
+                vint::size(track_number));
+        written += ids::write(header.id, output);
+        written += vint::write(body_size, output);
+        written += write_header_values(track_number, timecode, output);
+        // Skip the old timecode; the flags and frames are unchanged
+        input.seekg(2, std::ios::cur);
+        written += copy_bytes(input, size_res.first - track_res.second - 2,
+                output);
+        return written;
+    }
+
+    // Find the Block child of the group so that the new sizes are known
+    // before anything is written
+    std::streampos body_end(static_cast<std::streamsize>(body_start) +
+            size_res.first);
+    std::streampos block_start(0);
+    vint::ReadResult block_size(0, 0);
+    vint::ReadResult track_res(0, 0);
+    bool have_block(false);
+    while (input.tellg() < body_end)
+    {
+        std::streampos child_start(input.tellg());
+        ids::ReadResult child_id = ids::read(input);
+        vint::ReadResult child_size = vint::read(input);
+        if (child_id.first == ids::Block)
+        {
+            block_start = child_start;
+            block_size = child_size;
+            track_res = vint::read(input);
+            have_block = true;
+            break;
+        }
+        input.seekg(child_size.first, std::ios::cur);
+    }
+    if (!have_block)
+    {
+        throw MissingChild() << err_id(ids::Block) <<
+            err_par_id(ids::BlockGroup) << err_pos(header.offset);
+    }
+    std::streamsize block_body_size(block_size.first - track_res.second +
+            vint::size(track_number));
+    std::streamsize body_size(size_res.first - block_size.second -
+            block_size.first + vint::size(block_body_size) + block_body_size);
+
+    written += ids::write(header.id, output);
+    written += vint::write(body_size, output);
+    // Copy the children before the Block
+    input.seekg(body_start);
+    written += copy_bytes(input, block_start - body_start, output);
+    // Re-encode the Block's header
+    written += ids::write(ids::Block, output);
+    written += vint::write(block_body_size, output);
+    written += write_header_values(track_number, timecode, output);
+    // Copy the Block's flags and frames and the children after the Block
+    input.seekg(static_cast<std::streamsize>(block_start) +
+            ids::size(ids::Block) + block_size.second + track_res.second + 2);
+    written += copy_bytes(input, body_end - input.tellg(), output);
+    return written;
+}
+
+
+std::streamsize tawara::copy_block(std::istream& input,
+        BlockHeader const& header, std::ostream& output)
+{
+    return copy_block(input, header, output, header.track_number,
+            header.timecode);
+}
+
@@ -40,7 +40,9 @@
 
 #include <algorithm>
 #include <boost/foreach.hpp>
+#include <boost/make_shared.hpp>
 #include <numeric>
+#include <sstream>
 #include <tawara/el_ids.h>
 #include <tawara/exceptions.h>
 #include <tawara/vint.h>
@@ -56,7 +58,19 @@ BlockImpl::BlockImpl(uint64_t track_number, int16_t timecode,
         LacingType lacing)
     : Block(track_number, timecode, lacing),
     track_num_(track_number), timecode_(timecode), invisible_(false),
-    lacing_(lacing)
+    lacing_(lacing), compression_(COMPRESSION_NONE), packed_valid_(false),
+    frame_allocs_(0)
+{
+}
+
+
+BlockImpl::BlockImpl(BlockImpl const& other)
+    : Block(other),
+    track_num_(other.track_num_), timecode_(other.timecode_),
+    invisible_(other.invisible_), lacing_(other.lacing_),
+    compression_(other.compression_), dictionaries_(other.dictionaries_),
+    frames_(other.frames_), packed_valid_(false),
+    frame_allocs_(other.frame_allocs_)
 {
 }
 
@@ -71,18 +85,34 @@ BlockImpl& BlockImpl::operator=(BlockImpl const& other)
     timecode_ = other.timecode_;
     invisible_ = other.invisible_;
     lacing_ = other.lacing_;
+    compression_ = other.compression_;
+    dictionaries_ = other.dictionaries_;
     frames_ = other.frames_;
+    packed_valid_ = false;
+    frame_allocs_ = other.frame_allocs_;
     return *this;
 }
 
 
+void BlockImpl::compression(Compression compression)
+{
+    if (!compression_available(compression))
+    {
+        throw UnsupportedCompression();
+    }
+    compression_ = compression;
+    packed_valid_ = false;
+}
+
+
 BlockImpl::size_type BlockImpl::max_count() const
 {
     if (lacing_ == LACING_NONE)
     {
         return 1;
     }
-    return frames_.max_size();
+    // The frame count of a lace is stored in a single byte
+    return 255;
 }
 
 
@@ -98,9 +128,9 @@ void BlockImpl::push_back(BlockImpl::value_type const& value)
         // Pointer has a vector, but it is empty
         throw EmptyFrame();
     }
-    if (frames_.size() >= 1 && lacing_ == LACING_NONE)
+    if (frames_.size() >= max_count())
     {
-        throw MaxLaceSizeExceeded() << err_max_lace(1) <<
+        throw MaxLaceSizeExceeded() << err_max_lace(max_count()) <<
             err_req_lace(frames_.size() + 1);
     }
     if (frames_.size() > 0 && lacing_ == LACING_FIXED &&
@@ -109,16 +139,19 @@ void BlockImpl::push_back(BlockImpl::value_type const& value)
         throw BadLacedFrameSize() << err_frame_size(value->size());
     }
     frames_.push_back(value);
+    packed_valid_ = false;
 }
 
 
 void BlockImpl::resize(BlockImpl::size_type count)
 {
-    if (count > 1 && lacing_ == LACING_NONE)
+    if (count > max_count())
     {
-        throw MaxLaceSizeExceeded() << err_max_lace(1) << err_req_lace(count);
+        throw MaxLaceSizeExceeded() << err_max_lace(max_count()) <<
+            err_req_lace(count);
     }
     frames_.resize(count);
+    packed_valid_ = false;
 }
 
 
@@ -128,7 +161,12 @@ void BlockImpl::swap(BlockImpl& other)
     std::swap(timecode_, other.timecode_);
     std::swap(invisible_, other.invisible_);
     std::swap(lacing_, other.lacing_);
+    std::swap(compression_, other.compression_);
+    dictionaries_.swap(other.dictionaries_);
     frames_.swap(other.frames_);
+    packed_.swap(other.packed_);
+    std::swap(packed_valid_, other.packed_valid_);
+    std::swap(frame_allocs_, other.frame_allocs_);
 }
 
 
@@ -148,6 +186,17 @@ std::streamsize BlockImpl::size() const
 
     hdr_size += tawara::vint::size(track_num_);
 
+    if (compression_ != COMPRESSION_NONE && !packed().empty())
+    {
+        return hdr_size + packed().size();
+    }
+    return hdr_size + payload_size();
+}
+
+
+std::streamsize BlockImpl::payload_size() const
+{
+    std::streamsize hdr_size(0);
     switch(lacing_)
     {
         case LACING_EBML:
@@ -251,12 +300,36 @@ std::streamsize BlockImpl::write(std::ostream& output, uint8_t extra_flags)
             // Nothing to do for no lacing
             break;
     }
+    std::vector<char> const* compressed(0);
+    if (compression_ != COMPRESSION_NONE && !packed().empty())
+    {
+        compressed = &packed();
+        // Bit 3 marks a compressed block
+        flags |= 0x08;
+    }
     output.put(flags);
     if (!output)
     {
         throw tawara::WriteError() << tawara::err_pos(output.tellp());
     }
     written += 1;
+    if (compressed)
+    {
+        // The lacing header and frames are stored compressed
+        output.write(&(*compressed)[0], compressed->size());
+        if (!output)
+        {
+            throw tawara::WriteError() << tawara::err_pos(output.tellp());
+        }
+        return written + compressed->size();
+    }
+    return written + write_payload(output);
+}
+
+
+std::streamsize BlockImpl::write_payload(std::ostream& output) const
+{
+    std::streamsize written(0);
     // Write the lacing header
     uint8_t num_frames(frames_.size());
     std::streamsize prev_size(0);
@@ -367,19 +440,42 @@ BlockImpl::ReadResult BlockImpl::read(std::istream& input,
     {
         lacing_ = Block::LACING_FIXED;
     }
+    bool compressed(flags & 0x08);
     // Prepare the remaining flags to be returned
-    flags &= 0x8F;
+    flags &= 0x87;
     // Check there is still data left for the frames
     if (read >= size)
     {
         throw BadBodySize() << err_el_size(size) << err_pos(start_pos);
     }
+    if (compressed)
+    {
+        read += read_compressed_frames(input, size - read);
+    }
+    else
+    {
+        read += read_payload(input, size - read);
+    }
+
+    if (read != size)
+    {
+        throw BadBodySize() << err_el_size(size) << err_pos(start_pos);
+    }
+
+    return std::make_pair(read, flags);
+}
+
+
+std::streamsize BlockImpl::read_payload(std::istream& input,
+        std::streamsize size)
+{
+    std::streamsize read(0);
     // Read the frames according to the lace style used
     char frame_count(0);
     switch (lacing_)
     {
         case Block::LACING_EBML:
-            read += read_ebml_laced_frames(input, size - read);
+            read += read_ebml_laced_frames(input, size);
             break;
         case Block::LACING_FIXED:
             // Get the number of frames
@@ -389,20 +485,114 @@ BlockImpl::ReadResult BlockImpl::read(std::istream& input,
                 throw tawara::ReadError() << tawara::err_pos(input.tellg());
             }
             read += 1;
-            read += read_fixed_frames(input, size - read, frame_count);
+            read += read_fixed_frames(input, size - read,
+                    static_cast<unsigned char>(frame_count));
             break;
         case Block::LACING_NONE:
             // Read the remaining data as a single "fixed-lace" frame
-            read += read_fixed_frames(input, size - read, 1);
+            read += read_fixed_frames(input, size, 1);
             break;
     }
+    return read;
+}
 
-    if (read != size)
+
+// Presents a buffer of decompressed frames as a stream.
+class FrameBuffer : public std::streambuf
+{
+    public:
+        FrameBuffer(char* data, std::size_t size)
+        {
+            setg(data, data, data + size);
+        }
+}; // class FrameBuffer
+
+
+std::streamsize BlockImpl::read_compressed_frames(std::istream& input,
+        std::streamsize size)
+{
+    std::streampos start_pos(input.tellg());
+    // The compressed data starts with the algorithm and the uncompressed size
+    char byte(0);
+    input.get(byte);
+    if (input.fail())
+    {
+        throw ReadError() << err_pos(input.tellg());
+    }
+    // The top bit of the algorithm marks the use of the track's dictionary
+    unsigned char algo(byte & 0x7F);
+    CompressionDictionary const* dict(0);
+    try
+    {
+        compression_ = algo_to_compression(algo);
+        if (!compression_available(compression_))
+        {
+            throw UnsupportedCompression() << err_comp_algo(algo);
+        }
+    }
+    catch (UnsupportedCompression& e)
+    {
+        e << err_pos(start_pos);
+        throw;
+    }
+    if (byte & 0x80)
+    {
+        dict = dictionary();
+        if (!dict)
+        {
+            throw MissingDictionary() << err_track_num(track_num_) <<
+                err_pos(start_pos);
+        }
+    }
+    vint::ReadResult raw_size(vint::read(input));
+    std::streamsize packed_size(size - 1 - raw_size.second);
+    if (packed_size <= 0 || raw_size.first == 0)
     {
         throw BadBodySize() << err_el_size(size) << err_pos(start_pos);
     }
+    if (raw_size.first > max_decompressed_size(compression_, packed_size))
+    {
+        // The recorded size cannot be right, so do not allocate it
+        throw BadCompressedData() << err_pos(start_pos);
+    }
+    std::vector<char> packed(packed_size);
+    input.read(&packed[0], packed_size);
+    if (!input)
+    {
+        throw ReadError() << err_pos(input.tellg()) <<
+            err_reqsize(packed_size);
+    }
 
-    return std::make_pair(read, flags);
+    std::vector<char> raw(raw_size.first);
+    // The compressed and decompressed buffers
+    frame_allocs_ += 2;
+    try
+    {
+        if (dict)
+        {
+            dict->decompress(compression_, &packed[0], packed.size(),
+                    &raw[0], raw.size());
+        }
+        else
+        {
+            decompress(compression_, &packed[0], packed.size(), &raw[0],
+                    raw.size());
+        }
+        FrameBuffer buffer(&raw[0], raw.size());
+        std::istream raw_input(&buffer);
+        if (read_payload(raw_input, raw.size()) !=
+                static_cast<std::streamsize>(raw.size()))
+        {
+            throw BadCompressedData();
+        }
+    }
+    catch (TawaraError& e)
+    {
+        // Positions within the decompressed data are meaningless
+        e << err_pos(start_pos);
+        throw;
+    }
+    return size;
 }
 
 
@@ -417,8 +607,17 @@ void BlockImpl::validate() const
         throw EmptyBlock();
     }
 
-    assert((lacing_ == LACING_NONE && frames_.size() == 1) ||
-            lacing_ != LACING_NONE);
+    if (frames_.size() > max_count())
+    {
+        // The lacing was changed after the frames were added
+        throw MaxLaceSizeExceeded() << err_max_lace(max_count()) <<
+            err_req_lace(frames_.size());
+    }
+    if (frames_.size() < 2 && lacing_ == Block::LACING_EBML)
+    {
+        // EBML lacing always stores the sizes of a first and a last frame
+        throw BadLacedFrameSize() << err_frame_size(frames_[0]->size());
+    }
 
     BOOST_FOREACH(value_type f, frames_)
     {
@@ -441,13 +640,68 @@ void BlockImpl::validate() const
 }
 
 
+CompressionDictionary const* BlockImpl::dictionary() const
+{
+    if (!dictionaries_)
+    {
+        return 0;
+    }
+    DictionaryMap::const_iterator dict(dictionaries_->find(track_num_));
+    if (dict == dictionaries_->end())
+    {
+        return 0;
+    }
+    return dict->second.get();
+}
+
+
+std::vector<char> const& BlockImpl::packed() const
+{
+    if (packed_valid_)
+    {
+        return packed_;
+    }
+    validate();
+    CompressionDictionary const* dict(dictionary());
+
+    std::ostringstream payload(std::ios::out | std::ios::binary);
+    write_payload(payload);
+    std::string raw(payload.str());
+    std::vector<char> compressed;
+    if (dict)
+    {
+        dict->compress(compression_, raw.data(), raw.size(), compressed);
+    }
+    else
+    {
+        compress(compression_, raw.data(), raw.size(), compressed);
+    }
+    std::vector<char> raw_size(vint::encode(raw.size()));
+    packed_.clear();
+    // Only use the compressed data if it is smaller
+    if (1 + raw_size.size() + compressed.size() < raw.size())
+    {
+        packed_.reserve(1 + raw_size.size() + compressed.size());
+        packed_.push_back(static_cast<char>(
+                    compression_to_algo(compression_) | (dict ? 0x80 : 0)));
+        packed_.insert(packed_.end(), raw_size.begin(), raw_size.end());
+        packed_.insert(packed_.end(), compressed.begin(), compressed.end());
+    }
+    packed_valid_ = true;
+    return packed_;
+}
+
+
 void BlockImpl::reset()
 {
     track_num_ = 0;
     timecode_ = 0;
     invisible_ = false;
     lacing_ = Block::LACING_NONE;
+    compression_ = COMPRESSION_NONE;
     frames_.clear();
+    packed_valid_ = false;
+    frame_allocs_ = 0;
 }
 
 
@@ -457,16 +711,24 @@ std::streamsize BlockImpl::read_ebml_laced_frames(std::istream& input,
     std::streamsize read(0);
 
     // Read the frame counts
-    char frame_count;
-    input.get(frame_count);
+    char count_byte;
+    input.get(count_byte);
     if (input.fail())
     {
         throw tawara::ReadError() << tawara::err_pos(input.tellg());
     }
     read += 1;
+    int frame_count(static_cast<unsigned char>(count_byte));
+    if (frame_count < 2)
+    {
+        // The sizes of the first and last frames are always present
+        throw BadLacedFrameSize() << err_pos(input.tellg());
+    }
 
     // Read the frame sizes
     std::vector<std::streamsize> sizes;
+    sizes.reserve(frame_count);
+    ++frame_allocs_;
     // First frame size is just a normal vint
     vint::ReadResult res = vint::read(input);
     if (res.first == 0)
@@ -508,23 +770,15 @@ std::streamsize BlockImpl::read_ebml_laced_frames(std::istream& input,
             err_frame_size(leftover);
     }
 
-    size -= read;
     BOOST_FOREACH(std::streamsize frame_size, sizes)
     {
         if (read >= size)
         {
             throw EmptyFrame() << err_pos(input.tellg());
         }
-        Block::value_type new_frame(new std::vector<char>(frame_size));
-        input.read(&(*new_frame)[0], frame_size);
-        if (!input)
-        {
-            throw ReadError() << err_pos(input.tellg()) <<
-                err_reqsize(frame_size);
-        }
-        frames_.push_back(new_frame);
         read += frame_size;
     }
+    read_frame_run(input, sizes);
 
     return read;
 }
@@ -533,6 +787,10 @@ std::streamsize BlockImpl::read_ebml_laced_frames(std::istream& input,
 std::streamsize BlockImpl::read_fixed_frames(std::istream& input,
         std::streamsize size, unsigned int count)
 {
+    if (count == 0)
+    {
+        throw BadLacedFrameSize() << err_pos(input.tellg());
+    }
     if ((size % count) != 0)
     {
         // Frame sizes are not equal
@@ -541,24 +799,77 @@ std::streamsize BlockImpl::read_fixed_frames(std::istream& input,
     std::streamsize frame_size(size / count);
     assert((frame_size * count) == size);
 
-    std::streamsize read(0);
-    for(unsigned int ii(0); ii < count; ++ii)
+    if (frame_size == 0)
     {
-        if (read >= size)
-        {
-            throw EmptyFrame() << err_pos(input.tellg());
-        }
-        Block::value_type new_frame(new std::vector<char>(frame_size));
-        input.read(&(*new_frame)[0], frame_size);
+        throw EmptyFrame() << err_pos(input.tellg());
+    }
+    std::vector<std::streamsize> sizes(count, frame_size);
+    ++frame_allocs_;
+    read_frame_run(input, sizes);
+
+    return size;
+}
+
+
+void BlockImpl::read_frame_run(std::istream& input,
+        std::vector<std::streamsize> const& sizes)
+{
+    if (sizes.size() == 1)
+    {
+        // An unlaced frame is read straight into its own storage.
+        Block::value_type frame(boost::make_shared<Block::Frame>(sizes[0]));
+        // The frame with its shared count, and its data
+        frame_allocs_ += 2;
+        input.read(&(*frame)[0], sizes[0]);
         if (!input)
         {
             throw ReadError() << err_pos(input.tellg()) <<
-                err_reqsize(frame_size);
+                err_reqsize(sizes[0]);
         }
-        frames_.push_back(new_frame);
-        read += frame_size;
+        std::vector<value_type>::size_type capacity(frames_.capacity());
+        frames_.push_back(frame);
+        if (frames_.capacity() != capacity)
+        {
+            ++frame_allocs_;
+        }
+        return;
     }
 
-    return read;
+    // The whole run is read with a single read, then split into frames.
+    std::streamsize total(std::accumulate(sizes.begin(), sizes.end(),
+                static_cast<std::streamsize>(0)));
+    std::vector<char> payload(total);
+    ++frame_allocs_;
+    input.read(&payload[0], total);
+    if (!input)
+    {
+        throw ReadError() << err_pos(input.tellg()) << err_reqsize(total);
+    }
+
+    // Frames must be separate vectors, so each needs storage of its own for
+    // its slice of the payload. The vectors themselves are held in one
+    // shared array rather than each having its own control block.
+    boost::shared_ptr<std::vector<Block::Frame> > run(
+            boost::make_shared<std::vector<Block::Frame> >(sizes.size()));
+    // The run with its shared count, and its array of frames
+    frame_allocs_ += 2;
+    std::vector<char>::const_iterator start(payload.begin());
+    for (std::vector<std::streamsize>::size_type ii(0); ii < sizes.size();
+            ++ii)
+    {
+        (*run)[ii].assign(start, start + sizes[ii]);
+        ++frame_allocs_;
+        start += sizes[ii];
+    }
+    std::vector<value_type>::size_type capacity(frames_.capacity());
+    frames_.reserve(frames_.size() + run->size());
+    if (frames_.capacity() != capacity)
+    {
+        ++frame_allocs_;
+    }
+    for (std::vector<Block::Frame>::size_type ii(0); ii < run->size(); ++ii)
+    {
+        frames_.push_back(Block::value_type(run, &(*run)[ii]));
+    }
 }
 
@@ -0,0 +1,231 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/chapter_index.h>
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <utility>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// Reads a level 1 element listed in the index of a segment, returning false
+// if it is not listed.
+static bool read_indexed_element(std::istream& stream,
+        Segment const& segment, Element& element)
+{
+    SeekHead::const_iterator entry(segment.index.find(element.id()));
+    if (entry == segment.index.end())
+    {
+        return false;
+    }
+    stream.seekg(segment.to_stream_offset(entry->second));
+    ids::ReadResult id_res(ids::read(stream));
+    if (id_res.first != element.id())
+    {
+        throw InvalidChildID() << err_id(id_res.first) <<
+            err_par_id(ids::Segment) <<
+            // The cast here makes Apple's LLVM compiler happy
+            err_pos(static_cast<std::streamsize>(stream.tellg()) -
+                    id_res.second);
+    }
+    element.read(stream);
+    return true;
+}
+
+
+// Checks if a chapter starts after a time.
+static bool chapter_starts_after(uint64_t time,
+        ChapterIndex::Entry const& entry)
+{
+    return time < entry.start;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ChapterIndex::ChapterIndex()
+{
+}
+
+
+ChapterIndex::ChapterIndex(Chapters const& chapters, Cues const& cues,
+        uint64_t timecode_scale)
+{
+    build(chapters, cues, timecode_scale);
+}
+
+
+ChapterIndex::ChapterIndex(std::istream& stream, Segment const& segment)
+{
+    std::streampos current_pos(stream.tellg());
+    Chapters chapters;
+    if (!read_indexed_element(stream, segment, chapters))
+    {
+        return;
+    }
+    Cues cues;
+    read_indexed_element(stream, segment, cues);
+    stream.seekg(current_pos);
+    build(chapters, cues, segment.info.timecode_scale());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Accessors
+///////////////////////////////////////////////////////////////////////////////
+
+ChapterIndex::Entry const* ChapterIndex::find_time(uint64_t time) const
+{
+    // Search back from the last chapter starting at or before the time for
+    // one that has not ended by then
+    const_iterator entry(std::upper_bound(entries_.begin(), entries_.end(),
+                time, chapter_starts_after));
+    while (entry != entries_.begin())
+    {
+        --entry;
+        if (!entry->has_end || time < entry->end)
+        {
+            return &*entry;
+        }
+    }
+    return 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Private functions
+///////////////////////////////////////////////////////////////////////////////
+
+void ChapterIndex::build(Chapters const& chapters, Cues const& cues,
+        uint64_t timecode_scale)
+{
+    std::vector<std::vector<std::string> > names;
+    BOOST_FOREACH(EditionEntry const& edition, chapters)
+    {
+        BOOST_FOREACH(ChapterAtom const& atom, edition.atoms())
+        {
+            add(atom, edition.uid(), names);
+        }
+    }
+
+    // Sort by start time, keeping chapters with the same start in file
+    // order
+    std::vector<std::pair<uint64_t, size_type> > order;
+    order.reserve(entries_.size());
+    for (size_type ii(0); ii < entries_.size(); ++ii)
+    {
+        order.push_back(std::make_pair(entries_[ii].start, ii));
+    }
+    std::sort(order.begin(), order.end());
+
+    std::vector<Entry> unsorted;
+    unsorted.swap(entries_);
+    entries_.reserve(unsorted.size());
+    for (size_type ii(0); ii < order.size(); ++ii)
+    {
+        Entry entry(unsorted[order[ii].second]);
+        if (!cues.empty())
+        {
+            // Any position in the last cue point at or before the start
+            // will do; the earliest is used so that no blocks are missed.
+            Cues::const_iterator cue(cues.upper_bound(entry.start /
+                        timecode_scale));
+            if (cue != cues.begin())
+            {
+                --cue;
+                BOOST_FOREACH(CueTrackPosition const& ctp, cue->second)
+                {
+                    if (!entry.has_cluster ||
+                            ctp.cluster_pos() < entry.cluster_pos)
+                    {
+                        entry.cluster_pos = ctp.cluster_pos();
+                    }
+                    entry.has_cluster = true;
+                }
+            }
+        }
+        entries_.push_back(entry);
+
+        // Keep the earliest chapter with each name
+        uids_.insert(std::make_pair(entry.uid, ii));
+        BOOST_FOREACH(std::string const& name, names[order[ii].second])
+        {
+            names_.insert(std::make_pair(name, ii));
+        }
+    }
+}
+
+
+void ChapterIndex::add(ChapterAtom const& atom, uint64_t edition_uid,
+        std::vector<std::vector<std::string> >& names)
+{
+    Entry entry;
+    entry.uid = atom.uid();
+    entry.edition_uid = edition_uid;
+    entry.name = atom.name();
+    entry.start = atom.start();
+    entry.has_end = atom.has_end();
+    entry.end = atom.end();
+    entry.hidden = atom.hidden();
+    entry.enabled = atom.enabled();
+    entry.has_cluster = false;
+    entry.cluster_pos = 0;
+    entries_.push_back(entry);
+
+    names.push_back(std::vector<std::string>());
+    BOOST_FOREACH(ChapterDisplay const& display, atom.displays())
+    {
+        names.back().push_back(display.string());
+    }
+
+    BOOST_FOREACH(ChapterAtom const& child, atom.children())
+    {
+        add(child, edition_uid, names);
+    }
+}
+
@@ -0,0 +1,714 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/chapters.h>
+
+#include <boost/foreach.hpp>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/vint.h>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// Gets the total size of a list of strings written as String elements.
+std::streamsize chapter_strings_size(ids::ID id,
+        std::vector<std::string> const& strings)
+{
+    std::streamsize size(0);
+    BOOST_FOREACH(std::string const& s, strings)
+    {
+        size += StringElement(id, s).size();
+    }
+    return size;
+}
+
+
+// Writes a list of strings as String elements.
+std::streamsize write_chapter_strings(ids::ID id,
+        std::vector<std::string> const& strings, std::ostream& output)
+{
+    std::streamsize written(0);
+    BOOST_FOREACH(std::string const& s, strings)
+    {
+        StringElement el(id, s);
+        written += el.write(output);
+    }
+    return written;
+}
+
+
+// Reads a flag, checking that it is 0 or 1.
+std::streamsize read_chapter_flag(UIntElement& flag, std::istream& input,
+        ids::ID parent, std::streamsize pos)
+{
+    std::streamsize result(flag.read(input));
+    if (flag != 0 && flag != 1)
+    {
+        throw ValueOutOfRange() << err_id(flag.id()) << err_par_id(parent) <<
+            err_pos(pos);
+    }
+    return result;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ChapterDisplay constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ChapterDisplay::ChapterDisplay()
+    : MasterElement(ids::ChapterDisplay), string_(ids::ChapString, ""),
+    languages_(1, "eng")
+{
+}
+
+
+ChapterDisplay::ChapterDisplay(std::string const& string,
+        std::string const& language)
+    : MasterElement(ids::ChapterDisplay), string_(ids::ChapString, string),
+    languages_(1, language)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ChapterDisplay operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(ChapterDisplay const& lhs, ChapterDisplay const& rhs)
+{
+    return lhs.string_ == rhs.string_ &&
+        lhs.languages_ == rhs.languages_ &&
+        lhs.countries_ == rhs.countries_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ChapterDisplay Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize ChapterDisplay::body_size() const
+{
+    return string_.size() +
+        chapter_strings_size(ids::ChapLanguage, languages_) +
+        chapter_strings_size(ids::ChapCountry, countries_);
+}
+
+
+std::streamsize ChapterDisplay::write_body(std::ostream& output)
+{
+    std::streamsize written(0);
+    written += string_.write(output);
+    written += write_chapter_strings(ids::ChapLanguage, languages_, output);
+    written += write_chapter_strings(ids::ChapCountry, countries_, output);
+    return written;
+}
+
+
+std::streamsize ChapterDisplay::read_body(std::istream& input,
+        std::streamsize size)
+{
+    string_ = "";
+    languages_.clear();
+    countries_.clear();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    bool have_string(false);
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        StringElement value(id, "");
+        switch(id)
+        {
+            case ids::ChapString:
+                read_bytes += string_.read(input);
+                have_string = true;
+                break;
+            case ids::ChapLanguage:
+                read_bytes += value.read(input);
+                languages_.push_back(value);
+                break;
+            case ids::ChapCountry:
+                read_bytes += value.read(input);
+                countries_.push_back(value);
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (!have_string)
+    {
+        throw MissingChild() << err_id(ids::ChapString) << err_par_id(id_) <<
+            err_pos(offset_);
+    }
+    if (languages_.empty())
+    {
+        languages_.push_back("eng");
+    }
+
+    return read_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ChapterAtom constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ChapterAtom::ChapterAtom()
+    : MasterElement(ids::ChapterAtom), uid_(ids::ChapterUID, 1),
+    start_(ids::ChapterTimeStart, 0), end_(ids::ChapterTimeEnd, 0),
+    has_end_(false), hidden_(ids::ChapterFlagHidden, 0, 0),
+    enabled_(ids::ChapterFlagEnabled, 1, 1)
+{
+}
+
+
+ChapterAtom::ChapterAtom(uint64_t uid, uint64_t start,
+        std::string const& name)
+    : MasterElement(ids::ChapterAtom), uid_(ids::ChapterUID, uid),
+    start_(ids::ChapterTimeStart, start), end_(ids::ChapterTimeEnd, 0),
+    has_end_(false), hidden_(ids::ChapterFlagHidden, 0, 0),
+    enabled_(ids::ChapterFlagEnabled, 1, 1)
+{
+    if (uid_ == 0)
+    {
+        throw ValueOutOfRange() << err_id(ids::ChapterUID) << err_par_id(id_);
+    }
+    if (!name.empty())
+    {
+        displays_.push_back(ChapterDisplay(name));
+    }
+}
+
+
+void ChapterAtom::uid(uint64_t uid)
+{
+    if (uid == 0)
+    {
+        throw ValueOutOfRange() << err_id(ids::ChapterUID) << err_par_id(id_);
+    }
+    uid_ = uid;
+}
+
+
+std::string ChapterAtom::name() const
+{
+    if (displays_.empty())
+    {
+        return "";
+    }
+    return displays_[0].string();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ChapterAtom operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(ChapterAtom const& lhs, ChapterAtom const& rhs)
+{
+    return lhs.uid_ == rhs.uid_ &&
+        lhs.start_ == rhs.start_ &&
+        lhs.has_end_ == rhs.has_end_ &&
+        lhs.end_ == rhs.end_ &&
+        lhs.hidden_ == rhs.hidden_ &&
+        lhs.enabled_ == rhs.enabled_ &&
+        lhs.tracks_ == rhs.tracks_ &&
+        lhs.displays_ == rhs.displays_ &&
+        lhs.children_ == rhs.children_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ChapterAtom Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize ChapterAtom::tracks_size() const
+{
+    std::streamsize size(0);
+    BOOST_FOREACH(uint64_t track, tracks_)
+    {
+        size += UIntElement(ids::ChapterTrackNumber, track).size();
+    }
+    return size;
+}
+
+
+std::streamsize ChapterAtom::body_size() const
+{
+    // The flags are mandatory, so they are always written
+    std::streamsize size(uid_.size() + start_.size() + hidden_.size() +
+            enabled_.size());
+
+    if (has_end_)
+    {
+        size += end_.size();
+    }
+    if (!tracks_.empty())
+    {
+        size += ids::size(ids::ChapterTrack) + vint::size(tracks_size()) +
+            tracks_size();
+    }
+    BOOST_FOREACH(ChapterDisplay const& display, displays_)
+    {
+        size += display.size();
+    }
+    BOOST_FOREACH(ChapterAtom const& child, children_)
+    {
+        size += child.size();
+    }
+    return size;
+}
+
+
+std::streamsize ChapterAtom::write_body(std::ostream& output)
+{
+    assert(uid_ != 0);
+
+    std::streamsize written(0);
+
+    written += uid_.write(output);
+    written += start_.write(output);
+    if (has_end_)
+    {
+        written += end_.write(output);
+    }
+    written += hidden_.write(output);
+    written += enabled_.write(output);
+    if (!tracks_.empty())
+    {
+        written += ids::write(ids::ChapterTrack, output);
+        written += vint::write(tracks_size(), output);
+        BOOST_FOREACH(uint64_t track, tracks_)
+        {
+            UIntElement el(ids::ChapterTrackNumber, track);
+            written += el.write(output);
+        }
+    }
+    BOOST_FOREACH(ChapterDisplay& display, displays_)
+    {
+        written += display.write(output);
+    }
+    BOOST_FOREACH(ChapterAtom& child, children_)
+    {
+        written += child.write(output);
+    }
+    return written;
+}
+
+
+std::streamsize ChapterAtom::read_body(std::istream& input,
+        std::streamsize size)
+{
+    // Reset to defaults
+    reset();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    bool have_uid(false), have_start(false);
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        switch(id)
+        {
+            case ids::ChapterUID:
+                read_bytes += uid_.read(input);
+                if (uid_ == 0)
+                {
+                    throw ValueOutOfRange() << err_id(ids::ChapterUID) <<
+                        err_par_id(id_) << err_pos(offset_);
+                }
+                have_uid = true;
+                break;
+            case ids::ChapterTimeStart:
+                read_bytes += start_.read(input);
+                have_start = true;
+                break;
+            case ids::ChapterTimeEnd:
+                read_bytes += end_.read(input);
+                has_end_ = true;
+                break;
+            case ids::ChapterFlagHidden:
+                read_bytes += read_chapter_flag(hidden_, input, id_, offset_);
+                break;
+            case ids::ChapterFlagEnabled:
+                read_bytes += read_chapter_flag(enabled_, input, id_,
+                        offset_);
+                break;
+            case ids::ChapterTrack:
+                {
+                    vint::ReadResult size_res = vint::read(input);
+                    read_bytes += size_res.second;
+                    std::streamsize track_size(
+                            static_cast<std::streamsize>(size_res.first));
+                    std::streamsize track_bytes(0);
+                    while (track_bytes < track_size)
+                    {
+                        id_res = ids::read(input);
+                        track_bytes += id_res.second;
+                        if (id_res.first != ids::ChapterTrackNumber)
+                        {
+                            throw InvalidChildID() << err_id(id_res.first) <<
+                                err_par_id(ids::ChapterTrack) <<
+                                // The cast here makes Apple's LLVM compiler
+                                // happy
+                                err_pos(static_cast<std::streamsize>(
+                                            input.tellg()) - id_res.second);
+                        }
+                        UIntElement track(ids::ChapterTrackNumber, 0);
+                        track_bytes += track.read(input);
+                        tracks_.push_back(track);
+                    }
+                    if (track_bytes != track_size)
+                    {
+                        throw BadBodySize() << err_id(ids::ChapterTrack) <<
+                            err_el_size(size_res.first) << err_pos(offset_);
+                    }
+                    read_bytes += track_bytes;
+                }
+                break;
+            case ids::ChapterDisplay:
+                displays_.push_back(ChapterDisplay());
+                read_bytes += displays_.back().read(input);
+                break;
+            case ids::ChapterAtom:
+                children_.push_back(ChapterAtom());
+                read_bytes += children_.back().read(input);
+                break;
+            case ids::ChapterSegmentUID:
+                // Linked segments are not supported
+                read_bytes += skip_read(input, false);
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (!have_uid)
+    {
+        throw MissingChild() << err_id(ids::ChapterUID) << err_par_id(id_) <<
+            err_pos(offset_);
+    }
+    if (!have_start)
+    {
+        throw MissingChild() << err_id(ids::ChapterTimeStart) <<
+            err_par_id(id_) << err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ChapterAtom private functions
+///////////////////////////////////////////////////////////////////////////////
+
+void ChapterAtom::reset()
+{
+    uid_ = 1;
+    start_ = 0;
+    clear_end();
+    hidden_ = hidden_.get_default();
+    enabled_ = enabled_.get_default();
+    tracks_.clear();
+    displays_.clear();
+    children_.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// EditionEntry constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+EditionEntry::EditionEntry()
+    : MasterElement(ids::EditionEntry), uid_(ids::EditionUID, 0),
+    hidden_(ids::EditionFlagHidden, 0, 0),
+    default_(ids::EditionFlagDefault, 0, 0),
+    ordered_(ids::EditionFlagOrdered, 0, 0)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// EditionEntry operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(EditionEntry const& lhs, EditionEntry const& rhs)
+{
+    return lhs.uid_ == rhs.uid_ &&
+        lhs.hidden_ == rhs.hidden_ &&
+        lhs.default_ == rhs.default_ &&
+        lhs.ordered_ == rhs.ordered_ &&
+        lhs.atoms_ == rhs.atoms_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// EditionEntry Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize EditionEntry::body_size() const
+{
+    // The hidden and default flags are mandatory, so they are always written
+    std::streamsize size(hidden_.size() + default_.size());
+
+    if (uid_ != 0)
+    {
+        size += uid_.size();
+    }
+    if (!ordered_.is_default())
+    {
+        size += ordered_.size();
+    }
+    BOOST_FOREACH(ChapterAtom const& atom, atoms_)
+    {
+        size += atom.size();
+    }
+    return size;
+}
+
+
+std::streamsize EditionEntry::write_body(std::ostream& output)
+{
+    if (atoms_.empty())
+    {
+        throw EmptyEditionEntry();
+    }
+
+    std::streamsize written(0);
+
+    if (uid_ != 0)
+    {
+        written += uid_.write(output);
+    }
+    written += hidden_.write(output);
+    written += default_.write(output);
+    if (!ordered_.is_default())
+    {
+        written += ordered_.write(output);
+    }
+    BOOST_FOREACH(ChapterAtom& atom, atoms_)
+    {
+        written += atom.write(output);
+    }
+    return written;
+}
+
+
+std::streamsize EditionEntry::read_body(std::istream& input,
+        std::streamsize size)
+{
+    uid_ = 0;
+    hidden_ = hidden_.get_default();
+    default_ = default_.get_default();
+    ordered_ = ordered_.get_default();
+    atoms_.clear();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        switch(id)
+        {
+            case ids::EditionUID:
+                read_bytes += uid_.read(input);
+                if (uid_ == 0)
+                {
+                    throw ValueOutOfRange() << err_id(ids::EditionUID) <<
+                        err_par_id(id_) << err_pos(offset_);
+                }
+                break;
+            case ids::EditionFlagHidden:
+                read_bytes += read_chapter_flag(hidden_, input, id_, offset_);
+                break;
+            case ids::EditionFlagDefault:
+                read_bytes += read_chapter_flag(default_, input, id_,
+                        offset_);
+                break;
+            case ids::EditionFlagOrdered:
+                read_bytes += read_chapter_flag(ordered_, input, id_,
+                        offset_);
+                break;
+            case ids::ChapterAtom:
+                atoms_.push_back(ChapterAtom());
+                read_bytes += atoms_.back().read(input);
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (atoms_.empty())
+    {
+        throw EmptyEditionEntry() << err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Chapters constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Chapters::Chapters()
+    : MasterElement(ids::Chapters)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Chapters operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(Chapters const& lhs, Chapters const& rhs)
+{
+    return lhs.editions_ == rhs.editions_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Chapters Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize Chapters::body_size() const
+{
+    std::streamsize size(0);
+
+    BOOST_FOREACH(EditionEntry const& edition, editions_)
+    {
+        size += edition.size();
+    }
+    return size;
+}
+
+
+std::streamsize Chapters::write_body(std::ostream& output)
+{
+    if (editions_.empty())
+    {
+        throw EmptyChaptersElement();
+    }
+
+    std::streamsize written(0);
+
+    BOOST_FOREACH(EditionEntry& edition, editions_)
+    {
+        written += edition.write(output);
+    }
+    return written;
+}
+
+
+std::streamsize Chapters::read_body(std::istream& input,
+        std::streamsize size)
+{
+    editions_.clear();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        if (id != ids::EditionEntry)
+        {
+            throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                // The cast here makes Apple's LLVM compiler happy
+                err_pos(static_cast<std::streamsize>(input.tellg()) -
+                        id_res.second);
+        }
+        editions_.push_back(EditionEntry());
+        read_bytes += editions_.back().read(input);
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (editions_.empty())
+    {
+        throw EmptyChaptersElement() << err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
@@ -40,9 +40,12 @@
 
 #include <boost/foreach.hpp>
 #include <numeric>
+#include <tawara/crc32.h>
 #include <tawara/el_ids.h>
 #include <tawara/exceptions.h>
+#include <tawara/trace.h>
 #include <tawara/vint.h>
+#include <tawara/void_element.h>
 
 using namespace tawara;
 
@@ -53,7 +56,8 @@ using namespace tawara;
 Cluster::Cluster(uint64_t timecode)
     : MasterElement(ids::Cluster),
     timecode_(ids::Timecode, timecode), position_(ids::Position, 0),
-    prev_size_(ids::PrevSize, 0), writing_(false)
+    prev_size_(ids::PrevSize, 0), has_summary_(false), summary_pad_(0),
+    summary_pos_(0), crc_pos_(0), writing_(false)
 {
 }
 
@@ -88,6 +92,11 @@ std::streamsize Cluster::meta_size() const
 {
     std::streamsize result(timecode_.size());
 
+    if (crc_)
+    {
+        result += crc_size_;
+    }
+
     if (!silent_tracks_.empty())
     {
         result += ids::size(ids::SilentTracks);
@@ -103,6 +112,7 @@ std::streamsize Cluster::meta_size() const
     {
         result += prev_size_.size();
     }
+    result += summary_pad_;
 
     return result;
 }
@@ -118,7 +128,15 @@ std::streamsize Cluster::write_body(std::ostream& output)
 {
     std::streamsize written(0);
     writing_ = true;
+    TAWARA_TRACE(CLUSTER_OPEN, id_, offset_, 0);
 
+    if (crc_)
+    {
+        // Reserve space for the CRC, which is written when the cluster is
+        // finalised
+        crc_pos_ = output.tellp();
+        written += write_crc(0, output);
+    }
     written += timecode_.write(output);
     if (!silent_tracks_.empty())
     {
@@ -139,6 +157,14 @@ std::streamsize Cluster::write_body(std::ostream& output)
     {
         written += prev_size_.write(output);
     }
+    if (summary_pad_ != 0)
+    {
+        // Reserve space for the summary, which is written when the cluster
+        // is finalised
+        summary_pos_ = output.tellp();
+        VoidElement ve(summary_pad_, true);
+        written += ve.write(output);
+    }
 
     return written;
 }
@@ -151,10 +177,16 @@ std::streamsize Cluster::read_body(std::istream& input,
     reset();
     // Cannot write a cluster being read
     writing_ = false;
+    if (stats_)
+    {
+        ++stats_->clusters_read;
+    }
+    TAWARA_TRACE(CLUSTER_OPEN, id_, offset_, size);
 
     std::streamsize read_bytes(0);
     // Read elements until the body is exhausted
     bool have_timecode(false);
+    bool have_blocks(false);
     while (read_bytes < size)
     {
         // Read the ID
@@ -176,6 +208,18 @@ std::streamsize Cluster::read_body(std::istream& input,
             case ids::PrevSize:
                 read_bytes += prev_size_.read(input);
                 break;
+            case ids::ClusterSummary:
+                read_bytes += summary_.read(input);
+                has_summary_ = true;
+                summary_pad_ += summary_.size();
+                break;
+            case ids::Void:
+                {
+                    std::streamsize skipped(skip_read(input, false));
+                    read_bytes += skipped;
+                    summary_pad_ += id_res.second + skipped;
+                }
+                break;
             case ids::SimpleBlock:
             case ids::BlockGroup:
                 // Rewind to the element ID value
@@ -183,6 +227,7 @@ std::streamsize Cluster::read_body(std::istream& input,
                 read_bytes -= id_res.second;
                 // Read all the blocks - this will use up the rest of the block
                 read_bytes += read_blocks(input, size - read_bytes);
+                have_blocks = true;
                 break;
             default:
                 throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
@@ -202,6 +247,11 @@ std::streamsize Cluster::read_body(std::istream& input,
         throw MissingChild() << err_id(ids::Timecode) << err_par_id(id_) <<
             err_pos(offset_);
     }
+    if (!have_blocks)
+    {
+        // Let the implementation know that there are no blocks
+        read_blocks(input, 0);
+    }
 
     return read_bytes;
 }
@@ -246,11 +296,66 @@ std::streamsize Cluster::read_silent_tracks(std::istream& input)
 }
 
 
+bool Cluster::write_summary(std::ostream& output)
+{
+    if (summary_pad_ == 0)
+    {
+        return false;
+    }
+    std::streamsize remaining(summary_pad_ - summary_.size());
+    if (remaining < 0 || remaining == 1)
+    {
+        // Void elements must be at least 2 bytes, so the summary cannot be
+        // fitted in
+        return false;
+    }
+
+    std::streampos cur_pos(output.tellp());
+    output.seekp(summary_pos_);
+    summary_.write(output);
+    if (remaining != 0)
+    {
+        VoidElement ve(remaining, false);
+        ve.write(output);
+    }
+    output.seekp(cur_pos);
+    return true;
+}
+
+
+void Cluster::write_cluster_crc(std::ostream& output, std::streampos end)
+{
+    if (!crc_)
+    {
+        return;
+    }
+    std::istream* input(dynamic_cast<std::istream*>(&output));
+    if (!input)
+    {
+        throw ReadError() << err_pos(crc_pos_);
+    }
+
+    std::streampos cur_read(input->tellg());
+    std::streampos cur_write(output.tellp());
+    std::streampos data_start(static_cast<std::streamsize>(crc_pos_) +
+            crc_size_);
+    input->seekg(data_start);
+    uint32_t value(crc32(*input, end - data_start));
+    input->seekg(cur_read);
+    output.seekp(crc_pos_);
+    write_crc(value, output);
+    output.seekp(cur_write);
+}
+
+
 void Cluster::reset()
 {
     timecode_ = 0;
     silent_tracks_.clear();
     position_ = 0;
     prev_size_ = 0;
+    summary_.clear();
+    has_summary_ = false;
+    summary_pad_ = 0;
 }
 
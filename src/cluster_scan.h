@@ -0,0 +1,141 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_CLUSTER_SCAN_H_)
+#define TAWARA_CLUSTER_SCAN_H_
+
+#include <algorithm>
+#include <boost/ref.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+#include <exception>
+#include <fstream>
+#include <string>
+#include <vector>
+
+// Internal helpers shared by the functions that scan the clusters of a file
+// in parallel. Not installed.
+
+namespace tawara
+{
+    /** \brief Shares out clusters between scanning threads.
+     *
+     * Each thread opens its own stream and takes the next unscanned cluster
+     * until none are left. The scan functor is called with the thread's
+     * stream and the result for the cluster, which it fills in.
+     */
+    template <typename Result, typename Scan>
+    class ClusterScanQueue
+    {
+        public:
+            ClusterScanQueue(std::string const& path,
+                    std::vector<Result>& results, Scan scan)
+                : path_(path), results_(results), scan_(scan), next_(0)
+            {
+            }
+
+            void operator()()
+            {
+                std::ifstream stream(path_.c_str(),
+                        std::ios::in | std::ios::binary);
+                Result* result(0);
+                while ((result = take()) != 0)
+                {
+                    scan_(stream, *result);
+                }
+            }
+
+        private:
+            std::string const& path_;
+            std::vector<Result>& results_;
+            Scan scan_;
+            typename std::vector<Result>::size_type next_;
+            boost::mutex mutex_;
+
+            Result* take()
+            {
+                boost::mutex::scoped_lock lock(mutex_);
+                if (next_ == results_.size())
+                {
+                    return 0;
+                }
+                return &results_[next_++];
+            }
+    }; // class ClusterScanQueue
+
+    /** \brief Scan the clusters of a file in parallel.
+     *
+     * \param[in] path The path of the file.
+     * \param[in,out] results One result per cluster, each holding what the
+     * scan functor needs to find its cluster.
+     * \param[in] scan The functor to call for each cluster, as
+     * scan(std::istream&, Result&). It must not throw.
+     * \param[in] threads The number of threads to use. If 0, one thread is
+     * used per processor core.
+     * \return The number of threads used.
+     */
+    template <typename Result, typename Scan>
+    unsigned int scan_clusters(std::string const& path,
+            std::vector<Result>& results, Scan scan, unsigned int threads)
+    {
+        if (threads == 0)
+        {
+            threads = std::max(boost::thread::hardware_concurrency(), 1u);
+        }
+        threads = std::max<std::size_t>(std::min<std::size_t>(threads,
+                    results.size()), 1);
+        ClusterScanQueue<Result, Scan> queue(path, results, scan);
+        boost::thread_group group;
+        for (unsigned int ii(0); ii < threads; ++ii)
+        {
+            group.create_thread(boost::ref(queue));
+        }
+        group.join_all();
+        return threads;
+    }
+
+    /** \brief Get the name of an exception's type, without its namespace.
+     *
+     * Used to record the errors found while scanning.
+     */
+    std::string exception_name(std::exception const& e);
+}; // namespace tawara
+
+#endif // TAWARA_CLUSTER_SCAN_H_
+
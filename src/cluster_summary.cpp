@@ -0,0 +1,439 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tawara/cluster_summary.h>
+
+#include <boost/foreach.hpp>
+#include <tawara/binary_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/vint.h>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// TrackSummary constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+TrackSummary::TrackSummary(uint64_t track_number)
+    : MasterElement(ids::SummaryTrack),
+    track_number_(ids::SummaryTrackNumber, track_number),
+    block_count_(ids::SummaryBlockCount, 0),
+    min_tc_(ids::SummaryMinTimecode, 0),
+    max_tc_(ids::SummaryMaxTimecode, 0)
+{
+    if (track_number == 0)
+    {
+        throw ValueOutOfRange() << err_id(ids::SummaryTrackNumber) <<
+            err_par_id(ids::SummaryTrack);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TrackSummary accessors
+///////////////////////////////////////////////////////////////////////////////
+
+void TrackSummary::track_number(uint64_t track_number)
+{
+    if (track_number == 0)
+    {
+        throw ValueOutOfRange() << err_id(ids::SummaryTrackNumber) <<
+            err_par_id(ids::SummaryTrack);
+    }
+    track_number_ = track_number;
+}
+
+
+void TrackSummary::add(int16_t timecode)
+{
+    if (block_count_ == 0)
+    {
+        min_tc_ = timecode;
+        max_tc_ = timecode;
+    }
+    else if (timecode < min_tc_)
+    {
+        min_tc_ = timecode;
+    }
+    else if (timecode > max_tc_)
+    {
+        max_tc_ = timecode;
+    }
+    block_count_ = block_count_ + 1;
+}
+
+
+bool TrackSummary::overlaps(int16_t first, int16_t last) const
+{
+    return block_count_ != 0 && min_tc_ <= last && max_tc_ >= first;
+}
+
+
+bool TrackSummary::within(int16_t first, int16_t last) const
+{
+    return block_count_ != 0 && min_tc_ >= first && max_tc_ <= last;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TrackSummary operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(TrackSummary const& lhs, TrackSummary const& rhs)
+{
+    return lhs.track_number_ == rhs.track_number_ &&
+        lhs.block_count_ == rhs.block_count_ &&
+        lhs.min_tc_ == rhs.min_tc_ &&
+        lhs.max_tc_ == rhs.max_tc_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TrackSummary Element interface
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize TrackSummary::body_size() const
+{
+    return track_number_.size() + block_count_.size() + min_tc_.size() +
+        max_tc_.size();
+}
+
+
+std::streamsize TrackSummary::write_body(std::ostream& output)
+{
+    return track_number_.write(output) + block_count_.write(output) +
+        min_tc_.write(output) + max_tc_.write(output);
+}
+
+
+std::streamsize TrackSummary::read_body(std::istream& input,
+        std::streamsize size)
+{
+    reset();
+
+    std::streamsize read_bytes(0);
+    bool have_track(false);
+    // Read elements until the body is exhausted
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        switch(id)
+        {
+            case ids::SummaryTrackNumber:
+                read_bytes += track_number_.read(input);
+                if (track_number_ == 0)
+                {
+                    throw ValueOutOfRange() <<
+                        err_id(ids::SummaryTrackNumber) <<
+                        err_par_id(id_) << err_pos(input.tellg());
+                }
+                have_track = true;
+                break;
+            case ids::SummaryBlockCount:
+                read_bytes += block_count_.read(input);
+                break;
+            case ids::SummaryMinTimecode:
+                read_bytes += min_tc_.read(input);
+                break;
+            case ids::SummaryMaxTimecode:
+                read_bytes += max_tc_.read(input);
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (!have_track)
+    {
+        throw MissingChild() << err_id(ids::SummaryTrackNumber) <<
+            err_par_id(id_) << err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
+
+void TrackSummary::reset()
+{
+    track_number_ = 1;
+    block_count_ = 0;
+    min_tc_ = 0;
+    max_tc_ = 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ClusterSummary constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+ClusterSummary::ClusterSummary()
+    : MasterElement(ids::ClusterSummary)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ClusterSummary accessors
+///////////////////////////////////////////////////////////////////////////////
+
+void ClusterSummary::clear()
+{
+    map_.clear();
+    tracks_.clear();
+}
+
+
+void ClusterSummary::add(uint64_t track_number, int16_t timecode)
+{
+    storage_type_::iterator track(tracks_.find(track_number));
+    if (track == tracks_.end())
+    {
+        track = tracks_.insert(std::make_pair(track_number,
+                    TrackSummary(track_number))).first;
+    }
+    track->second.add(timecode);
+}
+
+
+bool ClusterSummary::has_track(uint64_t track_number) const
+{
+    if (tracks_.find(track_number) != tracks_.end())
+    {
+        return true;
+    }
+    if (track_number == 0 ||
+            (track_number - 1) / 8 >= map_.size())
+    {
+        return false;
+    }
+    return (map_[(track_number - 1) / 8] &
+            (0x80 >> ((track_number - 1) % 8))) != 0;
+}
+
+
+bool ClusterSummary::may_contain(std::set<uint64_t> const& tracks,
+        int16_t first, int16_t last) const
+{
+    if (tracks.empty())
+    {
+        BOOST_FOREACH(value_type const& track, tracks_)
+        {
+            if (track.second.overlaps(first, last))
+            {
+                return true;
+            }
+        }
+        // Tracks that are only in the bitmap have no timecode information
+        for (uint64_t track_number(1); track_number <= map_.size() * 8;
+                ++track_number)
+        {
+            if (has_track(track_number) &&
+                    tracks_.find(track_number) == tracks_.end())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+    BOOST_FOREACH(uint64_t track_number, tracks)
+    {
+        const_iterator track(tracks_.find(track_number));
+        if (track != tracks_.end())
+        {
+            if (track->second.overlaps(first, last))
+            {
+                return true;
+            }
+        }
+        else if (has_track(track_number))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+
+bool ClusterSummary::only_contains(std::set<uint64_t> const& tracks,
+        int16_t first, int16_t last) const
+{
+    if (tracks_.empty())
+    {
+        return false;
+    }
+    BOOST_FOREACH(value_type const& track, tracks_)
+    {
+        if ((!tracks.empty() && tracks.count(track.first) == 0) ||
+                !track.second.within(first, last))
+        {
+            return false;
+        }
+    }
+    // Tracks that are only in the bitmap have no timecode information
+    for (uint64_t track_number(1); track_number <= map_.size() * 8;
+            ++track_number)
+    {
+        if (has_track(track_number) &&
+                tracks_.find(track_number) == tracks_.end())
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ClusterSummary operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(ClusterSummary const& lhs, ClusterSummary const& rhs)
+{
+    std::vector<char> lhs_map(lhs.map_.empty() ? lhs.make_map() : lhs.map_);
+    std::vector<char> rhs_map(rhs.map_.empty() ? rhs.make_map() : rhs.map_);
+    return lhs.tracks_ == rhs.tracks_ && lhs_map == rhs_map;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ClusterSummary Element interface
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<char> ClusterSummary::make_map() const
+{
+    std::vector<char> result;
+    if (tracks_.empty() || tracks_.rbegin()->first > max_map_track())
+    {
+        return result;
+    }
+    result.resize((tracks_.rbegin()->first - 1) / 8 + 1, 0);
+    BOOST_FOREACH(value_type const& track, tracks_)
+    {
+        result[(track.first - 1) / 8] |= 0x80 >> ((track.first - 1) % 8);
+    }
+    return result;
+}
+
+
+std::streamsize ClusterSummary::body_size() const
+{
+    std::streamsize result(0);
+    std::vector<char> map(make_map());
+    if (!map.empty())
+    {
+        result += BinaryElement(ids::SummaryTrackMap, map).size();
+    }
+    BOOST_FOREACH(value_type const& track, tracks_)
+    {
+        result += track.second.size();
+    }
+    return result;
+}
+
+
+std::streamsize ClusterSummary::write_body(std::ostream& output)
+{
+    std::streamsize written(0);
+    std::vector<char> map(make_map());
+    if (!map.empty())
+    {
+        BinaryElement map_el(ids::SummaryTrackMap, map);
+        written += map_el.write(output);
+    }
+    BOOST_FOREACH(storage_type_::value_type& track, tracks_)
+    {
+        written += track.second.write(output);
+    }
+    return written;
+}
+
+
+std::streamsize ClusterSummary::read_body(std::istream& input,
+        std::streamsize size)
+{
+    clear();
+
+    std::streamsize read_bytes(0);
+    BinaryElement map_el(ids::SummaryTrackMap, std::vector<char>());
+    TrackSummary track;
+    // Read elements until the body is exhausted
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        switch(id)
+        {
+            case ids::SummaryTrackMap:
+                read_bytes += map_el.read(input);
+                map_ = map_el.value();
+                break;
+            case ids::SummaryTrack:
+                read_bytes += track.read(input);
+                tracks_.insert(std::make_pair(track.track_number(), track));
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
@@ -0,0 +1,823 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/compression.h>
+
+#include <algorithm>
+#include <boost/thread/mutex.hpp>
+#include <boost/unordered_map.hpp>
+#include <cstring>
+#include <tawara/crc32.h>
+#include <tawara/exceptions.h>
+
+#if defined(TAWARA_HAVE_LZ4)
+#include <lz4.h>
+#endif // defined(TAWARA_HAVE_LZ4)
+#if defined(TAWARA_HAVE_ZSTD)
+#include <zstd.h>
+#endif // defined(TAWARA_HAVE_ZSTD)
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Built-in LZ4 block format implementation
+///////////////////////////////////////////////////////////////////////////////
+
+// The shortest match that can be encoded.
+static std::size_t const lz4_min_match(4);
+// The last match must start at least this many bytes before the end.
+static std::size_t const lz4_mf_limit(12);
+// The last bytes of the data are always literals.
+static std::size_t const lz4_last_literals(5);
+// The furthest back a match can be.
+static std::size_t const lz4_max_distance(65535);
+// Size of the match-finding hash table, as a power of two.
+static unsigned int const lz4_hash_log(12);
+
+
+static uint32_t lz4_read32(char const* data)
+{
+    uint32_t result;
+    std::memcpy(&result, data, 4);
+    return result;
+}
+
+
+static uint32_t lz4_hash(uint32_t sequence)
+{
+    return (sequence * 2654435761U) >> (32 - lz4_hash_log);
+}
+
+
+// Writes the remainder of a literal or match length that does not fit in
+// its half of the token.
+static void lz4_write_length(std::size_t length, std::vector<char>& output)
+{
+    length -= 15;
+    while (length >= 255)
+    {
+        output.push_back(static_cast<char>(255));
+        length -= 255;
+    }
+    output.push_back(static_cast<char>(length));
+}
+
+
+// Writes a sequence of literals followed by a match. A match length of zero
+// marks the final sequence, which has only literals.
+static void lz4_write_sequence(char const* literals,
+        std::size_t literal_length, std::size_t offset,
+        std::size_t match_length, std::vector<char>& output)
+{
+    std::size_t token_pos(output.size());
+    unsigned char token(literal_length >= 15 ? 0xF0 : literal_length << 4);
+    output.push_back(0);
+    if (literal_length >= 15)
+    {
+        lz4_write_length(literal_length, output);
+    }
+    output.insert(output.end(), literals, literals + literal_length);
+    if (match_length != 0)
+    {
+        output.push_back(static_cast<char>(offset & 0xFF));
+        output.push_back(static_cast<char>(offset >> 8));
+        match_length -= lz4_min_match;
+        token |= match_length >= 15 ? 0x0F : match_length;
+        if (match_length >= 15)
+        {
+            lz4_write_length(match_length, output);
+        }
+    }
+    output[token_pos] = static_cast<char>(token);
+}
+
+
+namespace
+{
+
+// Data that precedes the data being compressed or decompressed, which
+// matches may refer back into. This is how dictionaries are used.
+struct Lz4Prefix
+{
+    char const* data;
+    std::size_t size;
+    // Match-finding table for the prefix; may be null
+    uint32_t const* table;
+};
+
+}; // namespace
+
+
+// Fills a match-finding table for a prefix. Entries are positions + 1, so
+// that zero is empty.
+static void lz4_fill_table(char const* data, std::size_t size,
+        std::vector<uint32_t>& table)
+{
+    table.assign(1 << lz4_hash_log, 0);
+    // Only the end of the prefix can be reached
+    std::size_t pos(size > lz4_max_distance ? size - lz4_max_distance : 0);
+    for (; pos + 4 <= size; ++pos)
+    {
+        table[lz4_hash(lz4_read32(data + pos))] = pos + 1;
+    }
+}
+
+
+// Gets a byte from the prefix followed by the data.
+static inline char lz4_window_at(Lz4Prefix const& prefix, char const* data,
+        std::size_t pos)
+{
+    return pos < prefix.size ? prefix.data[pos] : data[pos - prefix.size];
+}
+
+
+// Reads four bytes from the prefix followed by the data.
+static uint32_t lz4_window_read32(Lz4Prefix const& prefix, char const* data,
+        std::size_t pos)
+{
+    if (pos >= prefix.size)
+    {
+        return lz4_read32(data + pos - prefix.size);
+    }
+    else if (pos + 4 <= prefix.size)
+    {
+        return lz4_read32(prefix.data + pos);
+    }
+    char bytes[4];
+    for (std::size_t ii(0); ii < 4; ++ii)
+    {
+        bytes[ii] = lz4_window_at(prefix, data, pos + ii);
+    }
+    return lz4_read32(bytes);
+}
+
+
+// Checks if a match-finding table entry is a usable match.
+static bool lz4_is_match(Lz4Prefix const& prefix, char const* data,
+        std::size_t window_pos, std::size_t entry, uint32_t sequence)
+{
+    return entry != 0 && window_pos - (entry - 1) <= lz4_max_distance &&
+        lz4_window_read32(prefix, data, entry - 1) == sequence;
+}
+
+
+// A simple greedy compressor using a single-entry hash table to find
+// matches. Positions are in the window made by the prefix followed by the
+// data.
+static void lz4_compress(Lz4Prefix const& prefix, char const* data,
+        std::size_t size, std::vector<char>& output)
+{
+    output.clear();
+    output.reserve(size + size / 255 + 16);
+    std::size_t anchor(0);
+    if (size > lz4_mf_limit)
+    {
+        std::vector<uint32_t> table(1 << lz4_hash_log, 0);
+        std::size_t const match_limit(size - lz4_mf_limit);
+        std::size_t const match_end(size - lz4_last_literals);
+        std::size_t pos(0);
+        // The step grows while no matches are found, so incompressible data
+        // is skipped over quickly
+        unsigned int misses(0);
+        while (pos < match_limit)
+        {
+            std::size_t const window_pos(prefix.size + pos);
+            uint32_t sequence(lz4_read32(data + pos));
+            uint32_t const hash(lz4_hash(sequence));
+            std::size_t candidate(table[hash]);
+            table[hash] = window_pos + 1;
+            if (!lz4_is_match(prefix, data, window_pos, candidate, sequence))
+            {
+                candidate = prefix.table ? prefix.table[hash] : 0;
+                if (!lz4_is_match(prefix, data, window_pos, candidate,
+                            sequence))
+                {
+                    pos += 1 + (misses++ >> 6);
+                    continue;
+                }
+            }
+            --candidate;
+            misses = 0;
+            // Extend the match backwards into the pending literals
+            while (pos > anchor && candidate > 0 && data[pos - 1] ==
+                    lz4_window_at(prefix, data, candidate - 1))
+            {
+                --pos;
+                --candidate;
+            }
+            std::size_t length(lz4_min_match);
+            while (pos + length < match_end && data[pos + length] ==
+                    lz4_window_at(prefix, data, candidate + length))
+            {
+                ++length;
+            }
+            lz4_write_sequence(data + anchor, pos - anchor,
+                    prefix.size + pos - candidate, length, output);
+            pos += length;
+            anchor = pos;
+        }
+    }
+    lz4_write_sequence(data + anchor, size - anchor, 0, 0, output);
+}
+
+
+// Reads the remainder of a literal or match length.
+static std::size_t lz4_read_length(unsigned char const*& in,
+        unsigned char const* end)
+{
+    std::size_t length(0);
+    unsigned char byte(0);
+    do
+    {
+        if (in == end)
+        {
+            throw BadCompressedData();
+        }
+        byte = *in++;
+        length += byte;
+    }
+    while (byte == 255);
+    return length;
+}
+
+
+static void lz4_decompress(Lz4Prefix const& prefix, char const* data,
+        std::size_t size, char* output, std::size_t output_size)
+{
+    unsigned char const* in(reinterpret_cast<unsigned char const*>(data));
+    unsigned char const* end(in + size);
+    std::size_t out(0);
+    while (true)
+    {
+        if (in == end)
+        {
+            throw BadCompressedData();
+        }
+        unsigned char token(*in++);
+        std::size_t literal_length(token >> 4);
+        if (literal_length == 15)
+        {
+            literal_length += lz4_read_length(in, end);
+        }
+        if (literal_length > static_cast<std::size_t>(end - in) ||
+                literal_length > output_size - out)
+        {
+            throw BadCompressedData();
+        }
+        std::memcpy(output + out, in, literal_length);
+        in += literal_length;
+        out += literal_length;
+        if (in == end)
+        {
+            // The final sequence has only literals
+            break;
+        }
+
+        if (end - in < 2)
+        {
+            throw BadCompressedData();
+        }
+        std::size_t offset(in[0] | (in[1] << 8));
+        in += 2;
+        if (offset == 0 || offset > out + prefix.size)
+        {
+            throw BadCompressedData();
+        }
+        std::size_t match_length(token & 0x0F);
+        if (match_length == 15)
+        {
+            match_length += lz4_read_length(in, end);
+        }
+        match_length += lz4_min_match;
+        if (match_length > output_size - out)
+        {
+            throw BadCompressedData();
+        }
+        // Matches may overlap the data they produce, so copy byte by byte
+        std::size_t ii(0);
+        for (; out + ii < offset && ii < match_length; ++ii)
+        {
+            // Still in the prefix
+            output[out + ii] = prefix.data[prefix.size + out + ii - offset];
+        }
+        char* dest(output + out);
+        char const* src(dest - offset);
+        for (; ii < match_length; ++ii)
+        {
+            dest[ii] = src[ii];
+        }
+        out += match_length;
+    }
+    if (out != output_size)
+    {
+        throw BadCompressedData();
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Interface
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::compression_available(Compression algorithm)
+{
+    switch (algorithm)
+    {
+        case COMPRESSION_NONE:
+        case COMPRESSION_LZ4:
+            return true;
+        case COMPRESSION_ZSTD:
+#if defined(TAWARA_HAVE_ZSTD)
+            return true;
+#else // defined(TAWARA_HAVE_ZSTD)
+            return false;
+#endif // defined(TAWARA_HAVE_ZSTD)
+    }
+    return false;
+}
+
+
+uint64_t tawara::compression_to_algo(Compression algorithm)
+{
+    switch (algorithm)
+    {
+        case COMPRESSION_LZ4:
+            return 4;
+        case COMPRESSION_ZSTD:
+            return 5;
+        case COMPRESSION_NONE:
+            break;
+    }
+    throw UnsupportedCompression();
+}
+
+
+Compression tawara::algo_to_compression(uint64_t algo)
+{
+    switch (algo)
+    {
+        case 4:
+            return COMPRESSION_LZ4;
+        case 5:
+            return COMPRESSION_ZSTD;
+    }
+    throw UnsupportedCompression() << err_comp_algo(algo);
+}
+
+
+void tawara::compress(Compression algorithm, char const* data,
+        std::size_t size, std::vector<char>& output)
+{
+    switch (algorithm)
+    {
+        case COMPRESSION_LZ4:
+#if defined(TAWARA_HAVE_LZ4)
+            {
+                output.resize(LZ4_compressBound(size));
+                int result(LZ4_compress_default(data, &output[0], size,
+                            output.size()));
+                if (result <= 0)
+                {
+                    throw UnsupportedCompression() <<
+                        err_comp_algo(compression_to_algo(algorithm));
+                }
+                output.resize(result);
+            }
+#else // defined(TAWARA_HAVE_LZ4)
+            {
+                Lz4Prefix const no_prefix = {0, 0, 0};
+                lz4_compress(no_prefix, data, size, output);
+            }
+#endif // defined(TAWARA_HAVE_LZ4)
+            return;
+#if defined(TAWARA_HAVE_ZSTD)
+        case COMPRESSION_ZSTD:
+            {
+                output.resize(ZSTD_compressBound(size));
+                std::size_t result(ZSTD_compress(&output[0], output.size(),
+                            data, size, 1));
+                if (ZSTD_isError(result))
+                {
+                    throw UnsupportedCompression() <<
+                        err_comp_algo(compression_to_algo(algorithm));
+                }
+                output.resize(result);
+            }
+            return;
+#endif // defined(TAWARA_HAVE_ZSTD)
+        default:
+            break;
+    }
+    throw UnsupportedCompression();
+}
+
+
+void tawara::decompress(Compression algorithm, char const* data,
+        std::size_t size, char* output, std::size_t output_size)
+{
+    switch (algorithm)
+    {
+        case COMPRESSION_LZ4:
+#if defined(TAWARA_HAVE_LZ4)
+            if (LZ4_decompress_safe(data, output, size, output_size) !=
+                    static_cast<int>(output_size))
+            {
+                throw BadCompressedData();
+            }
+#else // defined(TAWARA_HAVE_LZ4)
+            {
+                Lz4Prefix const no_prefix = {0, 0, 0};
+                lz4_decompress(no_prefix, data, size, output, output_size);
+            }
+#endif // defined(TAWARA_HAVE_LZ4)
+            return;
+#if defined(TAWARA_HAVE_ZSTD)
+        case COMPRESSION_ZSTD:
+            if (ZSTD_decompress(output, output_size, data, size) !=
+                    output_size)
+            {
+                throw BadCompressedData();
+            }
+            return;
+#endif // defined(TAWARA_HAVE_ZSTD)
+        default:
+            break;
+    }
+    throw UnsupportedCompression();
+}
+
+
+uint64_t tawara::max_decompressed_size(Compression algorithm,
+        std::size_t size)
+{
+    switch (algorithm)
+    {
+        case COMPRESSION_LZ4:
+            // Each byte of a match length adds at most 255 bytes
+            return static_cast<uint64_t>(size) * 256 + 64;
+        case COMPRESSION_ZSTD:
+            // A run-length block of 4 bytes holds at most 128 KiB
+            return static_cast<uint64_t>(size) * 32768;
+        case COMPRESSION_NONE:
+            break;
+    }
+    return size;
+}
+
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Dictionaries
+///////////////////////////////////////////////////////////////////////////////
+
+// The contexts a dictionary keeps for reuse. Each is used by one thread at a
+// time; a thread that finds one in use makes a temporary context rather than
+// waiting for it.
+struct CompressionDictionary::Contexts
+{
+    boost::mutex cctx_mutex;
+    void* zstd_cctx;
+    boost::mutex dctx_mutex;
+    void* zstd_dctx;
+};
+
+
+CompressionDictionary::CompressionDictionary(std::vector<char> const& data)
+    : data_(data), id_(crc32(data.empty() ? 0 : &data[0], data.size())),
+    lz4_stream_(0), zstd_cdict_(0), zstd_ddict_(0), contexts_(0)
+{
+#if defined(TAWARA_HAVE_LZ4)
+    LZ4_stream_t* stream(LZ4_createStream());
+    LZ4_loadDict(stream, data_.empty() ? 0 : &data_[0], data_.size());
+    lz4_stream_ = stream;
+#else // defined(TAWARA_HAVE_LZ4)
+    lz4_fill_table(data_.empty() ? 0 : &data_[0], data_.size(), lz4_table_);
+#endif // defined(TAWARA_HAVE_LZ4)
+#if defined(TAWARA_HAVE_ZSTD)
+    zstd_cdict_ = ZSTD_createCDict(data_.empty() ? 0 : &data_[0],
+            data_.size(), 1);
+    zstd_ddict_ = ZSTD_createDDict(data_.empty() ? 0 : &data_[0],
+            data_.size());
+    contexts_ = new Contexts;
+    contexts_->zstd_cctx = ZSTD_createCCtx();
+    contexts_->zstd_dctx = ZSTD_createDCtx();
+#endif // defined(TAWARA_HAVE_ZSTD)
+}
+
+
+CompressionDictionary::~CompressionDictionary()
+{
+#if defined(TAWARA_HAVE_LZ4)
+    LZ4_freeStream(static_cast<LZ4_stream_t*>(lz4_stream_));
+#endif // defined(TAWARA_HAVE_LZ4)
+#if defined(TAWARA_HAVE_ZSTD)
+    ZSTD_freeCDict(static_cast<ZSTD_CDict*>(zstd_cdict_));
+    ZSTD_freeDDict(static_cast<ZSTD_DDict*>(zstd_ddict_));
+    ZSTD_freeCCtx(static_cast<ZSTD_CCtx*>(contexts_->zstd_cctx));
+    ZSTD_freeDCtx(static_cast<ZSTD_DCtx*>(contexts_->zstd_dctx));
+    delete contexts_;
+#endif // defined(TAWARA_HAVE_ZSTD)
+}
+
+
+void CompressionDictionary::compress(Compression algorithm, char const* data,
+        std::size_t size, std::vector<char>& output) const
+{
+    switch (algorithm)
+    {
+        case COMPRESSION_LZ4:
+#if defined(TAWARA_HAVE_LZ4)
+            {
+                // Start from a copy of the stream with the dictionary
+                // loaded, which is much cheaper than loading it again.
+                // (LZ4_attach_dictionary() would avoid the copy, but it is
+                // not exported by shared builds of the library.)
+                LZ4_stream_t stream;
+                std::memcpy(&stream, lz4_stream_, sizeof(stream));
+                output.resize(LZ4_compressBound(size));
+                int result(LZ4_compress_fast_continue(&stream, data,
+                            &output[0], size, output.size(), 1));
+                if (result <= 0)
+                {
+                    throw UnsupportedCompression() <<
+                        err_comp_algo(compression_to_algo(algorithm));
+                }
+                output.resize(result);
+            }
+#else // defined(TAWARA_HAVE_LZ4)
+            {
+                Lz4Prefix const prefix = {data_.empty() ? 0 : &data_[0],
+                    data_.size(), &lz4_table_[0]};
+                lz4_compress(prefix, data, size, output);
+            }
+#endif // defined(TAWARA_HAVE_LZ4)
+            return;
+#if defined(TAWARA_HAVE_ZSTD)
+        case COMPRESSION_ZSTD:
+            {
+                output.resize(ZSTD_compressBound(size));
+                boost::mutex::scoped_try_lock lock(contexts_->cctx_mutex);
+                ZSTD_CCtx* context(lock.owns_lock() ?
+                        static_cast<ZSTD_CCtx*>(contexts_->zstd_cctx) :
+                        ZSTD_createCCtx());
+                std::size_t result(ZSTD_compress_usingCDict(context,
+                            &output[0], output.size(), data, size,
+                            static_cast<ZSTD_CDict*>(zstd_cdict_)));
+                if (!lock.owns_lock())
+                {
+                    ZSTD_freeCCtx(context);
+                }
+                if (ZSTD_isError(result))
+                {
+                    throw UnsupportedCompression() <<
+                        err_comp_algo(compression_to_algo(algorithm));
+                }
+                output.resize(result);
+            }
+            return;
+#endif // defined(TAWARA_HAVE_ZSTD)
+        default:
+            break;
+    }
+    throw UnsupportedCompression();
+}
+
+
+void CompressionDictionary::decompress(Compression algorithm,
+        char const* data, std::size_t size, char* output,
+        std::size_t output_size) const
+{
+    char const* dict(data_.empty() ? 0 : &data_[0]);
+    switch (algorithm)
+    {
+        case COMPRESSION_LZ4:
+#if defined(TAWARA_HAVE_LZ4)
+            if (LZ4_decompress_safe_usingDict(data, output, size,
+                        output_size, dict, data_.size()) !=
+                    static_cast<int>(output_size))
+            {
+                throw BadCompressedData();
+            }
+#else // defined(TAWARA_HAVE_LZ4)
+            {
+                // Nothing beyond the maximum distance can be referred to
+                std::size_t const offset(data_.size() > lz4_max_distance ?
+                        data_.size() - lz4_max_distance : 0);
+                Lz4Prefix const prefix = {dict + offset,
+                    data_.size() - offset, 0};
+                lz4_decompress(prefix, data, size, output, output_size);
+            }
+#endif // defined(TAWARA_HAVE_LZ4)
+            return;
+#if defined(TAWARA_HAVE_ZSTD)
+        case COMPRESSION_ZSTD:
+            {
+                boost::mutex::scoped_try_lock lock(contexts_->dctx_mutex);
+                ZSTD_DCtx* context(lock.owns_lock() ?
+                        static_cast<ZSTD_DCtx*>(contexts_->zstd_dctx) :
+                        ZSTD_createDCtx());
+                std::size_t result(ZSTD_decompress_usingDDict(context, output,
+                            output_size, data, size,
+                            static_cast<ZSTD_DDict*>(zstd_ddict_)));
+                if (!lock.owns_lock())
+                {
+                    ZSTD_freeDCtx(context);
+                }
+                if (result != output_size)
+                {
+                    throw BadCompressedData();
+                }
+            }
+            return;
+#endif // defined(TAWARA_HAVE_ZSTD)
+        default:
+            break;
+    }
+    throw UnsupportedCompression();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Dictionary training
+///////////////////////////////////////////////////////////////////////////////
+
+// The length of the sequences counted when training. Sequences shorter than
+// this are not worth finding in a dictionary.
+static std::size_t const dict_seq_length(6);
+// The length of the segments the dictionary is made from.
+static std::size_t const dict_segment_length(64);
+
+
+// Gets the sequence starting at a position.
+static uint64_t dict_sequence(char const* data)
+{
+    uint64_t result(0);
+    std::memcpy(&result, data, dict_seq_length);
+    return result;
+}
+
+
+// A segment of the samples chosen for the dictionary.
+struct DictSegment
+{
+    std::size_t start;
+    std::size_t length;
+    uint64_t score;
+
+    bool operator<(DictSegment const& other) const
+        { return score < other.score; }
+};
+
+
+std::vector<char> tawara::train_dictionary(
+        std::vector<std::vector<char> > const& samples, std::size_t max_size)
+{
+    // Join the samples, remembering where each starts
+    std::vector<char> joined;
+    std::vector<std::size_t> starts;
+    for (std::vector<std::vector<char> >::const_iterator sample(
+                samples.begin()); sample != samples.end(); ++sample)
+    {
+        starts.push_back(joined.size());
+        joined.insert(joined.end(), sample->begin(), sample->end());
+    }
+    starts.push_back(joined.size());
+    if (joined.size() < dict_seq_length || max_size == 0)
+    {
+        return std::vector<char>();
+    }
+
+    // Count the number of samples each sequence occurs in. The position of
+    // each sequence is its key, as the sequences themselves are not needed
+    // after counting. Positions where a sequence would cross into the next
+    // sample are given no key.
+    typedef boost::unordered_map<uint64_t, std::pair<uint32_t, std::size_t> >
+        Counts;
+    Counts counts;
+    std::vector<uint32_t*> seq_counts(joined.size(), 0);
+    for (std::size_t ii(0); ii < samples.size(); ++ii)
+    {
+        for (std::size_t pos(starts[ii]);
+                pos + dict_seq_length <= starts[ii + 1]; ++pos)
+        {
+            std::pair<uint32_t, std::size_t>& count(
+                    counts[dict_sequence(&joined[pos])]);
+            if (count.first == 0 || count.second != ii)
+            {
+                ++count.first;
+                count.second = ii;
+            }
+            seq_counts[pos] = &count.first;
+        }
+    }
+    // A sequence that occurs in only one sample is not worth including
+    for (Counts::iterator count(counts.begin()); count != counts.end();
+            ++count)
+    {
+        if (count->second.first < 2)
+        {
+            count->second.first = 0;
+        }
+    }
+
+    // Split the samples into one epoch per segment that fits in the
+    // dictionary, and choose the best segment in each epoch. Once chosen,
+    // a segment's sequences are not counted again, so later segments only
+    // score for content not already in the dictionary.
+    std::size_t const segment_length(std::min(dict_segment_length,
+                std::min(max_size, joined.size())));
+    std::size_t const covered(segment_length - dict_seq_length + 1);
+    std::size_t epochs(std::max<std::size_t>(max_size / segment_length, 1));
+    epochs = std::min(epochs, joined.size() / segment_length);
+    std::size_t const epoch_length(joined.size() / epochs);
+    std::vector<DictSegment> segments;
+    for (std::size_t epoch(0); epoch < epochs; ++epoch)
+    {
+        std::size_t const begin(epoch * epoch_length);
+        std::size_t const end(epoch == epochs - 1 ? joined.size() :
+                begin + epoch_length);
+        DictSegment best = {begin, segment_length, 0};
+        uint64_t score(0);
+        for (std::size_t pos(begin); pos + dict_seq_length <= end; ++pos)
+        {
+            // Slide the window so it ends at pos
+            score += seq_counts[pos] ? *seq_counts[pos] : 0;
+            if (pos >= begin + covered)
+            {
+                std::size_t const leaving(pos - covered);
+                score -= seq_counts[leaving] ? *seq_counts[leaving] : 0;
+            }
+            if (score > best.score && pos + 1 >= begin + covered)
+            {
+                best.start = pos + 1 - covered;
+                best.score = score;
+            }
+        }
+        if (best.score == 0)
+        {
+            continue;
+        }
+        for (std::size_t pos(best.start); pos < best.start + covered; ++pos)
+        {
+            if (seq_counts[pos])
+            {
+                *seq_counts[pos] = 0;
+            }
+        }
+        segments.push_back(best);
+    }
+
+    // Put the best segments last, and drop the worst if there are too many
+    std::stable_sort(segments.begin(), segments.end());
+    std::vector<char> result;
+    std::size_t size(0);
+    std::size_t first(segments.size());
+    while (first > 0 && size + segments[first - 1].length <= max_size)
+    {
+        --first;
+        size += segments[first].length;
+    }
+    for (; first < segments.size(); ++first)
+    {
+        std::vector<char>::const_iterator start(joined.begin() +
+                segments[first].start);
+        result.insert(result.end(), start, start + segments[first].length);
+    }
+    return result;
+}
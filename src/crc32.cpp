@@ -0,0 +1,139 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/crc32.h>
+
+#include <algorithm>
+#include <tawara/exceptions.h>
+#include <vector>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Lookup tables
+///////////////////////////////////////////////////////////////////////////////
+
+// The tables for the slice-by-8 method. Table 0 is the usual byte-at-a-time
+// table for the reflected IEEE polynomial; table n gives the CRC of a byte
+// followed by n zero bytes.
+struct CRC32Tables
+{
+    CRC32Tables()
+    {
+        for (uint32_t ii(0); ii < 256; ++ii)
+        {
+            uint32_t crc(ii);
+            for (int jj(0); jj < 8; ++jj)
+            {
+                crc = (crc >> 1) ^ (crc & 1 ? 0xEDB88320 : 0);
+            }
+            table[0][ii] = crc;
+        }
+        for (uint32_t ii(0); ii < 256; ++ii)
+        {
+            for (int jj(1); jj < 8; ++jj)
+            {
+                table[jj][ii] = (table[jj - 1][ii] >> 8) ^
+                    table[0][table[jj - 1][ii] & 0xFF];
+            }
+        }
+    }
+
+    uint32_t table[8][256];
+}; // struct CRC32Tables
+
+static CRC32Tables const crc_tables;
+
+
+// Reads a little-endian 32-bit value.
+inline uint32_t read_le32(unsigned char const* p)
+{
+    return static_cast<uint32_t>(p[0]) |
+        (static_cast<uint32_t>(p[1]) << 8) |
+        (static_cast<uint32_t>(p[2]) << 16) |
+        (static_cast<uint32_t>(p[3]) << 24);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CRC functions
+///////////////////////////////////////////////////////////////////////////////
+
+uint32_t tawara::crc32(char const* data, std::size_t size, uint32_t crc)
+{
+    uint32_t const (*t)[256](crc_tables.table);
+    unsigned char const* p(reinterpret_cast<unsigned char const*>(data));
+    crc = ~crc;
+    for (; size >= 8; size -= 8, p += 8)
+    {
+        uint32_t one(read_le32(p) ^ crc);
+        uint32_t two(read_le32(p + 4));
+        crc = t[7][one & 0xFF] ^ t[6][(one >> 8) & 0xFF] ^
+            t[5][(one >> 16) & 0xFF] ^ t[4][one >> 24] ^
+            t[3][two & 0xFF] ^ t[2][(two >> 8) & 0xFF] ^
+            t[1][(two >> 16) & 0xFF] ^ t[0][two >> 24];
+    }
+    for (; size > 0; --size, ++p)
+    {
+        crc = (crc >> 8) ^ t[0][(crc ^ *p) & 0xFF];
+    }
+    return ~crc;
+}
+
+
+uint32_t tawara::crc32(std::istream& input, std::streamsize size,
+        uint32_t crc)
+{
+    std::vector<char> buffer(std::min(size,
+                static_cast<std::streamsize>(65536)));
+    while (size > 0)
+    {
+        std::streamsize chunk(std::min(size,
+                    static_cast<std::streamsize>(buffer.size())));
+        input.read(&buffer[0], chunk);
+        if (!input)
+        {
+            throw ReadError() << err_pos(input.tellg());
+        }
+        crc = crc32(&buffer[0], chunk, crc);
+        size -= chunk;
+    }
+    return crc;
+}
+
@@ -0,0 +1,289 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tawara/cut.h>
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <limits>
+#include <tawara/block_header.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/segment.h>
+#include <tawara/tracks.h>
+#include <tawara/vint.h>
+#include <vector>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// Copies a level 1 element, given by its segment offset, into the output
+// segment and adds it to the output segment's index.
+static void copy_element(std::istream& input, Segment const& in_segment,
+        std::streamoff pos, std::ostream& output, Segment& out_segment)
+{
+    std::streampos start(in_segment.to_stream_offset(pos));
+    input.seekg(start);
+    ids::ReadResult id_res = ids::read(input);
+    vint::ReadResult size_res = vint::read(input);
+    out_segment.index.insert(std::make_pair(id_res.first,
+                out_segment.to_segment_offset(output.tellp())));
+    input.seekg(start);
+    copy_bytes(input, id_res.second + size_res.second + size_res.first,
+            output);
+}
+
+
+// Copies a run of consecutive clusters in one go.
+static void flush_run(std::istream& input, std::streampos& start,
+        std::streampos& end, std::ostream& output, Segment& out_segment)
+{
+    if (start == end)
+    {
+        return;
+    }
+    if (out_segment.index.find(ids::Cluster) == out_segment.index.end())
+    {
+        out_segment.index.insert(std::make_pair(ids::Cluster,
+                    out_segment.to_segment_offset(output.tellp())));
+    }
+    input.seekg(start);
+    copy_bytes(input, end - start, output);
+    start = end = 0;
+}
+
+
+// Checks from a cluster's summary, without reading its blocks, if every block
+// of the cluster falls in the time range and is of a wanted track.
+static bool keep_whole(FileCluster const& cluster, int64_t begin_tc,
+        int64_t end_tc, FileCluster::TrackSet const& tracks)
+{
+    if (!cluster.has_summary())
+    {
+        return false;
+    }
+    int64_t first(begin_tc - static_cast<int64_t>(cluster.timecode()));
+    int64_t last(end_tc - static_cast<int64_t>(cluster.timecode()) - 1);
+    if (first > std::numeric_limits<int16_t>::max() ||
+            last < std::numeric_limits<int16_t>::min())
+    {
+        return false;
+    }
+    first = std::max(first,
+            static_cast<int64_t>(std::numeric_limits<int16_t>::min()));
+    last = std::min(last,
+            static_cast<int64_t>(std::numeric_limits<int16_t>::max()));
+    return cluster.summary().only_contains(tracks, first, last);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Cutting
+///////////////////////////////////////////////////////////////////////////////
+
+void tawara::cut(std::istream& input, std::iostream& output, int64_t t_begin,
+        int64_t t_end, FileCluster::TrackSet const& tracks)
+{
+    read_tawara_header(input);
+    ids::ReadResult id_res = ids::read(input);
+    if (id_res.first != ids::Segment)
+    {
+        throw InvalidChildID() << err_id(id_res.first) <<
+            // The cast here makes Apple's LLVM compiler happy
+            err_pos(static_cast<std::streamsize>(input.tellg()) -
+                    id_res.second);
+    }
+    Segment in_segment;
+    in_segment.read(input);
+
+    SeekHead::const_iterator tracks_el(in_segment.index.find(ids::Tracks));
+    if (tracks_el == in_segment.index.end())
+    {
+        throw NoTracks();
+    }
+    input.seekg(in_segment.to_stream_offset(tracks_el->second));
+    ids::read(input);
+    Tracks in_tracks;
+    in_tracks.read(input);
+    Tracks out_tracks;
+    BOOST_FOREACH(Tracks::value_type const& track, in_tracks)
+    {
+        if (tracks.empty() || tracks.count(track.first) != 0)
+        {
+            out_tracks.insert(track.second);
+        }
+    }
+
+    // Write the document header, segment information, tracks and
+    // attachments
+    EBMLElement ebml_el;
+    ebml_el.write(output);
+    int64_t begin_tc(in_segment.to_timecode(t_begin));
+    int64_t end_tc(in_segment.to_timecode(t_end));
+    Segment out_segment;
+    out_segment.info = in_segment.info;
+    if (in_segment.info.has_duration())
+    {
+        // The new document lasts for the part of the range covered by the
+        // input
+        double begin(std::max(begin_tc, static_cast<int64_t>(0)));
+        double end(std::min(static_cast<double>(end_tc),
+                    in_segment.info.duration()));
+        if (end > begin)
+        {
+            out_segment.info.duration(end - begin);
+        }
+        else
+        {
+            out_segment.info.clear_duration();
+        }
+    }
+    out_segment.write(output);
+    out_segment.index.insert(std::make_pair(ids::Tracks,
+                out_segment.to_segment_offset(output.tellp())));
+    out_tracks.write(output);
+    SeekHead::const_iterator attachments_el(
+            in_segment.index.find(ids::Attachments));
+    if (attachments_el != in_segment.index.end())
+    {
+        copy_element(input, in_segment, attachments_el->second, output,
+                out_segment);
+    }
+
+    std::streampos run_start(0), run_end(0);
+    std::vector<BlockHeader> headers;
+    std::vector<bool> keep;
+    for (Segment::FileClusterIterator cluster(
+                in_segment.clusters_at_time(input, t_begin));
+            cluster != in_segment.clusters_end_file(input); ++cluster)
+    {
+        int64_t cluster_tc(cluster->timecode());
+        if (cluster_tc >= end_tc)
+        {
+            break;
+        }
+
+        // A cluster's Position and PrevSize are wrong once it has been
+        // moved, so clusters holding them are rewritten without them
+        bool movable(!cluster->has_position() &&
+                cluster->previous_size() == 0);
+
+        // Find the blocks of the cluster to keep, from the cluster's summary
+        // if it shows that the cluster can be copied whole, otherwise from
+        // their headers
+        headers.clear();
+        keep.clear();
+        size_t kept(0);
+        bool whole(movable && keep_whole(*cluster, begin_tc, end_tc, tracks));
+        if (!whole)
+        {
+            input.seekg(cluster->blocks_start_pos());
+            while (input.tellg() < cluster->blocks_end_pos())
+            {
+                BlockHeader header(read_block_header(input));
+                int64_t block_tc(cluster_tc + header.timecode);
+                bool wanted(block_tc >= begin_tc && block_tc < end_tc &&
+                        (tracks.empty() ||
+                         tracks.count(header.track_number) != 0));
+                headers.push_back(header);
+                keep.push_back(wanted);
+                kept += wanted ? 1 : 0;
+            }
+            whole = kept != 0 && kept == headers.size();
+        }
+
+        if (whole && movable)
+        {
+            // The whole cluster is kept; add it to the run of clusters to
+            // copy
+            if (run_start != run_end && run_end != cluster->offset())
+            {
+                flush_run(input, run_start, run_end, output, out_segment);
+            }
+            if (run_start == run_end)
+            {
+                run_start = cluster->offset();
+            }
+            run_end = static_cast<std::streamsize>(cluster->offset()) +
+                cluster->size();
+            continue;
+        }
+        flush_run(input, run_start, run_end, output, out_segment);
+        if (kept == 0)
+        {
+            continue;
+        }
+
+        // Rewrite the cluster with only the blocks to keep
+        FileCluster new_cluster(cluster->timecode());
+        new_cluster.summary_pad(cluster->summary_pad());
+        if (out_segment.index.find(ids::Cluster) == out_segment.index.end())
+        {
+            out_segment.index.insert(std::make_pair(ids::Cluster,
+                        out_segment.to_segment_offset(output.tellp())));
+        }
+        new_cluster.write(output);
+        for (size_t ii(0); ii < headers.size(); ++ii)
+        {
+            if (keep[ii])
+            {
+                new_cluster.push_back_copy(input, headers[ii],
+                        headers[ii].track_number, headers[ii].timecode);
+            }
+        }
+        new_cluster.finalise(output);
+    }
+    flush_run(input, run_start, run_end, output, out_segment);
+    if (out_segment.index.find(ids::Cluster) == out_segment.index.end())
+    {
+        // A segment must have a cluster to be readable, so write an empty
+        // one if there were no blocks in the range
+        FileCluster empty(std::max(begin_tc, static_cast<int64_t>(0)));
+        out_segment.index.insert(std::make_pair(ids::Cluster,
+                    out_segment.to_segment_offset(output.tellp())));
+        empty.write(output);
+        empty.finalise(output);
+    }
+
+    out_segment.finalise(output);
+}
+
@@ -153,6 +153,35 @@ std::streamsize EBMLElement::read_body(std::istream& input,
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Document header checking
+///////////////////////////////////////////////////////////////////////////////
+
+EBMLElement tawara::read_tawara_header(std::istream& input)
+{
+    ids::ReadResult id_res = ids::read(input);
+    if (id_res.first != ids::EBML)
+    {
+        throw NotEBML();
+    }
+    EBMLElement result;
+    result.read(input);
+    if (result.doc_type() != TawaraDocType)
+    {
+        throw NotTawara();
+    }
+    if (result.read_version() > TawaraEBMLVersion)
+    {
+        throw BadReadVersion();
+    }
+    if (result.doc_read_version() > TawaraVersionMajor)
+    {
+        throw BadDocReadVersion();
+    }
+    return result;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Internal methods
 ///////////////////////////////////////////////////////////////////////////////
@@ -40,6 +40,7 @@
 
 #include <limits>
 #include <tawara/exceptions.h>
+#include <tawara/trace.h>
 #include <tawara/vint.h>
 
 using namespace tawara;
@@ -82,8 +83,13 @@ std::streamsize Element::write(std::ostream& output)
 {
     // Fill in the offset of this element in the byte stream.
     offset_ = output.tellp();
+    TAWARA_TRACE(ELEMENT_WRITE_BEGIN, id_, offset_, 0);
 
-    return write_id(output) + write_size(output) + write_body(output);
+    std::streamsize written(write_id(output));
+    written += write_size(output);
+    written += write_body(output);
+    TAWARA_TRACE(ELEMENT_WRITE_END, id_, offset_, written);
+    return written;
 }
 
 
@@ -113,8 +119,12 @@ std::streamsize Element::read(std::istream& input)
     vint::ReadResult result = tawara::vint::read(input);
     std::streamsize body_size(result.first);
     std::streamsize read_bytes(result.second);
+    TAWARA_TRACE(ELEMENT_READ_BEGIN, id_, offset_, body_size);
     // The rest of the read is implemented by child classes
-    return read_bytes + read_body(input, body_size);
+    read_bytes += read_body(input, body_size);
+    TAWARA_TRACE(ELEMENT_READ_END, id_, offset_,
+            ids::size(id_) + read_bytes);
+    return read_bytes;
 }
 
 
@@ -0,0 +1,343 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/faststart.h>
+
+#include <boost/foreach.hpp>
+#include <map>
+#include <tawara/block_header.h>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/segment.h>
+#include <tawara/uint_element.h>
+#include <tawara/vint.h>
+#include <tawara/void_element.h>
+#include <vector>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// A level 1 element that is copied without decoding.
+struct RelocatedElement
+{
+    RelocatedElement(ids::ID id, std::streampos pos, std::streamsize size)
+        : id(id), pos(pos), size(size), position_offset(0), position_size(0)
+    {
+    }
+
+    ids::ID id;
+    std::streampos pos;
+    std::streamsize size;
+    // The offset of a cluster's Position element from the start of the
+    // cluster, and the size of the element. The size is zero if the cluster
+    // has no Position.
+    std::streamoff position_offset;
+    std::streamsize position_size;
+}; // struct RelocatedElement
+
+
+// Finds the Position element of a cluster, if it has one, by reading the
+// children before its first block. The input must be at the start of the
+// cluster's body.
+static void find_position(std::istream& input, RelocatedElement& cluster)
+{
+    std::streampos end(static_cast<std::streamsize>(cluster.pos) +
+            cluster.size);
+    while (input.tellg() < end)
+    {
+        std::streampos start(input.tellg());
+        ids::ReadResult id_res = ids::read(input);
+        if (id_res.first == ids::SimpleBlock ||
+                id_res.first == ids::BlockGroup)
+        {
+            return;
+        }
+        vint::ReadResult size_res = vint::read(input);
+        if (id_res.first == ids::Position)
+        {
+            cluster.position_offset = start - cluster.pos;
+            cluster.position_size = id_res.second + size_res.second +
+                size_res.first;
+            return;
+        }
+        input.seekg(size_res.first, std::ios::cur);
+    }
+}
+
+
+// Copies a cluster to its new place in the output. A Position element is
+// replaced with one holding the new position of the cluster, followed by
+// padding for any space left over. If the new Position does not leave room
+// for the padding, it is dropped and its space is all padding, as
+// a Position is optional. The size of the cluster does not change.
+static void copy_cluster(std::istream& input, RelocatedElement const& cluster,
+        std::ostream& output, Segment const& out_segment)
+{
+    std::streampos out_start(output.tellp());
+    input.seekg(cluster.pos);
+    if (cluster.position_size == 0)
+    {
+        copy_bytes(input, cluster.size, output);
+        return;
+    }
+
+    copy_bytes(input, cluster.position_offset, output);
+    UIntElement position(ids::Position,
+            out_segment.to_segment_offset(out_start));
+    std::streamsize left(cluster.position_size - position.size());
+    if (left == 0 || left >= 2)
+    {
+        position.write(output);
+    }
+    else
+    {
+        left = cluster.position_size;
+    }
+    if (left != 0)
+    {
+        VoidElement padding(left, true);
+        padding.write(output);
+    }
+    input.seekg(static_cast<std::streamsize>(cluster.pos) +
+            cluster.position_offset + cluster.position_size);
+    copy_bytes(input, cluster.size - cluster.position_offset -
+            cluster.position_size, output);
+}
+
+
+// Sets the cluster positions in a set of cues to the new position of each
+// cluster. Positions that do not refer to the start of a cluster cannot be
+// relocated and are left as they are.
+static void patch_cues(std::vector<Cues> const& in_cues,
+        std::map<uint64_t, uint64_t> const& cluster_offsets,
+        uint64_t clusters_start, std::vector<Cues>& out_cues)
+{
+    out_cues = in_cues;
+    BOOST_FOREACH(Cues& cues, out_cues)
+    {
+        BOOST_FOREACH(Cues::value_type& point, cues)
+        {
+            BOOST_FOREACH(CueTrackPosition& ctp, point.second)
+            {
+                std::map<uint64_t, uint64_t>::const_iterator new_pos(
+                        cluster_offsets.find(ctp.cluster_pos()));
+                if (new_pos != cluster_offsets.end())
+                {
+                    ctp.cluster_pos(clusters_start + new_pos->second);
+                }
+            }
+        }
+    }
+}
+
+
+// Gets the total size of a set of cues.
+static std::streamsize cues_size(std::vector<Cues> const& cues)
+{
+    std::streamsize result(0);
+    BOOST_FOREACH(Cues const& c, cues)
+    {
+        result += c.size();
+    }
+    return result;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Relocation
+///////////////////////////////////////////////////////////////////////////////
+
+void tawara::faststart(std::istream& input, std::iostream& output)
+{
+    read_tawara_header(input);
+    ids::ReadResult id_res = ids::read(input);
+    if (id_res.first != ids::Segment)
+    {
+        throw InvalidChildID() << err_id(id_res.first) <<
+            // The cast here makes Apple's LLVM compiler happy
+            err_pos(static_cast<std::streamsize>(input.tellg()) -
+                    id_res.second);
+    }
+    Segment in_segment;
+    in_segment.read(input);
+
+    // Find the level 1 elements of the segment by skipping over their
+    // bodies. The SeekHead is regenerated, so it and any padding are
+    // dropped, while the Tracks go first and the other elements after the
+    // Cues.
+    input.seekg(in_segment.offset());
+    ids::read(input);
+    vint::ReadResult seg_size = vint::read(input);
+    std::streampos seg_end(static_cast<std::streamsize>(input.tellg()) +
+            seg_size.first);
+    std::vector<RelocatedElement> tracks, others, clusters;
+    std::vector<Cues> in_cues;
+    while (input.tellg() < seg_end)
+    {
+        std::streampos start(input.tellg());
+        id_res = ids::read(input);
+        vint::ReadResult size_res = vint::read(input);
+        std::streamsize size(id_res.second + size_res.second +
+                size_res.first);
+        switch (id_res.first)
+        {
+            case ids::SeekHead:
+            case ids::Info:
+            case ids::Void:
+                break;
+            case ids::Tracks:
+                tracks.push_back(RelocatedElement(id_res.first, start, size));
+                break;
+            case ids::Cluster:
+                clusters.push_back(RelocatedElement(id_res.first, start,
+                            size));
+                find_position(input, clusters.back());
+                break;
+            case ids::Cues:
+                input.seekg(static_cast<std::streamsize>(start) +
+                        id_res.second);
+                in_cues.push_back(Cues());
+                in_cues.back().read(input);
+                break;
+            default:
+                others.push_back(RelocatedElement(id_res.first, start, size));
+        }
+        input.seekg(static_cast<std::streamsize>(start) + size);
+    }
+
+    // The offset of each cluster from the start of the clusters, which is
+    // the same in the new document as they are copied in order
+    std::map<uint64_t, uint64_t> cluster_offsets;
+    uint64_t clusters_size(0);
+    BOOST_FOREACH(RelocatedElement const& el, clusters)
+    {
+        cluster_offsets[in_segment.to_segment_offset(el.pos)] =
+            clusters_size;
+        clusters_size += el.size;
+    }
+
+    // Lay out the new segment. The SeekHead and SegmentInfo are written by
+    // Segment::finalise() into the padding at the start of the segment,
+    // which must have room for both plus a Void element of at least two
+    // bytes. The size of the SeekHead and the Cues depends on the positions
+    // they hold, which depend on the size of the padding and the Cues, so
+    // repeat until the sizes no longer change. Sizes only grow, so this
+    // will end.
+    SegmentInfo info(in_segment.info);
+    Segment out_segment(2);
+    std::vector<Cues> out_cues;
+    while (true)
+    {
+        out_segment.index.clear();
+        uint64_t pos(out_segment.pad_size());
+        BOOST_FOREACH(RelocatedElement const& el, tracks)
+        {
+            out_segment.index.insert(std::make_pair(el.id, pos));
+            pos += el.size;
+        }
+        uint64_t others_size(0);
+        BOOST_FOREACH(RelocatedElement const& el, others)
+        {
+            others_size += el.size;
+        }
+        std::streamsize out_cues_size(cues_size(in_cues));
+        while (true)
+        {
+            patch_cues(in_cues, cluster_offsets,
+                    pos + out_cues_size + others_size, out_cues);
+            if (cues_size(out_cues) == out_cues_size)
+            {
+                break;
+            }
+            out_cues_size = cues_size(out_cues);
+        }
+        BOOST_FOREACH(Cues const& cues, out_cues)
+        {
+            out_segment.index.insert(std::make_pair(ids::Cues, pos));
+            pos += cues.size();
+        }
+        BOOST_FOREACH(RelocatedElement const& el, others)
+        {
+            out_segment.index.insert(std::make_pair(el.id, pos));
+            pos += el.size;
+        }
+        if (!clusters.empty())
+        {
+            out_segment.index.insert(std::make_pair(ids::Cluster, pos));
+        }
+
+        std::streamsize needed(out_segment.index.size() + info.size() + 2);
+        if (needed <= out_segment.pad_size())
+        {
+            break;
+        }
+        out_segment.pad_size(needed);
+    }
+
+    // Write the new document
+    EBMLElement ebml_el;
+    ebml_el.write(output);
+    out_segment.info = info;
+    out_segment.write(output);
+    BOOST_FOREACH(RelocatedElement const& el, tracks)
+    {
+        input.seekg(el.pos);
+        copy_bytes(input, el.size, output);
+    }
+    BOOST_FOREACH(Cues& cues, out_cues)
+    {
+        cues.write(output);
+    }
+    BOOST_FOREACH(RelocatedElement const& el, others)
+    {
+        input.seekg(el.pos);
+        copy_bytes(input, el.size, output);
+    }
+    BOOST_FOREACH(RelocatedElement const& el, clusters)
+    {
+        copy_cluster(input, el, output, out_segment);
+    }
+    out_segment.finalise(output);
+}
+
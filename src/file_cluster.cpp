@@ -41,6 +41,7 @@
 #include <tawara/block_group.h>
 #include <tawara/exceptions.h>
 #include <tawara/simple_block.h>
+#include <tawara/trace.h>
 
 using namespace tawara;
 
@@ -70,6 +71,14 @@ FileCluster::Iterator FileCluster::end()
 }
 
 
+FileCluster::Iterator FileCluster::begin(FileCluster::TrackSet const& tracks,
+        int16_t first_tc, int16_t last_tc)
+{
+    return Iterator(this, *istream_, blocks_start_pos_, tracks, first_tc,
+            last_tc);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // I/O (Cluster interface)
 ///////////////////////////////////////////////////////////////////////////////
@@ -161,6 +170,8 @@ void FileCluster::push_back(FileCluster::value_type const& value)
         throw NotWriting();
     }
     assert(ostream_ != 0 && "ostream_ was not initialised");
+    boost::posix_time::ptime start(stats_ ? IOStats::now() :
+            boost::posix_time::ptime());
 
     // Preserve the current write position
     //std::streampos cur_pos(ostream_->tellp());
@@ -170,6 +181,13 @@ void FileCluster::push_back(FileCluster::value_type const& value)
     value->write(*ostream_);
     // Update the cluster's current write position
     blocks_end_pos_ = ostream_->tellp();
+    // Record the block in the summary
+    summary_.add(*value);
+    if (stats_)
+    {
+        stats_->block_written(*value);
+        stats_->write_latency.record(start);
+    }
     // Return to the original write position
     //ostream_->seekp(cur_pos);
     // TODO: update the block size continuously so that it can be written
@@ -180,6 +198,32 @@ void FileCluster::push_back(FileCluster::value_type const& value)
 }
 
 
+void FileCluster::push_back_copy(std::istream& input,
+        BlockHeader const& header, uint64_t track_number, int16_t timecode)
+{
+    // TODO: Make this a compile-time error somehow (type traits?)
+    if (!writing_)
+    {
+        throw NotWriting();
+    }
+    assert(ostream_ != 0 && "ostream_ was not initialised");
+
+    // Jump to the cluster's current write position
+    ostream_->seekp(blocks_end_pos_);
+    // Copy the block
+    copy_block(input, header, *ostream_, track_number, timecode);
+    // Update the cluster's current write position
+    blocks_end_pos_ = ostream_->tellp();
+    // Record the block in the summary
+    summary_.add(track_number, timecode);
+    if (stats_)
+    {
+        // The frames of a copied block are not parsed
+        ++stats_->blocks_written;
+    }
+}
+
+
 std::streamsize FileCluster::finalise(std::ostream& output)
 {
     // TODO: Make this a compile-time error somehow (type traits?)
@@ -187,10 +231,16 @@ std::streamsize FileCluster::finalise(std::ostream& output)
     {
         throw NotWriting();
     }
+    boost::posix_time::ptime start(stats_ ? IOStats::now() :
+            boost::posix_time::ptime());
+    TAWARA_TRACE(CLUSTER_FINALISE_BEGIN, id_, offset_, 0);
 
     // Preserve the current write position
     std::streampos cur_pos(output.tellp());
 
+    write_summary(output);
+    write_cluster_crc(output, blocks_end_pos_);
+
     // Go back and write the cluster's actual size in the element header
     // actual size = current write position (i.e. end of the
     // cluster) - cluster's start position - ID - 8-byte size.
@@ -203,6 +253,13 @@ std::streamsize FileCluster::finalise(std::ostream& output)
     output.seekp(cur_pos);
 
     writing_ = false;
+    if (stats_)
+    {
+        ++stats_->clusters_written;
+        stats_->finalised(start);
+    }
+    TAWARA_TRACE(CLUSTER_FINALISE_END, id_, offset_,
+            ids::size(id_) + 8 + size);
     return ids::size(id_) + 8 + size;
 }
 
@@ -219,6 +276,7 @@ std::streamsize FileCluster::write(std::ostream& output)
     assert(!writing_ && "Already writing");
     // Store a pointer to the stream for push_back() to use.
     ostream_ = &output;
+    summary_.clear();
     std::streamsize result = Element::write(output);
     // Make a note of where to write the first block.
     blocks_start_pos_ = blocks_end_pos_ = output.tellp();
@@ -0,0 +1,395 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/fsck.h>
+
+#include "cluster_scan.h"
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <fstream>
+#include <map>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/metaseek.h>
+#include <tawara/segment.h>
+#include <tawara/segment_info.h>
+#include <tawara/track_table.h>
+#include <tawara/tracks.h>
+#include <tawara/vint.h>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// Creates a problem from an exception, named after the exception's type. The
+// position recorded in the exception is used if it has one.
+static FsckProblem fsck_problem(std::exception const& e,
+        std::streamsize pos, std::string const& check)
+{
+    std::string name(exception_name(e));
+    boost::exception const* be(dynamic_cast<boost::exception const*>(&e));
+    if (be)
+    {
+        std::streamsize const* e_pos(boost::get_error_info<err_pos>(*be));
+        if (e_pos && *e_pos >= 0)
+        {
+            pos = *e_pos;
+        }
+    }
+    return FsckProblem(pos, check, name);
+}
+
+
+// Orders problems by their position in the file.
+static bool fsck_problem_before(FsckProblem const& lhs,
+        FsckProblem const& rhs)
+{
+    return lhs.pos < rhs.pos;
+}
+
+
+// Reads and verifies a level 1 element, recording any problem.
+template <typename ElementType>
+bool fsck_element(std::istream& stream, std::streamsize start,
+        ElementType& element, std::string const& check, FsckReport& report)
+{
+    try
+    {
+        stream.seekg(start + ids::size(element.id()));
+        element.verify_crc(true);
+        element.read(stream);
+        if (element.crc())
+        {
+            ++report.crcs;
+        }
+        return true;
+    }
+    catch (std::exception& e)
+    {
+        report.problems.push_back(fsck_problem(e, start, check));
+        stream.clear();
+        return false;
+    }
+}
+
+
+// The result of checking a single cluster.
+struct FsckCluster
+{
+    FsckCluster()
+        : start(0), read(false), timecode(0), blocks(0), frames(0),
+        crc(false)
+    {
+    }
+
+    std::streamsize start;
+    bool read;
+    uint64_t timecode;
+    uint64_t blocks;
+    uint64_t frames;
+    bool crc;
+    std::vector<FsckProblem> problems;
+}; // struct FsckCluster
+
+
+// Checks a cluster and all its blocks.
+static void fsck_cluster(std::istream& stream, TrackTable const* tracks,
+        DictionaryMapPtr dictionaries, FsckCluster& result)
+{
+    try
+    {
+        stream.seekg(result.start + ids::size(ids::Cluster));
+        FileCluster cluster;
+        cluster.verify_crc(true);
+        cluster.dictionaries(dictionaries);
+        cluster.read(stream);
+        result.read = true;
+        result.timecode = cluster.timecode();
+        result.crc = cluster.crc();
+
+        for (FileCluster::Iterator block(cluster.begin());
+                block != cluster.end(); ++block)
+        {
+            ++result.blocks;
+            result.frames += block->count();
+            if (tracks && !tracks->find(block->track_number()))
+            {
+                result.problems.push_back(FsckProblem(block->offset(),
+                            "block", "UnknownTrack"));
+            }
+        }
+    }
+    catch (std::exception& e)
+    {
+        result.problems.push_back(fsck_problem(e, result.start,
+                    result.read ? "block" : "cluster"));
+        stream.clear();
+    }
+}
+
+
+// Checks each cluster given to it by the scanning threads.
+struct FsckScan
+{
+    FsckScan(TrackTable const* tracks, DictionaryMapPtr dictionaries)
+        : tracks(tracks), dictionaries(dictionaries)
+    {
+    }
+
+    void operator()(std::istream& stream, FsckCluster& result) const
+    {
+        fsck_cluster(stream, tracks, dictionaries, result);
+    }
+
+    TrackTable const* tracks;
+    DictionaryMapPtr dictionaries;
+}; // struct FsckScan
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Interface
+///////////////////////////////////////////////////////////////////////////////
+
+FsckReport tawara::fsck(std::string const& path, unsigned int threads)
+{
+    FsckReport report;
+    std::ifstream stream(path.c_str(), std::ios::in | std::ios::binary);
+    if (!stream)
+    {
+        throw ReadError() << err_pos(0);
+    }
+    stream.seekg(0, std::ios::end);
+    std::streamsize file_end(stream.tellg());
+    stream.seekg(0);
+
+    Segment segment;
+    std::streamsize body_start(0), seg_end(0);
+    try
+    {
+        read_tawara_header(stream);
+        ids::ReadResult id_res = ids::read(stream);
+        if (id_res.first != ids::Segment)
+        {
+            throw InvalidChildID() << err_id(id_res.first) <<
+                // The cast here makes Apple's LLVM compiler happy
+                err_pos(static_cast<std::streamsize>(stream.tellg()) -
+                        id_res.second);
+        }
+        segment.read(stream);
+        stream.seekg(segment.offset());
+        ids::read(stream);
+        vint::ReadResult seg_size = vint::read(stream);
+        body_start = stream.tellg();
+        seg_end = body_start + seg_size.first;
+    }
+    catch (std::exception& e)
+    {
+        report.problems.push_back(fsck_problem(e, 0, "header"));
+        return report;
+    }
+    if (seg_end > file_end)
+    {
+        report.problems.push_back(FsckProblem(segment.offset(), "structure",
+                    "TruncatedSegment"));
+        seg_end = file_end;
+    }
+
+    // Find the level 1 elements by skipping over their bodies
+    std::map<std::streamsize, ids::ID> children;
+    stream.seekg(body_start);
+    std::streamsize start(body_start);
+    try
+    {
+        while (start < seg_end)
+        {
+            ids::ReadResult id_res = ids::read(stream);
+            vint::ReadResult size_res = vint::read(stream);
+            std::streamsize end(start + id_res.second + size_res.second +
+                    size_res.first);
+            if (end > seg_end)
+            {
+                report.problems.push_back(FsckProblem(start, "structure",
+                            "BadElementLength"));
+                break;
+            }
+            children[start] = id_res.first;
+            stream.seekg(end);
+            start = end;
+        }
+    }
+    catch (std::exception& e)
+    {
+        report.problems.push_back(fsck_problem(e, start, "structure"));
+        stream.clear();
+    }
+
+    // Check the meta-data elements and gather the clusters
+    TrackTable tracks;
+    bool have_tracks(false);
+    boost::shared_ptr<DictionaryMap> dictionaries(new DictionaryMap);
+    Cues cues;
+    std::vector<FsckCluster> clusters;
+    typedef std::map<std::streamsize, ids::ID>::value_type Child;
+    BOOST_FOREACH(Child const& child, children)
+    {
+        switch (child.second)
+        {
+            case ids::SeekHead:
+                {
+                    SeekHead seekhead;
+                    fsck_element(stream, child.first, seekhead, "seekhead",
+                            report);
+                }
+                break;
+            case ids::Info:
+                {
+                    SegmentInfo info;
+                    fsck_element(stream, child.first, info, "info", report);
+                }
+                break;
+            case ids::Tracks:
+                {
+                    Tracks t;
+                    if (fsck_element(stream, child.first, t, "tracks",
+                                report))
+                    {
+                        have_tracks = true;
+                        tracks = TrackTable(t);
+                        DictionaryMapPtr d(t.dictionaries());
+                        dictionaries->insert(d->begin(), d->end());
+                    }
+                }
+                break;
+            case ids::Cues:
+                {
+                    Cues c;
+                    if (fsck_element(stream, child.first, c, "cues", report))
+                    {
+                        cues.insert(c.begin(), c.end());
+                    }
+                }
+                break;
+            case ids::Cluster:
+                clusters.push_back(FsckCluster());
+                clusters.back().start = child.first;
+                break;
+        }
+    }
+
+    // Every SeekHead entry must point at an element of the right type
+    BOOST_FOREACH(SeekHead::value_type const& entry, segment.index)
+    {
+        std::streamsize pos(segment.to_stream_offset(entry.second));
+        std::map<std::streamsize, ids::ID>::const_iterator target(
+                children.find(pos));
+        if (target == children.end() || target->second != entry.first)
+        {
+            report.problems.push_back(FsckProblem(pos, "seekhead",
+                        "BadSeekTarget"));
+        }
+    }
+
+    // Check the clusters in parallel
+    scan_clusters(path, clusters, FsckScan(have_tracks ? &tracks : 0,
+                dictionaries), threads);
+
+    uint64_t prev_timecode(0);
+    std::map<std::streamsize, FsckCluster const*> by_start;
+    BOOST_FOREACH(FsckCluster const& cluster, clusters)
+    {
+        by_start[cluster.start] = &cluster;
+        report.problems.insert(report.problems.end(),
+                cluster.problems.begin(), cluster.problems.end());
+        if (!cluster.read)
+        {
+            continue;
+        }
+        ++report.clusters;
+        report.blocks += cluster.blocks;
+        report.frames += cluster.frames;
+        if (cluster.crc)
+        {
+            ++report.crcs;
+        }
+        if (cluster.timecode < prev_timecode)
+        {
+            report.problems.push_back(FsckProblem(cluster.start, "timecode",
+                        "TimecodeDecreased"));
+        }
+        prev_timecode = cluster.timecode;
+    }
+
+    // Every cue must point at a cluster, track and block that exist
+    BOOST_FOREACH(Cues::value_type const& point, cues)
+    {
+        BOOST_FOREACH(CueTrackPosition const& ctp, point.second)
+        {
+            std::map<std::streamsize, FsckCluster const*>::const_iterator
+                cluster(by_start.find(
+                            segment.to_stream_offset(ctp.cluster_pos())));
+            if (cluster == by_start.end())
+            {
+                report.problems.push_back(FsckProblem(point.second.offset(),
+                            "cues", "BadCuePosition"));
+            }
+            else if (cluster->second->read &&
+                    ctp.block_num() > cluster->second->blocks)
+            {
+                report.problems.push_back(FsckProblem(point.second.offset(),
+                            "cues", "BadCueBlockNumber"));
+            }
+            if (have_tracks && !tracks.find(ctp.track()))
+            {
+                report.problems.push_back(FsckProblem(point.second.offset(),
+                            "cues", "UnknownTrack"));
+            }
+        }
+    }
+
+    std::stable_sort(report.problems.begin(), report.problems.end(),
+            fsck_problem_before);
+    return report;
+}
+
@@ -0,0 +1,360 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/io_stats.h>
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <tawara/block.h>
+#include <tawara/exceptions.h>
+
+#if defined(_WIN32)
+    #include <io.h>
+#else
+    #include <unistd.h>
+#endif
+
+using namespace tawara;
+
+namespace bpt = boost::posix_time;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// IOStats
+///////////////////////////////////////////////////////////////////////////////
+
+IOStats::IOStats()
+{
+    reset();
+}
+
+
+void IOStats::reset()
+{
+    bytes_read = 0;
+    bytes_written = 0;
+    read_calls = 0;
+    write_calls = 0;
+    seeks = 0;
+    clusters_read = 0;
+    clusters_written = 0;
+    blocks_read = 0;
+    block_headers_read = 0;
+    blocks_written = 0;
+    frames_read = 0;
+    frames_written = 0;
+    frame_allocs = 0;
+    finalise_calls = 0;
+    finalise_us = 0;
+    sync_calls = 0;
+    write_latency.reset();
+    finalise_latency.reset();
+    sync_latency.reset();
+}
+
+
+IOStats& IOStats::operator+=(IOStats const& rhs)
+{
+    bytes_read += rhs.bytes_read;
+    bytes_written += rhs.bytes_written;
+    read_calls += rhs.read_calls;
+    write_calls += rhs.write_calls;
+    seeks += rhs.seeks;
+    clusters_read += rhs.clusters_read;
+    clusters_written += rhs.clusters_written;
+    blocks_read += rhs.blocks_read;
+    block_headers_read += rhs.block_headers_read;
+    blocks_written += rhs.blocks_written;
+    frames_read += rhs.frames_read;
+    frames_written += rhs.frames_written;
+    frame_allocs += rhs.frame_allocs;
+    finalise_calls += rhs.finalise_calls;
+    finalise_us += rhs.finalise_us;
+    sync_calls += rhs.sync_calls;
+    write_latency += rhs.write_latency;
+    finalise_latency += rhs.finalise_latency;
+    sync_latency += rhs.sync_latency;
+    return *this;
+}
+
+
+void IOStats::block_read(Block const& block)
+{
+    ++blocks_read;
+    frames_read += block.count();
+    frame_allocs += block.frame_allocs();
+}
+
+
+void IOStats::block_written(Block const& block)
+{
+    ++blocks_written;
+    frames_written += block.count();
+}
+
+
+bpt::ptime IOStats::now()
+{
+    return bpt::microsec_clock::universal_time();
+}
+
+
+void IOStats::finalised(bpt::ptime start)
+{
+    uint64_t elapsed((now() - start).total_microseconds());
+    ++finalise_calls;
+    finalise_us += elapsed;
+    finalise_latency.record(elapsed);
+}
+
+
+void IOStats::synced(bpt::ptime start)
+{
+    ++sync_calls;
+    sync_latency.record(start);
+}
+
+
+std::ostream& tawara::operator<<(std::ostream& output, IOStats const& stats)
+{
+    output << "Bytes read: " << stats.bytes_read << '\n' <<
+        "Bytes written: " << stats.bytes_written << '\n' <<
+        "Read calls: " << stats.read_calls << '\n' <<
+        "Write calls: " << stats.write_calls << '\n' <<
+        "Seeks: " << stats.seeks << '\n' <<
+        "Clusters read: " << stats.clusters_read << '\n' <<
+        "Clusters written: " << stats.clusters_written << '\n' <<
+        "Blocks read: " << stats.blocks_read << '\n' <<
+        "Block headers read: " << stats.block_headers_read << '\n' <<
+        "Blocks written: " << stats.blocks_written << '\n' <<
+        "Frames read: " << stats.frames_read << '\n' <<
+        "Frames written: " << stats.frames_written << '\n' <<
+        "Frame allocations: " << stats.frame_allocs << '\n' <<
+        "Finalise calls: " << stats.finalise_calls << '\n' <<
+        "Finalise time (us): " << stats.finalise_us << '\n' <<
+        "Syncs: " << stats.sync_calls << '\n';
+    if (stats.write_latency.count() != 0)
+    {
+        output << "Write latency (us): " << stats.write_latency << '\n';
+    }
+    if (stats.finalise_latency.count() != 0)
+    {
+        output << "Finalise latency (us): " << stats.finalise_latency <<
+            '\n';
+    }
+    if (stats.sync_latency.count() != 0)
+    {
+        output << "Sync latency (us): " << stats.sync_latency << '\n';
+    }
+    return output;
+}
+
+
+void tawara::sync(std::ostream& output, int fd, IOStats::Ptr stats)
+{
+    bpt::ptime start(stats ? IOStats::now() : bpt::ptime());
+    output.flush();
+    if (!output)
+    {
+        throw WriteError() << err_pos(output.tellp());
+    }
+    if (fd >= 0)
+    {
+#if defined(_WIN32)
+        int result(_commit(fd));
+#else
+        int result(fsync(fd));
+#endif
+        if (result != 0)
+        {
+            throw WriteError() << err_pos(output.tellp());
+        }
+    }
+    if (stats)
+    {
+        stats->synced(start);
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// StatsDumper
+///////////////////////////////////////////////////////////////////////////////
+
+StatsDumper::StatsDumper(IOStats::Ptr stats, std::ostream& output,
+        bpt::time_duration interval, bool reset)
+    : stats_(stats), output_(output), interval_(interval), reset_(reset),
+    last_(IOStats::now()), dumps_(0)
+{
+}
+
+
+bool StatsDumper::poll()
+{
+    if (IOStats::now() - last_ < interval_)
+    {
+        return false;
+    }
+    dump();
+    return true;
+}
+
+
+void StatsDumper::dump()
+{
+    last_ = IOStats::now();
+    output_ << "Statistics at " << last_ << ":\n" << *stats_;
+    output_.flush();
+    ++dumps_;
+    if (reset_)
+    {
+        stats_->reset();
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// CountingStreamBuf
+///////////////////////////////////////////////////////////////////////////////
+
+CountingStreamBuf::CountingStreamBuf(std::streambuf* buffer,
+        IOStats::Ptr stats)
+    : buffer_(buffer), stats_(stats)
+{
+}
+
+
+CountingStreamBuf::int_type CountingStreamBuf::underflow()
+{
+    // Only looks at the next character, so nothing is counted
+    return buffer_->sgetc();
+}
+
+
+CountingStreamBuf::int_type CountingStreamBuf::uflow()
+{
+    int_type c(buffer_->sbumpc());
+    ++stats_->read_calls;
+    if (!traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        ++stats_->bytes_read;
+    }
+    return c;
+}
+
+
+std::streamsize CountingStreamBuf::xsgetn(char_type* s, std::streamsize n)
+{
+    std::streamsize result(buffer_->sgetn(s, n));
+    ++stats_->read_calls;
+    stats_->bytes_read += result;
+    return result;
+}
+
+
+CountingStreamBuf::int_type CountingStreamBuf::pbackfail(int_type c)
+{
+    int_type result(traits_type::eq_int_type(c, traits_type::eof()) ?
+            buffer_->sungetc() :
+            buffer_->sputbackc(traits_type::to_char_type(c)));
+    if (!traits_type::eq_int_type(result, traits_type::eof()) &&
+            stats_->bytes_read > 0)
+    {
+        // The character will be counted again when it is re-read
+        --stats_->bytes_read;
+    }
+    return result;
+}
+
+
+std::streamsize CountingStreamBuf::showmanyc()
+{
+    return buffer_->in_avail();
+}
+
+
+CountingStreamBuf::int_type CountingStreamBuf::overflow(int_type c)
+{
+    if (traits_type::eq_int_type(c, traits_type::eof()))
+    {
+        return traits_type::not_eof(c);
+    }
+    ++stats_->write_calls;
+    int_type result(buffer_->sputc(traits_type::to_char_type(c)));
+    if (!traits_type::eq_int_type(result, traits_type::eof()))
+    {
+        ++stats_->bytes_written;
+    }
+    return result;
+}
+
+
+std::streamsize CountingStreamBuf::xsputn(char_type const* s,
+        std::streamsize n)
+{
+    std::streamsize result(buffer_->sputn(s, n));
+    ++stats_->write_calls;
+    stats_->bytes_written += result;
+    return result;
+}
+
+
+CountingStreamBuf::pos_type CountingStreamBuf::seekoff(off_type off,
+        std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+    // A zero offset from the current position only gets the position
+    if (off != 0 || dir != std::ios_base::cur)
+    {
+        ++stats_->seeks;
+    }
+    return buffer_->pubseekoff(off, dir, which);
+}
+
+
+CountingStreamBuf::pos_type CountingStreamBuf::seekpos(pos_type pos,
+        std::ios_base::openmode which)
+{
+    ++stats_->seeks;
+    return buffer_->pubseekpos(pos, which);
+}
+
+
+int CountingStreamBuf::sync()
+{
+    return buffer_->pubsync();
+}
@@ -0,0 +1,174 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/lace_packer.h>
+
+#include <tawara/exceptions.h>
+#include <tawara/simple_block.h>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+LacePacker::LacePacker(TrackEntry const& track, uint64_t timecode_scale,
+        unsigned int max_frames, std::size_t max_bytes, int16_t max_latency)
+    : track_number_(track.number()),
+    default_duration_(track.default_duration()),
+    timecode_scale_(timecode_scale), compression_(track.compression()),
+    max_frames_(max_frames), max_bytes_(max_bytes),
+    max_latency_(max_latency), bytes_(0), first_timecode_(0)
+{
+    if (timecode_scale_ == 0 || max_frames_ == 0 || max_frames_ > 255)
+    {
+        throw ValueOutOfRange();
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Packing
+///////////////////////////////////////////////////////////////////////////////
+
+BlockElement::Ptr LacePacker::add(Block::value_type const& frame,
+        int16_t timecode)
+{
+    if (!frame || frame->empty())
+    {
+        throw EmptyFrame();
+    }
+
+    BlockElement::Ptr result;
+    if (!frames_.empty() && (frames_.size() >= max_frames_ ||
+            bytes_ + frame->size() > max_bytes_ ||
+            default_duration_ == 0 ||
+            timecode != expected_timecode(frames_.size()) ||
+            timecode - first_timecode_ > max_latency_))
+    {
+        result = flush();
+    }
+    if (frames_.empty())
+    {
+        first_timecode_ = timecode;
+    }
+    frames_.push_back(frame);
+    bytes_ += frame->size();
+    return result;
+}
+
+
+BlockElement::Ptr LacePacker::expire(int16_t timecode)
+{
+    // A full block cannot take any more frames, so there is no reason to
+    // hold on to it
+    if (!frames_.empty() && (timecode - first_timecode_ > max_latency_ ||
+                frames_.size() >= max_frames_ || bytes_ >= max_bytes_))
+    {
+        return flush();
+    }
+    return BlockElement::Ptr();
+}
+
+
+BlockElement::Ptr LacePacker::flush()
+{
+    if (frames_.empty())
+    {
+        return BlockElement::Ptr();
+    }
+
+    Block::LacingType lacing(Block::LACING_NONE);
+    if (frames_.size() > 1)
+    {
+        lacing = Block::LACING_FIXED;
+        for (std::size_t ii(1); ii < frames_.size(); ++ii)
+        {
+            if (frames_[ii]->size() != frames_[0]->size())
+            {
+                lacing = Block::LACING_EBML;
+                break;
+            }
+        }
+    }
+    BlockElement::Ptr result(new SimpleBlock(track_number_, first_timecode_,
+                lacing));
+    for (std::size_t ii(0); ii < frames_.size(); ++ii)
+    {
+        result->push_back(frames_[ii]);
+    }
+    result->compression(compression_);
+
+    frames_.clear();
+    bytes_ = 0;
+    return result;
+}
+
+
+int64_t LacePacker::expected_timecode(std::size_t index) const
+{
+    // Rounded to the nearest timecode unit
+    return first_timecode_ + static_cast<int64_t>(
+            (index * default_duration_ + timecode_scale_ / 2) /
+            timecode_scale_);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Unpacking
+///////////////////////////////////////////////////////////////////////////////
+
+std::vector<TimedFrame> tawara::unpack_frames(Block const& block,
+        uint64_t cluster_timecode, uint64_t timecode_scale,
+        uint64_t default_duration)
+{
+    std::vector<TimedFrame> result;
+    result.reserve(block.count());
+    int64_t const start((static_cast<int64_t>(cluster_timecode) +
+                block.timecode()) * static_cast<int64_t>(timecode_scale));
+    for (Block::size_type ii(0); ii < block.count(); ++ii)
+    {
+        TimedFrame frame;
+        frame.time = start + static_cast<int64_t>(ii * default_duration);
+        frame.data = block[ii];
+        result.push_back(frame);
+    }
+    return result;
+}
+
@@ -0,0 +1,218 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/latency_histogram.h>
+
+#include <algorithm>
+#include <cmath>
+
+using namespace tawara;
+
+namespace bpt = boost::posix_time;
+
+
+// Each power of two above 2 * sub_buckets is split into this many buckets
+static unsigned int const sub_bucket_bits(5);
+static uint64_t const sub_buckets(1 << sub_bucket_bits);
+// Latencies are counted up to 2^36 us (about 19 hours)
+static unsigned int const max_bits(36);
+static std::size_t const bucket_count((max_bits - sub_bucket_bits + 1) *
+        sub_buckets);
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+LatencyHistogram::LatencyHistogram()
+    : counts_(bucket_count, 0), count_(0), min_(0), max_(0), total_(0)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Recording
+///////////////////////////////////////////////////////////////////////////////
+
+void LatencyHistogram::record(uint64_t us)
+{
+    if (us > max_value())
+    {
+        us = max_value();
+    }
+    ++counts_[bucket(us)];
+    if (count_ == 0 || us < min_)
+    {
+        min_ = us;
+    }
+    if (us > max_)
+    {
+        max_ = us;
+    }
+    ++count_;
+    total_ += us;
+}
+
+
+void LatencyHistogram::record(bpt::ptime start)
+{
+    bpt::time_duration elapsed(bpt::microsec_clock::universal_time() - start);
+    record(elapsed.is_negative() ? 0 : elapsed.total_microseconds());
+}
+
+
+void LatencyHistogram::reset()
+{
+    std::fill(counts_.begin(), counts_.end(), 0);
+    count_ = 0;
+    min_ = 0;
+    max_ = 0;
+    total_ = 0;
+}
+
+
+LatencyHistogram& LatencyHistogram::operator+=(LatencyHistogram const& rhs)
+{
+    if (rhs.count_ == 0)
+    {
+        return *this;
+    }
+    for (std::size_t ii(0); ii < counts_.size(); ++ii)
+    {
+        counts_[ii] += rhs.counts_[ii];
+    }
+    if (count_ == 0 || rhs.min_ < min_)
+    {
+        min_ = rhs.min_;
+    }
+    max_ = std::max(max_, rhs.max_);
+    count_ += rhs.count_;
+    total_ += rhs.total_;
+    return *this;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Queries
+///////////////////////////////////////////////////////////////////////////////
+
+double LatencyHistogram::mean() const
+{
+    if (count_ == 0)
+    {
+        return 0;
+    }
+    return static_cast<double>(total_) / count_;
+}
+
+
+uint64_t LatencyHistogram::percentile(double percent) const
+{
+    if (count_ == 0)
+    {
+        return 0;
+    }
+    percent = std::min(std::max(percent, 0.0), 100.0);
+    // The small offset stops rounding errors in percentages such as 99.9
+    // pushing the target into the next bucket
+    uint64_t target(static_cast<uint64_t>(std::ceil(percent * count_ /
+                    100.0 - 1e-9)));
+    if (target == 0)
+    {
+        target = 1;
+    }
+    uint64_t seen(0);
+    for (std::size_t ii(0); ii < counts_.size(); ++ii)
+    {
+        seen += counts_[ii];
+        if (seen >= target)
+        {
+            return std::min(bucket_max(ii), max_);
+        }
+    }
+    return max_;
+}
+
+
+uint64_t LatencyHistogram::max_value()
+{
+    return (static_cast<uint64_t>(1) << max_bits) - 1;
+}
+
+
+std::size_t LatencyHistogram::bucket(uint64_t us)
+{
+    if (us < 2 * sub_buckets)
+    {
+        return us;
+    }
+    // Find the most significant bit
+    unsigned int msb(0);
+    for (uint64_t v(us); v > 1; v >>= 1)
+    {
+        ++msb;
+    }
+    unsigned int shift(msb - sub_bucket_bits);
+    return (shift + 1) * sub_buckets + ((us >> shift) - sub_buckets);
+}
+
+
+uint64_t LatencyHistogram::bucket_max(std::size_t index)
+{
+    if (index < 2 * sub_buckets)
+    {
+        return index;
+    }
+    unsigned int shift(index / sub_buckets - 1);
+    uint64_t mantissa(index % sub_buckets + sub_buckets);
+    return ((mantissa + 1) << shift) - 1;
+}
+
+
+std::ostream& tawara::operator<<(std::ostream& output,
+        LatencyHistogram const& histogram)
+{
+    return output << "count=" << histogram.count() <<
+        " min=" << histogram.min() <<
+        " p50=" << histogram.percentile(50) <<
+        " p90=" << histogram.percentile(90) <<
+        " p99=" << histogram.percentile(99) <<
+        " p99.9=" << histogram.percentile(99.9) <<
+        " max=" << histogram.max();
+}
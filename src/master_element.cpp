@@ -38,7 +38,12 @@
 
 #include <tawara/master_element.h>
 
+#include <sstream>
+#include <tawara/crc32.h>
+#include <tawara/el_ids.h>
 #include <tawara/exceptions.h>
+#include <tawara/trace.h>
+#include <tawara/vint.h>
 
 using namespace tawara;
 
@@ -47,7 +52,134 @@ using namespace tawara;
 ///////////////////////////////////////////////////////////////////////////////
 
 MasterElement::MasterElement(uint32_t id, bool crc)
-    : Element(id), crc_(crc)
+    : Element(id), crc_(crc), verify_crc_(false)
 {
 }
 
+
+std::streamsize const MasterElement::crc_size_;
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Accessors
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize MasterElement::size() const
+{
+    if (!crc_)
+    {
+        return Element::size();
+    }
+    std::streamsize body(body_size() + crc_size_);
+    return ids::size(id_) + vint::size(body) + body;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// I/O
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize MasterElement::write(std::ostream& output)
+{
+    if (!crc_)
+    {
+        return Element::write(output);
+    }
+
+    // Fill in the offset of this element in the byte stream.
+    offset_ = output.tellp();
+    TAWARA_TRACE(ELEMENT_WRITE_BEGIN, id_, offset_, 0);
+
+    std::ostringstream body(std::ios::out | std::ios::binary);
+    write_body(body);
+    std::string data(body.str());
+    std::streamsize written(write_id(output));
+    written += vint::write(data.size() + crc_size_, output);
+    written += write_crc(crc32(data.data(), data.size()), output);
+    output.write(data.data(), data.size());
+    if (!output)
+    {
+        throw WriteError() << err_pos(offset_);
+    }
+    written += data.size();
+    TAWARA_TRACE(ELEMENT_WRITE_END, id_, offset_, written);
+    return written;
+}
+
+
+std::streamsize MasterElement::read(std::istream& input)
+{
+    // The cast here makes Apple's LLVM compiler happy
+    offset_ = static_cast<std::streamsize>(input.tellg()) -
+        ids::size(id_);
+    vint::ReadResult result = vint::read(input);
+    std::streamsize body_size(result.first);
+    std::streamsize read_bytes(result.second);
+    TAWARA_TRACE(ELEMENT_READ_BEGIN, id_, offset_, body_size);
+
+    // Check for a CRC-32 element as the first child
+    crc_ = false;
+    if (body_size >= crc_size_)
+    {
+        std::streampos start(input.tellg());
+        if (ids::read(input).first == ids::CRC32)
+        {
+            if (vint::read(input).first != 4)
+            {
+                throw BadElementLength() << err_id(ids::CRC32) <<
+                    err_pos(start);
+            }
+            unsigned char value[4];
+            input.read(reinterpret_cast<char*>(value), 4);
+            if (!input)
+            {
+                throw ReadError() << err_pos(input.tellg());
+            }
+            crc_ = true;
+            body_size -= crc_size_;
+            read_bytes += crc_size_;
+            if (verify_crc_)
+            {
+                std::streampos body_start(input.tellg());
+                uint32_t expected(static_cast<uint32_t>(value[0]) |
+                        (static_cast<uint32_t>(value[1]) << 8) |
+                        (static_cast<uint32_t>(value[2]) << 16) |
+                        (static_cast<uint32_t>(value[3]) << 24));
+                if (crc32(input, body_size) != expected)
+                {
+                    throw BadCRC() << err_id(id_) << err_pos(offset_);
+                }
+                input.seekg(body_start);
+            }
+        }
+        else
+        {
+            input.seekg(start);
+        }
+    }
+
+    // The rest of the read is implemented by child classes
+    read_bytes += read_body(input, body_size);
+    TAWARA_TRACE(ELEMENT_READ_END, id_, offset_,
+            ids::size(id_) + read_bytes);
+    return read_bytes;
+}
+
+
+std::streamsize MasterElement::write_crc(uint32_t value, std::ostream& output)
+{
+    std::streamsize written(ids::write(ids::CRC32, output));
+    written += vint::write(4, output);
+    // The CRC is stored little-endian
+    char bytes[4] = {static_cast<char>(value & 0xFF),
+        static_cast<char>((value >> 8) & 0xFF),
+        static_cast<char>((value >> 16) & 0xFF),
+        static_cast<char>((value >> 24) & 0xFF)};
+    output.write(bytes, 4);
+    if (!output)
+    {
+        throw WriteError() << err_pos(output.tellp());
+    }
+    return written + 4;
+}
+
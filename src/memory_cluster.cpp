@@ -43,6 +43,7 @@
 #include <tawara/block_group.h>
 #include <tawara/exceptions.h>
 #include <tawara/simple_block.h>
+#include <tawara/trace.h>
 
 using namespace tawara;
 
@@ -84,6 +85,20 @@ MemoryCluster::ConstIterator MemoryCluster::end() const
 }
 
 
+///////////////////////////////////////////////////////////////////////////////
+// Cluster interface
+///////////////////////////////////////////////////////////////////////////////
+
+void MemoryCluster::push_back(value_type const& value)
+{
+    blocks_.push_back(value);
+    if (stats_)
+    {
+        push_times_.push_back(IOStats::now());
+    }
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // I/O (Cluster interface)
 ///////////////////////////////////////////////////////////////////////////////
@@ -95,16 +110,34 @@ std::streamsize MemoryCluster::finalise(std::ostream& output)
         throw NotWriting();
     }
 
+    boost::posix_time::ptime start(stats_ ? IOStats::now() :
+            boost::posix_time::ptime());
+    TAWARA_TRACE(CLUSTER_FINALISE_BEGIN, id_, offset_, 0);
     std::streamsize written(0);
 
-    // Write the blocks to the file
-    BOOST_FOREACH(BlockElement::Ptr& block, blocks_)
+    // Write the blocks to the file. The push times are only usable if
+    // every block has one.
+    bool timed(stats_ && push_times_.size() == blocks_.size());
+    summary_.clear();
+    for (BlockStore::size_type ii(0); ii < blocks_.size(); ++ii)
     {
-        written += block->write(output);
+        written += blocks_[ii]->write(output);
+        summary_.add(*blocks_[ii]);
+        if (stats_)
+        {
+            stats_->block_written(*blocks_[ii]);
+            if (timed)
+            {
+                stats_->write_latency.record(push_times_[ii]);
+            }
+        }
     }
+    push_times_.clear();
+    write_summary(output);
 
     // Go back and write the cluster's actual size in the element header
     std::streampos cluster_end(output.tellp());
+    write_cluster_crc(output, cluster_end);
     std::streamsize size = cluster_end - offset_ - 8 - ids::size(id_);
     output.seekp(static_cast<std::streamsize>(offset_) +
             ids::size(ids::Cluster));
@@ -113,7 +146,14 @@ std::streamsize MemoryCluster::finalise(std::ostream& output)
     output.seekp(cluster_end);
 
     writing_ = false;
-    return ids::size(id_) + 8 + meta_size() + written;
+    if (stats_)
+    {
+        ++stats_->clusters_written;
+        stats_->finalised(start);
+    }
+    std::streamsize total(ids::size(id_) + 8 + meta_size() + written);
+    TAWARA_TRACE(CLUSTER_FINALISE_END, id_, offset_, total);
+    return total;
 }
 
 
@@ -134,6 +174,7 @@ std::streamsize MemoryCluster::read_blocks(std::istream& input,
 {
     // Clear any existing blocks
     blocks_.clear();
+    push_times_.clear();
 
     std::streamsize read_bytes(0);
     // Read elements until the body is exhausted
@@ -147,14 +188,24 @@ std::streamsize MemoryCluster::read_blocks(std::istream& input,
         if (id == ids::SimpleBlock)
         {
             BlockElement::Ptr new_block(new SimpleBlock(0, 0));
+            new_block->dictionaries(dictionaries_);
             read_bytes += new_block->read(input);
             blocks_.push_back(new_block);
+            if (stats_)
+            {
+                stats_->block_read(*new_block);
+            }
         }
         else if (id == ids::BlockGroup)
         {
             BlockElement::Ptr new_block(new BlockGroup(0, 0));
+            new_block->dictionaries(dictionaries_);
             read_bytes += new_block->read(input);
             blocks_.push_back(new_block);
+            if (stats_)
+            {
+                stats_->block_read(*new_block);
+            }
         }
         else
         {
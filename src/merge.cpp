@@ -0,0 +1,411 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <tawara/merge.h>
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <functional>
+#include <limits>
+#include <queue>
+#include <set>
+#include <sstream>
+#include <tawara/block_header.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/int_element.h>
+#include <tawara/segment.h>
+#include <tawara/tracks.h>
+#include <tawara/uint_element.h>
+#include <tawara/vint.h>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Merge inputs
+///////////////////////////////////////////////////////////////////////////////
+
+namespace
+{
+
+// The state of one input document during a merge.
+struct MergeInput
+{
+    MergeInput(std::istream& stream)
+        : stream(stream), date(0), scale(0), block_pos(0), timestamp(0)
+    {
+    }
+
+    std::istream& stream;
+    Segment segment;
+    Tracks tracks;
+    int64_t date;
+    uint64_t scale;
+    boost::shared_ptr<Segment::FileClusterIterator> cluster;
+    std::streampos block_pos;
+    BlockHeader block;
+    int64_t timestamp;
+};
+
+}; // namespace
+
+typedef boost::shared_ptr<MergeInput> MergeInputPtr;
+
+
+// Checks the EBML header of a document and reads its segment and tracks.
+static void open_input(MergeInput& input)
+{
+    read_tawara_header(input.stream);
+
+    ids::ReadResult id_res = ids::read(input.stream);
+    if (id_res.first != ids::Segment)
+    {
+        throw InvalidChildID() << err_id(id_res.first) <<
+            // The cast here makes Apple's LLVM compiler happy
+            err_pos(static_cast<std::streamsize>(input.stream.tellg()) -
+                    id_res.second);
+    }
+    input.segment.read(input.stream);
+    input.date = input.segment.info.date();
+    input.scale = input.segment.info.timecode_scale();
+
+    SeekHead::iterator tracks_el(
+            input.segment.index.find(ids::Tracks));
+    if (tracks_el == input.segment.index.end())
+    {
+        throw NoTracks();
+    }
+    input.stream.seekg(input.segment.to_stream_offset(tracks_el->second));
+    ids::read(input.stream);
+    input.tracks.read(input.stream);
+}
+
+
+// Moves an input to its next block, reading the block's header. Returns
+// false when there are no more blocks.
+static bool next_block(MergeInput& input)
+{
+    if (!input.cluster)
+    {
+        input.cluster.reset(new Segment::FileClusterIterator(
+                    input.segment.clusters_begin_file(input.stream)));
+        if (*input.cluster == input.segment.clusters_end_file(input.stream))
+        {
+            return false;
+        }
+        input.block_pos = (*input.cluster)->blocks_start_pos();
+    }
+    while (input.block_pos == (*input.cluster)->blocks_end_pos())
+    {
+        ++(*input.cluster);
+        if (*input.cluster == input.segment.clusters_end_file(input.stream))
+        {
+            return false;
+        }
+        input.block_pos = (*input.cluster)->blocks_start_pos();
+    }
+    input.stream.seekg(input.block_pos);
+    input.block = read_block_header(input.stream);
+    input.block_pos = input.stream.tellg();
+    input.timestamp = input.date +
+        (static_cast<int64_t>((*input.cluster)->timecode()) +
+         input.block.timecode) * static_cast<int64_t>(input.scale);
+    return true;
+}
+
+
+// Gets the merged track number of an input's current block.
+static uint64_t merged_track(MergeInput const& input,
+        TrackNumberMap const& tracks)
+{
+    TrackNumberMap::const_iterator track(
+            tracks.find(input.block.track_number));
+    if (track == tracks.end())
+    {
+        throw UnknownTrack() << err_track_num(input.block.track_number) <<
+            err_pos(input.block.offset);
+    }
+    return track->second;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Timecodes
+///////////////////////////////////////////////////////////////////////////////
+
+// Converts an offset in nanoseconds from the merged segment's date into a
+// timecode, rounding down.
+static int64_t merged_timecode(int64_t offset, uint64_t scale)
+{
+    int64_t tc(offset / static_cast<int64_t>(scale));
+    if (offset % static_cast<int64_t>(scale) < 0)
+    {
+        // Round down for timestamps before the segment date
+        --tc;
+    }
+    return tc;
+}
+
+
+// Copies a BlockGroup into a buffer, with its BlockDuration and
+// ReferenceBlock values, which are in the timecode scale of the input,
+// converted to the merged timecode scale. The block itself is copied as it
+// is. The offset is the block's time from the merged segment's date.
+static void rescale_group(MergeInput& input, int64_t offset, uint64_t scale,
+        std::iostream& buffer)
+{
+    std::istream& stream(input.stream);
+    int64_t const in_scale(static_cast<int64_t>(input.scale));
+    int64_t const tc(merged_timecode(offset, scale));
+
+    stream.seekg(input.block.offset);
+    ids::read(stream);
+    vint::ReadResult size_res(vint::read(stream));
+    std::streampos body_end(static_cast<std::streamsize>(stream.tellg()) +
+            size_res.first);
+    std::stringstream body;
+    while (stream.tellg() < body_end)
+    {
+        std::streampos child_start(stream.tellg());
+        ids::ReadResult child_id(ids::read(stream));
+        if (child_id.first == ids::BlockDuration)
+        {
+            UIntElement duration(ids::BlockDuration, 0);
+            duration.read(stream);
+            duration = merged_timecode(offset +
+                    static_cast<int64_t>(duration.value()) * in_scale,
+                    scale) - tc;
+            duration.write(body);
+        }
+        else if (child_id.first == ids::ReferenceBlock)
+        {
+            IntElement ref(ids::ReferenceBlock, 0);
+            ref.read(stream);
+            ref = merged_timecode(offset + ref.value() * in_scale, scale) -
+                tc;
+            ref.write(body);
+        }
+        else
+        {
+            vint::ReadResult child_size(vint::read(stream));
+            stream.seekg(child_start);
+            copy_bytes(stream, ids::size(child_id.first) + child_size.second +
+                    child_size.first, body);
+        }
+    }
+    std::string const& children(body.str());
+    ids::write(ids::BlockGroup, buffer);
+    vint::write(children.size(), buffer);
+    buffer.write(children.data(), children.size());
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Merging
+///////////////////////////////////////////////////////////////////////////////
+
+// Renumbers the tracks of all inputs into a single Tracks element.
+std::vector<TrackNumberMap> merge_tracks(
+        std::vector<MergeInputPtr> const& inputs, Tracks& merged)
+{
+    std::vector<TrackNumberMap> result;
+    std::set<uint64_t> used_uids;
+    uint64_t next_number(1);
+    uint64_t max_uid(0);
+    BOOST_FOREACH(MergeInputPtr const& input, inputs)
+    {
+        BOOST_FOREACH(Tracks::value_type const& track, input->tracks)
+        {
+            max_uid = std::max(max_uid, track.second->uid());
+        }
+    }
+    BOOST_FOREACH(MergeInputPtr const& input, inputs)
+    {
+        TrackNumberMap numbers;
+        BOOST_FOREACH(Tracks::value_type const& track, input->tracks)
+        {
+            TrackEntry::Ptr entry(new TrackEntry(*track.second));
+            entry->number(next_number);
+            if (used_uids.count(entry->uid()) != 0)
+            {
+                // The UID has been taken by a track of an earlier input
+                entry->uid(++max_uid);
+            }
+            used_uids.insert(entry->uid());
+            merged.insert(entry);
+            numbers[track.first] = next_number++;
+        }
+        result.push_back(numbers);
+    }
+    return result;
+}
+
+
+std::vector<TrackNumberMap> tawara::merge(
+        std::vector<std::istream*> const& inputs, std::iostream& output,
+        int64_t cluster_span)
+{
+    std::vector<MergeInputPtr> opened;
+    BOOST_FOREACH(std::istream* stream, inputs)
+    {
+        MergeInputPtr input(new MergeInput(*stream));
+        open_input(*input);
+        opened.push_back(input);
+    }
+
+    // The merged segment uses the finest timecode scale and the earliest
+    // date
+    Segment segment;
+    uint64_t scale(std::numeric_limits<uint64_t>::max());
+    int64_t date(std::numeric_limits<int64_t>::max());
+    BOOST_FOREACH(MergeInputPtr const& input, opened)
+    {
+        scale = std::min(scale, input->scale);
+        date = std::min(date, input->date);
+    }
+    if (!opened.empty())
+    {
+        segment.info.timecode_scale(scale);
+        if (date != 0)
+        {
+            segment.info.date(date);
+        }
+    }
+    Tracks tracks;
+    std::vector<TrackNumberMap> result(merge_tracks(opened, tracks));
+
+    EBMLElement ebml_el;
+    ebml_el.write(output);
+    segment.write(output);
+    segment.index.insert(std::make_pair(ids::Tracks,
+                segment.to_segment_offset(output.tellp())));
+    tracks.write(output);
+
+    // Start each input on its first block, ordering the inputs by the
+    // timestamp of their next block
+    typedef std::pair<int64_t, size_t> QueueEntry;
+    std::priority_queue<QueueEntry, std::vector<QueueEntry>,
+        std::greater<QueueEntry> > queue;
+    for (size_t ii(0); ii < opened.size(); ++ii)
+    {
+        if (next_block(*opened[ii]))
+        {
+            queue.push(std::make_pair(opened[ii]->timestamp, ii));
+        }
+    }
+
+    // Cluster timecodes cannot be negative, so if the earliest block is
+    // before the earliest date, the merged segment's date is moved back to
+    // it
+    if (!queue.empty() && queue.top().first < date)
+    {
+        date = queue.top().first;
+        segment.info.date(date);
+    }
+
+    boost::shared_ptr<FileCluster> cluster;
+    int64_t cluster_tc(0);
+    std::stringstream group_buffer;
+    while (!queue.empty())
+    {
+        size_t index(queue.top().second);
+        queue.pop();
+        MergeInput& input(*opened[index]);
+
+        int64_t offset(input.timestamp - date);
+        int64_t tc(merged_timecode(offset, scale));
+        if (tc < 0)
+        {
+            // The block is before an earlier block of the same input
+            throw ValueOutOfRange() << err_id(ids::Timecode) <<
+                err_pos(input.block.offset);
+        }
+        if (!cluster || tc - cluster_tc > std::numeric_limits<int16_t>::max() ||
+                tc - cluster_tc < std::numeric_limits<int16_t>::min() ||
+                (tc - cluster_tc) * static_cast<int64_t>(scale) >=
+                cluster_span)
+        {
+            if (cluster)
+            {
+                cluster->finalise(output);
+            }
+            cluster_tc = tc;
+            cluster.reset(new FileCluster(cluster_tc));
+            if (segment.index.find(ids::Cluster) == segment.index.end())
+            {
+                segment.index.insert(std::make_pair(ids::Cluster,
+                            segment.to_segment_offset(output.tellp())));
+            }
+            cluster->write(output);
+        }
+
+        if (input.block.id == ids::BlockGroup && input.scale != scale)
+        {
+            // The group's durations and references must be rescaled
+            group_buffer.str(std::string());
+            group_buffer.clear();
+            rescale_group(input, offset, scale, group_buffer);
+            group_buffer.seekg(0);
+            cluster->push_back_copy(group_buffer,
+                    read_block_header(group_buffer),
+                    merged_track(input, result[index]),
+                    static_cast<int16_t>(tc - cluster_tc));
+        }
+        else
+        {
+            cluster->push_back_copy(input.stream, input.block,
+                    merged_track(input, result[index]),
+                    static_cast<int16_t>(tc - cluster_tc));
+        }
+
+        if (next_block(input))
+        {
+            queue.push(std::make_pair(input.timestamp, index));
+        }
+    }
+    if (cluster)
+    {
+        cluster->finalise(output);
+    }
+    segment.finalise(output);
+
+    return result;
+}
+
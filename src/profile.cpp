@@ -0,0 +1,316 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/profile.h>
+
+#include "cluster_scan.h"
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/foreach.hpp>
+#include <cmath>
+#include <fstream>
+#include <tawara/block_header.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/segment_info.h>
+#include <tawara/vint.h>
+
+using namespace tawara;
+
+namespace bpt = boost::posix_time;
+
+///////////////////////////////////////////////////////////////////////////////
+// TrackProfile
+///////////////////////////////////////////////////////////////////////////////
+
+TrackProfile::TrackProfile()
+    : blocks(0), bytes(0), first(0), last(0), gaps(0), min_gap(0),
+    max_gap(0), gap_sum(0), gap_sq_sum(0)
+{
+    std::fill(lacing, lacing + 3, 0);
+}
+
+
+// Counts the gap between two consecutive blocks of a track.
+static void profile_gap(TrackProfile& profile, int64_t gap)
+{
+    if (profile.gaps == 0 || gap < profile.min_gap)
+    {
+        profile.min_gap = gap;
+    }
+    if (profile.gaps == 0 || gap > profile.max_gap)
+    {
+        profile.max_gap = gap;
+    }
+    ++profile.gaps;
+    profile.gap_sum += gap;
+    profile.gap_sq_sum += static_cast<double>(gap) * gap;
+}
+
+
+void TrackProfile::add(int64_t timecode, std::streamsize size,
+        Block::LacingType lacing_type)
+{
+    if (blocks == 0)
+    {
+        first = timecode;
+    }
+    else
+    {
+        profile_gap(*this, timecode - last);
+    }
+    last = timecode;
+    ++blocks;
+    bytes += size;
+    ++lacing[lacing_type];
+}
+
+
+TrackProfile& TrackProfile::operator+=(TrackProfile const& rhs)
+{
+    if (rhs.blocks == 0)
+    {
+        return *this;
+    }
+    if (blocks == 0)
+    {
+        *this = rhs;
+        return *this;
+    }
+    // The gap between the last block of this and the first of rhs
+    profile_gap(*this, rhs.first - last);
+    if (rhs.gaps != 0)
+    {
+        min_gap = std::min(min_gap, rhs.min_gap);
+        max_gap = std::max(max_gap, rhs.max_gap);
+        gaps += rhs.gaps;
+        gap_sum += rhs.gap_sum;
+        gap_sq_sum += rhs.gap_sq_sum;
+    }
+    last = rhs.last;
+    blocks += rhs.blocks;
+    bytes += rhs.bytes;
+    for (int ii(0); ii < 3; ++ii)
+    {
+        lacing[ii] += rhs.lacing[ii];
+    }
+    return *this;
+}
+
+
+double TrackProfile::mean_gap() const
+{
+    return gaps == 0 ? 0 : gap_sum / gaps;
+}
+
+
+double TrackProfile::jitter() const
+{
+    if (gaps == 0)
+    {
+        return 0;
+    }
+    double mean(mean_gap());
+    double variance(gap_sq_sum / gaps - mean * mean);
+    return variance > 0 ? std::sqrt(variance) : 0;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// The result of scanning a single cluster.
+struct ProfileCluster
+{
+    ProfileCluster()
+        : start(0), read(false), size(0), blocks(0)
+    {
+    }
+
+    std::streamsize start;
+    bool read;
+    std::streamsize size;
+    uint64_t blocks;
+    std::map<uint64_t, TrackProfile> tracks;
+    std::string error;
+}; // struct ProfileCluster
+
+
+// Scans the block headers of a cluster.
+static void profile_cluster(std::istream& stream, ProfileCluster& result)
+{
+    try
+    {
+        stream.seekg(result.start + ids::size(ids::Cluster));
+        FileCluster cluster;
+        cluster.read(stream);
+        int64_t timecode(cluster.timecode());
+        std::streamsize pos(cluster.blocks_start_pos());
+        std::streamsize end(cluster.blocks_end_pos());
+        stream.seekg(pos);
+        while (pos < end)
+        {
+            BlockHeader header(read_block_header(stream));
+            result.tracks[header.track_number].add(timecode +
+                    header.timecode, header.size, header.lacing());
+            ++result.blocks;
+            pos = static_cast<std::streamsize>(header.offset) + header.size;
+        }
+        result.size = cluster.size();
+        result.read = true;
+    }
+    catch (std::exception& e)
+    {
+        result.read = false;
+        result.error = exception_name(e);
+        stream.clear();
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Interface
+///////////////////////////////////////////////////////////////////////////////
+
+ProfileReport tawara::profile(std::string const& path, unsigned int threads)
+{
+    bpt::ptime start_time(bpt::microsec_clock::universal_time());
+    ProfileReport report;
+    std::ifstream stream(path.c_str(), std::ios::in | std::ios::binary);
+    if (!stream)
+    {
+        throw ReadError() << err_pos(0);
+    }
+    stream.seekg(0, std::ios::end);
+    std::streamsize file_end(stream.tellg());
+    stream.seekg(0);
+
+    read_tawara_header(stream);
+    ids::ReadResult id_res = ids::read(stream);
+    if (id_res.first != ids::Segment)
+    {
+        throw InvalidChildID() << err_id(id_res.first) <<
+            // The cast here makes Apple's LLVM compiler happy
+            err_pos(static_cast<std::streamsize>(stream.tellg()) -
+                    id_res.second);
+    }
+    vint::ReadResult seg_size = vint::read(stream);
+    std::streamsize body_start(stream.tellg());
+    // An unfinalised segment's size may run past the end of the file
+    std::streamsize seg_end(file_end);
+    if (seg_size.first < static_cast<uint64_t>(file_end - body_start))
+    {
+        seg_end = body_start + seg_size.first;
+    }
+
+    // Find the clusters by skipping over the level 1 elements' bodies
+    SegmentInfo info;
+    std::vector<ProfileCluster> clusters;
+    std::streamsize start(body_start);
+    try
+    {
+        while (start < seg_end)
+        {
+            id_res = ids::read(stream);
+            if (id_res.first == ids::Info)
+            {
+                info.read(stream);
+                start = stream.tellg();
+                continue;
+            }
+            vint::ReadResult size_res = vint::read(stream);
+            if (id_res.first == ids::Cluster)
+            {
+                clusters.push_back(ProfileCluster());
+                clusters.back().start = start;
+            }
+            start += id_res.second + size_res.second + size_res.first;
+            stream.seekg(start);
+        }
+    }
+    catch (std::exception& e)
+    {
+        // Scan the clusters found before the damage
+        report.errors[start] = exception_name(e);
+        stream.clear();
+    }
+    report.timecode_scale = info.timecode_scale();
+
+    // Scan the clusters in parallel
+    report.threads = scan_clusters(path, clusters, profile_cluster,
+            threads);
+
+    // Merge the clusters' statistics in file order
+    BOOST_FOREACH(ProfileCluster const& cluster, clusters)
+    {
+        if (!cluster.read)
+        {
+            ++report.bad_clusters;
+            report.errors[cluster.start] = cluster.error;
+            continue;
+        }
+        ++report.clusters;
+        report.blocks += cluster.blocks;
+        report.bytes += cluster.size;
+        typedef std::map<uint64_t, TrackProfile>::value_type Track;
+        BOOST_FOREACH(Track const& track, cluster.tracks)
+        {
+            report.tracks[track.first] += track.second;
+        }
+        std::size_t bucket(0);
+        while ((static_cast<uint64_t>(2) << bucket) <=
+                static_cast<uint64_t>(cluster.size))
+        {
+            ++bucket;
+        }
+        if (report.cluster_sizes.size() <= bucket)
+        {
+            report.cluster_sizes.resize(bucket + 1, 0);
+        }
+        ++report.cluster_sizes[bucket];
+    }
+
+    report.seconds = (bpt::microsec_clock::universal_time() -
+            start_time).total_microseconds() / 1e6;
+    return report;
+}
@@ -0,0 +1,107 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "seekhead_layout.h"
+
+#include <algorithm>
+#include <tawara/vint.h>
+#include <tawara/void_element.h>
+
+using namespace tawara;
+
+std::vector<SegmentChild> tawara::read_segment_children(
+        std::istream& stream, std::streampos body_start,
+        std::streampos seg_end)
+{
+    std::vector<SegmentChild> children;
+    stream.seekg(body_start);
+    while (stream.tellg() < seg_end)
+    {
+        std::streampos start(stream.tellg());
+        ids::ReadResult id_res = ids::read(stream);
+        vint::ReadResult size_res = vint::read(stream);
+        children.push_back(SegmentChild(id_res.first, start,
+                    id_res.second + size_res.second + size_res.first));
+        stream.seekg(static_cast<std::streamsize>(start) +
+                children.back().size);
+    }
+    return children;
+}
+
+
+bool tawara::fits_in_space(std::streamsize used, std::streamsize space)
+{
+    return used == space || used + 2 <= space;
+}
+
+
+std::streamsize tawara::layout_seekhead(SeekHead const& base,
+        SeekHead& index, ids::ID id, uint64_t pos, bool info_entry,
+        std::streamsize info_size, bool follows, uint64_t el_pos)
+{
+    std::streamsize size(0), prev_size(-1);
+    while (size != prev_size)
+    {
+        prev_size = size;
+        index = base;
+        if (info_entry)
+        {
+            index.insert(std::make_pair(ids::Info, pos + size));
+        }
+        index.insert(std::make_pair(id,
+                    follows ? pos + size + info_size : el_pos));
+        size = index.size();
+    }
+    return size;
+}
+
+
+void tawara::pad_space(std::ostream& stream, std::streampos end, bool fill)
+{
+    std::streamsize remaining(end - stream.tellp());
+    if (remaining > 0)
+    {
+        // A single spare byte only occurs at the end of the stream, so the
+        // Void can grow into it.
+        VoidElement ve(std::max(remaining, static_cast<std::streamsize>(2)),
+                fill);
+        ve.write(stream);
+    }
+}
+
@@ -0,0 +1,123 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#if !defined(TAWARA_SEEKHEAD_LAYOUT_H_)
+#define TAWARA_SEEKHEAD_LAYOUT_H_
+
+#include <iostream>
+#include <tawara/el_ids.h>
+#include <tawara/metaseek.h>
+#include <vector>
+
+// Internal helpers shared by the functions that rewrite the SeekHead of an
+// existing document in place. Not installed.
+
+namespace tawara
+{
+    /// \brief A level 1 element of a segment.
+    struct SegmentChild
+    {
+        SegmentChild(ids::ID id, std::streampos start, std::streamsize size)
+            : id(id), start(start), size(size)
+        {
+        }
+
+        /// The ID of the element.
+        ids::ID id;
+        /// The stream position of the element's ID.
+        std::streampos start;
+        /// The total size of the element, including its ID and size.
+        std::streamsize size;
+    }; // struct SegmentChild
+
+    /** \brief Find the level 1 elements of a segment.
+     *
+     * The elements are found by skipping over their bodies, so only their
+     * IDs and sizes are read.
+     *
+     * \param[in] stream The stream to read from.
+     * \param[in] body_start The stream position of the segment's body.
+     * \param[in] seg_end The stream position of the end of the segment.
+     * \return The level 1 elements, in stream order.
+     */
+    std::vector<SegmentChild> read_segment_children(std::istream& stream,
+            std::streampos body_start, std::streampos seg_end);
+
+    /** \brief Check if an element can be written into a space.
+     *
+     * The element must leave either no space or enough for a Void element.
+     */
+    bool fits_in_space(std::streamsize used, std::streamsize space);
+
+    /** \brief Build a new SeekHead from existing entries.
+     *
+     * An entry for the given element is added to the base entries, along
+     * with an entry for the SegmentInfo if requested. If the SegmentInfo or
+     * the element follow the SeekHead, their positions depend on the size of
+     * the SeekHead, so the layout is repeated until the size settles.
+     *
+     * \param[in] base The existing entries, without the element or the
+     * SegmentInfo.
+     * \param[out] index The new SeekHead.
+     * \param[in] id The ID of the element to index.
+     * \param[in] pos The segment offset the SeekHead will be written at.
+     * \param[in] info_entry Whether the SegmentInfo follows the SeekHead and
+     * needs an entry.
+     * \param[in] info_size The size of the SegmentInfo following the
+     * SeekHead.
+     * \param[in] follows Whether the element follows the SeekHead and the
+     * SegmentInfo.
+     * \param[in] el_pos The segment offset of the element, if it does not
+     * follow the SeekHead.
+     * \return The size of the new SeekHead.
+     */
+    std::streamsize layout_seekhead(SeekHead const& base, SeekHead& index,
+            ids::ID id, uint64_t pos, bool info_entry,
+            std::streamsize info_size, bool follows, uint64_t el_pos);
+
+    /** \brief Fill the space up to a position with a Void element.
+     *
+     * The space runs from the write pointer to the given position. Space
+     * beyond the end of the stream must be filled to be kept.
+     */
+    void pad_space(std::ostream& stream, std::streampos end, bool fill);
+}; // namespace tawara
+
+#endif // TAWARA_SEEKHEAD_LAYOUT_H_
+
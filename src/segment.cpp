@@ -38,9 +38,12 @@
 
 #include <tawara/segment.h>
 
+#include <boost/foreach.hpp>
+#include <tawara/cues.h>
 #include <tawara/el_ids.h>
 #include <tawara/exceptions.h>
 #include <tawara/seek_element.h>
+#include <tawara/tracks.h>
 #include <tawara/vint.h>
 #include <tawara/void_element.h>
 
@@ -52,7 +55,7 @@ using namespace tawara;
 
 Segment::Segment(std::streamsize pad_size)
     : MasterElement(ids::Segment), pad_size_(pad_size), size_(pad_size),
-    writing_(false)
+    writing_(false), read_dictionaries_(false), cues_pos_(0)
 {
 }
 
@@ -117,10 +120,137 @@ Segment::FileBlockIterator Segment::blocks_end_file(std::istream& stream)
 }
 
 
+Segment::FilteredBlockIterator Segment::blocks_begin_file(
+        std::istream& stream, FileCluster::TrackSet const& tracks)
+{
+    return Segment::FilteredBlockIterator(this,
+            Segment::clusters_begin_file(stream), tracks);
+}
+
+
+Segment::FilteredBlockIterator Segment::blocks_end_file(
+        std::istream& stream, FileCluster::TrackSet const& tracks)
+{
+    return Segment::FilteredBlockIterator(this,
+            Segment::clusters_end_file(stream), tracks);
+}
+
+
+Segment::FileClusterIterator Segment::clusters_at_time(std::istream& stream,
+        int64_t time)
+{
+    int64_t tc(to_timecode(time));
+
+    // If there are cues, use the last cue point at or before the time to
+    // skip the clusters before it.
+    bool have_cue(false);
+    uint64_t cue_pos(0);
+    SeekHead::const_iterator cues_el(index.find(ids::Cues));
+    if (cues_el != index.end())
+    {
+        if (!cues_ || cues_pos_ != cues_el->second)
+        {
+            std::streampos cur_read(stream.tellg());
+            stream.seekg(to_stream_offset(cues_el->second));
+            ids::ReadResult id_res(ids::read(stream));
+            if (id_res.first != ids::Cues)
+            {
+                throw InvalidChildID() << err_id(id_res.first) <<
+                    err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(stream.tellg()) -
+                            id_res.second);
+            }
+            boost::shared_ptr<Cues> cues(new Cues);
+            cues->read(stream);
+            stream.seekg(cur_read);
+            cues_ = cues;
+            cues_pos_ = cues_el->second;
+        }
+        // Cue point times are unsigned, so none are before a negative time
+        Cues::const_iterator cue(cues_->begin());
+        if (tc >= 0)
+        {
+            cue = cues_->upper_bound(static_cast<uint64_t>(tc));
+        }
+        if (cue != cues_->begin())
+        {
+            --cue;
+            // Any position in the cue point will do, as the cluster holding
+            // it cannot start later than the cue point's time; the earliest
+            // is used so that no blocks are missed.
+            BOOST_FOREACH(CueTrackPosition const& ctp, cue->second)
+            {
+                if (!have_cue || ctp.cluster_pos() < cue_pos)
+                {
+                    cue_pos = ctp.cluster_pos();
+                }
+                have_cue = true;
+            }
+        }
+    }
+
+    FileClusterIterator cluster(have_cue ?
+            FileClusterIterator(this, stream, to_stream_offset(cue_pos)) :
+            clusters_begin_file(stream));
+    if (!cluster.cluster_)
+    {
+        // No clusters
+        return cluster;
+    }
+    // Move forward to the last cluster starting at or before the time. Only
+    // the cluster headers are read while doing so.
+    std::streampos start_pos(cluster->offset());
+    while (cluster.cluster_ && static_cast<int64_t>(cluster->timecode()) <= tc)
+    {
+        start_pos = cluster->offset();
+        ++cluster;
+    }
+    return FileClusterIterator(this, stream, start_pos);
+}
+
+
+Segment::FilteredBlockIterator Segment::blocks_in_range(std::istream& stream,
+        int64_t t_begin, int64_t t_end, FileCluster::TrackSet const& tracks)
+{
+    return FilteredBlockIterator(this, clusters_at_time(stream, t_begin),
+            tracks, t_begin, t_end);
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Miscellaneous member functions
 ///////////////////////////////////////////////////////////////////////////////
 
+DictionaryMapPtr Segment::cluster_dictionaries(std::istream& stream) const
+{
+    if (!dictionaries_ && !read_dictionaries_)
+    {
+        read_dictionaries_ = true;
+        SeekHead::const_iterator tracks_el(index.find(ids::Tracks));
+        if (tracks_el != index.end())
+        {
+            std::streampos cur_read(stream.tellg());
+            stream.seekg(to_stream_offset(tracks_el->second));
+            ids::ReadResult id_res(ids::read(stream));
+            if (id_res.first != ids::Tracks)
+            {
+                throw NoTracks() << err_pos(tracks_el->second);
+            }
+            Tracks tracks;
+            tracks.read(stream);
+            stream.seekg(cur_read);
+            DictionaryMapPtr dictionaries(tracks.dictionaries());
+            if (!dictionaries->empty())
+            {
+                dictionaries_ = dictionaries;
+            }
+        }
+    }
+    return dictionaries_;
+}
+
+
 std::streamsize Segment::to_segment_offset(std::streamsize stream_offset) const
 {
     return stream_offset - offset_ - ids::size(ids::Segment) - 8;
@@ -133,6 +263,19 @@ std::streamsize Segment::to_stream_offset(std::streamsize seg_offset) const
 }
 
 
+int64_t Segment::to_timecode(int64_t time) const
+{
+    int64_t scale(info.timecode_scale());
+    int64_t result(time / scale);
+    if (time % scale > 0)
+    {
+        // Round up; negative values are already rounded up by the division
+        ++result;
+    }
+    return result;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // I/O
 ///////////////////////////////////////////////////////////////////////////////
@@ -150,6 +293,8 @@ std::streamsize Segment::finalise(std::iostream& stream)
     {
         throw NotWriting();
     }
+    boost::posix_time::ptime start(stats_ ? IOStats::now() :
+            boost::posix_time::ptime());
 
     // Store the current end of the file
     std::streamoff end_pos(stream.tellp());
@@ -179,18 +324,15 @@ std::streamsize Segment::finalise(std::iostream& stream)
     // disaster if it's placed immediately afterwards).
     std::streamsize written(0);
     bool wrote_seekhead(false), wrote_seginfo(false);
-    while(written < pad_size && (!wrote_seekhead || !wrote_seginfo))
+    if (index.size() < pad_size - written)
     {
-        if (!wrote_seekhead && index.size() < pad_size - written)
-        {
-            written += index.write(stream);
-            wrote_seekhead = true;
-        }
-        else if (!wrote_seginfo && info.size() < pad_size - written)
-        {
-            written += info.write(stream);
-            wrote_seginfo = true;
-        }
+        written += index.write(stream);
+        wrote_seekhead = true;
+    }
+    if (info.size() < pad_size - written)
+    {
+        written += info.write(stream);
+        wrote_seginfo = true;
     }
     // Re-do the padding
     if (pad_size - written != 0)
@@ -224,6 +366,10 @@ std::streamsize Segment::finalise(std::iostream& stream)
     stream.seekg(cur_read);
 
     writing_ = false;
+    if (stats_)
+    {
+        stats_->finalised(start);
+    }
     return size();
 }
 
@@ -246,6 +392,8 @@ std::streamsize Segment::write_body(std::ostream& output)
 std::streamsize Segment::read_body(std::istream& input, std::streamsize size)
 {
     index.clear();
+    cues_.reset();
+    read_dictionaries_ = false;
     // +2 for the size values (which must be at least 1 byte each)
     if (size < ids::size(ids::Tracks) + ids::size(ids::Cluster) + 2)
     {
@@ -312,6 +460,7 @@ std::streamsize Segment::read_body(std::istream& input, std::streamsize size)
                 {
                     throw MultipleSeekHeads() << err_pos(offset_);
                 }
+                have_seekhead = true;
                 // Read the SeekHead element
                 read_bytes += index.read(input);
                 last_read_end = input.tellg();
@@ -390,6 +539,10 @@ std::streamsize Segment::read_body(std::istream& input, std::streamsize size)
         {
             throw NoSegmentInfo() << err_pos(index.find(ids::Info)->second);
         }
+        if (verify_crc_)
+        {
+            info.verify_crc(true);
+        }
         info.read(input);
         if (input.tellg() > last_read_end)
         {
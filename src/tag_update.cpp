@@ -0,0 +1,334 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/tag_update.h>
+
+#include "seekhead_layout.h"
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <limits>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/vint.h>
+#include <tawara/void_element.h>
+#include <vector>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Writing tags
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize tawara::write_tags(std::ostream& output, Segment& segment,
+        Tags& tags, std::streamsize padding)
+{
+    std::streampos start(output.tellp());
+    std::streamsize written(tags.write(output));
+    if (padding > 0)
+    {
+        VoidElement ve(std::max(padding, static_cast<std::streamsize>(2)),
+                true);
+        written += ve.write(output);
+    }
+    segment.index.erase(ids::Tags);
+    segment.index.insert(std::make_pair(ids::Tags,
+                segment.to_segment_offset(start)));
+    return written;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Updating tags
+///////////////////////////////////////////////////////////////////////////////
+
+void tawara::update_tags(std::iostream& stream, Tags& tags,
+        std::streamsize padding)
+{
+    if (tags.empty())
+    {
+        throw NoTags();
+    }
+    if (padding == 1)
+    {
+        padding = 2;
+    }
+
+    read_tawara_header(stream);
+    ids::ReadResult id_res = ids::read(stream);
+    if (id_res.first != ids::Segment)
+    {
+        throw InvalidChildID() << err_id(id_res.first) <<
+            // The cast here makes Apple's LLVM compiler happy
+            err_pos(static_cast<std::streamsize>(stream.tellg()) -
+                    id_res.second);
+    }
+    Segment segment;
+    segment.read(stream);
+
+    stream.seekg(segment.offset());
+    ids::read(stream);
+    std::streampos size_pos(stream.tellg());
+    vint::ReadResult seg_size = vint::read(stream);
+    std::streampos body_start(stream.tellg());
+    std::streampos seg_end(static_cast<std::streamsize>(body_start) +
+            seg_size.first);
+    stream.seekg(0, std::ios::end);
+    bool at_end(stream.tellg() == seg_end);
+
+    std::vector<SegmentChild> children(read_segment_children(stream,
+                body_start, seg_end));
+
+    // The space of the existing tags includes any padding after them
+    std::streamsize tags_size(tags.size());
+    std::vector<SegmentChild>::const_iterator old(children.begin());
+    while (old != children.end() && old->id != ids::Tags)
+    {
+        ++old;
+    }
+    std::streampos old_start(0);
+    std::streamsize old_space(0);
+    if (old != children.end())
+    {
+        old_start = old->start;
+        old_space = old->size;
+        for (std::vector<SegmentChild>::const_iterator child(old + 1);
+                child != children.end() && child->id == ids::Void; ++child)
+        {
+            old_space += child->size;
+        }
+    }
+    bool in_place(old_space > 0 && fits_in_space(tags_size, old_space));
+    SeekHead::const_iterator entry(segment.index.find(ids::Tags));
+    if (in_place && entry != segment.index.end() &&
+            segment.to_stream_offset(entry->second) == old_start)
+    {
+        // The index is already correct, so only the tags change
+        stream.seekp(old_start);
+        tags.write(stream);
+        pad_space(stream,
+                static_cast<std::streamsize>(old_start) + old_space, false);
+        stream.flush();
+        return;
+    }
+
+    // The SeekHead is rewritten in its current space, along with the
+    // SegmentInfo and any padding immediately after it. Without a SeekHead,
+    // the space is at the end of the segment.
+    std::vector<SegmentChild>::const_iterator sh(children.begin());
+    while (sh != children.end() && sh->id != ids::SeekHead)
+    {
+        ++sh;
+    }
+    SeekHead base;
+    base = segment.index;
+    std::streampos region_start(seg_end), region_end(seg_end);
+    std::streampos info_start(0);
+    std::vector<char> info;
+    if (sh != children.end())
+    {
+        stream.seekg(static_cast<std::streamsize>(sh->start) +
+                ids::size(ids::SeekHead));
+        base.read(stream);
+        region_start = sh->start;
+        region_end = static_cast<std::streamsize>(sh->start) + sh->size;
+        for (std::vector<SegmentChild>::const_iterator child(sh + 1);
+                child != children.end() && (child->id == ids::Void ||
+                    (child->id == ids::Info && info.empty())); ++child)
+        {
+            if (child->id == ids::Info)
+            {
+                info_start = child->start;
+                info.resize(child->size);
+                stream.seekg(child->start);
+                stream.read(&info[0], info.size());
+                if (!stream)
+                {
+                    throw ReadError() << err_pos(child->start);
+                }
+            }
+            region_end = static_cast<std::streamsize>(child->start) +
+                child->size;
+        }
+    }
+    base.erase(ids::Tags);
+    // If the SegmentInfo is moved with the SeekHead, give it an entry so
+    // that readers can stop searching at the SeekHead
+    bool info_entry(!info.empty());
+    if (info_entry)
+    {
+        base.erase(ids::Info);
+    }
+    std::streamsize region_size(region_end - region_start);
+    if (region_end == seg_end && at_end)
+    {
+        region_size = std::numeric_limits<std::streamsize>::max();
+    }
+    uint64_t region_pos(segment.to_segment_offset(region_start));
+
+    // Place the tags: in their current space if they fit, else after the
+    // SeekHead if there is room, else in some other free space, else at the
+    // end of the segment
+    SeekHead index;
+    bool tags_in_region(false);
+    std::streampos tags_start(0);
+    std::streamsize tags_space(0);
+    if (in_place)
+    {
+        tags_start = old_start;
+        tags_space = old_space;
+    }
+    else
+    {
+        tags_in_region = fits_in_space(layout_seekhead(base, index,
+                    ids::Tags, region_pos, info_entry, info.size(), true, 0) +
+                info.size() + tags_size + padding, region_size);
+    }
+    if (!in_place && !tags_in_region)
+    {
+        BOOST_FOREACH(SegmentChild const& child, children)
+        {
+            if (child.id == ids::Void &&
+                    (child.start < region_start ||
+                     child.start >= region_end) &&
+                    fits_in_space(tags_size + padding, child.size))
+            {
+                tags_start = child.start;
+                tags_space = child.size;
+                break;
+            }
+        }
+        if (tags_space == 0)
+        {
+            if (!at_end)
+            {
+                throw NoIndexSpace() << err_reqsize(tags_size);
+            }
+            tags_start = seg_end;
+            tags_space = tags_size + padding;
+        }
+    }
+    bool sh_at_end(false);
+    if (!tags_in_region)
+    {
+        sh_at_end = !fits_in_space(layout_seekhead(base, index,
+                    ids::Tags, region_pos, info_entry, info.size(), false,
+                    segment.to_segment_offset(tags_start)) + info.size(),
+                region_size);
+    }
+    if (sh_at_end)
+    {
+        // The SegmentInfo stays where it is, and the SeekHead is moved to
+        // the end of the segment.
+        if (!at_end)
+        {
+            throw NoIndexSpace() << err_reqsize(index.size());
+        }
+        if (info_entry)
+        {
+            base.insert(std::make_pair(ids::Info,
+                        segment.to_segment_offset(info_start)));
+        }
+        layout_seekhead(base, index, ids::Tags, 0, false, 0, false,
+                segment.to_segment_offset(tags_start));
+    }
+
+    // Write the new elements
+    std::streampos end(seg_end);
+    if (!sh_at_end)
+    {
+        stream.seekp(region_start);
+        index.write(stream);
+        if (!info.empty())
+        {
+            stream.write(&info[0], info.size());
+            if (!stream)
+            {
+                throw WriteError() << err_pos(stream.tellp());
+            }
+        }
+        std::streampos pad_end(region_end);
+        if (tags_in_region)
+        {
+            tags.write(stream);
+            pad_end = std::max(pad_end, stream.tellp() + padding);
+        }
+        pad_space(stream, pad_end, pad_end > seg_end);
+        end = std::max(end, stream.tellp());
+    }
+    if (!tags_in_region)
+    {
+        stream.seekp(tags_start);
+        tags.write(stream);
+        std::streampos pad_end(static_cast<std::streamsize>(tags_start) +
+                tags_space);
+        pad_space(stream, pad_end, pad_end > seg_end);
+        end = std::max(end, stream.tellp());
+    }
+    if (sh_at_end)
+    {
+        stream.seekp(end);
+        index.write(stream);
+        end = stream.tellp();
+        stream.seekp(sh->start);
+        VoidElement ve(sh->size);
+        ve.write(stream);
+    }
+    // Blank out the old tags
+    BOOST_FOREACH(SegmentChild const& child, children)
+    {
+        if (child.id == ids::Tags &&
+                (tags_in_region || child.start != tags_start))
+        {
+            stream.seekp(child.start);
+            VoidElement ve(child.size);
+            ve.write(stream);
+        }
+    }
+    if (end != seg_end)
+    {
+        stream.seekp(size_pos);
+        vint::write(static_cast<std::streamsize>(end) -
+                static_cast<std::streamsize>(body_start), stream,
+                seg_size.second);
+    }
+    stream.flush();
+}
+
@@ -0,0 +1,594 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/tags.h>
+
+#include <boost/foreach.hpp>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+
+using namespace tawara;
+
+///////////////////////////////////////////////////////////////////////////////
+// Helpers
+///////////////////////////////////////////////////////////////////////////////
+
+// Gets the total size of a list of UIDs written as UInt elements.
+std::streamsize tag_uids_size(ids::ID id, std::vector<uint64_t> const& uids)
+{
+    std::streamsize size(0);
+    BOOST_FOREACH(uint64_t uid, uids)
+    {
+        size += UIntElement(id, uid).size();
+    }
+    return size;
+}
+
+
+// Writes a list of UIDs as UInt elements.
+std::streamsize write_tag_uids(ids::ID id, std::vector<uint64_t> const& uids,
+        std::ostream& output)
+{
+    std::streamsize written(0);
+    BOOST_FOREACH(uint64_t uid, uids)
+    {
+        UIntElement el(id, uid);
+        written += el.write(output);
+    }
+    return written;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Targets constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Targets::Targets()
+    : MasterElement(ids::Targets)
+{
+}
+
+
+bool Targets::empty() const
+{
+    return track_uids_.empty() && edition_uids_.empty() &&
+        chapter_uids_.empty() && attachment_uids_.empty();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Targets operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(Targets const& lhs, Targets const& rhs)
+{
+    return lhs.track_uids_ == rhs.track_uids_ &&
+        lhs.edition_uids_ == rhs.edition_uids_ &&
+        lhs.chapter_uids_ == rhs.chapter_uids_ &&
+        lhs.attachment_uids_ == rhs.attachment_uids_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Targets Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize Targets::body_size() const
+{
+    return tag_uids_size(ids::TagTrackUID, track_uids_) +
+        tag_uids_size(ids::TagEditionUID, edition_uids_) +
+        tag_uids_size(ids::TagChapterUID, chapter_uids_) +
+        tag_uids_size(ids::TagAttachmentUID, attachment_uids_);
+}
+
+
+std::streamsize Targets::write_body(std::ostream& output)
+{
+    std::streamsize written(0);
+    written += write_tag_uids(ids::TagTrackUID, track_uids_, output);
+    written += write_tag_uids(ids::TagEditionUID, edition_uids_, output);
+    written += write_tag_uids(ids::TagChapterUID, chapter_uids_, output);
+    written += write_tag_uids(ids::TagAttachmentUID, attachment_uids_, output);
+    return written;
+}
+
+
+std::streamsize Targets::read_body(std::istream& input,
+        std::streamsize size)
+{
+    track_uids_.clear();
+    edition_uids_.clear();
+    chapter_uids_.clear();
+    attachment_uids_.clear();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        UIntElement uid(id, 0);
+        switch(id)
+        {
+            case ids::TagTrackUID:
+                read_bytes += uid.read(input);
+                track_uids_.push_back(uid);
+                break;
+            case ids::TagEditionUID:
+                read_bytes += uid.read(input);
+                edition_uids_.push_back(uid);
+                break;
+            case ids::TagChapterUID:
+                read_bytes += uid.read(input);
+                chapter_uids_.push_back(uid);
+                break;
+            case ids::TagAttachmentUID:
+                read_bytes += uid.read(input);
+                attachment_uids_.push_back(uid);
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SimpleTag constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+SimpleTag::SimpleTag()
+    : MasterElement(ids::SimpleTag), name_(ids::TagName, ""),
+    lang_(ids::TagLanguage, "und", "und"), default_(ids::TagDefault, 1, 1),
+    string_(ids::TagString, ""), binary_(ids::TagBinary, std::vector<char>()),
+    has_string_(false), has_binary_(false)
+{
+}
+
+
+SimpleTag::SimpleTag(std::string const& name, std::string const& value)
+    : MasterElement(ids::SimpleTag), name_(ids::TagName, name),
+    lang_(ids::TagLanguage, "und", "und"), default_(ids::TagDefault, 1, 1),
+    string_(ids::TagString, value),
+    binary_(ids::TagBinary, std::vector<char>()),
+    has_string_(true), has_binary_(false)
+{
+}
+
+
+void SimpleTag::string(std::string const& value)
+{
+    string_ = value;
+    has_string_ = true;
+    binary_ = std::vector<char>();
+    has_binary_ = false;
+}
+
+
+void SimpleTag::binary(std::vector<char> const& value)
+{
+    binary_ = value;
+    has_binary_ = true;
+    string_ = "";
+    has_string_ = false;
+}
+
+
+void SimpleTag::clear_value()
+{
+    string_ = "";
+    has_string_ = false;
+    binary_ = std::vector<char>();
+    has_binary_ = false;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SimpleTag operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(SimpleTag const& lhs, SimpleTag const& rhs)
+{
+    return lhs.name_ == rhs.name_ &&
+        lhs.lang_ == rhs.lang_ &&
+        lhs.default_ == rhs.default_ &&
+        lhs.has_string_ == rhs.has_string_ &&
+        lhs.string_ == rhs.string_ &&
+        lhs.has_binary_ == rhs.has_binary_ &&
+        lhs.binary_ == rhs.binary_ &&
+        lhs.children_ == rhs.children_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SimpleTag Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize SimpleTag::body_size() const
+{
+    std::streamsize size(name_.size());
+
+    if (!lang_.is_default())
+    {
+        size += lang_.size();
+    }
+    if (!default_.is_default())
+    {
+        size += default_.size();
+    }
+    if (has_string_)
+    {
+        size += string_.size();
+    }
+    else if (has_binary_)
+    {
+        size += binary_.size();
+    }
+    BOOST_FOREACH(SimpleTag const& child, children_)
+    {
+        size += child.size();
+    }
+    return size;
+}
+
+
+std::streamsize SimpleTag::write_body(std::ostream& output)
+{
+    assert(!(has_string_ && has_binary_));
+    assert(default_ == 0 || default_ == 1);
+
+    std::streamsize written(0);
+
+    written += name_.write(output);
+    if (!lang_.is_default())
+    {
+        written += lang_.write(output);
+    }
+    if (!default_.is_default())
+    {
+        written += default_.write(output);
+    }
+    if (has_string_)
+    {
+        written += string_.write(output);
+    }
+    else if (has_binary_)
+    {
+        written += binary_.write(output);
+    }
+    BOOST_FOREACH(SimpleTag& child, children_)
+    {
+        written += child.write(output);
+    }
+    return written;
+}
+
+
+std::streamsize SimpleTag::read_body(std::istream& input,
+        std::streamsize size)
+{
+    // Reset to defaults
+    reset();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    bool have_name(false);
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        switch(id)
+        {
+            case ids::TagName:
+                read_bytes += name_.read(input);
+                have_name = true;
+                break;
+            case ids::TagLanguage:
+                read_bytes += lang_.read(input);
+                break;
+            case ids::TagDefault:
+                read_bytes += default_.read(input);
+                if (default_ != 0 && default_ != 1)
+                {
+                    throw ValueOutOfRange() << err_id(default_.id()) <<
+                        err_par_id(id_) << err_pos(offset_);
+                }
+                break;
+            case ids::TagString:
+                if (has_binary_)
+                {
+                    throw TagStringAndBinary() << err_id(id_) <<
+                        err_pos(offset_);
+                }
+                read_bytes += string_.read(input);
+                has_string_ = true;
+                break;
+            case ids::TagBinary:
+                if (has_string_)
+                {
+                    throw TagStringAndBinary() << err_id(id_) <<
+                        err_pos(offset_);
+                }
+                read_bytes += binary_.read(input);
+                has_binary_ = true;
+                break;
+            case ids::SimpleTag:
+                children_.push_back(SimpleTag());
+                read_bytes += children_.back().read(input);
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (!have_name)
+    {
+        throw MissingChild() << err_id(ids::TagName) << err_par_id(id_) <<
+            err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// SimpleTag private functions
+///////////////////////////////////////////////////////////////////////////////
+
+void SimpleTag::reset()
+{
+    name_ = "";
+    lang_ = lang_.get_default();
+    default_ = default_.get_default();
+    clear_value();
+    children_.clear();
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tag constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Tag::Tag()
+    : MasterElement(ids::Tag)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tag operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(Tag const& lhs, Tag const& rhs)
+{
+    return lhs.targets_ == rhs.targets_ &&
+        lhs.simple_tags_ == rhs.simple_tags_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tag Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize Tag::body_size() const
+{
+    std::streamsize size(targets_.size());
+
+    BOOST_FOREACH(SimpleTag const& st, simple_tags_)
+    {
+        size += st.size();
+    }
+    return size;
+}
+
+
+std::streamsize Tag::write_body(std::ostream& output)
+{
+    if (simple_tags_.empty())
+    {
+        throw NoSimpleTags();
+    }
+
+    std::streamsize written(0);
+
+    written += targets_.write(output);
+    BOOST_FOREACH(SimpleTag& st, simple_tags_)
+    {
+        written += st.write(output);
+    }
+    return written;
+}
+
+
+std::streamsize Tag::read_body(std::istream& input, std::streamsize size)
+{
+    targets_ = Targets();
+    simple_tags_.clear();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        switch(id)
+        {
+            case ids::Targets:
+                read_bytes += targets_.read(input);
+                break;
+            case ids::SimpleTag:
+                simple_tags_.push_back(SimpleTag());
+                read_bytes += simple_tags_.back().read(input);
+                break;
+            default:
+                throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                    // The cast here makes Apple's LLVM compiler happy
+                    err_pos(static_cast<std::streamsize>(input.tellg()) -
+                            id_res.second);
+        }
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (simple_tags_.empty())
+    {
+        throw NoSimpleTags() << err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tags constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+Tags::Tags()
+    : MasterElement(ids::Tags)
+{
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tags operators
+///////////////////////////////////////////////////////////////////////////////
+
+bool tawara::operator==(Tags const& lhs, Tags const& rhs)
+{
+    return lhs.tags_ == rhs.tags_;
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Tags Element interface implementation
+///////////////////////////////////////////////////////////////////////////////
+
+std::streamsize Tags::body_size() const
+{
+    std::streamsize size(0);
+
+    BOOST_FOREACH(Tag const& tag, tags_)
+    {
+        size += tag.size();
+    }
+    return size;
+}
+
+
+std::streamsize Tags::write_body(std::ostream& output)
+{
+    if (tags_.empty())
+    {
+        throw NoTags();
+    }
+
+    std::streamsize written(0);
+
+    BOOST_FOREACH(Tag& tag, tags_)
+    {
+        written += tag.write(output);
+    }
+    return written;
+}
+
+
+std::streamsize Tags::read_body(std::istream& input, std::streamsize size)
+{
+    tags_.clear();
+
+    std::streamsize read_bytes(0);
+    // Read elements until the body is exhausted
+    while (read_bytes < size)
+    {
+        // Read the ID
+        ids::ReadResult id_res = ids::read(input);
+        ids::ID id(id_res.first);
+        read_bytes += id_res.second;
+        if (id != ids::Tag)
+        {
+            throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
+                // The cast here makes Apple's LLVM compiler happy
+                err_pos(static_cast<std::streamsize>(input.tellg()) -
+                        id_res.second);
+        }
+        tags_.push_back(Tag());
+        read_bytes += tags_.back().read(input);
+    }
+    if (read_bytes != size)
+    {
+        // Read more than was specified by the body size value
+        throw BadBodySize() << err_id(id_) << err_el_size(size) <<
+            err_pos(offset_);
+    }
+    if (tags_.empty())
+    {
+        throw NoTags() << err_pos(offset_);
+    }
+
+    return read_bytes;
+}
+
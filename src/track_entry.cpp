@@ -61,7 +61,7 @@ TrackEntry::TrackEntry(uint64_t number, uint64_t uid, std::string const& codec)
     name_(ids::Name, ""), codec_id_(ids::CodecID, codec),
     codec_private_(ids::CodecPrivate, std::vector<char>()),
     codec_name_(ids::CodecName, ""), attachment_link_(ids::AttachmentLink, 0),
-    decode_all_(ids::CodecDecodeAll, 0, 0)
+    decode_all_(ids::CodecDecodeAll, 0, 0), compression_(COMPRESSION_NONE)
 {
     if (number == 0)
     {
@@ -136,6 +136,16 @@ void TrackEntry::codec_id(std::string id)
 }
 
 
+void TrackEntry::compression(Compression compression)
+{
+    if (!compression_available(compression))
+    {
+        throw UnsupportedCompression() << err_par_id(id_);
+    }
+    compression_ = compression;
+}
+
+
 std::vector<uint64_t> TrackEntry::overlays() const
 {
     std::vector<uint64_t> result;
@@ -181,7 +191,11 @@ bool tawara::operator==(TrackEntry const& lhs, TrackEntry const& rhs)
         lhs.attachment_link_ == rhs.attachment_link_ &&
         lhs.decode_all_ == rhs.decode_all_ &&
         lhs.overlays_ == rhs.overlays_ &&
-        lhs.operation_ == rhs.operation_;
+        lhs.operation_ == rhs.operation_ &&
+        lhs.compression_ == rhs.compression_ &&
+        (lhs.dictionary_ == rhs.dictionary_ ||
+         (lhs.dictionary_ && rhs.dictionary_ &&
+          lhs.dictionary_->data() == rhs.dictionary_->data()));
 }
 
 
@@ -258,6 +272,10 @@ std::streamsize TrackEntry::body_size() const
             tawara::vint::size(operation_->size()) +
             operation_->size();
     }
+    if (compression_ != COMPRESSION_NONE)
+    {
+        size += encodings_size();
+    }
     return size;
 }
 
@@ -340,6 +358,10 @@ std::streamsize TrackEntry::write_body(std::ostream& output)
         written += tawara::vint::write(operation_->size(), output);
         written += operation_->write(output);
     }
+    if (compression_ != COMPRESSION_NONE)
+    {
+        written += write_encodings(output);
+    }
     return written;
 }
 
@@ -480,6 +502,9 @@ std::streamsize TrackEntry::read_body(std::istream& input,
             case ids::TrackOperation:
                 read_bytes += read_operation(input);
                 break;
+            case ids::ContentEncodings:
+                read_bytes += read_encodings(input);
+                break;
             default:
                 throw InvalidChildID() << err_id(id) << err_par_id(id_) <<
                     // The cast here makes Apple's LLVM compiler happy
@@ -543,6 +568,8 @@ void TrackEntry::reset()
     decode_all_ = decode_all_.get_default();
     overlays_.clear();
     operation_.reset();
+    compression_ = COMPRESSION_NONE;
+    dictionary_.reset();
 }
 
 
@@ -570,3 +597,175 @@ std::streamsize TrackEntry::read_operation(std::istream& input)
     return read_bytes;
 }
 
+
+// The ContentEncodings element holds a single ContentEncoding, which holds a
+// ContentCompression with the algorithm and the dictionary, if any. The
+// order, scope and type of the encoding are all left at their defaults,
+// meaning compression of the frames.
+std::streamsize TrackEntry::encodings_size() const
+{
+    UIntElement algo(ids::ContentCompAlgo, compression_to_algo(compression_));
+    std::streamsize size(algo.size());
+    if (dictionary_)
+    {
+        size += BinaryElement(ids::ContentCompSettings,
+                dictionary_->data()).size();
+    }
+    size += ids::size(ids::ContentCompression) + vint::size(size);
+    size += ids::size(ids::ContentEncoding) + vint::size(size);
+    return ids::size(ids::ContentEncodings) + vint::size(size) + size;
+}
+
+
+std::streamsize TrackEntry::write_encodings(std::ostream& output) const
+{
+    UIntElement algo(ids::ContentCompAlgo, compression_to_algo(compression_));
+    std::streamsize comp_size(algo.size());
+    if (dictionary_)
+    {
+        comp_size += BinaryElement(ids::ContentCompSettings,
+                dictionary_->data()).size();
+    }
+    std::streamsize enc_size(ids::size(ids::ContentCompression) +
+            vint::size(comp_size) + comp_size);
+    std::streamsize encs_size(ids::size(ids::ContentEncoding) +
+            vint::size(enc_size) + enc_size);
+
+    std::streamsize written(0);
+    written += ids::write(ids::ContentEncodings, output);
+    written += vint::write(encs_size, output);
+    written += ids::write(ids::ContentEncoding, output);
+    written += vint::write(enc_size, output);
+    written += ids::write(ids::ContentCompression, output);
+    written += vint::write(comp_size, output);
+    written += algo.write(output);
+    if (dictionary_)
+    {
+        written += BinaryElement(ids::ContentCompSettings,
+                dictionary_->data()).write(output);
+    }
+    return written;
+}
+
+
+std::streamsize TrackEntry::read_encodings(std::istream& input)
+{
+    vint::ReadResult encs_size = vint::read(input);
+    std::streamsize read_bytes(encs_size.second);
+    std::streamsize encs_end(read_bytes + encs_size.first);
+    bool have_encoding(false);
+    while (read_bytes < encs_end)
+    {
+        ids::ReadResult id_res = ids::read(input);
+        read_bytes += id_res.second;
+        if (id_res.first != ids::ContentEncoding)
+        {
+            throw InvalidChildID() << err_id(id_res.first) <<
+                err_par_id(ids::ContentEncodings) <<
+                // The cast here makes Apple's LLVM compiler happy
+                err_pos(static_cast<std::streamsize>(input.tellg()) -
+                        id_res.second);
+        }
+        if (have_encoding)
+        {
+            // Chains of encodings are not supported
+            throw UnsupportedCompression() << err_par_id(id_) <<
+                err_pos(input.tellg());
+        }
+        have_encoding = true;
+
+        vint::ReadResult enc_size = vint::read(input);
+        read_bytes += enc_size.second;
+        std::streamsize enc_end(read_bytes + enc_size.first);
+        UIntElement scope(ids::ContentEncodingScope, 1, 1);
+        UIntElement type(ids::ContentEncodingType, 0, 0);
+        UIntElement order(ids::ContentEncodingOrder, 0, 0);
+        // Matroska's default algorithm is zlib, which is not supported
+        UIntElement algo(ids::ContentCompAlgo, 0, 0);
+        BinaryElement settings(ids::ContentCompSettings,
+                std::vector<char>());
+        bool have_compression(false);
+        while (read_bytes < enc_end)
+        {
+            id_res = ids::read(input);
+            read_bytes += id_res.second;
+            switch (id_res.first)
+            {
+                case ids::ContentEncodingOrder:
+                    read_bytes += order.read(input);
+                    break;
+                case ids::ContentEncodingScope:
+                    read_bytes += scope.read(input);
+                    break;
+                case ids::ContentEncodingType:
+                    read_bytes += type.read(input);
+                    break;
+                case ids::ContentCompression:
+                    {
+                        have_compression = true;
+                        vint::ReadResult comp_size = vint::read(input);
+                        read_bytes += comp_size.second;
+                        std::streamsize comp_end(read_bytes +
+                                comp_size.first);
+                        while (read_bytes < comp_end)
+                        {
+                            id_res = ids::read(input);
+                            read_bytes += id_res.second;
+                            if (id_res.first == ids::ContentCompAlgo)
+                            {
+                                read_bytes += algo.read(input);
+                            }
+                            else if (id_res.first ==
+                                    ids::ContentCompSettings)
+                            {
+                                read_bytes += settings.read(input);
+                            }
+                            else
+                            {
+                                throw InvalidChildID() <<
+                                    err_id(id_res.first) <<
+                                    err_par_id(ids::ContentCompression) <<
+                                    err_pos(static_cast<std::streamsize>(
+                                                input.tellg()) -
+                                            id_res.second);
+                            }
+                        }
+                    }
+                    break;
+                default:
+                    // Includes ContentEncryption, which is not supported
+                    throw UnsupportedCompression() << err_id(id_res.first) <<
+                        err_par_id(id_) << err_pos(input.tellg());
+            }
+        }
+        // Only compression of the frames is supported
+        if (type != 0 || !have_compression || !(scope & 1))
+        {
+            throw UnsupportedCompression() << err_par_id(id_) <<
+                err_pos(input.tellg());
+        }
+        try
+        {
+            compression_ = algo_to_compression(algo);
+            if (!compression_available(compression_))
+            {
+                throw UnsupportedCompression() << err_comp_algo(algo);
+            }
+        }
+        catch (UnsupportedCompression& e)
+        {
+            e << err_par_id(id_) << err_pos(input.tellg());
+            throw;
+        }
+        if (!settings.value().empty())
+        {
+            dictionary_.reset(new CompressionDictionary(settings.value()));
+        }
+    }
+    if (read_bytes != encs_end)
+    {
+        throw BadBodySize() << err_id(ids::ContentEncodings) <<
+            err_el_size(encs_size.first) << err_pos(input.tellg());
+    }
+    return read_bytes;
+}
@@ -0,0 +1,113 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <tawara/track_table.h>
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <sstream>
+#include <stdexcept>
+
+using namespace tawara;
+
+TrackTable::size_type const TrackTable::npos_;
+
+///////////////////////////////////////////////////////////////////////////////
+// Constructors and destructors
+///////////////////////////////////////////////////////////////////////////////
+
+TrackTable::TrackTable()
+{
+}
+
+
+TrackTable::TrackTable(Tracks const& tracks, uint64_t timecode_scale)
+{
+    // Track numbers are normally small and consecutive, so store them
+    // densely unless that would waste a lot of space.
+    uint64_t dense_limit(std::max(static_cast<uint64_t>(64),
+                static_cast<uint64_t>(tracks.count()) * 4));
+    entries_.reserve(tracks.count());
+    BOOST_FOREACH(Tracks::value_type const& track, tracks)
+    {
+        Entry entry;
+        entry.number = track.first;
+        entry.uid = track.second->uid();
+        entry.timecode_scale = timecode_scale *
+            track.second->timecode_scale();
+        entry.default_duration = track.second->default_duration();
+        entry.track = track.second;
+        size_type index(entries_.size());
+        entries_.push_back(entry);
+
+        if (entry.number < dense_limit)
+        {
+            if (entry.number >= dense_.size())
+            {
+                dense_.resize(entry.number + 1, npos_);
+            }
+            dense_[entry.number] = index;
+        }
+        else
+        {
+            sparse_[entry.number] = index;
+        }
+        uids_[entry.uid] = index;
+        // Keep the lowest-numbered track with each name
+        names_.insert(std::make_pair(track.second->name(), index));
+    }
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// Accessors
+///////////////////////////////////////////////////////////////////////////////
+
+TrackTable::Entry const& TrackTable::at(uint64_t number) const
+{
+    Entry const* entry(find(number));
+    if (!entry)
+    {
+        std::stringstream str;
+        str << number;
+        throw std::out_of_range(str.str());
+    }
+    return *entry;
+}
+
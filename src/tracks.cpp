@@ -64,26 +64,27 @@ Tracks::Tracks()
 
 Tracks::mapped_type& Tracks::operator[](Tracks::key_type const& key)
 {
-    if (entries_.find(key) == entries_.end())
+    iterator entry(entries_.find(key));
+    if (entry == entries_.end())
     {
         std::stringstream str;
         str << key;
         throw std::out_of_range(str.str());
     }
-    return entries_[key];
+    return entry->second;
 }
 
 
 Tracks::mapped_type const& Tracks::operator[](Tracks::key_type const& key) const
 {
-    if (entries_.find(key) == entries_.end())
+    const_iterator entry(entries_.find(key));
+    if (entry == entries_.end())
     {
         std::stringstream str;
         str << key;
         throw std::out_of_range(str.str());
     }
-    // Cannot use entries_[key] because it is not a const function.
-    return entries_.find(key)->second;
+    return entry->second;
 }
 
 
@@ -108,6 +109,21 @@ void Tracks::insert(const_iterator first, const_iterator last)
 }
 
 
+DictionaryMapPtr Tracks::dictionaries() const
+{
+    boost::shared_ptr<DictionaryMap> result(new DictionaryMap);
+    BOOST_FOREACH(value_type const& entry, entries_)
+    {
+        if (entry.second->compression() != COMPRESSION_NONE &&
+                entry.second->dictionary())
+        {
+            (*result)[entry.first] = entry.second->dictionary();
+        }
+    }
+    return result;
+}
+
+
 ///////////////////////////////////////////////////////////////////////////////
 // Operators
 ///////////////////////////////////////////////////////////////////////////////
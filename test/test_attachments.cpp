@@ -36,12 +36,15 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <algorithm>
+#include <fstream>
 #include <gtest/gtest.h>
 #include <tawara/attachments.h>
 #include <tawara/el_ids.h>
 #include <tawara/exceptions.h>
 #include <tawara/vint.h>
 
+#include "test_consts.h"
 #include "test_utils.h"
 
 
@@ -549,3 +552,123 @@ TEST(Attachments, Read)
     EXPECT_THROW(a.read(input), tawara::NoAttachments);
 }
 
+
+///////////////////////////////////////////////////////////////////////////////
+// FileData tests
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(FileData, ReadData)
+{
+    boost::shared_ptr<std::vector<char> > blob(test_utils::make_blob(10));
+    tawara::FileData fd(*blob);
+    EXPECT_TRUE(fd.in_memory());
+    EXPECT_EQ(10, fd.data_size());
+
+    std::stringstream unused;
+    char buffer[4];
+    EXPECT_EQ(4, fd.read_data(unused, 2, buffer, 4));
+    EXPECT_TRUE(std::equal(buffer, buffer + 4, blob->begin() + 2));
+    EXPECT_EQ(2, fd.read_data(unused, 8, buffer, 4));
+    EXPECT_EQ(0, fd.read_data(unused, 10, buffer, 4));
+
+    tawara::FileData empty((std::vector<char>()));
+    std::stringstream output;
+    EXPECT_EQ(0, empty.copy_data(unused, output));
+    EXPECT_TRUE(output.str().empty());
+}
+
+
+TEST(FileData, Stream)
+{
+    boost::shared_ptr<std::vector<char> > blob(test_utils::make_blob(200));
+    boost::shared_ptr<std::stringstream> source(new std::stringstream);
+    source->write("skip", 4);
+    source->write(&(*blob)[0], blob->size());
+    source->seekg(4);
+    tawara::FileData fd(source, blob->size());
+    EXPECT_FALSE(fd.in_memory());
+    EXPECT_EQ(200, fd.data_size());
+    EXPECT_TRUE(fd.value().empty());
+
+    std::stringstream expected;
+    tawara::FileData(*blob).write(expected);
+    std::stringstream output;
+    EXPECT_EQ(fd.size(), fd.write(output));
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, expected.str(),
+            output.str());
+    // The source is read from the start of the data again
+    output.str(std::string());
+    fd.write(output);
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, expected.str(),
+            output.str());
+
+    char buffer[3];
+    EXPECT_EQ(3, fd.read_data(output, 100, buffer, 3));
+    EXPECT_TRUE(std::equal(buffer, buffer + 3, blob->begin() + 100));
+
+    EXPECT_THROW(tawara::FileData(boost::shared_ptr<std::istream>(), 10),
+            tawara::ReadError);
+}
+
+
+TEST(FileData, Path)
+{
+    boost::shared_ptr<std::vector<char> > blob(test_utils::make_blob(250));
+    std::string path((test_bin_dir / "attachment_data.bin").string());
+    {
+        std::ofstream file(path.c_str(), std::ios::out | std::ios::binary);
+        file.write(&(*blob)[0], blob->size());
+    }
+    tawara::FileData::Ptr fd(new tawara::FileData(path));
+    EXPECT_EQ(250, fd->data_size());
+    tawara::AttachedFile f("data.bin", "application/octet-stream", fd, 3);
+
+    std::stringstream expected;
+    tawara::AttachedFile mem("data.bin", "application/octet-stream",
+            tawara::FileData::Ptr(new tawara::FileData(*blob)), 3);
+    mem.write(expected);
+    std::stringstream output;
+    EXPECT_EQ(f.size(), f.write(output));
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, expected.str(),
+            output.str());
+
+    EXPECT_THROW(tawara::FileData((test_bin_dir / "missing.bin").string()),
+            tawara::ReadError);
+}
+
+
+TEST(FileData, LazyRead)
+{
+    boost::shared_ptr<std::vector<char> > blob1(test_utils::make_blob(240));
+    boost::shared_ptr<std::vector<char> > blob2(test_utils::make_blob(20));
+    tawara::Attachments a;
+    a.push_back(tawara::AttachedFile("one", "mime",
+                tawara::FileData::Ptr(new tawara::FileData(*blob1)), 1));
+    a.push_back(tawara::AttachedFile("two", "mime",
+                tawara::FileData::Ptr(new tawara::FileData(*blob2)), 2));
+    std::stringstream stream;
+    a.write(stream);
+
+    tawara::Attachments read;
+    read.lazy_data(true);
+    EXPECT_EQ(tawara::ids::Attachments, tawara::ids::read(stream).first);
+    read.read(stream);
+    EXPECT_EQ(stream.str().size(), stream.tellg());
+    ASSERT_EQ(2, read.count());
+    tawara::FileData::ConstPtr fd(read[0].data());
+    EXPECT_FALSE(fd->in_memory());
+    EXPECT_TRUE(fd->value().empty());
+    EXPECT_EQ(240, fd->data_size());
+    EXPECT_EQ(20, read[1].data()->data_size());
+
+    char buffer[10];
+    EXPECT_EQ(10, fd->read_data(stream, 200, buffer, 10));
+    EXPECT_TRUE(std::equal(buffer, buffer + 10, blob1->begin() + 200));
+    std::stringstream copy;
+    EXPECT_EQ(20, read[1].data()->copy_data(stream, copy));
+    EXPECT_EQ(std::string(blob2->begin(), blob2->end()), copy.str());
+
+    // The data cannot be written without its stream
+    std::stringstream output;
+    EXPECT_THROW(read.write(output), tawara::NoAttachedData);
+}
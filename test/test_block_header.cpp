@@ -0,0 +1,286 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <tawara/block_group.h>
+#include <tawara/block_header.h>
+#include <tawara/block_impl.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/simple_block.h>
+#include <tawara/uint_element.h>
+#include <tawara/vint.h>
+
+#include "test_utils.h"
+
+
+TEST(BlockHeader, Lacing)
+{
+    tawara::BlockHeader h;
+    h.flags = 0x00;
+    EXPECT_EQ(tawara::Block::LACING_NONE, h.lacing());
+    h.flags = 0x40;
+    EXPECT_EQ(tawara::Block::LACING_FIXED, h.lacing());
+    h.flags = 0x60;
+    EXPECT_EQ(tawara::Block::LACING_EBML, h.lacing());
+    h.flags = 0x91;
+    EXPECT_EQ(tawara::Block::LACING_NONE, h.lacing());
+}
+
+
+TEST(BlockHeader, ReadSimpleBlock)
+{
+    std::stringstream input;
+    tawara::SimpleBlock b1(42, -300, tawara::Block::LACING_FIXED);
+    b1.keyframe(true);
+    b1.push_back(test_utils::make_blob(10));
+    b1.push_back(test_utils::make_blob(10));
+    tawara::SimpleBlock b2(3, 12, tawara::Block::LACING_NONE);
+    b2.invisible(true);
+    b2.push_back(test_utils::make_blob(5));
+    input << "abc";
+    b1.write(input);
+    b2.write(input);
+    input.seekg(3);
+
+    tawara::BlockHeader h(tawara::read_block_header(input));
+    EXPECT_EQ(tawara::ids::SimpleBlock, h.id);
+    EXPECT_EQ(3, h.offset);
+    EXPECT_EQ(b1.size(), h.size);
+    EXPECT_EQ(42, h.track_number);
+    EXPECT_EQ(-300, h.timecode);
+    EXPECT_EQ(0x41, h.flags);
+    EXPECT_EQ(tawara::Block::LACING_FIXED, h.lacing());
+    // The read pointer should be at the next block
+    EXPECT_EQ(3 + b1.size(), input.tellg());
+
+    h = tawara::read_block_header(input);
+    EXPECT_EQ(3 + b1.size(), h.offset);
+    EXPECT_EQ(b2.size(), h.size);
+    EXPECT_EQ(3, h.track_number);
+    EXPECT_EQ(12, h.timecode);
+    EXPECT_EQ(0x10, h.flags);
+    EXPECT_EQ(3 + b1.size() + b2.size(), input.tellg());
+}
+
+
+TEST(BlockHeader, ReadBlockGroup)
+{
+    std::stringstream input;
+    tawara::BlockGroup b1(7, 1234, tawara::Block::LACING_EBML, 50);
+    b1.push_back(test_utils::make_blob(10));
+    b1.push_back(test_utils::make_blob(15));
+    b1.write(input);
+    input.seekg(0);
+
+    tawara::BlockHeader h(tawara::read_block_header(input));
+    EXPECT_EQ(tawara::ids::BlockGroup, h.id);
+    EXPECT_EQ(0, h.offset);
+    EXPECT_EQ(b1.size(), h.size);
+    EXPECT_EQ(7, h.track_number);
+    EXPECT_EQ(1234, h.timecode);
+    EXPECT_EQ(tawara::Block::LACING_EBML, h.lacing());
+    EXPECT_EQ(b1.size(), input.tellg());
+
+    // A Block child that is not the first child
+    input.str(std::string());
+    tawara::UIntElement duration(tawara::ids::BlockDuration, 50);
+    tawara::BlockImpl block(7, 1234, tawara::Block::LACING_NONE);
+    block.push_back(test_utils::make_blob(10));
+    std::stringstream block_el;
+    tawara::ids::write(tawara::ids::Block, block_el);
+    tawara::vint::write(block.size(), block_el);
+    block.write(block_el, 0);
+    tawara::ids::write(tawara::ids::BlockGroup, input);
+    tawara::vint::write(duration.size() + block_el.str().size(), input);
+    duration.write(input);
+    input << block_el.str();
+    input.seekg(0);
+    h = tawara::read_block_header(input);
+    EXPECT_EQ(7, h.track_number);
+    EXPECT_EQ(1234, h.timecode);
+    EXPECT_EQ(static_cast<std::streamsize>(input.str().size()),
+            input.tellg());
+
+    // A BlockGroup with no Block
+    input.str(std::string());
+    tawara::ids::write(tawara::ids::BlockGroup, input);
+    tawara::vint::write(duration.size(), input);
+    duration.write(input);
+    input.seekg(0);
+    EXPECT_THROW(tawara::read_block_header(input), tawara::MissingChild);
+}
+
+
+TEST(BlockHeader, ReadErrors)
+{
+    std::stringstream input;
+    // Not a block
+    tawara::UIntElement el(tawara::ids::Timecode, 42);
+    el.write(input);
+    input.seekg(0);
+    EXPECT_THROW(tawara::read_block_header(input), tawara::InvalidChildID);
+
+    // Too small
+    input.str(std::string());
+    tawara::ids::write(tawara::ids::SimpleBlock, input);
+    tawara::vint::write(3, input);
+    tawara::vint::write(1, input);
+    input.put(0);
+    input.put(0);
+    input.seekg(0);
+    EXPECT_THROW(tawara::read_block_header(input), tawara::BadBodySize);
+
+    // No frame data
+    input.str(std::string());
+    tawara::ids::write(tawara::ids::SimpleBlock, input);
+    tawara::vint::write(4, input);
+    tawara::vint::write(1, input);
+    input.put(0);
+    input.put(0);
+    input.put(0);
+    input.seekg(0);
+    EXPECT_THROW(tawara::read_block_header(input), tawara::BadBodySize);
+
+    // Truncated
+    input.str(std::string());
+    tawara::ids::write(tawara::ids::SimpleBlock, input);
+    tawara::vint::write(10, input);
+    tawara::vint::write(1, input);
+    input.seekg(0);
+    EXPECT_THROW(tawara::read_block_header(input), tawara::ReadError);
+}
+
+
+
+TEST(BlockHeader, CopyBytes)
+{
+    std::stringstream input, output;
+    boost::shared_ptr<std::vector<char> > blob(test_utils::make_blob(200));
+    input.write(&(*blob)[0], blob->size());
+    input.seekg(50);
+    EXPECT_EQ(100, tawara::copy_bytes(input, 100, output));
+    EXPECT_EQ(std::string(&(*blob)[50], 100), output.str());
+    EXPECT_EQ(150, input.tellg());
+    EXPECT_EQ(0, tawara::copy_bytes(input, 0, output));
+    EXPECT_THROW(tawara::copy_bytes(input, 100, output), tawara::ReadError);
+}
+
+
+TEST(BlockHeader, CopySimpleBlock)
+{
+    std::stringstream input, output;
+    tawara::SimpleBlock b1(42, -300, tawara::Block::LACING_FIXED);
+    b1.keyframe(true);
+    b1.push_back(test_utils::make_blob(10));
+    b1.push_back(test_utils::make_blob(10));
+    input << "abc";
+    b1.write(input);
+    input.seekg(3);
+    tawara::BlockHeader h(tawara::read_block_header(input));
+
+    // Unchanged
+    EXPECT_EQ(b1.size(), tawara::copy_block(input, h, output));
+    EXPECT_EQ(input.str().substr(3), output.str());
+
+    // New track number with a larger encoding, and a new timecode
+    output.str(std::string());
+    tawara::SimpleBlock b2(b1);
+    b2.track_number(300);
+    b2.timecode(12);
+    EXPECT_EQ(b2.size(), tawara::copy_block(input, h, output, 300, 12));
+    std::stringstream expected;
+    b2.write(expected);
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, output.str(),
+            expected.str());
+}
+
+
+TEST(BlockHeader, CopyBlockGroup)
+{
+    std::stringstream input, output;
+    tawara::BlockGroup b1(7, 1234, tawara::Block::LACING_EBML, 50);
+    b1.push_back(test_utils::make_blob(10));
+    b1.push_back(test_utils::make_blob(15));
+    b1.write(input);
+    input.seekg(0);
+    tawara::BlockHeader h(tawara::read_block_header(input));
+
+    tawara::BlockGroup b2(b1);
+    b2.track_number(1000);
+    b2.timecode(-2);
+    EXPECT_EQ(b2.size(), tawara::copy_block(input, h, output, 1000, -2));
+    std::stringstream expected;
+    b2.write(expected);
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, output.str(),
+            expected.str());
+
+    // A Block child that is not the first child
+    input.str(std::string());
+    output.str(std::string());
+    tawara::UIntElement duration(tawara::ids::BlockDuration, 50);
+    tawara::UIntElement priority(tawara::ids::ReferencePriority, 3);
+    tawara::BlockImpl block(7, 1234, tawara::Block::LACING_NONE);
+    block.push_back(test_utils::make_blob(10));
+    std::stringstream block_el;
+    tawara::ids::write(tawara::ids::Block, block_el);
+    tawara::vint::write(block.size(), block_el);
+    block.write(block_el, 0);
+    tawara::ids::write(tawara::ids::BlockGroup, input);
+    tawara::vint::write(duration.size() + block_el.str().size() +
+            priority.size(), input);
+    duration.write(input);
+    input << block_el.str();
+    priority.write(input);
+    input.seekg(0);
+    h = tawara::read_block_header(input);
+    tawara::copy_block(input, h, output, 2, 5);
+
+    output.seekg(0);
+    EXPECT_EQ(tawara::ids::BlockGroup, tawara::ids::read(output).first);
+    tawara::BlockGroup b3(0, 0);
+    b3.read(output);
+    EXPECT_EQ(2, b3.track_number());
+    EXPECT_EQ(5, b3.timecode());
+    EXPECT_EQ(50, b3.duration());
+    EXPECT_EQ(3, b3.ref_priority());
+    ASSERT_EQ(1, b3.count());
+    EXPECT_TRUE(*test_utils::make_blob(10) == *b3[0]);
+    EXPECT_EQ(static_cast<std::streamsize>(output.str().size()),
+            output.tellg());
+}
@@ -36,6 +36,7 @@
  *  POSSIBILITY OF SUCH DAMAGE.
  */
 
+#include <boost/foreach.hpp>
 #include <gtest/gtest.h>
 #include <tawara/block_impl.h>
 #include <tawara/el_ids.h>
@@ -122,6 +123,29 @@ TEST(BlockImpl, Assignment)
 }
 
 
+TEST(BlockImpl, Copy)
+{
+    tawara::BlockImpl b1(1, 12345, tawara::Block::LACING_EBML);
+    b1.invisible(true);
+    tawara::Block::value_type f1(test_utils::make_blob(5));
+    tawara::Block::value_type f2(test_utils::make_blob(10));
+    b1.push_back(f1);
+    b1.push_back(f2);
+    std::streamsize size(b1.size());
+
+    tawara::BlockImpl b2(b1);
+    EXPECT_EQ(b1.track_number(), b2.track_number());
+    EXPECT_EQ(b1.timecode(), b2.timecode());
+    EXPECT_TRUE(b2.invisible());
+    EXPECT_EQ(b1.lacing(), b2.lacing());
+    EXPECT_TRUE(b1 == b2);
+    EXPECT_EQ(size, b2.size());
+    b2.push_back(f1);
+    EXPECT_EQ(2, b1.count());
+    EXPECT_EQ(size + f1->size() + 1, b2.size());
+}
+
+
 TEST(BlockImpl, At)
 {
     tawara::BlockImpl b(2, 22222, tawara::Block::LACING_EBML);
@@ -183,7 +207,10 @@ TEST(BlockImpl, Counts)
     b.lacing(tawara::Block::LACING_EBML);
     EXPECT_NE(1, b.max_count());
     b.lacing(tawara::Block::LACING_FIXED);
-    EXPECT_NE(1, b.max_count());
+    EXPECT_EQ(255, b.max_count());
+    b.resize(255);
+    EXPECT_THROW(b.resize(256), tawara::MaxLaceSizeExceeded);
+    EXPECT_THROW(b.push_back(f1), tawara::MaxLaceSizeExceeded);
 }
 
 
@@ -473,6 +500,12 @@ TEST(BlockImpl, Write)
     b.push_back(f2);
     b.lacing(tawara::Block::LACING_FIXED);
     EXPECT_THROW(b.write(output, 0), tawara::BadLacedFrameSize);
+
+    // A single EBML laced frame
+    b.clear();
+    b.lacing(tawara::Block::LACING_EBML);
+    b.push_back(f1);
+    EXPECT_THROW(b.write(output, 0), tawara::BadLacedFrameSize);
 }
 
 
@@ -677,5 +710,73 @@ TEST(BlockImpl, Read)
     expected_size = tawara::vint::size(track_num) + 3 + 1 + f1->size() +
         f2->size();
     EXPECT_THROW(b.read(input, expected_size), tawara::BadLacedFrameSize);
+
+    // No frames - fixed lacing
+    input.str(std::string());
+    tawara::vint::write(track_num, input);
+    input.put(timecode >> 8);
+    input.put(timecode & 0xFF);
+    input.put(0x40); // Flags - fixed lacing
+    input.put(0); // Lace header - number of frames
+    input.write(&(*f1)[0], f1->size());
+    expected_size = tawara::vint::size(track_num) + 3 + 1 + f1->size();
+    EXPECT_THROW(b.read(input, expected_size), tawara::BadLacedFrameSize);
+
+    // A single frame - EBML lacing
+    input.str(std::string());
+    tawara::vint::write(track_num, input);
+    input.put(timecode >> 8);
+    input.put(timecode & 0xFF);
+    input.put(0x60); // Flags - EBML lacing
+    input.put(1); // Lace header - number of frames
+    tawara::vint::write(f1->size(), input);
+    input.write(&(*f1)[0], f1->size());
+    expected_size = tawara::vint::size(track_num) + 3 + 1 +
+        tawara::vint::size(f1->size()) + f1->size();
+    EXPECT_THROW(b.read(input, expected_size), tawara::BadLacedFrameSize);
 }
 
+
+
+TEST(BlockImpl, ReadLargeLace)
+{
+    // 255 distinct frames, in both lacing styles, must come back intact
+    tawara::BlockImpl b(1, 12);
+    b.lacing(tawara::Block::LACING_FIXED);
+    for (int ii(0); ii < 255; ++ii)
+    {
+        tawara::Block::value_type f(new std::vector<char>(16));
+        for (size_t jj(0); jj < f->size(); ++jj)
+        {
+            (*f)[jj] = ii + jj;
+        }
+        b.push_back(f);
+    }
+
+    tawara::Block::LacingType types[] = {tawara::Block::LACING_FIXED,
+        tawara::Block::LACING_EBML};
+    BOOST_FOREACH(tawara::Block::LacingType type, types)
+    {
+        b.lacing(type);
+        std::stringstream io;
+        std::streamsize written(b.write(io, 0));
+        io.seekg(0, std::ios::beg);
+
+        tawara::BlockImpl r(0, 0);
+        tawara::BlockImpl::ReadResult res(r.read(io, written));
+        EXPECT_EQ(written, res.first);
+        EXPECT_EQ(type, r.lacing());
+        ASSERT_EQ(255, r.count());
+        for (int ii(0); ii < 255; ++ii)
+        {
+            EXPECT_TRUE(*b[ii] == *r[ii]) << "frame " << ii;
+        }
+
+        // A truncated payload fails without leaving partial frames behind
+        std::string truncated(io.str().substr(0, written - 1));
+        std::stringstream short_io(truncated);
+        tawara::BlockImpl t(0, 0);
+        EXPECT_THROW(t.read(short_io, written), tawara::ReadError);
+        EXPECT_EQ(0, t.count());
+    }
+}
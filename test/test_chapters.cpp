@@ -0,0 +1,298 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <tawara/chapter_index.h>
+#include <tawara/chapters.h>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+#include <tawara/vint.h>
+
+#include "test_utils.h"
+
+
+// Times are in seconds, converted to nanoseconds.
+static const uint64_t sec(1000000000);
+
+
+// Makes the chapters of the example in the specification, with the times
+// in seconds instead of minutes, and a nested chapter in the carpark.
+tawara::Chapters make_chapters()
+{
+    tawara::EditionEntry edition;
+    edition.uid(7);
+    char const* names[] = {"Office", "Hallway", "Carpark", "Warehouse",
+        "Carpark 2"};
+    uint64_t times[] = {0, 5, 7, 15, 20, 25};
+    for (int ii(0); ii < 5; ++ii)
+    {
+        tawara::ChapterAtom atom(ii + 1, times[ii] * sec, names[ii]);
+        atom.end(times[ii + 1] * sec);
+        edition.atoms().push_back(atom);
+    }
+    tawara::ChapterAtom fault(10, 9 * sec, "fault");
+    fault.end(10 * sec);
+    fault.displays().push_back(tawara::ChapterDisplay("panne", "fre"));
+    edition.atoms()[2].children().push_back(fault);
+    tawara::Chapters chapters;
+    chapters.push_back(edition);
+    return chapters;
+}
+
+
+TEST(ChapterDisplay, WriteRead)
+{
+    tawara::ChapterDisplay display("docking");
+    EXPECT_EQ(1, display.languages().size());
+    EXPECT_EQ("eng", display.languages()[0]);
+    display.countries(std::vector<std::string>(1, "jp"));
+
+    std::stringstream stream;
+    EXPECT_EQ(display.size(), display.write(stream));
+    EXPECT_EQ(display.size(), stream.str().size());
+    EXPECT_EQ(tawara::ids::ChapterDisplay, tawara::ids::read(stream).first);
+    tawara::ChapterDisplay read;
+    read.read(stream);
+    EXPECT_TRUE(display == read);
+    EXPECT_EQ("docking", read.string());
+    EXPECT_EQ("jp", read.countries()[0]);
+}
+
+
+TEST(ChapterAtom, Create)
+{
+    tawara::ChapterAtom atom(3, 100, "name");
+    EXPECT_EQ(3, atom.uid());
+    EXPECT_EQ(100, atom.start());
+    EXPECT_FALSE(atom.has_end());
+    EXPECT_FALSE(atom.hidden());
+    EXPECT_TRUE(atom.enabled());
+    EXPECT_EQ("name", atom.name());
+    EXPECT_TRUE(tawara::ChapterAtom().name().empty());
+
+    EXPECT_THROW(tawara::ChapterAtom(0, 0), tawara::ValueOutOfRange);
+    EXPECT_THROW(atom.uid(0), tawara::ValueOutOfRange);
+    atom.end(200);
+    EXPECT_TRUE(atom.has_end());
+    EXPECT_EQ(200, atom.end());
+    atom.clear_end();
+    EXPECT_FALSE(atom.has_end());
+}
+
+
+TEST(ChapterAtom, WriteRead)
+{
+    tawara::ChapterAtom atom(3, 100, "name");
+    atom.end(500);
+    atom.hidden(true);
+    atom.enabled(false);
+    std::vector<uint64_t> tracks;
+    tracks.push_back(1);
+    tracks.push_back(2);
+    atom.tracks(tracks);
+    atom.children().push_back(tawara::ChapterAtom(4, 200, "child"));
+
+    std::stringstream stream;
+    EXPECT_EQ(atom.size(), atom.write(stream));
+    EXPECT_EQ(atom.size(), stream.str().size());
+    EXPECT_EQ(tawara::ids::ChapterAtom, tawara::ids::read(stream).first);
+    tawara::ChapterAtom read;
+    read.read(stream);
+    EXPECT_TRUE(atom == read);
+    EXPECT_EQ(tracks, read.tracks());
+    ASSERT_EQ(1, read.children().size());
+    EXPECT_EQ("child", read.children()[0].name());
+    EXPECT_FALSE(read.children()[0].has_end());
+}
+
+
+TEST(ChapterAtom, MissingStart)
+{
+    std::stringstream stream;
+    tawara::UIntElement uid(tawara::ids::ChapterUID, 1);
+    tawara::vint::write(uid.size(), stream);
+    uid.write(stream);
+    tawara::ChapterAtom atom;
+    EXPECT_THROW(atom.read(stream), tawara::MissingChild);
+}
+
+
+TEST(Chapters, WriteRead)
+{
+    tawara::Chapters chapters;
+    std::stringstream stream;
+    EXPECT_THROW(chapters.write(stream), tawara::EmptyChaptersElement);
+    tawara::EditionEntry edition;
+    EXPECT_THROW(edition.write(stream), tawara::EmptyEditionEntry);
+
+    chapters = make_chapters();
+    chapters[0].ordered(true);
+    stream.str(std::string());
+    EXPECT_EQ(chapters.size(), chapters.write(stream));
+    EXPECT_EQ(chapters.size(), stream.str().size());
+    EXPECT_EQ(tawara::ids::Chapters, tawara::ids::read(stream).first);
+    tawara::Chapters read;
+    read.read(stream);
+    EXPECT_TRUE(chapters == read);
+    ASSERT_EQ(1, read.count());
+    EXPECT_EQ(7, read[0].uid());
+    EXPECT_TRUE(read[0].ordered());
+    EXPECT_FALSE(read[0].default_edition());
+    EXPECT_EQ(5, read[0].atoms().size());
+}
+
+
+TEST(ChapterIndex, Lookup)
+{
+    tawara::ChapterIndex index(make_chapters());
+    EXPECT_EQ(6, index.count());
+    EXPECT_EQ(9 * sec, index.begin()[3].start);
+
+    ASSERT_TRUE(index.find_name("Warehouse"));
+    EXPECT_EQ(4, index.find_name("Warehouse")->uid);
+    EXPECT_EQ(7, index.find_name("Warehouse")->edition_uid);
+    ASSERT_TRUE(index.find_name("panne"));
+    EXPECT_EQ(10, index.find_name("panne")->uid);
+    EXPECT_EQ("fault", index.find_name("panne")->name);
+    EXPECT_FALSE(index.find_name("Garden"));
+    ASSERT_TRUE(index.find_uid(2));
+    EXPECT_EQ("Hallway", index.find_uid(2)->name);
+    EXPECT_FALSE(index.find_uid(99));
+
+    EXPECT_EQ(1, index.find_time(0)->uid);
+    EXPECT_EQ(2, index.find_time(5 * sec)->uid);
+    EXPECT_EQ(3, index.find_time(8 * sec)->uid);
+    // The nested chapter covers its range, then its parent again
+    EXPECT_EQ(10, index.find_time(9 * sec)->uid);
+    EXPECT_EQ(3, index.find_time(10 * sec)->uid);
+    EXPECT_EQ(5, index.find_time(25 * sec - 1)->uid);
+    EXPECT_FALSE(index.find_time(25 * sec));
+    EXPECT_FALSE(index.begin()->has_cluster);
+}
+
+
+TEST(ChapterIndex, Empty)
+{
+    tawara::ChapterIndex index;
+    EXPECT_TRUE(index.empty());
+    EXPECT_FALSE(index.find_name("Office"));
+    EXPECT_FALSE(index.find_time(0));
+}
+
+
+// Writes a document with a cluster every 2 seconds up to 24 seconds, cues
+// for each cluster and, optionally, the example chapters.
+class ChapteredDocument : public test_utils::TestDocument
+{
+    public:
+        ChapteredDocument(bool with_chapters=true)
+        {
+            track_count = 1;
+            // Timecodes are in milliseconds
+            cluster_count = 13;
+            cluster_step = 2000;
+            cluster_blocks = 1;
+            cues = true;
+            if (with_chapters)
+            {
+                head.push_back(test_utils::ElPtr(
+                            new tawara::Chapters(make_chapters())));
+            }
+        }
+
+    protected:
+        tawara::BlockElement::Ptr make_block(unsigned int, unsigned int)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, 0));
+            b->push_back(test_utils::make_blob(5));
+            return b;
+        }
+};
+
+
+TEST(ChapterIndex, ClusterPositions)
+{
+    std::stringstream stream;
+    ChapteredDocument().write(stream);
+
+    stream.seekg(0);
+    tawara::read_tawara_header(stream);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(stream).first);
+    tawara::Segment s;
+    s.read(stream);
+    std::streampos pos(stream.tellg());
+    tawara::ChapterIndex index(stream, s);
+    EXPECT_EQ(pos, stream.tellg());
+    ASSERT_EQ(6, index.count());
+
+    // Each chapter starts in the cluster of the last cue at or before it
+    uint64_t cluster_starts[] = {0, 4000, 6000, 8000, 14000, 20000};
+    for (int ii(0); ii < 6; ++ii)
+    {
+        tawara::ChapterIndex::Entry const& entry(index.begin()[ii]);
+        ASSERT_TRUE(entry.has_cluster);
+        tawara::Segment::FileClusterIterator cluster(&s, stream,
+                s.to_stream_offset(entry.cluster_pos));
+        EXPECT_EQ(cluster_starts[ii], cluster->timecode());
+    }
+    tawara::Segment::FileClusterIterator fault(&s, stream,
+            s.to_stream_offset(index.find_name("fault")->cluster_pos));
+    EXPECT_EQ(8000, fault->timecode());
+}
+
+
+TEST(ChapterIndex, NoChapters)
+{
+    std::stringstream stream;
+    ChapteredDocument(false).write(stream);
+
+    stream.seekg(0);
+    tawara::read_tawara_header(stream);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(stream).first);
+    tawara::Segment s;
+    s.read(stream);
+    tawara::ChapterIndex index(stream, s);
+    EXPECT_TRUE(index.empty());
+}
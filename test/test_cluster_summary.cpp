@@ -0,0 +1,370 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <gtest/gtest.h>
+#include <tawara/binary_element.h>
+#include <tawara/cluster_summary.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/simple_block.h>
+#include <tawara/vint.h>
+
+#include "test_utils.h"
+
+
+///////////////////////////////////////////////////////////////////////////////
+// TrackSummary tests
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(TrackSummary, Create)
+{
+    tawara::TrackSummary s1;
+    EXPECT_EQ(tawara::ids::SummaryTrack, s1.id());
+    EXPECT_EQ(1, s1.track_number());
+    EXPECT_EQ(0, s1.block_count());
+    EXPECT_EQ(0, s1.min_timecode());
+    EXPECT_EQ(0, s1.max_timecode());
+
+    tawara::TrackSummary s2(42);
+    EXPECT_EQ(42, s2.track_number());
+    EXPECT_THROW(tawara::TrackSummary(0), tawara::ValueOutOfRange);
+}
+
+
+TEST(TrackSummary, TrackNumber)
+{
+    tawara::TrackSummary s;
+    s.track_number(21);
+    EXPECT_EQ(21, s.track_number());
+    EXPECT_THROW(s.track_number(0), tawara::ValueOutOfRange);
+}
+
+
+TEST(TrackSummary, Add)
+{
+    tawara::TrackSummary s;
+    EXPECT_FALSE(s.overlaps(-32768, 32767));
+    s.add(5);
+    EXPECT_EQ(1, s.block_count());
+    EXPECT_EQ(5, s.min_timecode());
+    EXPECT_EQ(5, s.max_timecode());
+    s.add(-10);
+    s.add(20);
+    s.add(0);
+    EXPECT_EQ(4, s.block_count());
+    EXPECT_EQ(-10, s.min_timecode());
+    EXPECT_EQ(20, s.max_timecode());
+
+    EXPECT_TRUE(s.overlaps(-10, -10));
+    EXPECT_TRUE(s.overlaps(20, 100));
+    EXPECT_TRUE(s.overlaps(-100, 100));
+    EXPECT_FALSE(s.overlaps(21, 100));
+    EXPECT_FALSE(s.overlaps(-100, -11));
+}
+
+
+TEST(TrackSummary, Write)
+{
+    std::ostringstream output;
+    std::stringstream expected;
+    tawara::UIntElement tn(tawara::ids::SummaryTrackNumber, 3);
+    tawara::UIntElement bc(tawara::ids::SummaryBlockCount, 2);
+    tawara::IntElement min_tc(tawara::ids::SummaryMinTimecode, -4);
+    tawara::IntElement max_tc(tawara::ids::SummaryMaxTimecode, 300);
+
+    tawara::TrackSummary s(3);
+    s.add(300);
+    s.add(-4);
+    std::streamsize body_size(tn.size() + bc.size() + min_tc.size() +
+            max_tc.size());
+    tawara::ids::write(tawara::ids::SummaryTrack, expected);
+    tawara::vint::write(body_size, expected);
+    tn.write(expected);
+    bc.write(expected);
+    min_tc.write(expected);
+    max_tc.write(expected);
+    EXPECT_EQ(tawara::ids::size(tawara::ids::SummaryTrack) +
+            tawara::vint::size(body_size) + body_size, s.write(output));
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, output.str(),
+            expected.str());
+}
+
+
+TEST(TrackSummary, Read)
+{
+    std::stringstream input;
+    tawara::UIntElement tn(tawara::ids::SummaryTrackNumber, 3);
+    tawara::UIntElement bc(tawara::ids::SummaryBlockCount, 2);
+    tawara::IntElement min_tc(tawara::ids::SummaryMinTimecode, -4);
+    tawara::IntElement max_tc(tawara::ids::SummaryMaxTimecode, 300);
+
+    tawara::TrackSummary s;
+    std::streamsize body_size(tn.size() + bc.size() + min_tc.size() +
+            max_tc.size());
+    tawara::vint::write(body_size, input);
+    tn.write(input);
+    bc.write(input);
+    min_tc.write(input);
+    max_tc.write(input);
+    EXPECT_EQ(tawara::vint::size(body_size) + body_size, s.read(input));
+    EXPECT_EQ(3, s.track_number());
+    EXPECT_EQ(2, s.block_count());
+    EXPECT_EQ(-4, s.min_timecode());
+    EXPECT_EQ(300, s.max_timecode());
+
+    // Body size value wrong (too small)
+    input.str(std::string());
+    tawara::vint::write(2, input);
+    tn.write(input);
+    EXPECT_THROW(s.read(input), tawara::BadBodySize);
+    // Invalid child
+    input.str(std::string());
+    tawara::UIntElement ue(tawara::ids::EBML, 0xFFFF);
+    tawara::vint::write(ue.size(), input);
+    ue.write(input);
+    EXPECT_THROW(s.read(input), tawara::InvalidChildID);
+    // No track number
+    input.str(std::string());
+    tawara::vint::write(bc.size(), input);
+    bc.write(input);
+    EXPECT_THROW(s.read(input), tawara::MissingChild);
+    // Zero track number
+    input.str(std::string());
+    tawara::UIntElement zero(tawara::ids::SummaryTrackNumber, 0);
+    tawara::vint::write(zero.size(), input);
+    zero.write(input);
+    EXPECT_THROW(s.read(input), tawara::ValueOutOfRange);
+}
+
+
+///////////////////////////////////////////////////////////////////////////////
+// ClusterSummary tests
+///////////////////////////////////////////////////////////////////////////////
+
+TEST(ClusterSummary, Create)
+{
+    tawara::ClusterSummary s;
+    EXPECT_EQ(tawara::ids::ClusterSummary, s.id());
+    EXPECT_TRUE(s.empty());
+    EXPECT_EQ(0, s.count());
+}
+
+
+TEST(ClusterSummary, Add)
+{
+    tawara::ClusterSummary s;
+    s.add(tawara::SimpleBlock(2, 10));
+    s.add(tawara::SimpleBlock(5, -3));
+    s.add(tawara::SimpleBlock(2, 40));
+    EXPECT_FALSE(s.empty());
+    EXPECT_EQ(2, s.count());
+    ASSERT_TRUE(s.find(2) != s.end());
+    EXPECT_EQ(2, s.find(2)->second.block_count());
+    EXPECT_EQ(10, s.find(2)->second.min_timecode());
+    EXPECT_EQ(40, s.find(2)->second.max_timecode());
+    EXPECT_EQ(1, s.find(5)->second.block_count());
+    EXPECT_TRUE(s.find(1) == s.end());
+
+    EXPECT_TRUE(s.has_track(2));
+    EXPECT_TRUE(s.has_track(5));
+    EXPECT_FALSE(s.has_track(1));
+    EXPECT_FALSE(s.has_track(42));
+
+    s.clear();
+    EXPECT_TRUE(s.empty());
+    EXPECT_FALSE(s.has_track(2));
+}
+
+
+TEST(ClusterSummary, MayContain)
+{
+    tawara::ClusterSummary s;
+    std::set<uint64_t> tracks;
+    EXPECT_FALSE(s.may_contain(tracks, -32768, 32767));
+
+    s.add(tawara::SimpleBlock(2, 10));
+    s.add(tawara::SimpleBlock(2, 40));
+    s.add(tawara::SimpleBlock(5, 100));
+    EXPECT_TRUE(s.may_contain(tracks, -32768, 32767));
+    EXPECT_TRUE(s.may_contain(tracks, 41, 100));
+    EXPECT_FALSE(s.may_contain(tracks, 41, 99));
+
+    tracks.insert(1);
+    EXPECT_FALSE(s.may_contain(tracks, -32768, 32767));
+    tracks.insert(2);
+    EXPECT_TRUE(s.may_contain(tracks, -32768, 32767));
+    EXPECT_TRUE(s.may_contain(tracks, 0, 10));
+    EXPECT_FALSE(s.may_contain(tracks, 41, 200));
+    tracks.insert(5);
+    EXPECT_TRUE(s.may_contain(tracks, 41, 200));
+}
+
+
+TEST(ClusterSummary, OnlyContains)
+{
+    tawara::ClusterSummary s;
+    std::set<uint64_t> tracks;
+    EXPECT_FALSE(s.only_contains(tracks, -32768, 32767));
+
+    s.add(tawara::SimpleBlock(2, 10));
+    s.add(tawara::SimpleBlock(2, 40));
+    s.add(tawara::SimpleBlock(5, 100));
+    EXPECT_TRUE(s.find(2)->second.within(10, 40));
+    EXPECT_FALSE(s.find(2)->second.within(11, 40));
+    EXPECT_TRUE(s.only_contains(tracks, -32768, 32767));
+    EXPECT_TRUE(s.only_contains(tracks, 10, 100));
+    EXPECT_FALSE(s.only_contains(tracks, 10, 99));
+    EXPECT_FALSE(s.only_contains(tracks, 11, 100));
+
+    tracks.insert(2);
+    EXPECT_FALSE(s.only_contains(tracks, -32768, 32767));
+    tracks.insert(5);
+    EXPECT_TRUE(s.only_contains(tracks, -32768, 32767));
+}
+
+
+TEST(ClusterSummary, Write)
+{
+    std::ostringstream output;
+    std::stringstream expected;
+
+    // Empty
+    tawara::ClusterSummary s;
+    tawara::ids::write(tawara::ids::ClusterSummary, expected);
+    tawara::vint::write(0, expected);
+    EXPECT_EQ(tawara::ids::size(tawara::ids::ClusterSummary) + 1,
+            s.write(output));
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, output.str(),
+            expected.str());
+
+    // Tracks 1 and 10 give a two-byte map
+    output.str(std::string());
+    expected.str(std::string());
+    s.add(tawara::SimpleBlock(10, 7));
+    s.add(tawara::SimpleBlock(1, 3));
+    std::vector<char> map;
+    map.push_back(0x80);
+    map.push_back(0x40);
+    tawara::BinaryElement map_el(tawara::ids::SummaryTrackMap, map);
+    tawara::TrackSummary t1(1);
+    t1.add(3);
+    tawara::TrackSummary t10(10);
+    t10.add(7);
+    std::streamsize body_size(map_el.size() + t1.size() + t10.size());
+    tawara::ids::write(tawara::ids::ClusterSummary, expected);
+    tawara::vint::write(body_size, expected);
+    map_el.write(expected);
+    t1.write(expected);
+    t10.write(expected);
+    EXPECT_EQ(tawara::ids::size(tawara::ids::ClusterSummary) +
+            tawara::vint::size(body_size) + body_size, s.write(output));
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, output.str(),
+            expected.str());
+
+    // No map if the track number is too high
+    output.str(std::string());
+    expected.str(std::string());
+    s.clear();
+    uint64_t high(tawara::ClusterSummary::max_map_track() + 1);
+    s.add(tawara::SimpleBlock(high, 0));
+    tawara::TrackSummary th(high);
+    th.add(0);
+    tawara::ids::write(tawara::ids::ClusterSummary, expected);
+    tawara::vint::write(th.size(), expected);
+    th.write(expected);
+    EXPECT_EQ(tawara::ids::size(tawara::ids::ClusterSummary) +
+            tawara::vint::size(th.size()) + th.size(), s.write(output));
+    EXPECT_PRED_FORMAT2(test_utils::std_buffers_eq, output.str(),
+            expected.str());
+}
+
+
+TEST(ClusterSummary, Read)
+{
+    std::stringstream input;
+    std::vector<char> map;
+    map.push_back(0x40);
+    map.push_back(0x01);
+    tawara::BinaryElement map_el(tawara::ids::SummaryTrackMap, map);
+    tawara::TrackSummary t2(2);
+    t2.add(-5);
+    t2.add(5);
+
+    // Track 16 is only present in the map
+    tawara::ClusterSummary s;
+    std::streamsize body_size(map_el.size() + t2.size());
+    tawara::vint::write(body_size, input);
+    map_el.write(input);
+    t2.write(input);
+    EXPECT_EQ(tawara::vint::size(body_size) + body_size, s.read(input));
+    EXPECT_EQ(1, s.count());
+    EXPECT_TRUE(t2 == s.find(2)->second);
+    EXPECT_TRUE(s.has_track(2));
+    EXPECT_TRUE(s.has_track(16));
+    EXPECT_FALSE(s.has_track(15));
+    EXPECT_FALSE(s.has_track(17));
+    std::set<uint64_t> tracks;
+    EXPECT_TRUE(s.may_contain(tracks, 100, 200));
+    tracks.insert(2);
+    EXPECT_FALSE(s.may_contain(tracks, 100, 200));
+    tracks.insert(16);
+    EXPECT_TRUE(s.may_contain(tracks, 100, 200));
+    EXPECT_FALSE(s.only_contains(tracks, -32768, 32767));
+
+    // Round trip
+    input.str(std::string());
+    tawara::ClusterSummary w;
+    w.add(tawara::SimpleBlock(3, 1));
+    w.add(tawara::SimpleBlock(7, 2));
+    w.write(input);
+    input.seekg(tawara::ids::size(tawara::ids::ClusterSummary));
+    s.read(input);
+    EXPECT_TRUE(w == s);
+
+    // Body size value wrong (too small)
+    input.str(std::string());
+    tawara::vint::write(2, input);
+    t2.write(input);
+    EXPECT_THROW(s.read(input), tawara::BadBodySize);
+    // Invalid child
+    input.str(std::string());
+    tawara::UIntElement ue(tawara::ids::EBML, 0xFFFF);
+    tawara::vint::write(ue.size(), input);
+    ue.write(input);
+    EXPECT_THROW(s.read(input), tawara::InvalidChildID);
+}
+
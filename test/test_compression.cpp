@@ -0,0 +1,585 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/foreach.hpp>
+#include <cstdio>
+#include <cstdlib>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tawara/block_group.h>
+#include <tawara/compression.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/memory_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+#include <tawara/vint.h>
+
+#include "test_utils.h"
+
+
+// Makes data that compresses well, with some variation.
+std::vector<char> compressible_data(size_t size)
+{
+    std::string const text("lidar range 12.5 intensity 200 ");
+    std::vector<char> result(size);
+    for (size_t ii(0); ii < size; ++ii)
+    {
+        result[ii] = text[ii % text.size()] + (ii % 97 == 0 ? 1 : 0);
+    }
+    return result;
+}
+
+
+// Makes data that does not compress.
+std::vector<char> random_data(size_t size)
+{
+    std::vector<char> result(size);
+    std::srand(42);
+    for (size_t ii(0); ii < size; ++ii)
+    {
+        result[ii] = std::rand();
+    }
+    return result;
+}
+
+
+void check_round_trip(tawara::Compression algorithm,
+        std::vector<char> const& data)
+{
+    std::vector<char> compressed;
+    tawara::compress(algorithm, data.empty() ? 0 : &data[0], data.size(),
+            compressed);
+    std::vector<char> result(data.size() + 1);
+    tawara::decompress(algorithm, &compressed[0], compressed.size(),
+            &result[0], data.size());
+    result.resize(data.size());
+    EXPECT_TRUE(data == result);
+}
+
+
+TEST(Compression, Available)
+{
+    EXPECT_TRUE(tawara::compression_available(tawara::COMPRESSION_NONE));
+    EXPECT_TRUE(tawara::compression_available(tawara::COMPRESSION_LZ4));
+}
+
+
+TEST(Compression, Algorithms)
+{
+    EXPECT_EQ(4, tawara::compression_to_algo(tawara::COMPRESSION_LZ4));
+    EXPECT_EQ(5, tawara::compression_to_algo(tawara::COMPRESSION_ZSTD));
+    EXPECT_THROW(tawara::compression_to_algo(tawara::COMPRESSION_NONE),
+            tawara::UnsupportedCompression);
+    EXPECT_EQ(tawara::COMPRESSION_LZ4, tawara::algo_to_compression(4));
+    EXPECT_EQ(tawara::COMPRESSION_ZSTD, tawara::algo_to_compression(5));
+    // zlib
+    EXPECT_THROW(tawara::algo_to_compression(0),
+            tawara::UnsupportedCompression);
+}
+
+
+TEST(Compression, LZ4)
+{
+    for (size_t size(0); size < 40; ++size)
+    {
+        check_round_trip(tawara::COMPRESSION_LZ4, compressible_data(size));
+        check_round_trip(tawara::COMPRESSION_LZ4, random_data(size));
+    }
+    check_round_trip(tawara::COMPRESSION_LZ4, compressible_data(300000));
+    check_round_trip(tawara::COMPRESSION_LZ4, random_data(300000));
+    // Long runs need extended match lengths
+    check_round_trip(tawara::COMPRESSION_LZ4, std::vector<char>(5000, 'a'));
+
+    std::vector<char> data(compressible_data(10000));
+    std::vector<char> compressed;
+    tawara::compress(tawara::COMPRESSION_LZ4, &data[0], data.size(),
+            compressed);
+    EXPECT_LT(compressed.size(), data.size() / 3);
+}
+
+
+TEST(Compression, Zstd)
+{
+    if (!tawara::compression_available(tawara::COMPRESSION_ZSTD))
+    {
+        std::vector<char> compressed;
+        EXPECT_THROW(tawara::compress(tawara::COMPRESSION_ZSTD, "a", 1,
+                    compressed), tawara::UnsupportedCompression);
+        return;
+    }
+    check_round_trip(tawara::COMPRESSION_ZSTD, compressible_data(300000));
+    check_round_trip(tawara::COMPRESSION_ZSTD, random_data(1000));
+}
+
+
+TEST(Compression, BadData)
+{
+    std::vector<char> data(compressible_data(1000));
+    std::vector<char> compressed;
+    tawara::compress(tawara::COMPRESSION_LZ4, &data[0], data.size(),
+            compressed);
+    std::vector<char> result(data.size());
+    // Truncated
+    EXPECT_THROW(tawara::decompress(tawara::COMPRESSION_LZ4, &compressed[0],
+                compressed.size() / 2, &result[0], result.size()),
+            tawara::BadCompressedData);
+    // Wrong size
+    EXPECT_THROW(tawara::decompress(tawara::COMPRESSION_LZ4, &compressed[0],
+                compressed.size(), &result[0], result.size() - 1),
+            tawara::BadCompressedData);
+    // Match before the start of the data
+    char bad[] = {0x10, 'a', 0x05, 0x00, 0x00};
+    EXPECT_THROW(tawara::decompress(tawara::COMPRESSION_LZ4, bad,
+                sizeof(bad), &result[0], 10), tawara::BadCompressedData);
+}
+
+
+TEST(Compression, SimpleBlock)
+{
+    tawara::SimpleBlock b(1, 42, tawara::Block::LACING_EBML);
+    b.push_back(tawara::Block::value_type(new std::vector<char>(
+                    compressible_data(2000))));
+    b.push_back(tawara::Block::value_type(new std::vector<char>(
+                    compressible_data(3000))));
+    b.push_back(tawara::Block::value_type(new std::vector<char>(
+                    compressible_data(1000))));
+    b.keyframe(true);
+    std::streamsize uncompressed(b.size());
+    b.compression(tawara::COMPRESSION_LZ4);
+    std::streamsize compressed(b.size());
+    EXPECT_LT(compressed, uncompressed / 3);
+
+    std::stringstream stream;
+    EXPECT_EQ(compressed, b.write(stream));
+    EXPECT_EQ(compressed, stream.str().size());
+
+    tawara::SimpleBlock r(0, 0);
+    stream.seekg(tawara::ids::size(tawara::ids::SimpleBlock));
+    EXPECT_EQ(compressed - tawara::ids::size(tawara::ids::SimpleBlock),
+            r.read(stream));
+    EXPECT_TRUE(b == r);
+    EXPECT_EQ(tawara::COMPRESSION_LZ4, r.compression());
+    EXPECT_EQ(tawara::Block::LACING_EBML, r.lacing());
+    EXPECT_TRUE(r.keyframe());
+    EXPECT_EQ(3, r.count());
+
+    // Changing a frame through the block is noticed
+    (*b[1])[10] = 'X';
+    stream.str(std::string());
+    b.write(stream);
+    stream.seekg(tawara::ids::size(tawara::ids::SimpleBlock));
+    r.read(stream);
+    EXPECT_EQ('X', (*r[1])[10]);
+}
+
+
+TEST(Compression, Incompressible)
+{
+    tawara::SimpleBlock b(1, 42);
+    b.push_back(tawara::Block::value_type(new std::vector<char>(
+                    random_data(500))));
+    std::streamsize uncompressed(b.size());
+    b.compression(tawara::COMPRESSION_LZ4);
+    EXPECT_EQ(uncompressed, b.size());
+
+    std::stringstream stream;
+    b.write(stream);
+    tawara::SimpleBlock r(0, 0);
+    stream.seekg(tawara::ids::size(tawara::ids::SimpleBlock));
+    r.read(stream);
+    EXPECT_TRUE(b == r);
+    EXPECT_EQ(tawara::COMPRESSION_NONE, r.compression());
+}
+
+
+TEST(Compression, BlockGroup)
+{
+    tawara::BlockGroup b(2, -10, tawara::Block::LACING_FIXED);
+    b.push_back(tawara::Block::value_type(new std::vector<char>(
+                    compressible_data(800))));
+    b.push_back(tawara::Block::value_type(new std::vector<char>(
+                    compressible_data(800))));
+    b.compression(tawara::COMPRESSION_LZ4);
+
+    std::stringstream stream;
+    EXPECT_EQ(b.size(), b.write(stream));
+    tawara::BlockGroup r(0, 0);
+    stream.seekg(tawara::ids::size(tawara::ids::BlockGroup));
+    r.read(stream);
+    EXPECT_TRUE(b == r);
+    EXPECT_EQ(tawara::COMPRESSION_LZ4, r.compression());
+}
+
+
+TEST(Compression, CorruptBlock)
+{
+    tawara::SimpleBlock b(1, 42);
+    b.push_back(tawara::Block::value_type(new std::vector<char>(
+                    compressible_data(2000))));
+    b.compression(tawara::COMPRESSION_LZ4);
+    std::stringstream stream;
+    b.write(stream);
+    // Remove the end of the compressed data
+    stream.seekg(tawara::ids::size(tawara::ids::SimpleBlock));
+    tawara::vint::ReadResult body_size(tawara::vint::read(stream));
+    std::string body(stream.str().substr(stream.tellg()));
+    std::stringstream truncated;
+    tawara::vint::write(body_size.first - 5, truncated, body_size.second);
+    truncated << body.substr(0, body.size() - 5);
+    tawara::SimpleBlock r(0, 0);
+    EXPECT_THROW(r.read(truncated), tawara::BadCompressedData);
+}
+
+
+TEST(Compression, HugeDecompressedSize)
+{
+    // A decompressed size that the compressed data could not produce
+    std::stringstream body;
+    tawara::vint::write(1, body);
+    body.put(0);
+    body.put(0);
+    body.put(0x08); // Flags - compressed
+    body.put(tawara::compression_to_algo(tawara::COMPRESSION_LZ4));
+    tawara::vint::write(1ULL << 40, body);
+    body << "0123456789";
+    std::stringstream stream;
+    tawara::vint::write(body.str().size(), stream);
+    stream << body.str();
+    stream.seekg(0);
+    tawara::SimpleBlock r(0, 0);
+    EXPECT_THROW(r.read(stream), tawara::BadCompressedData);
+    EXPECT_EQ(10, tawara::max_decompressed_size(tawara::COMPRESSION_NONE,
+                10));
+}
+
+
+TEST(Compression, TrackEntry)
+{
+    tawara::TrackEntry e(1, 1, "LOG");
+    EXPECT_EQ(tawara::COMPRESSION_NONE, e.compression());
+    std::streamsize plain_size(e.size());
+    e.compression(tawara::COMPRESSION_LZ4);
+    // ContentEncodings, ContentEncoding, ContentCompression, ContentCompAlgo
+    EXPECT_EQ(plain_size + 3 + 3 + 3 + 4, e.size());
+
+    std::stringstream stream;
+    EXPECT_EQ(e.size(), e.write(stream));
+    tawara::TrackEntry r(2, 2, "OTHER");
+    stream.seekg(tawara::ids::size(tawara::ids::TrackEntry));
+    r.read(stream);
+    EXPECT_EQ(tawara::COMPRESSION_LZ4, r.compression());
+    EXPECT_TRUE(e == r);
+
+    // Reading a track without compression clears it
+    e.compression(tawara::COMPRESSION_NONE);
+    stream.str(std::string());
+    e.write(stream);
+    stream.seekg(tawara::ids::size(tawara::ids::TrackEntry));
+    r.read(stream);
+    EXPECT_EQ(tawara::COMPRESSION_NONE, r.compression());
+}
+
+
+// Makes short status messages like those of a robot's diagnostics.
+std::vector<std::vector<char> > status_messages(size_t count)
+{
+    char const* modes[] = {"AUTO", "MANUAL", "IDLE"};
+    std::vector<std::vector<char> > result;
+    std::srand(7);
+    for (size_t ii(0); ii < count; ++ii)
+    {
+        char buffer[128];
+        int length(std::sprintf(buffer,
+                    "seq=%u mode=%s motors=OK lidar=OK gps=FIX batt=%d%%",
+                    static_cast<unsigned int>(ii), modes[std::rand() % 3],
+                    60 + std::rand() % 40));
+        result.push_back(std::vector<char>(buffer, buffer + length));
+    }
+    return result;
+}
+
+
+TEST(Compression, TrainDictionary)
+{
+    std::vector<std::vector<char> > samples(status_messages(2000));
+    std::vector<char> data(tawara::train_dictionary(samples, 1024));
+    EXPECT_FALSE(data.empty());
+    EXPECT_LE(data.size(), 1024);
+    EXPECT_TRUE(tawara::train_dictionary(samples, 0).empty());
+    EXPECT_TRUE(tawara::train_dictionary(
+                std::vector<std::vector<char> >(), 1024).empty());
+
+    // Compare the frames compressed individually with and without the
+    // dictionary
+    tawara::CompressionDictionary dict(data);
+    std::vector<std::vector<char> > frames(status_messages(500));
+    size_t raw(0), plain(0), with_dict(0);
+    std::vector<char> compressed;
+    for (size_t ii(0); ii < frames.size(); ++ii)
+    {
+        std::vector<char> const& frame(frames[ii]);
+        raw += frame.size();
+        tawara::compress(tawara::COMPRESSION_LZ4, &frame[0], frame.size(),
+                compressed);
+        plain += std::min(compressed.size(), frame.size());
+        dict.compress(tawara::COMPRESSION_LZ4, &frame[0], frame.size(),
+                compressed);
+        with_dict += compressed.size();
+        std::vector<char> result(frame.size());
+        dict.decompress(tawara::COMPRESSION_LZ4, &compressed[0],
+                compressed.size(), &result[0], result.size());
+        EXPECT_TRUE(frame == result);
+    }
+    EXPECT_EQ(raw, plain);
+    EXPECT_LT(with_dict * 2, raw);
+}
+
+
+TEST(Compression, Dictionary)
+{
+    std::vector<char> data(compressible_data(70000));
+    data[500] = 'Q';
+    tawara::CompressionDictionary dict(data);
+    EXPECT_EQ(data, dict.data());
+    EXPECT_EQ(tawara::CompressionDictionary(data).id(), dict.id());
+
+    // Data that matches the end of the dictionary, the start of which is too
+    // far back to be used
+    for (size_t size(1); size < 3000; size += 97)
+    {
+        std::vector<char> frame(compressible_data(size));
+        std::vector<char> compressed;
+        dict.compress(tawara::COMPRESSION_LZ4, &frame[0], frame.size(),
+                compressed);
+        if (size > 100)
+        {
+            EXPECT_LT(compressed.size(), size / 4);
+        }
+        std::vector<char> result(frame.size());
+        dict.decompress(tawara::COMPRESSION_LZ4, &compressed[0],
+                compressed.size(), &result[0], result.size());
+        EXPECT_TRUE(frame == result);
+    }
+    std::vector<char> frame(random_data(1000));
+    std::vector<char> compressed;
+    dict.compress(tawara::COMPRESSION_LZ4, &frame[0], frame.size(),
+            compressed);
+    std::vector<char> result(frame.size());
+    dict.decompress(tawara::COMPRESSION_LZ4, &compressed[0],
+            compressed.size(), &result[0], result.size());
+    EXPECT_TRUE(frame == result);
+
+    // The same data does not decompress without the dictionary
+    frame = compressible_data(200);
+    dict.compress(tawara::COMPRESSION_LZ4, &frame[0], frame.size(),
+            compressed);
+    EXPECT_THROW(tawara::decompress(tawara::COMPRESSION_LZ4, &compressed[0],
+                compressed.size(), &result[0], frame.size()),
+            tawara::BadCompressedData);
+}
+
+
+TEST(Compression, DictionaryReuse)
+{
+    std::vector<std::vector<char> > samples(status_messages(200));
+    tawara::CompressionDictionary dict(tawara::train_dictionary(samples));
+    tawara::Compression const algorithms[] = {tawara::COMPRESSION_LZ4,
+        tawara::COMPRESSION_ZSTD};
+    BOOST_FOREACH(tawara::Compression algorithm, algorithms)
+    {
+        if (!tawara::compression_available(algorithm))
+        {
+            continue;
+        }
+        // The kept state must not carry anything from one frame to the
+        // next
+        std::vector<char> first;
+        dict.compress(algorithm, &samples[0][0], samples[0].size(), first);
+        BOOST_FOREACH(std::vector<char> const& sample, samples)
+        {
+            std::vector<char> compressed;
+            dict.compress(algorithm, &sample[0], sample.size(), compressed);
+            std::vector<char> result(sample.size());
+            dict.decompress(algorithm, &compressed[0], compressed.size(),
+                    &result[0], result.size());
+            EXPECT_TRUE(sample == result);
+        }
+        std::vector<char> again;
+        dict.compress(algorithm, &samples[0][0], samples[0].size(), again);
+        EXPECT_TRUE(first == again);
+    }
+}
+
+
+TEST(Compression, DictionaryBlocks)
+{
+    std::vector<std::vector<char> > samples(status_messages(1000));
+    tawara::CompressionDictionary::Ptr dict(new tawara::CompressionDictionary(
+                tawara::train_dictionary(samples)));
+    boost::shared_ptr<tawara::DictionaryMap> dicts(new tawara::DictionaryMap);
+    (*dicts)[1] = dict;
+
+    tawara::MemoryCluster c(100);
+    std::vector<tawara::BlockElement::Ptr> blocks;
+    for (int ii(0); ii < 10; ++ii)
+    {
+        tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1 + ii % 2, ii));
+        b->push_back(tawara::Block::value_type(
+                    new std::vector<char>(samples[ii])));
+        b->compression(tawara::COMPRESSION_LZ4);
+        std::streamsize plain_size(b->size());
+        b->dictionaries(dicts);
+        if (ii % 2 == 0)
+        {
+            EXPECT_LT(b->size(), plain_size);
+        }
+        else
+        {
+            // No dictionary for the second track
+            EXPECT_EQ(plain_size, b->size());
+        }
+        c.push_back(b);
+        blocks.push_back(b);
+    }
+    std::stringstream stream;
+    c.write(stream);
+    c.finalise(stream);
+
+    tawara::MemoryCluster r;
+    r.dictionaries(dicts);
+    stream.seekg(tawara::ids::size(tawara::ids::Cluster));
+    r.read(stream);
+    ASSERT_EQ(10, r.count());
+    tawara::MemoryCluster::Iterator block(r.begin());
+    for (int ii(0); ii < 10; ++ii, ++block)
+    {
+        EXPECT_TRUE(*boost::static_pointer_cast<tawara::SimpleBlock>(
+                    blocks[ii]) ==
+                *boost::static_pointer_cast<tawara::SimpleBlock>(*block));
+    }
+
+    // Without the dictionary, the blocks cannot be read
+    tawara::MemoryCluster missing;
+    stream.seekg(tawara::ids::size(tawara::ids::Cluster));
+    EXPECT_THROW(missing.read(stream), tawara::MissingDictionary);
+}
+
+
+TEST(Compression, TrackDictionary)
+{
+    std::vector<char> data(tawara::train_dictionary(status_messages(1000)));
+    tawara::TrackEntry::Ptr e(new tawara::TrackEntry(1, 1, "STATUS"));
+    e->dictionary(tawara::CompressionDictionary::Ptr(
+                new tawara::CompressionDictionary(data)));
+    // The dictionary is only stored for compressed tracks
+    tawara::TrackEntry plain(1, 1, "STATUS");
+    EXPECT_EQ(plain.size(), e->size());
+    e->compression(tawara::COMPRESSION_LZ4);
+    std::streamsize size(e->size());
+
+    std::stringstream stream;
+    EXPECT_EQ(size, e->write(stream));
+    tawara::TrackEntry r(2, 2, "OTHER");
+    stream.seekg(tawara::ids::size(tawara::ids::TrackEntry));
+    r.read(stream);
+    ASSERT_TRUE(r.dictionary());
+    EXPECT_EQ(data, r.dictionary()->data());
+    EXPECT_TRUE(*e == r);
+
+    tawara::Tracks tracks;
+    tracks.insert(e);
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(2, 2,
+                    "OTHER")));
+    tawara::DictionaryMapPtr dicts(tracks.dictionaries());
+    EXPECT_EQ(1, dicts->size());
+    EXPECT_EQ(e->dictionary(), dicts->find(1)->second);
+}
+
+
+TEST(Compression, SegmentDictionaries)
+{
+    std::vector<std::vector<char> > samples(status_messages(100));
+    tawara::TrackEntry::Ptr e(new tawara::TrackEntry(1, 1, "STATUS"));
+    e->compression(tawara::COMPRESSION_LZ4);
+    e->dictionary(tawara::CompressionDictionary::Ptr(
+                new tawara::CompressionDictionary(
+                    tawara::train_dictionary(samples))));
+    tawara::Tracks tracks;
+    tracks.insert(e);
+
+    std::stringstream stream;
+    tawara::Segment s;
+    s.write(stream);
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+    tawara::FileCluster c;
+    s.index.insert(std::make_pair(c.id(),
+                s.to_segment_offset(stream.tellp())));
+    c.write(stream);
+    for (int ii(0); ii < 10; ++ii)
+    {
+        tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, ii));
+        b->push_back(tawara::Block::value_type(
+                    new std::vector<char>(samples[ii])));
+        b->compression(tawara::COMPRESSION_LZ4);
+        b->dictionaries(tracks.dictionaries());
+        c.push_back(b);
+    }
+    c.finalise(stream);
+    s.finalise(stream);
+
+    // The dictionaries are read from the tracks when the first cluster is
+    // read
+    stream.seekg(tawara::ids::size(tawara::ids::Segment));
+    tawara::Segment r;
+    r.read(stream);
+    int count(0);
+    for (tawara::Segment::FileBlockIterator block(r.blocks_begin_file(stream));
+            block != r.blocks_end_file(stream); ++block, ++count)
+    {
+        EXPECT_TRUE(*(*block)[0] == samples[count]);
+    }
+    EXPECT_EQ(10, count);
+    ASSERT_TRUE(r.dictionaries());
+    EXPECT_EQ(1, r.dictionaries()->size());
+}
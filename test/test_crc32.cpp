@@ -0,0 +1,230 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <cstring>
+#include <sstream>
+#include <tawara/crc32.h>
+#include <tawara/cues.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/memory_cluster.h>
+#include <tawara/segment_info.h>
+#include <tawara/simple_block.h>
+#include <tawara/tracks.h>
+
+#include "test_utils.h"
+
+
+TEST(CRC32, Buffer)
+{
+    char const* check("123456789");
+    EXPECT_EQ(0xCBF43926, tawara::crc32(check, 9));
+    EXPECT_EQ(0, tawara::crc32(check, 0));
+
+    // Chained calculation matches a single calculation, including for
+    // lengths that are not multiples of the slice size
+    char data[300];
+    for (unsigned int ii(0); ii < sizeof(data); ++ii)
+    {
+        data[ii] = static_cast<char>(ii * 7 + 3);
+    }
+    uint32_t whole(tawara::crc32(data, sizeof(data)));
+    for (unsigned int split(0); split < 20; ++split)
+    {
+        EXPECT_EQ(whole, tawara::crc32(data + split, sizeof(data) - split,
+                    tawara::crc32(data, split)));
+    }
+}
+
+
+TEST(CRC32, Stream)
+{
+    std::string data(200000, 'x');
+    for (unsigned int ii(0); ii < data.size(); ++ii)
+    {
+        data[ii] = static_cast<char>(ii % 251);
+    }
+    std::stringstream input(data);
+    EXPECT_EQ(tawara::crc32(data.data(), data.size()),
+            tawara::crc32(input, data.size()));
+
+    input.clear();
+    input.seekg(0);
+    EXPECT_THROW(tawara::crc32(input, data.size() + 1), tawara::ReadError);
+}
+
+
+TEST(CRC32, MasterElementRoundTrip)
+{
+    std::stringstream stream;
+    tawara::SegmentInfo info;
+    info.title("CRC test");
+    info.crc(true);
+    std::streamsize size(info.size());
+    EXPECT_EQ(size, info.write(stream));
+    EXPECT_EQ(size, stream.str().size());
+    // The CRC element is the first child
+    stream.seekg(tawara::ids::size(tawara::ids::Info) + 1);
+    EXPECT_EQ(tawara::ids::CRC32, tawara::ids::read(stream).first);
+
+    tawara::SegmentInfo r;
+    r.verify_crc(true);
+    stream.seekg(tawara::ids::size(tawara::ids::Info));
+    EXPECT_EQ(size - tawara::ids::size(tawara::ids::Info), r.read(stream));
+    EXPECT_TRUE(r.crc());
+    EXPECT_EQ("CRC test", r.title());
+
+    // Without a CRC, the flag is cleared on reading
+    stream.str(std::string());
+    info.crc(false);
+    info.write(stream);
+    stream.seekg(tawara::ids::size(tawara::ids::Info));
+    r.read(stream);
+    EXPECT_FALSE(r.crc());
+    EXPECT_EQ("CRC test", r.title());
+}
+
+
+TEST(CRC32, TracksAndCues)
+{
+    std::stringstream stream;
+    tawara::Tracks tracks;
+    tawara::TrackEntry::Ptr entry(new tawara::TrackEntry(1, 42, "TEST"));
+    tracks.insert(entry);
+    tracks.crc(true);
+    tracks.write(stream);
+    tawara::Tracks rt;
+    rt.verify_crc(true);
+    stream.seekg(tawara::ids::size(tawara::ids::Tracks));
+    rt.read(stream);
+    EXPECT_TRUE(rt.crc());
+    EXPECT_EQ(1, rt.count());
+
+    stream.str(std::string());
+    tawara::Cues cues;
+    tawara::CuePoint point(1000);
+    point.push_back(tawara::CueTrackPosition(1, 12345));
+    cues.insert(point);
+    cues.crc(true);
+    cues.write(stream);
+    tawara::Cues rc;
+    rc.verify_crc(true);
+    stream.seekg(tawara::ids::size(tawara::ids::Cues));
+    rc.read(stream);
+    EXPECT_TRUE(rc.crc());
+    EXPECT_EQ(1, rc.count());
+}
+
+
+TEST(CRC32, BadCRC)
+{
+    std::stringstream stream;
+    tawara::SegmentInfo info;
+    info.title("CRC test");
+    info.crc(true);
+    info.write(stream);
+    std::string data(stream.str());
+    data[data.size() - 1] ^= 0x01;
+    stream.str(data);
+
+    // Not verified by default
+    tawara::SegmentInfo r;
+    stream.seekg(tawara::ids::size(tawara::ids::Info));
+    EXPECT_NO_THROW(r.read(stream));
+
+    r.verify_crc(true);
+    stream.seekg(tawara::ids::size(tawara::ids::Info));
+    EXPECT_THROW(r.read(stream), tawara::BadCRC);
+}
+
+
+template <typename ClusterType>
+void write_crc_cluster(std::iostream& stream)
+{
+    tawara::BlockElement::Ptr b1(new tawara::SimpleBlock(1, 12345,
+                tawara::Block::LACING_NONE));
+    tawara::BlockElement::Ptr b2(new tawara::SimpleBlock(2, 26262,
+                tawara::Block::LACING_NONE));
+    b1->push_back(test_utils::make_blob(5));
+    b2->push_back(test_utils::make_blob(10));
+
+    ClusterType c;
+    c.crc(true);
+    c.write(stream);
+    c.push_back(b1);
+    c.push_back(b2);
+    EXPECT_EQ(c.size(), c.finalise(stream));
+    EXPECT_EQ(c.size(), stream.tellp());
+}
+
+
+template <typename ClusterType>
+void check_crc_cluster()
+{
+    std::stringstream stream;
+    write_crc_cluster<ClusterType>(stream);
+
+    ClusterType r;
+    r.verify_crc(true);
+    stream.seekg(tawara::ids::size(tawara::ids::Cluster));
+    r.read(stream);
+    EXPECT_TRUE(r.crc());
+    EXPECT_EQ(2, r.count());
+
+    // Corrupt the last byte of the last frame
+    std::string data(stream.str());
+    data[data.size() - 1] ^= 0x01;
+    stream.str(data);
+    stream.seekg(tawara::ids::size(tawara::ids::Cluster));
+    EXPECT_THROW(r.read(stream), tawara::BadCRC);
+}
+
+
+TEST(CRC32, MemoryCluster)
+{
+    check_crc_cluster<tawara::MemoryCluster>();
+}
+
+
+TEST(CRC32, FileCluster)
+{
+    check_crc_cluster<tawara::FileCluster>();
+}
+
@@ -0,0 +1,270 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <gtest/gtest.h>
+#include <tawara/attachments.h>
+#include <tawara/cut.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+
+#include "test_utils.h"
+
+
+// Writes a document with four clusters, at timecodes 0, 100, 200 and 300,
+// each containing blocks for tracks 1 and 2 at 0, 25, 50 and 75, and an
+// attachment. The document lasts for 400 and the third cluster records the
+// size of the one before it.
+class CutDocument : public test_utils::TestDocument
+{
+    public:
+        CutDocument()
+        {
+            segment.info.title("cut");
+            segment.info.duration(400);
+            cluster_count = 4;
+            cluster_blocks = 8;
+            tawara::Attachments* attachments(new tawara::Attachments);
+            tawara::FileData::Ptr fd(new tawara::FileData(
+                        *test_utils::make_blob(20)));
+            attachments->push_back(tawara::AttachedFile("name", "mime", fd,
+                        42));
+            head.push_back(test_utils::ElPtr(attachments));
+        }
+
+    protected:
+        ClusterPtr make_cluster(unsigned int index, uint64_t timecode)
+        {
+            ClusterPtr cluster(new tawara::FileCluster(timecode));
+            if (index == 2)
+            {
+                cluster->previous_size(1234);
+            }
+            return cluster;
+        }
+
+        tawara::BlockElement::Ptr make_block(unsigned int cluster,
+                unsigned int block)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(
+                        block % 2 + 1, (block / 2) * 25));
+            b->push_back(test_utils::make_blob(10 + cluster * 8 + block));
+            return b;
+        }
+};
+
+
+// The cut document with a summary in each cluster.
+class SummaryCutDocument : public CutDocument
+{
+    protected:
+        ClusterPtr make_cluster(unsigned int index, uint64_t timecode)
+        {
+            ClusterPtr cluster(CutDocument::make_cluster(index, timecode));
+            cluster->summary_pad(64);
+            return cluster;
+        }
+};
+
+
+// Opens a cut document and checks the carried-over elements.
+void open_cut_output(std::iostream& stream, tawara::Segment& s,
+        size_t track_count)
+{
+    stream.seekg(0);
+    tawara::read_tawara_header(stream);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(stream).first);
+    s.read(stream);
+    EXPECT_EQ("cut", s.info.title());
+
+    stream.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Tracks)->second));
+    tawara::ids::read(stream);
+    tawara::Tracks tracks;
+    tracks.read(stream);
+    EXPECT_EQ(track_count, tracks.count());
+
+    ASSERT_TRUE(s.index.find(tawara::ids::Attachments) != s.index.end());
+    stream.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Attachments)->second));
+    EXPECT_EQ(tawara::ids::Attachments, tawara::ids::read(stream).first);
+    tawara::Attachments attachments;
+    attachments.read(stream);
+    ASSERT_EQ(1, attachments.count());
+    EXPECT_EQ(42, attachments[0].uid());
+}
+
+
+TEST(Cut, WholeClusters)
+{
+    std::stringstream input, output;
+    CutDocument().write(input);
+    input.seekg(0);
+    tawara::cut(input, output, 100000000, 300000000);
+
+    tawara::Segment s;
+    open_cut_output(output, s, 2);
+    tawara::FileCluster::TrackSet all;
+    std::vector<int64_t> found;
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(output, all));
+            block != s.blocks_end_file(output, all); ++block)
+    {
+        EXPECT_EQ(10 + found.size() + 8, (*block)[0]->size());
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(16, found.size());
+    EXPECT_EQ(100000000, found[0]);
+    EXPECT_EQ(275000000, found[15]);
+    EXPECT_EQ(200, s.info.duration());
+
+    // The PrevSize of the moved cluster is not kept
+    std::vector<uint64_t> prev_sizes;
+    for (tawara::Segment::FileClusterIterator
+            cluster(s.clusters_begin_file(output));
+            cluster != s.clusters_end_file(output); ++cluster)
+    {
+        prev_sizes.push_back(cluster->previous_size());
+    }
+    ASSERT_EQ(2, prev_sizes.size());
+    EXPECT_EQ(0, prev_sizes[0]);
+    EXPECT_EQ(0, prev_sizes[1]);
+}
+
+
+TEST(Cut, BoundaryClusters)
+{
+    std::stringstream input, output;
+    CutDocument().write(input);
+    input.seekg(0);
+    tawara::FileCluster::TrackSet selected;
+    selected.insert(2);
+    tawara::cut(input, output, 130000000, 260000000, selected);
+
+    tawara::Segment s;
+    open_cut_output(output, s, 1);
+    tawara::FileCluster::TrackSet all;
+    std::vector<int64_t> found;
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(output, all));
+            block != s.blocks_end_file(output, all); ++block)
+    {
+        EXPECT_EQ(2, block->track_number());
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(5, found.size());
+    EXPECT_EQ(150000000, found[0]);
+    EXPECT_EQ(175000000, found[1]);
+    EXPECT_EQ(200000000, found[2]);
+    EXPECT_EQ(225000000, found[3]);
+    EXPECT_EQ(250000000, found[4]);
+    EXPECT_EQ(130, s.info.duration());
+
+    // Nothing in range
+    output.str(std::string());
+    input.seekg(0);
+    tawara::cut(input, output, 400000000, 500000000);
+    tawara::Segment empty;
+    open_cut_output(output, empty, 2);
+    EXPECT_FALSE(empty.info.has_duration());
+    EXPECT_TRUE(empty.blocks_begin_file(output, all) ==
+            empty.blocks_end_file(output, all));
+}
+
+
+
+TEST(Cut, Summaries)
+{
+    std::stringstream input, output;
+    SummaryCutDocument().write(input);
+    input.seekg(0);
+    tawara::cut(input, output, 100000000, 300000000);
+
+    tawara::Segment s;
+    open_cut_output(output, s, 2);
+    tawara::FileCluster::TrackSet all;
+    std::vector<int64_t> found;
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(output, all));
+            block != s.blocks_end_file(output, all); ++block)
+    {
+        EXPECT_EQ(10 + found.size() + 8, (*block)[0]->size());
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(16, found.size());
+    EXPECT_EQ(100000000, found[0]);
+    EXPECT_EQ(275000000, found[15]);
+
+    // Both the copied and the rewritten cluster keep their summaries
+    std::vector<uint64_t> counts;
+    for (tawara::Segment::FileClusterIterator
+            cluster(s.clusters_begin_file(output));
+            cluster != s.clusters_end_file(output); ++cluster)
+    {
+        ASSERT_TRUE(cluster->has_summary());
+        counts.push_back(cluster->summary().count());
+        EXPECT_EQ(0, cluster->previous_size());
+    }
+    ASSERT_EQ(2, counts.size());
+    EXPECT_EQ(2, counts[0]);
+    EXPECT_EQ(2, counts[1]);
+
+    // A summary showing unwanted tracks or blocks out of range does not
+    // stop the cluster being cut
+    output.str(std::string());
+    input.seekg(0);
+    tawara::FileCluster::TrackSet selected;
+    selected.insert(2);
+    tawara::cut(input, output, 130000000, 260000000, selected);
+    tawara::Segment cut;
+    open_cut_output(output, cut, 1);
+    found.clear();
+    for (tawara::Segment::FilteredBlockIterator
+            block(cut.blocks_begin_file(output, all));
+            block != cut.blocks_end_file(output, all); ++block)
+    {
+        EXPECT_EQ(2, block->track_number());
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(5, found.size());
+    EXPECT_EQ(150000000, found[0]);
+    EXPECT_EQ(250000000, found[4]);
+}
@@ -0,0 +1,267 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/foreach.hpp>
+#include <gtest/gtest.h>
+#include <tawara/attachments.h>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/faststart.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+#include <tawara/uint_element.h>
+#include <tawara/vint.h>
+
+#include "test_utils.h"
+
+
+// Writes a document with too little padding for the SeekHead, and with the
+// Tracks, Cues and Attachments after its three clusters.
+class FaststartDocument : public test_utils::TestDocument
+{
+    public:
+        FaststartDocument()
+        {
+            segment.pad_size(10);
+            segment.info.title("faststart");
+            tracks_last = true;
+            cluster_blocks = 8;
+            cues = true;
+            tawara::Attachments* attachments(new tawara::Attachments);
+            tawara::FileData::Ptr fd(new tawara::FileData(
+                        *test_utils::make_blob(20)));
+            attachments->push_back(tawara::AttachedFile("name", "mime", fd,
+                        42));
+            tail.push_back(test_utils::ElPtr(attachments));
+        }
+};
+
+
+// Writes the same document with a Position in each cluster, and a second
+// Attachments element to move the clusters further. The Position of the
+// first cluster is too short to hold its new position; the others are
+// longer than needed.
+class PositionDocument : public FaststartDocument
+{
+    public:
+        PositionDocument()
+        {
+            tawara::Attachments* attachments(new tawara::Attachments);
+            tawara::FileData::Ptr fd(new tawara::FileData(
+                        *test_utils::make_blob(200)));
+            attachments->push_back(tawara::AttachedFile("big", "mime", fd,
+                        43));
+            tail.push_back(test_utils::ElPtr(attachments));
+        }
+
+    protected:
+        ClusterPtr make_cluster(unsigned int index, uint64_t timecode)
+        {
+            // A cluster only has a Position if it was read with one
+            tawara::UIntElement tc(tawara::ids::Timecode, timecode);
+            tawara::UIntElement position(tawara::ids::Position,
+                    index == 0 ? 1 : 0x10000000);
+            std::stringstream header;
+            tc.write(header);
+            position.write(header);
+            std::string body(header.str());
+            header.str(std::string());
+            tawara::vint::write(body.size(), header);
+            header.write(body.data(), body.size());
+            header.seekg(0);
+            ClusterPtr cluster(new tawara::FileCluster);
+            cluster->read(header);
+            return cluster;
+        }
+};
+
+
+TEST(Faststart, Relocate)
+{
+    std::stringstream input, output;
+    FaststartDocument().write(input);
+    input.seekg(0);
+    tawara::faststart(input, output);
+
+    output.seekg(0);
+    tawara::read_tawara_header(output);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(output).first);
+    tawara::Segment s;
+    s.read(output);
+    EXPECT_EQ("faststart", s.info.title());
+
+    // The SeekHead is first, and the metadata is before the clusters
+    output.seekg(s.to_stream_offset(0));
+    EXPECT_EQ(tawara::ids::SeekHead, tawara::ids::read(output).first);
+    ASSERT_TRUE(s.index.find(tawara::ids::Tracks) != s.index.end());
+    ASSERT_TRUE(s.index.find(tawara::ids::Cues) != s.index.end());
+    ASSERT_TRUE(s.index.find(tawara::ids::Attachments) != s.index.end());
+    ASSERT_TRUE(s.index.find(tawara::ids::Cluster) != s.index.end());
+    std::streamoff first_cluster(s.index.find(tawara::ids::Cluster)->second);
+    EXPECT_LT(s.index.find(tawara::ids::Tracks)->second, first_cluster);
+    EXPECT_LT(s.index.find(tawara::ids::Cues)->second, first_cluster);
+    EXPECT_LT(s.index.find(tawara::ids::Attachments)->second, first_cluster);
+
+    output.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Tracks)->second));
+    EXPECT_EQ(tawara::ids::Tracks, tawara::ids::read(output).first);
+    tawara::Tracks tracks;
+    tracks.read(output);
+    EXPECT_EQ(2, tracks.count());
+
+    output.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Attachments)->second));
+    EXPECT_EQ(tawara::ids::Attachments, tawara::ids::read(output).first);
+    tawara::Attachments attachments;
+    attachments.read(output);
+    ASSERT_EQ(1, attachments.count());
+    EXPECT_EQ(42, attachments[0].uid());
+
+    // The cues point at the relocated clusters
+    output.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Cues)->second));
+    EXPECT_EQ(tawara::ids::Cues, tawara::ids::read(output).first);
+    tawara::Cues cues;
+    cues.read(output);
+    ASSERT_EQ(3, cues.count());
+    EXPECT_EQ(first_cluster, cues.find(0)->second[0].cluster_pos());
+    BOOST_FOREACH(tawara::Cues::value_type const& point, cues)
+    {
+        output.seekg(s.to_stream_offset(point.second[0].cluster_pos()));
+        EXPECT_EQ(tawara::ids::Cluster, tawara::ids::read(output).first);
+        tawara::FileCluster cluster;
+        cluster.read(output);
+        EXPECT_EQ(point.first, cluster.timecode());
+    }
+
+    // The blocks are unchanged
+    tawara::FileCluster::TrackSet all;
+    size_t count(0);
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(output, all));
+            block != s.blocks_end_file(output, all); ++block, ++count)
+    {
+        EXPECT_EQ(10 + count, (*block)[0]->size());
+        EXPECT_EQ((count / 8) * 100000000 + (count % 8) * 10000000,
+                block.timestamp());
+    }
+    EXPECT_EQ(24, count);
+}
+
+
+TEST(Faststart, ClusterPosition)
+{
+    std::stringstream input, output;
+    PositionDocument().write(input);
+    input.seekg(0);
+    tawara::faststart(input, output);
+
+    output.seekg(0);
+    tawara::read_tawara_header(output);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(output).first);
+    tawara::Segment s;
+    s.read(output);
+    output.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Cues)->second));
+    EXPECT_EQ(tawara::ids::Cues, tawara::ids::read(output).first);
+    tawara::Cues cues;
+    cues.read(output);
+    ASSERT_EQ(3, cues.count());
+    BOOST_FOREACH(tawara::Cues::value_type const& point, cues)
+    {
+        uint64_t pos(point.second[0].cluster_pos());
+        output.seekg(s.to_stream_offset(pos));
+        EXPECT_EQ(tawara::ids::Cluster, tawara::ids::read(output).first);
+        tawara::vint::read(output);
+        EXPECT_EQ(tawara::ids::Timecode, tawara::ids::read(output).first);
+        tawara::UIntElement tc(tawara::ids::Timecode, 0);
+        tc.read(output);
+        EXPECT_EQ(point.first, tc.value());
+        if (point.first == 0)
+        {
+            // The new position did not fit
+            EXPECT_EQ(tawara::ids::Void, tawara::ids::read(output).first);
+        }
+        else
+        {
+            EXPECT_EQ(tawara::ids::Position,
+                    tawara::ids::read(output).first);
+            tawara::UIntElement position(tawara::ids::Position, 0);
+            position.read(output);
+            EXPECT_EQ(pos, position.value());
+        }
+    }
+
+    // The blocks are unchanged
+    tawara::FileCluster::TrackSet all;
+    size_t count(0);
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(output, all));
+            block != s.blocks_end_file(output, all); ++block, ++count)
+    {
+        EXPECT_EQ(10 + count, (*block)[0]->size());
+    }
+    EXPECT_EQ(24, count);
+}
+
+
+TEST(Faststart, Repeated)
+{
+    std::stringstream input, once, twice;
+    FaststartDocument().write(input);
+    input.seekg(0);
+    tawara::faststart(input, once);
+    once.seekg(0);
+    tawara::faststart(once, twice);
+    EXPECT_EQ(once.str(), twice.str());
+}
+
+
+TEST(Faststart, NotTawara)
+{
+    std::stringstream input, output;
+    tawara::EBMLElement ebml_el("notatawaradoc");
+    ebml_el.write(input);
+    input.seekg(0);
+    EXPECT_THROW(tawara::faststart(input, output), tawara::NotTawara);
+}
+
@@ -0,0 +1,227 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/fsck.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+
+#include "test_consts.h"
+#include "test_utils.h"
+
+
+// Writes a document with CRCs on the Tracks, Cues and clusters. The
+// clusters are given the timecodes in order, and their blocks cycle through
+// the given number of tracks, of which only tracks 1 and 2 are declared.
+// Returns the stream positions of the clusters.
+std::vector<std::streamsize> write_fsck_input(std::string const& path,
+        std::vector<uint64_t> const& timecodes, int block_tracks=2)
+{
+    std::vector<std::streamsize> result;
+    std::fstream stream(path.c_str(), std::ios::in | std::ios::out |
+            std::ios::trunc | std::ios::binary);
+    tawara::EBMLElement ebml_el;
+    ebml_el.write(stream);
+    tawara::Segment s;
+    s.write(stream);
+    tawara::Tracks tracks;
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(1, 1, "A")));
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(2, 2, "B")));
+    tracks.crc(true);
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+    tawara::Cues cues;
+    for (size_t ii(0); ii < timecodes.size(); ++ii)
+    {
+        tawara::FileCluster cluster(timecodes[ii]);
+        cluster.crc(true);
+        result.push_back(stream.tellp());
+        if (ii == 0)
+        {
+            s.index.insert(std::make_pair(cluster.id(),
+                        s.to_segment_offset(stream.tellp())));
+        }
+        tawara::CuePoint point(timecodes[ii]);
+        point.push_back(tawara::CueTrackPosition(1,
+                    s.to_segment_offset(stream.tellp())));
+        cues.insert(point);
+        cluster.write(stream);
+        for (int jj(0); jj < 4; ++jj)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(
+                        jj % block_tracks + 1,
+                        jj * 10));
+            b->push_back(test_utils::make_blob(10 + jj));
+            cluster.push_back(b);
+        }
+        cluster.finalise(stream);
+    }
+    cues.crc(true);
+    s.index.insert(std::make_pair(cues.id(),
+                s.to_segment_offset(stream.tellp())));
+    cues.write(stream);
+    s.finalise(stream);
+    return result;
+}
+
+
+TEST(Fsck, Valid)
+{
+    std::string path((test_bin_dir / "fsck_valid.tawara").string());
+    std::vector<uint64_t> timecodes;
+    for (int ii(0); ii < 10; ++ii)
+    {
+        timecodes.push_back(ii * 100);
+    }
+    write_fsck_input(path, timecodes);
+
+    for (unsigned int threads(0); threads < 5; ++threads)
+    {
+        tawara::FsckReport report(tawara::fsck(path, threads));
+        EXPECT_TRUE(report.ok());
+        EXPECT_EQ(10, report.clusters);
+        EXPECT_EQ(40, report.blocks);
+        EXPECT_EQ(40, report.frames);
+        // Tracks, Cues and every cluster
+        EXPECT_EQ(12, report.crcs);
+    }
+    boost::filesystem::remove(path);
+}
+
+
+TEST(Fsck, BadCRC)
+{
+    std::string path((test_bin_dir / "fsck_crc.tawara").string());
+    std::vector<uint64_t> timecodes;
+    for (int ii(0); ii < 4; ++ii)
+    {
+        timecodes.push_back(ii * 100);
+    }
+    std::vector<std::streamsize> clusters(write_fsck_input(path, timecodes));
+    {
+        // Corrupt the last byte of the third cluster
+        std::fstream stream(path.c_str(), std::ios::in | std::ios::out |
+                std::ios::binary);
+        stream.seekg(clusters[3] - 1);
+        char c(stream.get() ^ 0x01);
+        stream.seekp(clusters[3] - 1);
+        stream.put(c);
+    }
+
+    tawara::FsckReport report(tawara::fsck(path, 2));
+    ASSERT_EQ(1, report.problems.size());
+    EXPECT_EQ(clusters[2], report.problems[0].pos);
+    EXPECT_EQ("cluster", report.problems[0].check);
+    EXPECT_EQ("BadCRC", report.problems[0].error);
+    // The other clusters are still checked
+    EXPECT_EQ(3, report.clusters);
+    EXPECT_EQ(12, report.blocks);
+    boost::filesystem::remove(path);
+}
+
+
+TEST(Fsck, Timecodes)
+{
+    std::string path((test_bin_dir / "fsck_timecodes.tawara").string());
+    std::vector<uint64_t> timecodes;
+    timecodes.push_back(0);
+    timecodes.push_back(200);
+    timecodes.push_back(100);
+    timecodes.push_back(300);
+    std::vector<std::streamsize> clusters(write_fsck_input(path, timecodes));
+
+    tawara::FsckReport report(tawara::fsck(path));
+    ASSERT_EQ(1, report.problems.size());
+    EXPECT_EQ(clusters[2], report.problems[0].pos);
+    EXPECT_EQ("timecode", report.problems[0].check);
+    EXPECT_EQ("TimecodeDecreased", report.problems[0].error);
+    EXPECT_EQ(4, report.clusters);
+    boost::filesystem::remove(path);
+}
+
+
+TEST(Fsck, UnknownTrack)
+{
+    std::string path((test_bin_dir / "fsck_unknown_track.tawara").string());
+    std::vector<uint64_t> timecodes;
+    timecodes.push_back(0);
+    timecodes.push_back(100);
+    std::vector<std::streamsize> clusters(write_fsck_input(path, timecodes,
+                3));
+
+    // The third block of each cluster is in track 3
+    tawara::FsckReport report(tawara::fsck(path));
+    ASSERT_EQ(2, report.problems.size());
+    for (int ii(0); ii < 2; ++ii)
+    {
+        EXPECT_LT(clusters[ii], report.problems[ii].pos);
+        EXPECT_EQ("block", report.problems[ii].check);
+        EXPECT_EQ("UnknownTrack", report.problems[ii].error);
+    }
+    EXPECT_EQ(2, report.clusters);
+    EXPECT_EQ(8, report.blocks);
+    boost::filesystem::remove(path);
+}
+
+
+TEST(Fsck, NotTawara)
+{
+    std::string path((test_bin_dir / "fsck_not_tawara.tawara").string());
+    {
+        std::ofstream stream(path.c_str(), std::ios::binary);
+        stream << "This is not a Tawara file.";
+    }
+    tawara::FsckReport report(tawara::fsck(path));
+    ASSERT_EQ(1, report.problems.size());
+    EXPECT_EQ("header", report.problems[0].check);
+    EXPECT_EQ(0, report.clusters);
+    boost::filesystem::remove(path);
+
+    EXPECT_THROW(tawara::fsck(path), tawara::ReadError);
+}
+
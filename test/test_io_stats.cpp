@@ -0,0 +1,406 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <fcntl.h>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tawara/ebml_element.h>
+#include <tawara/exceptions.h>
+#include <tawara/el_ids.h>
+#include <tawara/file_cluster.h>
+#include <tawara/io_stats.h>
+#include <tawara/memory_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+
+#include "test_consts.h"
+#include "test_utils.h"
+
+
+// Writes a segment with three clusters. The first two blocks of each cluster
+// hold a single frame, the third holds a lace of three frames.
+template<typename ClusterType>
+class StatsDocument : public test_utils::TestDocument
+{
+    public:
+        StatsDocument(tawara::IOStats::Ptr stats)
+        {
+            segment.stats(stats);
+            track_count = 1;
+            cluster_blocks = 3;
+        }
+
+    protected:
+        ClusterPtr make_cluster(unsigned int, uint64_t timecode)
+        {
+            return ClusterPtr(new ClusterType(timecode));
+        }
+
+        tawara::BlockElement::Ptr make_block(unsigned int, unsigned int block)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, block));
+            if (block == 2)
+            {
+                b->lacing(tawara::Block::LACING_FIXED);
+                for (int ii(0); ii < 3; ++ii)
+                {
+                    b->push_back(test_utils::make_blob(5));
+                }
+            }
+            else
+            {
+                b->push_back(test_utils::make_blob(10));
+            }
+            return b;
+        }
+};
+
+
+// Opens the segment written by StatsDocument for reading.
+void open_stats_input(std::istream& stream, tawara::Segment& s)
+{
+    stream.seekg(0);
+    tawara::ids::read(stream);
+    tawara::EBMLElement ebml_el;
+    ebml_el.read(stream);
+    tawara::ids::read(stream);
+    s.read(stream);
+}
+
+
+TEST(IOStats, Construction)
+{
+    tawara::IOStats stats;
+    EXPECT_EQ(0, stats.bytes_read);
+    EXPECT_EQ(0, stats.bytes_written);
+    EXPECT_EQ(0, stats.seeks);
+    EXPECT_EQ(0, stats.blocks_read);
+    EXPECT_EQ(0, stats.block_headers_read);
+    EXPECT_EQ(0, stats.frame_allocs);
+    EXPECT_EQ(0, stats.finalise_us);
+}
+
+
+TEST(IOStats, AddAndReset)
+{
+    tawara::IOStats a, b;
+    a.bytes_read = 10;
+    a.frames_read = 3;
+    b.bytes_read = 5;
+    b.seeks = 2;
+    a += b;
+    EXPECT_EQ(15, a.bytes_read);
+    EXPECT_EQ(3, a.frames_read);
+    EXPECT_EQ(2, a.seeks);
+    a.reset();
+    EXPECT_EQ(0, a.bytes_read);
+    EXPECT_EQ(0, a.frames_read);
+    EXPECT_EQ(0, a.seeks);
+}
+
+
+TEST(IOStats, Print)
+{
+    tawara::IOStats stats;
+    stats.bytes_read = 1234;
+    stats.seeks = 7;
+    std::stringstream output;
+    output << stats;
+    EXPECT_NE(std::string::npos, output.str().find("Bytes read: 1234\n"));
+    EXPECT_NE(std::string::npos, output.str().find("Seeks: 7\n"));
+}
+
+
+TEST(IOStats, CountingStreamBuf)
+{
+    std::stringbuf buffer;
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    tawara::CountingStreamBuf counter(&buffer, stats);
+    EXPECT_EQ(&buffer, counter.buffer());
+    EXPECT_EQ(stats, counter.stats());
+    std::iostream stream(&counter);
+
+    stream.write("abcdef", 6);
+    stream.put('g');
+    EXPECT_EQ(7, stats->bytes_written);
+    EXPECT_EQ(2, stats->write_calls);
+    EXPECT_EQ("abcdefg", buffer.str());
+
+    // Getting the position is not a seek
+    EXPECT_EQ(7, stream.tellp());
+    EXPECT_EQ(0, stats->seeks);
+    stream.seekg(0);
+    EXPECT_EQ(1, stats->seeks);
+
+    char data[4];
+    stream.read(data, 4);
+    EXPECT_EQ(4, stats->bytes_read);
+    EXPECT_EQ(1, stats->read_calls);
+    EXPECT_EQ('e', stream.get());
+    EXPECT_EQ(5, stats->bytes_read);
+    // A character put back is not counted twice
+    stream.unget();
+    EXPECT_EQ('e', stream.get());
+    EXPECT_EQ(5, stats->bytes_read);
+
+    stream.seekg(2, std::ios::cur);
+    EXPECT_EQ(2, stats->seeks);
+    EXPECT_EQ(EOF, stream.get());
+    EXPECT_EQ(5, stats->bytes_read);
+}
+
+
+TEST(IOStats, MemoryCluster)
+{
+    std::stringbuf buffer;
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    tawara::CountingStreamBuf counter(&buffer, stats);
+    std::iostream stream(&counter);
+
+    StatsDocument<tawara::MemoryCluster>(stats).write(stream);
+    // Sizes and CRCs are written over when finalising
+    EXPECT_LT(buffer.str().size(), stats->bytes_written);
+    EXPECT_EQ(3, stats->clusters_written);
+    EXPECT_EQ(9, stats->blocks_written);
+    EXPECT_EQ(15, stats->frames_written);
+    // Three clusters and the segment
+    EXPECT_EQ(4, stats->finalise_calls);
+    EXPECT_EQ(0, stats->blocks_read);
+
+    tawara::IOStats::Ptr read_stats(new tawara::IOStats);
+    tawara::CountingStreamBuf read_counter(&buffer, read_stats);
+    std::istream input(&read_counter);
+    tawara::Segment s;
+    open_stats_input(input, s);
+    // Creating the end iterator reads the first cluster, so it is not counted
+    tawara::Segment::MemClusterIterator end(s.clusters_end_mem(input));
+    s.stats(read_stats);
+    int blocks(0);
+    for (tawara::Segment::MemClusterIterator cluster(s.clusters_begin_mem(input));
+            cluster != end; ++cluster)
+    {
+        blocks += cluster->count();
+    }
+    EXPECT_EQ(9, blocks);
+    EXPECT_EQ(3, read_stats->clusters_read);
+    EXPECT_EQ(9, read_stats->blocks_read);
+    EXPECT_EQ(15, read_stats->frames_read);
+    // Each block allocates its frame sizes and its list of frames. A single
+    // frame also allocates the frame and its data; a lace allocates its
+    // payload buffer, the shared run of frames and its array, and the data
+    // of each frame.
+    EXPECT_EQ(3 * (2 * (2 + 2) + (2 + 3 + 3)), read_stats->frame_allocs);
+    EXPECT_EQ(0, read_stats->block_headers_read);
+    EXPECT_LT(0, read_stats->bytes_read);
+    EXPECT_LT(0, read_stats->read_calls);
+    EXPECT_LT(0, read_stats->seeks);
+    EXPECT_EQ(0, read_stats->bytes_written);
+    EXPECT_EQ(0, read_stats->finalise_calls);
+}
+
+
+TEST(IOStats, FileCluster)
+{
+    std::stringbuf buffer;
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    tawara::CountingStreamBuf counter(&buffer, stats);
+    std::iostream stream(&counter);
+
+    StatsDocument<tawara::FileCluster>(stats).write(stream);
+    // Sizes and CRCs are written over when finalising
+    EXPECT_LT(buffer.str().size(), stats->bytes_written);
+    EXPECT_EQ(3, stats->clusters_written);
+    EXPECT_EQ(9, stats->blocks_written);
+    EXPECT_EQ(15, stats->frames_written);
+    EXPECT_EQ(4, stats->finalise_calls);
+
+    stats->reset();
+    tawara::Segment s;
+    open_stats_input(stream, s);
+    tawara::Segment::FileClusterIterator end(s.clusters_end_file(stream));
+    s.stats(stats);
+    int blocks(0);
+    for (tawara::Segment::FileClusterIterator cluster(
+                s.clusters_begin_file(stream));
+            cluster != end; ++cluster)
+    {
+        // Only the clusters' headers have been read so far
+        EXPECT_EQ(blocks, stats->blocks_read);
+        for (tawara::FileCluster::Iterator block(cluster->begin());
+                block != cluster->end(); ++block)
+        {
+            EXPECT_EQ(1, block->track_number());
+            ++blocks;
+        }
+    }
+    EXPECT_EQ(9, blocks);
+    EXPECT_EQ(3, stats->clusters_read);
+    EXPECT_EQ(9, stats->blocks_read);
+    EXPECT_EQ(15, stats->frames_read);
+    EXPECT_EQ(0, stats->bytes_written);
+}
+
+
+TEST(IOStats, FilteredFileCluster)
+{
+    std::stringstream stream;
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    StatsDocument<tawara::FileCluster>(stats).write(stream);
+
+    stats->reset();
+    tawara::Segment s;
+    open_stats_input(stream, s);
+    tawara::Segment::FileClusterIterator end(s.clusters_end_file(stream));
+    s.stats(stats);
+    int blocks(0);
+    for (tawara::Segment::FileClusterIterator cluster(
+                s.clusters_begin_file(stream));
+            cluster != end; ++cluster)
+    {
+        // Only the lace at timecode 2 is read in full
+        for (tawara::FileCluster::Iterator block(cluster->begin(
+                        tawara::FileCluster::TrackSet(), 2, 2));
+                block != cluster->end(); ++block)
+        {
+            EXPECT_EQ(3, block->count());
+            ++blocks;
+        }
+    }
+    EXPECT_EQ(3, blocks);
+    EXPECT_EQ(3, stats->blocks_read);
+    EXPECT_EQ(9, stats->block_headers_read);
+    EXPECT_EQ(3 * (2 + 3 + 3), stats->frame_allocs);
+}
+
+
+TEST(IOStats, Latencies)
+{
+    std::stringstream stream;
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    StatsDocument<tawara::MemoryCluster>(stats).write(stream);
+    EXPECT_EQ(9, stats->write_latency.count());
+    EXPECT_EQ(4, stats->finalise_latency.count());
+    EXPECT_EQ(0, stats->sync_latency.count());
+    std::stringstream output;
+    output << *stats;
+    EXPECT_NE(std::string::npos, output.str().find("Write latency (us): "));
+    EXPECT_EQ(std::string::npos, output.str().find("Sync latency (us): "));
+
+    stats->reset();
+    EXPECT_EQ(0, stats->write_latency.count());
+    StatsDocument<tawara::FileCluster>(stats).write(stream);
+    EXPECT_EQ(9, stats->write_latency.count());
+    EXPECT_EQ(4, stats->finalise_latency.count());
+
+    // Blocks pushed before statistics were given are not timed
+    stats->reset();
+    tawara::MemoryCluster cluster;
+    cluster.write(stream);
+    tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, 0));
+    b->push_back(test_utils::make_blob(10));
+    cluster.push_back(b);
+    cluster.stats(stats);
+    cluster.push_back(b);
+    cluster.finalise(stream);
+    EXPECT_EQ(2, stats->blocks_written);
+    EXPECT_EQ(0, stats->write_latency.count());
+}
+
+
+TEST(IOStats, Sync)
+{
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    std::stringstream stream;
+    stream << "abc";
+    tawara::sync(stream);
+    EXPECT_EQ(0, stats->sync_calls);
+    tawara::sync(stream, -1, stats);
+    EXPECT_EQ(1, stats->sync_calls);
+    EXPECT_EQ(1, stats->sync_latency.count());
+
+    std::string path((test_bin_dir / "io_stats_sync.tawara").string());
+    std::ofstream file(path.c_str(), std::ios::out | std::ios::binary);
+    file << "abc";
+    int fd(::open(path.c_str(), O_WRONLY));
+    ASSERT_LE(0, fd);
+    tawara::sync(file, fd, stats);
+    ::close(fd);
+    EXPECT_EQ(2, stats->sync_calls);
+    EXPECT_THROW(tawara::sync(file, fd, stats), tawara::WriteError);
+}
+
+
+TEST(IOStats, StatsDumper)
+{
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    stats->bytes_read = 42;
+    std::stringstream output;
+    tawara::StatsDumper slow(stats, output, boost::posix_time::hours(1));
+    EXPECT_FALSE(slow.poll());
+    EXPECT_EQ(0, slow.dumps());
+    EXPECT_TRUE(output.str().empty());
+
+    tawara::StatsDumper fast(stats, output,
+            boost::posix_time::time_duration(), true);
+    EXPECT_TRUE(fast.poll());
+    EXPECT_EQ(1, fast.dumps());
+    EXPECT_NE(std::string::npos, output.str().find("Bytes read: 42\n"));
+    // The statistics were reset after the dump
+    EXPECT_EQ(0, stats->bytes_read);
+    slow.dump();
+    EXPECT_EQ(1, slow.dumps());
+    EXPECT_NE(std::string::npos, output.str().find("Bytes read: 0\n"));
+}
+
+
+TEST(IOStats, Disabled)
+{
+    // Without statistics, nothing is counted and nothing breaks
+    std::stringstream stream;
+    StatsDocument<tawara::MemoryCluster>(tawara::IOStats::Ptr()).write(stream);
+    tawara::Segment s;
+    open_stats_input(stream, s);
+    EXPECT_FALSE(s.stats());
+    tawara::Segment::MemClusterIterator cluster(s.clusters_begin_mem(stream));
+    EXPECT_FALSE(cluster->stats());
+    EXPECT_EQ(3, cluster->count());
+}
@@ -0,0 +1,251 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/lace_packer.h>
+#include <tawara/simple_block.h>
+
+#include "test_utils.h"
+
+
+// A 1 kHz track with a timecode scale of 1 ms
+tawara::TrackEntry packer_track(uint64_t default_duration=1000000)
+{
+    tawara::TrackEntry track(3, 3, "IMU");
+    track.default_duration(default_duration);
+    return track;
+}
+
+
+TEST(LacePacker, Construction)
+{
+    EXPECT_THROW(tawara::LacePacker(packer_track(), 0),
+            tawara::ValueOutOfRange);
+    EXPECT_THROW(tawara::LacePacker(packer_track(), 1000000, 0),
+            tawara::ValueOutOfRange);
+    EXPECT_THROW(tawara::LacePacker(packer_track(), 1000000, 256),
+            tawara::ValueOutOfRange);
+    tawara::LacePacker packer(packer_track(), 1000000, 255);
+    EXPECT_TRUE(packer.empty());
+    EXPECT_FALSE(packer.flush());
+    EXPECT_THROW(packer.add(tawara::Block::value_type(), 0),
+            tawara::EmptyFrame);
+}
+
+
+TEST(LacePacker, FixedLacing)
+{
+    tawara::LacePacker packer(packer_track(), 1000000, 4);
+    std::vector<tawara::BlockElement::Ptr> blocks;
+    for (int ii(0); ii < 10; ++ii)
+    {
+        tawara::BlockElement::Ptr b(packer.add(test_utils::make_blob(8),
+                    ii));
+        if (b)
+        {
+            blocks.push_back(b);
+        }
+    }
+    EXPECT_EQ(2, packer.count());
+    blocks.push_back(packer.flush());
+    EXPECT_TRUE(packer.empty());
+
+    ASSERT_EQ(3, blocks.size());
+    EXPECT_EQ(4, blocks[0]->count());
+    EXPECT_EQ(4, blocks[1]->count());
+    EXPECT_EQ(2, blocks[2]->count());
+    for (int ii(0); ii < 3; ++ii)
+    {
+        EXPECT_EQ(3, blocks[ii]->track_number());
+        EXPECT_EQ(ii * 4, blocks[ii]->timecode());
+        EXPECT_EQ(tawara::Block::LACING_FIXED, blocks[ii]->lacing());
+    }
+}
+
+
+TEST(LacePacker, EBMLLacing)
+{
+    tawara::LacePacker packer(packer_track(), 1000000);
+    EXPECT_FALSE(packer.add(test_utils::make_blob(8), 0));
+    EXPECT_FALSE(packer.add(test_utils::make_blob(9), 1));
+    EXPECT_FALSE(packer.add(test_utils::make_blob(8), 2));
+    tawara::BlockElement::Ptr b(packer.flush());
+    EXPECT_EQ(3, b->count());
+    EXPECT_EQ(tawara::Block::LACING_EBML, b->lacing());
+
+    // A single frame is not laced
+    packer.add(test_utils::make_blob(8), 5);
+    b = packer.flush();
+    EXPECT_EQ(1, b->count());
+    EXPECT_EQ(tawara::Block::LACING_NONE, b->lacing());
+}
+
+
+TEST(LacePacker, Timing)
+{
+    tawara::LacePacker packer(packer_track(), 1000000);
+    packer.add(test_utils::make_blob(8), 10);
+    packer.add(test_utils::make_blob(8), 11);
+    // A dropped sample
+    tawara::BlockElement::Ptr b(packer.add(test_utils::make_blob(8), 13));
+    ASSERT_TRUE(b);
+    EXPECT_EQ(2, b->count());
+    EXPECT_EQ(10, b->timecode());
+    // A repeated timecode
+    b = packer.add(test_utils::make_blob(8), 13);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(1, b->count());
+    EXPECT_EQ(13, b->timecode());
+
+    // 30 Hz frames are laced when their timecodes are rounded
+    tawara::LacePacker video(packer_track(33333333), 1000000);
+    EXPECT_FALSE(video.add(test_utils::make_blob(8), 0));
+    EXPECT_FALSE(video.add(test_utils::make_blob(8), 33));
+    EXPECT_FALSE(video.add(test_utils::make_blob(8), 67));
+    EXPECT_FALSE(video.add(test_utils::make_blob(8), 100));
+    EXPECT_EQ(4, video.count());
+
+    // Without a default duration, frames are not laced
+    tawara::LacePacker unlaced(packer_track(0), 1000000);
+    EXPECT_FALSE(unlaced.add(test_utils::make_blob(8), 0));
+    b = unlaced.add(test_utils::make_blob(8), 1);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(1, b->count());
+}
+
+
+TEST(LacePacker, Limits)
+{
+    tawara::LacePacker packer(packer_track(), 1000000, 255, 20, 5);
+    packer.add(test_utils::make_blob(8), 0);
+    packer.add(test_utils::make_blob(8), 1);
+    tawara::BlockElement::Ptr b(packer.add(test_utils::make_blob(8), 2));
+    ASSERT_TRUE(b);
+    EXPECT_EQ(2, b->count());
+    // A frame bigger than the limit gets its own block
+    b = packer.add(test_utils::make_blob(30), 3);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(1, b->count());
+    b = packer.add(test_utils::make_blob(2), 4);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(30, (*b)[0]->size());
+
+    // Latency
+    for (int ii(5); ii < 10; ++ii)
+    {
+        EXPECT_FALSE(packer.add(test_utils::make_blob(2), ii));
+    }
+    EXPECT_FALSE(packer.expire(9));
+    b = packer.expire(10);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(6, b->count());
+    EXPECT_EQ(4, b->timecode());
+    EXPECT_TRUE(packer.empty());
+    EXPECT_FALSE(packer.expire(100));
+
+    // Full blocks are completed by expire() without waiting
+    tawara::LacePacker two(packer_track(), 1000000, 2);
+    two.add(test_utils::make_blob(2), 0);
+    EXPECT_FALSE(two.expire(0));
+    two.add(test_utils::make_blob(2), 1);
+    b = two.expire(1);
+    ASSERT_TRUE(b);
+    EXPECT_EQ(2, b->count());
+}
+
+
+TEST(LacePacker, FullLace)
+{
+    tawara::LacePacker packer(packer_track(), 1000000, 255, 1 << 20, 1000);
+    for (int ii(0); ii < 255; ++ii)
+    {
+        EXPECT_FALSE(packer.add(test_utils::make_blob(4), ii));
+    }
+    tawara::BlockElement::Ptr b(packer.add(test_utils::make_blob(4), 255));
+    ASSERT_TRUE(b);
+    ASSERT_EQ(255, b->count());
+    EXPECT_EQ(tawara::Block::LACING_FIXED, b->lacing());
+
+    std::stringstream stream;
+    b->write(stream);
+    tawara::SimpleBlock r(0, 0);
+    stream.seekg(tawara::ids::size(tawara::ids::SimpleBlock));
+    r.read(stream);
+    EXPECT_EQ(255, r.count());
+    EXPECT_EQ(tawara::Block::LACING_FIXED, r.lacing());
+    EXPECT_EQ(4, r[254]->size());
+}
+
+
+TEST(LacePacker, Compression)
+{
+    tawara::TrackEntry track(packer_track());
+    track.compression(tawara::COMPRESSION_LZ4);
+    tawara::LacePacker packer(track, 1000000);
+    packer.add(test_utils::make_blob(8), 0);
+    EXPECT_EQ(tawara::COMPRESSION_LZ4, packer.flush()->compression());
+}
+
+
+TEST(LacePacker, Unpack)
+{
+    tawara::LacePacker packer(packer_track(), 1000000);
+    for (int ii(0); ii < 5; ++ii)
+    {
+        packer.add(test_utils::make_blob(4 + ii), -2 + ii);
+    }
+    tawara::BlockElement::Ptr b(packer.flush());
+    std::stringstream stream;
+    b->write(stream);
+    tawara::SimpleBlock r(0, 0);
+    stream.seekg(tawara::ids::size(tawara::ids::SimpleBlock));
+    r.read(stream);
+
+    std::vector<tawara::TimedFrame> frames(tawara::unpack_frames(r, 1000,
+                1000000, 1000000));
+    ASSERT_EQ(5, frames.size());
+    for (int ii(0); ii < 5; ++ii)
+    {
+        EXPECT_EQ((998 + ii) * 1000000LL, frames[ii].time);
+        EXPECT_EQ(4 + ii, frames[ii].data->size());
+    }
+}
+
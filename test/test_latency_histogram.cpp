@@ -0,0 +1,159 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/date_time/posix_time/posix_time.hpp>
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tawara/latency_histogram.h>
+
+namespace bpt = boost::posix_time;
+
+
+TEST(LatencyHistogram, Empty)
+{
+    tawara::LatencyHistogram h;
+    EXPECT_EQ(0, h.count());
+    EXPECT_EQ(0, h.min());
+    EXPECT_EQ(0, h.max());
+    EXPECT_EQ(0, h.mean());
+    EXPECT_EQ(0, h.percentile(50));
+    EXPECT_EQ(0, h.percentile(100));
+}
+
+
+TEST(LatencyHistogram, SmallValuesExact)
+{
+    tawara::LatencyHistogram h;
+    for (uint64_t ii(1); ii <= 60; ++ii)
+    {
+        h.record(ii);
+    }
+    EXPECT_EQ(60, h.count());
+    EXPECT_EQ(1, h.min());
+    EXPECT_EQ(60, h.max());
+    EXPECT_DOUBLE_EQ(30.5, h.mean());
+    EXPECT_EQ(30, h.percentile(50));
+    EXPECT_EQ(54, h.percentile(90));
+    EXPECT_EQ(60, h.percentile(100));
+    EXPECT_EQ(1, h.percentile(0));
+}
+
+
+TEST(LatencyHistogram, Precision)
+{
+    // Every percentile is within 1/32 above the true value
+    uint64_t values[] = {64, 100, 1000, 12345, 999999, 123456789};
+    for (std::size_t ii(0); ii < sizeof(values) / sizeof(values[0]); ++ii)
+    {
+        tawara::LatencyHistogram h;
+        h.record(values[ii]);
+        h.record(values[ii] * 2);
+        uint64_t p50(h.percentile(50));
+        EXPECT_LE(values[ii], p50);
+        EXPECT_GE(values[ii] + values[ii] / 32, p50);
+        EXPECT_EQ(values[ii] * 2, h.percentile(100));
+    }
+}
+
+
+TEST(LatencyHistogram, Tail)
+{
+    // A single stall is visible at the 99.9th percentile
+    tawara::LatencyHistogram h;
+    for (int ii(0); ii < 999; ++ii)
+    {
+        h.record(10);
+    }
+    h.record(50000);
+    EXPECT_EQ(10, h.percentile(99));
+    EXPECT_EQ(10, h.percentile(99.9));
+    EXPECT_LE(50000, h.percentile(99.95));
+    EXPECT_EQ(50000, h.max());
+}
+
+
+TEST(LatencyHistogram, Clamp)
+{
+    tawara::LatencyHistogram h;
+    h.record(tawara::LatencyHistogram::max_value() * 4);
+    EXPECT_EQ(tawara::LatencyHistogram::max_value(), h.max());
+    EXPECT_EQ(tawara::LatencyHistogram::max_value(), h.percentile(50));
+}
+
+
+TEST(LatencyHistogram, RecordStart)
+{
+    tawara::LatencyHistogram h;
+    bpt::ptime start(bpt::microsec_clock::universal_time() -
+            bpt::milliseconds(5));
+    h.record(start);
+    EXPECT_EQ(1, h.count());
+    EXPECT_LE(5000, h.max());
+    // A start time in the future is recorded as 0
+    h.record(bpt::microsec_clock::universal_time() + bpt::seconds(10));
+    EXPECT_EQ(0, h.min());
+}
+
+
+TEST(LatencyHistogram, AddAndReset)
+{
+    tawara::LatencyHistogram a, b;
+    a.record(10);
+    b.record(5);
+    b.record(1000);
+    a += b;
+    EXPECT_EQ(3, a.count());
+    EXPECT_EQ(5, a.min());
+    EXPECT_EQ(1000, a.max());
+    a += tawara::LatencyHistogram();
+    EXPECT_EQ(5, a.min());
+    a.reset();
+    EXPECT_EQ(0, a.count());
+    EXPECT_EQ(0, a.max());
+    EXPECT_EQ(0, a.percentile(50));
+}
+
+
+TEST(LatencyHistogram, Print)
+{
+    tawara::LatencyHistogram h;
+    h.record(7);
+    std::stringstream output;
+    output << h;
+    EXPECT_EQ("count=1 min=7 p50=7 p90=7 p99=7 p99.9=7 max=7", output.str());
+}
@@ -241,3 +241,54 @@ TEST(MemoryCluster, Read)
             (*boost::static_pointer_cast<tawara::SimpleBlock>(*(++c.begin()))));
 }
 
+
+
+TEST(MemoryCluster, Summary)
+{
+    std::stringstream output;
+    tawara::BlockElement::Ptr b1(new tawara::SimpleBlock(1, 12345,
+                tawara::Block::LACING_NONE));
+    tawara::BlockElement::Ptr b2(new tawara::SimpleBlock(2, 26262,
+                tawara::Block::LACING_NONE));
+    tawara::Block::value_type f1(test_utils::make_blob(5));
+    b1->push_back(f1);
+    tawara::Block::value_type f2(test_utils::make_blob(10));
+    b2->push_back(f2);
+    tawara::ClusterSummary expected;
+    expected.add(*b1);
+    expected.add(*b2);
+
+    tawara::MemoryCluster c;
+    EXPECT_EQ(0, c.summary_pad());
+    c.summary_pad(64);
+    std::streamsize meta_size(c.size());
+    c.write(output);
+    c.push_back(b1);
+    c.push_back(b2);
+    EXPECT_EQ(meta_size + b1->size() + b2->size(), c.finalise(output));
+    EXPECT_EQ(meta_size + b1->size() + b2->size(), output.str().size());
+
+    tawara::MemoryCluster r;
+    output.seekg(tawara::ids::size(tawara::ids::Cluster));
+    r.read(output);
+    EXPECT_TRUE(r.has_summary());
+    EXPECT_TRUE(expected == r.summary());
+    EXPECT_EQ(64, r.summary_pad());
+    EXPECT_EQ(2, r.count());
+    EXPECT_TRUE((*boost::static_pointer_cast<tawara::SimpleBlock>(b2)) ==
+            (*boost::static_pointer_cast<tawara::SimpleBlock>(*(++r.begin()))));
+
+    // A summary that does not fit leaves the reserved space empty
+    output.str(std::string());
+    tawara::MemoryCluster small;
+    small.summary_pad(4);
+    small.write(output);
+    small.push_back(b1);
+    small.push_back(b2);
+    small.finalise(output);
+    output.seekg(tawara::ids::size(tawara::ids::Cluster));
+    r.read(output);
+    EXPECT_FALSE(r.has_summary());
+    EXPECT_EQ(4, r.summary_pad());
+    EXPECT_EQ(2, r.count());
+}
@@ -0,0 +1,333 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+#include <gtest/gtest.h>
+#include <tawara/block_group.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/merge.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+
+#include "test_utils.h"
+
+
+// Writes a document with one cluster per 100 timecodes. Track n has the UID
+// uid_base + n. Blocks alternate between tracks 1 and 2 every step
+// timecodes, starting at start, and the frame of each block is made of
+// a blob whose size identifies the block. Every fourth block is a BlockGroup
+// with a duration of 7 that refers to the block before it.
+class MergeDocument : public test_utils::TestDocument
+{
+    public:
+        MergeDocument(int64_t date, uint64_t scale, uint64_t uid_base, int start,
+                int step, int count, std::streamsize blob_base)
+            : start_(start), step_(step), count_(count), blob_base_(blob_base)
+        {
+            segment.info.timecode_scale(scale);
+            segment.info.date(date);
+            this->uid_base = uid_base;
+            first_cluster = start - start % 100;
+            cluster_count = (start + (count - 1) * step) / 100 - start / 100 +
+                1;
+        }
+
+    protected:
+        void fill_cluster(tawara::Cluster& cluster, unsigned int)
+        {
+            for (int ii(0); ii < count_; ++ii)
+            {
+                int tc(start_ + ii * step_ -
+                        static_cast<int>(cluster.timecode()));
+                if (tc < 0 || tc >= 100)
+                {
+                    continue;
+                }
+                tawara::BlockElement::Ptr b;
+                if (ii % 4 == 3)
+                {
+                    tawara::BlockGroup* group(new tawara::BlockGroup(
+                                ii % 2 + 1, tc));
+                    group->duration(7);
+                    group->ref_blocks().push_back(-step_);
+                    b.reset(group);
+                }
+                else
+                {
+                    b.reset(new tawara::SimpleBlock(ii % 2 + 1, tc));
+                }
+                b->push_back(test_utils::make_blob(blob_base_ + ii));
+                cluster.push_back(b);
+            }
+        }
+
+    private:
+        int start_;
+        int step_;
+        int count_;
+        std::streamsize blob_base_;
+};
+
+
+TEST(Merge, Merge)
+{
+    std::stringstream in1, in2, output;
+    // The first input starts 1 second after the second input, which has
+    // a timecode scale of 0.5 milliseconds
+    MergeDocument(2000000000, 1000000, 10, 0, 30, 10, 10).write(in1);
+    MergeDocument(1000000000, 500000, 20, 1990, 50, 12, 100).write(in2);
+    std::vector<std::istream*> inputs;
+    inputs.push_back(&in1);
+    inputs.push_back(&in2);
+    in1.seekg(0);
+    in2.seekg(0);
+
+    std::vector<tawara::TrackNumberMap> maps(tawara::merge(inputs, output,
+                100000000));
+    ASSERT_EQ(2, maps.size());
+    EXPECT_EQ(1, maps[0][1]);
+    EXPECT_EQ(2, maps[0][2]);
+    EXPECT_EQ(3, maps[1][1]);
+    EXPECT_EQ(4, maps[1][2]);
+
+    output.seekg(0);
+    EXPECT_EQ(tawara::ids::EBML, tawara::ids::read(output).first);
+    tawara::EBMLElement ebml_el;
+    ebml_el.read(output);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(output).first);
+    tawara::Segment s;
+    s.read(output);
+    EXPECT_EQ(500000, s.info.timecode_scale());
+    EXPECT_EQ(1000000000, s.info.date());
+
+    output.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Tracks)->second));
+    tawara::ids::read(output);
+    tawara::Tracks tracks;
+    tracks.read(output);
+    ASSERT_EQ(4, tracks.count());
+    EXPECT_EQ(11, tracks[1]->uid());
+    EXPECT_EQ(12, tracks[2]->uid());
+    EXPECT_EQ(21, tracks[3]->uid());
+    EXPECT_EQ(22, tracks[4]->uid());
+
+    tawara::FileCluster::TrackSet all;
+    int64_t last(0);
+    int count(0), from_first(0);
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(output, all));
+            block != s.blocks_end_file(output, all); ++block, ++count)
+    {
+        int64_t timestamp(block.timestamp());
+        EXPECT_LE(last, timestamp);
+        last = timestamp;
+        EXPECT_LT(timestamp, 100000000 + static_cast<int64_t>(
+                    block.cluster()->timecode()) * 500000);
+        ASSERT_EQ(1, block->count());
+        std::streamsize size((*block)[0]->size());
+        if (block->track_number() <= 2)
+        {
+            // The frames identify the block in its input
+            EXPECT_EQ((size - 10) % 2 + 1, block->track_number());
+            EXPECT_EQ(from_first + 10, size);
+            EXPECT_EQ(1000000000 + (size - 10) * 30000000, timestamp);
+            ++from_first;
+        }
+        else
+        {
+            EXPECT_EQ((size - 100) % 2 + 3, block->track_number());
+            EXPECT_EQ((1990 + (size - 100) * 50) * 500000, timestamp);
+        }
+        boost::shared_ptr<std::vector<char> > blob(
+                test_utils::make_blob(size));
+        EXPECT_TRUE(*blob == *(*block)[0]);
+        if ((size - 10) % 4 == 3 && block->track_number() <= 2)
+        {
+            tawara::BlockGroup const* group(
+                    dynamic_cast<tawara::BlockGroup const*>(&*block));
+            ASSERT_TRUE(group != 0);
+            // The duration and reference are moved to the finer scale
+            EXPECT_EQ(14, group->duration());
+            ASSERT_EQ(1, group->ref_blocks().size());
+            EXPECT_EQ(-60, group->ref_blocks()[0]);
+        }
+        else if ((size - 100) % 4 == 3 && block->track_number() > 2)
+        {
+            tawara::BlockGroup const* group(
+                    dynamic_cast<tawara::BlockGroup const*>(&*block));
+            ASSERT_TRUE(group != 0);
+            EXPECT_EQ(7, group->duration());
+            ASSERT_EQ(1, group->ref_blocks().size());
+            EXPECT_EQ(-50, group->ref_blocks()[0]);
+        }
+    }
+    EXPECT_EQ(22, count);
+    EXPECT_EQ(10, from_first);
+}
+
+
+TEST(Merge, DuplicateUIDs)
+{
+    std::stringstream in1, in2, output;
+    MergeDocument(0, 1000000, 10, 0, 10, 4, 10).write(in1);
+    MergeDocument(0, 1000000, 11, 5, 10, 4, 20).write(in2);
+    std::vector<std::istream*> inputs;
+    inputs.push_back(&in1);
+    inputs.push_back(&in2);
+    in1.seekg(0);
+    in2.seekg(0);
+    tawara::merge(inputs, output);
+
+    output.seekg(0);
+    tawara::ids::read(output);
+    tawara::EBMLElement ebml_el;
+    ebml_el.read(output);
+    tawara::ids::read(output);
+    tawara::Segment s;
+    s.read(output);
+    output.seekg(s.to_stream_offset(
+                s.index.find(tawara::ids::Tracks)->second));
+    tawara::ids::read(output);
+    tawara::Tracks tracks;
+    tracks.read(output);
+    ASSERT_EQ(4, tracks.count());
+    EXPECT_EQ(11, tracks[1]->uid());
+    EXPECT_EQ(12, tracks[2]->uid());
+    // UID 12 was already taken by the first input
+    EXPECT_EQ(14, tracks[3]->uid());
+    EXPECT_EQ(13, tracks[4]->uid());
+
+    tawara::FileCluster::TrackSet all;
+    std::vector<int64_t> times;
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(output, all));
+            block != s.blocks_end_file(output, all); ++block)
+    {
+        times.push_back(block.timestamp() / 1000000);
+    }
+    ASSERT_EQ(8, times.size());
+    for (int ii(0); ii < 8; ++ii)
+    {
+        EXPECT_EQ(ii * 5, times[ii]);
+    }
+}
+
+
+TEST(Merge, BlockBeforeDate)
+{
+    // The first block is before the start of its cluster, and so before
+    // the segment's date
+    std::stringstream in, output;
+    tawara::EBMLElement ebml_el;
+    ebml_el.write(in);
+    tawara::Segment s;
+    s.write(in);
+    tawara::Tracks tracks;
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(1, 1, "A")));
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(in.tellp())));
+    tracks.write(in);
+    tawara::FileCluster cluster(0);
+    s.index.insert(std::make_pair(cluster.id(),
+                s.to_segment_offset(in.tellp())));
+    cluster.write(in);
+    for (int ii(0); ii < 3; ++ii)
+    {
+        tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1,
+                    -30000 + ii * 10));
+        b->push_back(test_utils::make_blob(10));
+        cluster.push_back(b);
+    }
+    cluster.finalise(in);
+    s.finalise(in);
+
+    std::vector<std::istream*> inputs;
+    inputs.push_back(&in);
+    in.seekg(0);
+    tawara::merge(inputs, output);
+
+    // The merged date is moved back to the first block
+    output.seekg(0);
+    tawara::read_tawara_header(output);
+    tawara::ids::read(output);
+    tawara::Segment r;
+    r.read(output);
+    EXPECT_EQ(-30000 * 1000000LL, r.info.date());
+    tawara::FileCluster::TrackSet all;
+    std::vector<int64_t> times;
+    for (tawara::Segment::FilteredBlockIterator
+            block(r.blocks_begin_file(output, all));
+            block != r.blocks_end_file(output, all); ++block)
+    {
+        times.push_back(block.timestamp());
+    }
+    ASSERT_EQ(3, times.size());
+    EXPECT_EQ(0, times[0]);
+    EXPECT_EQ(20000000, times[2]);
+}
+
+
+TEST(Merge, UnknownTrack)
+{
+    std::stringstream in1, in2, output;
+    MergeDocument(0, 1000000, 10, 0, 10, 4, 10).write(in1);
+    // The blocks of track 2 have no TrackEntry
+    MergeDocument missing(0, 1000000, 20, 5, 10, 4, 20);
+    missing.track_count = 1;
+    missing.write(in2);
+    std::vector<std::istream*> inputs;
+    inputs.push_back(&in1);
+    inputs.push_back(&in2);
+    in1.seekg(0);
+    in2.seekg(0);
+    EXPECT_THROW(tawara::merge(inputs, output), tawara::UnknownTrack);
+}
+
+
+TEST(Merge, NotTawara)
+{
+    std::stringstream in, output;
+    in << "not a tawara document";
+    std::vector<std::istream*> inputs;
+    inputs.push_back(&in);
+    EXPECT_THROW(tawara::merge(inputs, output), tawara::NotEBML);
+}
+
@@ -0,0 +1,212 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/filesystem.hpp>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/profile.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+
+#include "test_consts.h"
+#include "test_utils.h"
+
+
+// Writes a document with ten clusters of 100 time units. Track 1 has a
+// block every 10 units; track 2 has a block every 50 units, with a jitter of
+// one unit, holding a fixed lace of two frames.
+class ProfileDocument : public test_utils::TestDocument
+{
+    public:
+        ProfileDocument()
+        {
+            cluster_count = 10;
+        }
+
+        void write(std::string const& path)
+        {
+            std::fstream stream(path.c_str(), std::ios::in | std::ios::out |
+                    std::ios::trunc | std::ios::binary);
+            test_utils::TestDocument::write(stream);
+        }
+
+    protected:
+        void fill_cluster(tawara::Cluster& cluster, unsigned int)
+        {
+            for (int ii(0); ii < 10; ++ii)
+            {
+                tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1,
+                            ii * 10));
+                b->push_back(test_utils::make_blob(10));
+                cluster.push_back(b);
+                if (ii % 5 == 0)
+                {
+                    tawara::BlockElement::Ptr l(new tawara::SimpleBlock(2,
+                                ii * 10 + (ii == 0 ? 0 : 1)));
+                    l->lacing(tawara::Block::LACING_FIXED);
+                    l->push_back(test_utils::make_blob(20));
+                    l->push_back(test_utils::make_blob(20));
+                    cluster.push_back(l);
+                }
+            }
+        }
+};
+
+
+TEST(Profile, Tracks)
+{
+    std::string path((test_bin_dir / "profile.tawara").string());
+    ProfileDocument().write(path);
+    for (unsigned int threads(0); threads < 5; ++threads)
+    {
+        tawara::ProfileReport report(tawara::profile(path, threads));
+        EXPECT_EQ(1000000, report.timecode_scale);
+        EXPECT_EQ(10, report.clusters);
+        EXPECT_EQ(0, report.bad_clusters);
+        EXPECT_EQ(120, report.blocks);
+        EXPECT_LT(0, report.bytes);
+        EXPECT_LE(1, report.threads);
+        ASSERT_EQ(2, report.tracks.size());
+
+        tawara::TrackProfile const& t1(report.tracks[1]);
+        EXPECT_EQ(100, t1.blocks);
+        EXPECT_EQ(0, t1.first);
+        EXPECT_EQ(990, t1.last);
+        EXPECT_EQ(99, t1.gaps);
+        EXPECT_EQ(10, t1.min_gap);
+        EXPECT_EQ(10, t1.max_gap);
+        EXPECT_DOUBLE_EQ(10, t1.mean_gap());
+        EXPECT_NEAR(0, t1.jitter(), 1e-6);
+        EXPECT_EQ(100, t1.lacing[tawara::Block::LACING_NONE]);
+
+        tawara::TrackProfile const& t2(report.tracks[2]);
+        EXPECT_EQ(20, t2.blocks);
+        EXPECT_EQ(19, t2.gaps);
+        EXPECT_EQ(49, t2.min_gap);
+        EXPECT_EQ(51, t2.max_gap);
+        EXPECT_LT(0.9, t2.jitter());
+        EXPECT_EQ(20, t2.lacing[tawara::Block::LACING_FIXED]);
+        EXPECT_EQ(0, t2.lacing[tawara::Block::LACING_NONE]);
+        EXPECT_LT(t1.bytes, t2.bytes * 5);
+
+        uint64_t histogram_total(0);
+        for (std::size_t ii(0); ii < report.cluster_sizes.size(); ++ii)
+        {
+            histogram_total += report.cluster_sizes[ii];
+        }
+        EXPECT_EQ(10, histogram_total);
+    }
+    boost::filesystem::remove(path);
+}
+
+
+TEST(Profile, DamagedCluster)
+{
+    std::string path((test_bin_dir / "profile_damaged.tawara").string());
+    ProfileDocument().write(path);
+    // Break the ID of the first block of the fourth cluster
+    std::fstream stream(path.c_str(), std::ios::in | std::ios::out |
+            std::ios::binary);
+    std::string data((std::istreambuf_iterator<char>(stream)),
+            std::istreambuf_iterator<char>());
+    std::string const cluster_id("\x1F\x43\xB6\x75");
+    std::string::size_type cluster(0);
+    for (int ii(0); ii < 4; ++ii)
+    {
+        cluster = data.find(cluster_id, ii == 0 ? 0 : cluster + 1);
+        ASSERT_NE(std::string::npos, cluster);
+    }
+    std::string::size_type block(data.find('\xA3', cluster));
+    ASSERT_NE(std::string::npos, block);
+    stream.clear();
+    stream.seekp(block);
+    stream.put(0);
+    stream.close();
+
+    tawara::ProfileReport report(tawara::profile(path, 2));
+    EXPECT_EQ(9, report.clusters);
+    EXPECT_EQ(1, report.bad_clusters);
+    EXPECT_EQ(108, report.blocks);
+    ASSERT_EQ(1, report.errors.size());
+    EXPECT_EQ(static_cast<std::streamsize>(cluster),
+            report.errors.begin()->first);
+    EXPECT_FALSE(report.errors.begin()->second.empty());
+    boost::filesystem::remove(path);
+}
+
+
+TEST(Profile, Merge)
+{
+    tawara::TrackProfile a, b, all;
+    for (int ii(0); ii < 10; ++ii)
+    {
+        tawara::TrackProfile& half(ii < 4 ? a : b);
+        half.add(ii * ii, 5, tawara::Block::LACING_NONE);
+        all.add(ii * ii, 5, tawara::Block::LACING_NONE);
+    }
+    tawara::TrackProfile merged;
+    merged += a;
+    merged += tawara::TrackProfile();
+    merged += b;
+    EXPECT_EQ(all.blocks, merged.blocks);
+    EXPECT_EQ(all.bytes, merged.bytes);
+    EXPECT_EQ(all.first, merged.first);
+    EXPECT_EQ(all.last, merged.last);
+    EXPECT_EQ(all.gaps, merged.gaps);
+    EXPECT_EQ(all.min_gap, merged.min_gap);
+    EXPECT_EQ(all.max_gap, merged.max_gap);
+    EXPECT_DOUBLE_EQ(all.mean_gap(), merged.mean_gap());
+    EXPECT_DOUBLE_EQ(all.jitter(), merged.jitter());
+    EXPECT_EQ(81, merged.span());
+}
+
+
+TEST(Profile, BadFile)
+{
+    EXPECT_THROW(tawara::profile((test_bin_dir / "nonexistent").string()),
+            tawara::ReadError);
+    EXPECT_THROW(tawara::profile((test_source_dir / "not_ebml.tawara").string()),
+            tawara::NotEBML);
+}
@@ -0,0 +1,215 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/foreach.hpp>
+#include <gtest/gtest.h>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/reindex.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+
+#include "test_utils.h"
+
+
+// Writes a document with three clusters, at timecodes 0, 100 and 200. The
+// first has only blocks for track 2, the others for tracks 1 and 2. If
+// old_cues is true, Cues pointing at the start of the segment are written
+// after the clusters.
+class ReindexDocument : public test_utils::TestDocument
+{
+    public:
+        ReindexDocument(std::streamsize pad_size, bool old_cues=false)
+        {
+            segment.pad_size(pad_size);
+            segment.info.title("reindex");
+            if (old_cues)
+            {
+                tawara::Cues* cues(new tawara::Cues);
+                tawara::CuePoint point(0);
+                point.push_back(tawara::CueTrackPosition(1, 0));
+                cues->insert(point);
+                tail.push_back(test_utils::ElPtr(cues));
+            }
+        }
+
+    protected:
+        tawara::BlockElement::Ptr make_block(unsigned int cluster,
+                unsigned int block)
+        {
+            tawara::BlockElement::Ptr b(
+                    test_utils::TestDocument::make_block(cluster, block));
+            if (cluster == 0)
+            {
+                b->track_number(2);
+            }
+            return b;
+        }
+};
+
+
+// Opens a reindexed document and reads its cues, checking that each points
+// at a cluster with the cue's timecode.
+void read_reindexed(std::iostream& stream, tawara::Segment& s,
+        tawara::Cues& cues)
+{
+    stream.seekg(0);
+    tawara::read_tawara_header(stream);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(stream).first);
+    s.read(stream);
+    EXPECT_EQ("reindex", s.info.title());
+    size_t cues_entries(0);
+    BOOST_FOREACH(tawara::SeekHead::value_type const& entry, s.index)
+    {
+        cues_entries += entry.first == tawara::ids::Cues ? 1 : 0;
+    }
+    ASSERT_EQ(1, cues_entries);
+    stream.seekg(s.to_stream_offset(s.index.find(tawara::ids::Cues)->second));
+    EXPECT_EQ(tawara::ids::Cues, tawara::ids::read(stream).first);
+    cues.read(stream);
+    ASSERT_EQ(3, cues.count());
+    BOOST_FOREACH(tawara::Cues::value_type const& point, cues)
+    {
+        BOOST_FOREACH(tawara::CueTrackPosition const& ctp, point.second)
+        {
+            stream.seekg(s.to_stream_offset(ctp.cluster_pos()));
+            EXPECT_EQ(tawara::ids::Cluster, tawara::ids::read(stream).first);
+            tawara::FileCluster cluster;
+            cluster.read(stream);
+            EXPECT_EQ(point.first, cluster.timecode());
+        }
+    }
+    EXPECT_EQ(1, cues.find(0)->second.count());
+    EXPECT_EQ(2, cues.find(0)->second[0].track());
+    EXPECT_EQ(2, cues.find(100)->second.count());
+    EXPECT_EQ(1, cues.find(100)->second[0].track());
+    EXPECT_EQ(2, cues.find(100)->second[1].track());
+
+    // The blocks are unchanged
+    tawara::FileCluster::TrackSet all;
+    size_t count(0);
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(stream, all));
+            block != s.blocks_end_file(stream, all); ++block, ++count)
+    {
+        EXPECT_EQ(10 + count, (*block)[0]->size());
+    }
+    EXPECT_EQ(18, count);
+}
+
+
+TEST(Reindex, InPadding)
+{
+    std::stringstream stream;
+    ReindexDocument(4096).write(stream);
+    std::streamsize size(stream.str().size());
+    tawara::reindex(stream);
+    // Everything fits in the padding
+    EXPECT_EQ(size, stream.str().size());
+
+    tawara::Segment s;
+    tawara::Cues cues;
+    read_reindexed(stream, s, cues);
+    EXPECT_LT(s.index.find(tawara::ids::Cues)->second,
+            s.index.find(tawara::ids::Cluster)->second);
+    EXPECT_EQ(1, cues.find(100)->second[0].block_num());
+}
+
+
+TEST(Reindex, AtEnd)
+{
+    std::stringstream stream;
+    ReindexDocument(10).write(stream);
+    std::streamsize size(stream.str().size());
+    tawara::reindex(stream);
+    EXPECT_LT(size, stream.str().size());
+
+    tawara::Segment s;
+    tawara::Cues cues;
+    read_reindexed(stream, s, cues);
+    EXPECT_GT(s.index.find(tawara::ids::Cues)->second,
+            s.index.find(tawara::ids::Cluster)->second);
+}
+
+
+TEST(Reindex, BlockNumbers)
+{
+    std::stringstream stream;
+    ReindexDocument(4096).write(stream);
+    tawara::reindex(stream, true);
+
+    tawara::Segment s;
+    tawara::Cues cues;
+    read_reindexed(stream, s, cues);
+    EXPECT_EQ(1, cues.find(0)->second[0].block_num());
+    EXPECT_EQ(1, cues.find(100)->second[0].block_num());
+    EXPECT_EQ(2, cues.find(100)->second[1].block_num());
+}
+
+
+TEST(Reindex, ReplaceCues)
+{
+    std::stringstream stream;
+    ReindexDocument(4096, true).write(stream);
+    tawara::reindex(stream);
+
+    tawara::Segment s;
+    tawara::Cues cues;
+    read_reindexed(stream, s, cues);
+    // Reindexing again gives the same document
+    std::string once(stream.str());
+    stream.seekg(0);
+    tawara::reindex(stream);
+    EXPECT_EQ(once, stream.str());
+}
+
+
+TEST(Reindex, NoSpace)
+{
+    std::stringstream stream;
+    ReindexDocument(10).write(stream);
+    // Something after the segment prevents it from growing
+    tawara::EBMLElement ebml_el;
+    ebml_el.write(stream);
+    EXPECT_THROW(tawara::reindex(stream), tawara::NoIndexSpace);
+}
+
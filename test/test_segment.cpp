@@ -37,11 +37,15 @@
  */
 
 #include <gtest/gtest.h>
+#include <tawara/block_group.h>
+#include <tawara/cues.h>
 #include <tawara/el_ids.h>
+#include <tawara/file_cluster.h>
 #include <tawara/exceptions.h>
 #include <tawara/memory_cluster.h>
 #include <tawara/segment.h>
 #include <tawara/segment_info.h>
+#include <tawara/simple_block.h>
 #include <tawara/track_entry.h>
 #include <tawara/tracks.h>
 #include <tawara/vint.h>
@@ -218,3 +222,360 @@ TEST(Segment, Read)
     EXPECT_THROW(s.read(input), tawara::BadBodySize);
 }
 
+
+TEST(Segment, FilteredBlocks)
+{
+    std::stringstream stream;
+    tawara::Segment s(200);
+    s.write(stream);
+    tawara::Tracks tracks;
+    for (int ii(1); ii <= 3; ++ii)
+    {
+        tawara::TrackEntry::Ptr track(new tawara::TrackEntry(ii, ii, "MDCC"));
+        tracks.insert(track);
+    }
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+
+    // The first cluster contains blocks from all tracks
+    tawara::FileCluster c1(0);
+    s.index.insert(std::make_pair(c1.id(),
+                s.to_segment_offset(stream.tellp())));
+    c1.write(stream);
+    for (int ii(0); ii < 9; ++ii)
+    {
+        tawara::BlockElement::Ptr b;
+        if (ii % 3 == 1)
+        {
+            b.reset(new tawara::BlockGroup(ii % 3 + 1, ii));
+        }
+        else
+        {
+            b.reset(new tawara::SimpleBlock(ii % 3 + 1, ii));
+        }
+        b->push_back(test_utils::make_blob(50 * (ii % 3 + 1)));
+        c1.push_back(b);
+    }
+    c1.finalise(stream);
+    // The second cluster contains no blocks from track 2
+    tawara::MemoryCluster c2(100);
+    c2.write(stream);
+    for (int ii(0); ii < 4; ++ii)
+    {
+        tawara::BlockElement::Ptr b(new tawara::SimpleBlock(ii % 2 ? 3 : 1,
+                    ii));
+        b->push_back(test_utils::make_blob(10));
+        c2.push_back(b);
+    }
+    c2.finalise(stream);
+    // The third cluster contains only a block from track 2
+    tawara::FileCluster c3(200);
+    c3.write(stream);
+    tawara::BlockElement::Ptr b(new tawara::SimpleBlock(2, 5));
+    b->push_back(test_utils::make_blob(100));
+    c3.push_back(b);
+    c3.finalise(stream);
+    s.finalise(stream);
+
+    stream.seekg(tawara::ids::size(tawara::ids::Segment));
+    tawara::Segment r;
+    r.read(stream);
+
+    tawara::FileCluster::TrackSet selected;
+    selected.insert(2);
+    std::vector<std::pair<uint64_t, int16_t> > found;
+    for (tawara::Segment::FilteredBlockIterator
+            block(r.blocks_begin_file(stream, selected));
+            block != r.blocks_end_file(stream, selected); ++block)
+    {
+        EXPECT_EQ(2, block->track_number());
+        EXPECT_EQ(1, block->count());
+        EXPECT_EQ(100, (*block)[0]->size());
+        found.push_back(std::make_pair(block.cluster()->timecode(),
+                    block->timecode()));
+    }
+    ASSERT_EQ(4, found.size());
+    EXPECT_EQ(0, found[0].first);
+    EXPECT_EQ(1, found[0].second);
+    EXPECT_EQ(4, found[1].second);
+    EXPECT_EQ(7, found[2].second);
+    EXPECT_EQ(200, found[3].first);
+    EXPECT_EQ(5, found[3].second);
+
+    // Multiple tracks, matching the order of the unfiltered blocks
+    selected.insert(3);
+    int count(0);
+    tawara::Segment::FileBlockIterator all(r.blocks_begin_file(stream));
+    for (tawara::Segment::FilteredBlockIterator
+            block(r.blocks_begin_file(stream, selected));
+            block != r.blocks_end_file(stream, selected); ++block, ++all)
+    {
+        while (all->track_number() == 1)
+        {
+            ++all;
+        }
+        EXPECT_EQ(all->track_number(), block->track_number());
+        EXPECT_EQ(all->timecode(), block->timecode());
+        ++count;
+    }
+    EXPECT_EQ(9, count);
+
+    // No matching blocks
+    selected.clear();
+    selected.insert(42);
+    EXPECT_TRUE(r.blocks_begin_file(stream, selected) ==
+            r.blocks_end_file(stream, selected));
+}
+
+
+
+TEST(Segment, ToTimecode)
+{
+    tawara::Segment s;
+    s.info.timecode_scale(1000);
+    EXPECT_EQ(0, s.to_timecode(0));
+    EXPECT_EQ(1, s.to_timecode(1));
+    EXPECT_EQ(1, s.to_timecode(1000));
+    EXPECT_EQ(2, s.to_timecode(1001));
+    EXPECT_EQ(0, s.to_timecode(-999));
+    EXPECT_EQ(-1, s.to_timecode(-1000));
+}
+
+
+// Writes a segment with four clusters, at timecodes 0, 100, 200 and 300,
+// each containing blocks for tracks 1 and 2 at 0, 25, 50 and 75.
+void write_range_segment(std::iostream& stream, bool with_cues,
+        std::streamsize summary_pad=0)
+{
+    tawara::Segment s;
+    s.write(stream);
+    tawara::Tracks tracks;
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(1, 1, "A")));
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(2, 2, "B")));
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+    tawara::Cues cues;
+    for (int ii(0); ii < 4; ++ii)
+    {
+        tawara::FileCluster cluster(ii * 100);
+        std::streamsize pos(s.to_segment_offset(stream.tellp()));
+        if (ii == 0)
+        {
+            s.index.insert(std::make_pair(cluster.id(), pos));
+        }
+        tawara::CuePoint cp(ii * 100);
+        cp.push_back(tawara::CueTrackPosition(1, pos));
+        cues.insert(cp);
+        cluster.summary_pad(summary_pad);
+        cluster.write(stream);
+        for (int jj(0); jj < 8; ++jj)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(jj % 2 + 1,
+                        (jj / 2) * 25));
+            b->push_back(test_utils::make_blob(20));
+            cluster.push_back(b);
+        }
+        cluster.finalise(stream);
+    }
+    if (with_cues)
+    {
+        s.index.insert(std::make_pair(cues.id(),
+                    s.to_segment_offset(stream.tellp())));
+        cues.write(stream);
+    }
+    s.finalise(stream);
+}
+
+
+void check_range(std::iostream& stream)
+{
+    stream.seekg(tawara::ids::size(tawara::ids::Segment));
+    tawara::Segment s;
+    s.read(stream);
+
+    tawara::FileCluster::TrackSet selected;
+    selected.insert(2);
+    std::vector<int64_t> found;
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_in_range(stream, 130000000, 260000000, selected));
+            block != s.blocks_end_file(stream, selected); ++block)
+    {
+        EXPECT_EQ(2, block->track_number());
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(5, found.size());
+    EXPECT_EQ(150000000, found[0]);
+    EXPECT_EQ(175000000, found[1]);
+    EXPECT_EQ(200000000, found[2]);
+    EXPECT_EQ(225000000, found[3]);
+    EXPECT_EQ(250000000, found[4]);
+
+    // All tracks, with a range ending exactly on a block
+    selected.clear();
+    found.clear();
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_in_range(stream, 0, 25000000, selected));
+            block != s.blocks_end_file(stream, selected); ++block)
+    {
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(2, found.size());
+    EXPECT_EQ(0, found[0]);
+    EXPECT_EQ(0, found[1]);
+
+    // A range after the end
+    EXPECT_TRUE(s.blocks_in_range(stream, 400000000, 500000000, selected) ==
+            s.blocks_end_file(stream, selected));
+    // A range between blocks
+    EXPECT_TRUE(s.blocks_in_range(stream, 376000000, 399000000, selected) ==
+            s.blocks_end_file(stream, selected));
+}
+
+
+TEST(Segment, BlocksInRange)
+{
+    std::stringstream stream;
+    write_range_segment(stream, false);
+    check_range(stream);
+}
+
+
+TEST(Segment, BlocksInRangeWithCues)
+{
+    std::stringstream stream;
+    write_range_segment(stream, true);
+    check_range(stream);
+}
+
+
+TEST(Segment, ClustersAtTimeUsesCues)
+{
+    std::stringstream stream;
+    write_range_segment(stream, true);
+    stream.seekg(tawara::ids::size(tawara::ids::Segment));
+    tawara::Segment s;
+    s.read(stream);
+    std::vector<std::streampos> offsets;
+    for (tawara::Segment::FileClusterIterator
+            cluster(s.clusters_begin_file(stream));
+            cluster != s.clusters_end_file(stream); ++cluster)
+    {
+        offsets.push_back(cluster->offset());
+    }
+    ASSERT_EQ(4, offsets.size());
+    stream.clear();
+
+    // Damage the first two clusters; only a search that jumps past them
+    // using the cues can succeed. (Getting the end iterator reads the first
+    // cluster, so it cannot be used after this.)
+    for (int ii(0); ii < 2; ++ii)
+    {
+        stream.seekp(offsets[ii]);
+        stream.put(static_cast<char>(0xBF));
+    }
+    tawara::Segment::FileClusterIterator
+        cluster(s.clusters_at_time(stream, 250000000));
+    EXPECT_EQ(200, cluster->timecode());
+    EXPECT_EQ(offsets[2], cluster->offset());
+    EXPECT_EQ(offsets[2], s.clusters_at_time(stream, 200000000)->offset());
+    EXPECT_EQ(offsets[3], s.clusters_at_time(stream, 300000000)->offset());
+    EXPECT_EQ(offsets[3], s.clusters_at_time(stream, 900000000)->offset());
+    EXPECT_THROW(s.clusters_at_time(stream, 150000000),
+            tawara::InvalidChildID);
+}
+
+
+TEST(Segment, BlocksInRangeWithSummaries)
+{
+    std::stringstream stream;
+    write_range_segment(stream, true, 64);
+    check_range(stream);
+}
+
+
+TEST(Segment, SummarySkipsClusters)
+{
+    std::stringstream stream;
+    tawara::Segment s;
+    s.write(stream);
+    tawara::Tracks tracks;
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(1, 1, "A")));
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(2, 2, "B")));
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+
+    // The first cluster holds only track 1 blocks at timecode 0
+    tawara::FileCluster c1(0);
+    c1.summary_pad(64);
+    s.index.insert(std::make_pair(c1.id(),
+                s.to_segment_offset(stream.tellp())));
+    c1.write(stream);
+    std::streampos corrupt_pos(0);
+    for (int ii(0); ii < 3; ++ii)
+    {
+        if (ii == 1)
+        {
+            corrupt_pos = stream.tellp();
+        }
+        tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, 0));
+        b->push_back(test_utils::make_blob(20));
+        c1.push_back(b);
+    }
+    c1.finalise(stream);
+    // The second cluster holds blocks from both tracks
+    tawara::MemoryCluster c2(100);
+    c2.summary_pad(64);
+    c2.write(stream);
+    for (int ii(0); ii < 2; ++ii)
+    {
+        tawara::BlockElement::Ptr b(new tawara::SimpleBlock(ii + 1, 5 + ii));
+        b->push_back(test_utils::make_blob(20));
+        c2.push_back(b);
+    }
+    c2.finalise(stream);
+    s.finalise(stream);
+    // Damage the second block of the first cluster; reading its header
+    // would throw, so only a cluster skipped using its summary can be
+    // iterated over
+    stream.seekp(corrupt_pos);
+    stream.put(static_cast<char>(0xBF));
+
+    stream.seekg(tawara::ids::size(tawara::ids::Segment));
+    tawara::Segment r;
+    r.read(stream);
+
+    tawara::FileCluster::TrackSet selected;
+    selected.insert(2);
+    std::vector<int64_t> found;
+    for (tawara::Segment::FilteredBlockIterator
+            block(r.blocks_begin_file(stream, selected));
+            block != r.blocks_end_file(stream, selected); ++block)
+    {
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(1, found.size());
+    EXPECT_EQ(106000000, found[0]);
+
+    // The first cluster is in range, but its blocks are not
+    selected.clear();
+    found.clear();
+    for (tawara::Segment::FilteredBlockIterator
+            block(r.blocks_in_range(stream, 1000000, 200000000, selected));
+            block != r.blocks_end_file(stream, selected); ++block)
+    {
+        found.push_back(block.timestamp());
+    }
+    ASSERT_EQ(2, found.size());
+    EXPECT_EQ(105000000, found[0]);
+    EXPECT_EQ(106000000, found[1]);
+
+    // Without a filter, the damaged block is read
+    EXPECT_THROW(for (tawara::Segment::FilteredBlockIterator
+                block(r.blocks_begin_file(stream, selected));
+                block != r.blocks_end_file(stream, selected); ++block);,
+            tawara::InvalidChildID);
+}
+
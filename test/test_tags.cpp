@@ -0,0 +1,405 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/foreach.hpp>
+#include <gtest/gtest.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/tag_update.h>
+#include <tawara/tags.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+#include <tawara/vint.h>
+
+#include "test_utils.h"
+
+
+// Makes a tag for track 1 with a title and a nested SimpleTag.
+tawara::Tag make_tag(std::string const& title)
+{
+    tawara::Tag tag;
+    std::vector<uint64_t> uids(1, 1);
+    tag.targets().track_uids(uids);
+    tawara::SimpleTag st("TITLE", title);
+    st.children().push_back(tawara::SimpleTag("SORT_WITH", "x" + title));
+    tag.simple_tags().push_back(st);
+    return tag;
+}
+
+
+TEST(Targets, Empty)
+{
+    tawara::Targets targets;
+    EXPECT_TRUE(targets.empty());
+    std::vector<uint64_t> uids(1, 5);
+    targets.chapter_uids(uids);
+    EXPECT_FALSE(targets.empty());
+    EXPECT_EQ(uids, targets.chapter_uids());
+}
+
+
+TEST(Targets, WriteRead)
+{
+    tawara::Targets targets;
+    std::vector<uint64_t> uids;
+    uids.push_back(1);
+    uids.push_back(300);
+    targets.track_uids(uids);
+    targets.attachment_uids(std::vector<uint64_t>(1, 42));
+
+    std::stringstream stream;
+    EXPECT_EQ(targets.size(), targets.write(stream));
+    EXPECT_EQ(targets.size(), stream.str().size());
+    EXPECT_EQ(tawara::ids::Targets, tawara::ids::read(stream).first);
+    tawara::Targets read;
+    EXPECT_EQ(targets.size() - tawara::ids::size(tawara::ids::Targets),
+            read.read(stream));
+    EXPECT_TRUE(targets == read);
+    EXPECT_EQ(uids, read.track_uids());
+    EXPECT_TRUE(read.edition_uids().empty());
+}
+
+
+TEST(SimpleTag, Create)
+{
+    tawara::SimpleTag st;
+    EXPECT_EQ("", st.name());
+    EXPECT_EQ("und", st.language());
+    EXPECT_TRUE(st.default_flag());
+    EXPECT_FALSE(st.has_string());
+    EXPECT_FALSE(st.has_binary());
+    EXPECT_TRUE(st.children().empty());
+
+    tawara::SimpleTag st2("ARTIST", "someone");
+    EXPECT_EQ("ARTIST", st2.name());
+    EXPECT_TRUE(st2.has_string());
+    EXPECT_EQ("someone", st2.string());
+}
+
+
+TEST(SimpleTag, Value)
+{
+    tawara::SimpleTag st("NAME", "value");
+    std::vector<char> data(3, 'b');
+    st.binary(data);
+    EXPECT_TRUE(st.has_binary());
+    EXPECT_FALSE(st.has_string());
+    EXPECT_EQ(data, st.binary());
+    st.string("s");
+    EXPECT_TRUE(st.has_string());
+    EXPECT_FALSE(st.has_binary());
+    st.clear_value();
+    EXPECT_FALSE(st.has_string());
+    EXPECT_FALSE(st.has_binary());
+}
+
+
+TEST(SimpleTag, WriteRead)
+{
+    tawara::SimpleTag st("COMMENT", "hello");
+    st.language("jpn");
+    st.default_flag(false);
+    tawara::SimpleTag child("BIN", "");
+    child.binary(std::vector<char>(5, 'x'));
+    st.children().push_back(child);
+    st.children().push_back(tawara::SimpleTag("EMPTY", ""));
+
+    std::stringstream stream;
+    EXPECT_EQ(st.size(), st.write(stream));
+    EXPECT_EQ(st.size(), stream.str().size());
+    EXPECT_EQ(tawara::ids::SimpleTag, tawara::ids::read(stream).first);
+    tawara::SimpleTag read;
+    read.read(stream);
+    EXPECT_TRUE(st == read);
+    EXPECT_EQ("jpn", read.language());
+    EXPECT_FALSE(read.default_flag());
+    ASSERT_EQ(2, read.children().size());
+    EXPECT_EQ(std::vector<char>(5, 'x'), read.children()[0].binary());
+    EXPECT_TRUE(read.children()[1].has_string());
+}
+
+
+TEST(SimpleTag, DefaultsNotWritten)
+{
+    tawara::SimpleTag st("A", "b");
+    tawara::StringElement name(tawara::ids::TagName, "A");
+    tawara::StringElement value(tawara::ids::TagString, "b");
+    EXPECT_EQ(tawara::ids::size(tawara::ids::SimpleTag) +
+            tawara::vint::size(name.size() + value.size()) +
+            name.size() + value.size(), st.size());
+}
+
+
+TEST(SimpleTag, ReadErrors)
+{
+    std::stringstream stream;
+    tawara::StringElement name(tawara::ids::TagName, "A");
+    tawara::StringElement value(tawara::ids::TagString, "b");
+    tawara::BinaryElement bin(tawara::ids::TagBinary,
+            std::vector<char>(1, 'c'));
+    tawara::vint::write(name.size() + value.size() + bin.size(), stream);
+    name.write(stream);
+    value.write(stream);
+    bin.write(stream);
+    tawara::SimpleTag st;
+    EXPECT_THROW(st.read(stream), tawara::TagStringAndBinary);
+
+    stream.str(std::string());
+    tawara::vint::write(value.size(), stream);
+    value.write(stream);
+    EXPECT_THROW(st.read(stream), tawara::MissingChild);
+}
+
+
+TEST(Tag, WriteRead)
+{
+    tawara::Tag tag(make_tag("first"));
+    std::stringstream stream;
+    EXPECT_EQ(tag.size(), tag.write(stream));
+    EXPECT_EQ(tawara::ids::Tag, tawara::ids::read(stream).first);
+    tawara::Tag read;
+    read.read(stream);
+    EXPECT_TRUE(tag == read);
+    EXPECT_EQ(1, read.targets().track_uids()[0]);
+    EXPECT_EQ("xfirst", read.simple_tags()[0].children()[0].string());
+
+    tawara::Tag empty;
+    EXPECT_THROW(empty.write(stream), tawara::NoSimpleTags);
+}
+
+
+TEST(Tags, WriteRead)
+{
+    tawara::Tags tags;
+    std::stringstream stream;
+    EXPECT_THROW(tags.write(stream), tawara::NoTags);
+    tags.push_back(make_tag("a"));
+    tags.push_back(make_tag("b"));
+    EXPECT_EQ(2, tags.count());
+    stream.str(std::string());
+    EXPECT_EQ(tags.size(), tags.write(stream));
+    EXPECT_EQ(tawara::ids::Tags, tawara::ids::read(stream).first);
+    tawara::Tags read;
+    read.read(stream);
+    EXPECT_TRUE(tags == read);
+    EXPECT_EQ("b", read[1].simple_tags()[0].string());
+}
+
+
+// Writes a document with tags before its two clusters.
+void write_tagged(std::iostream& stream, std::streamsize pad_size,
+        tawara::Tags& tags, std::streamsize tags_padding)
+{
+    tawara::EBMLElement ebml_el;
+    ebml_el.write(stream);
+    tawara::Segment s(pad_size);
+    s.info.title("tags");
+    s.write(stream);
+    tawara::Tracks tracks;
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(1, 1, "A")));
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+    tawara::write_tags(stream, s, tags, tags_padding);
+    for (int ii(0); ii < 2; ++ii)
+    {
+        tawara::FileCluster cluster(ii * 100);
+        if (ii == 0)
+        {
+            s.index.insert(std::make_pair(cluster.id(),
+                        s.to_segment_offset(stream.tellp())));
+        }
+        cluster.write(stream);
+        for (int jj(0); jj < 4; ++jj)
+        {
+            tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, jj));
+            b->push_back(test_utils::make_blob(10 + jj));
+            cluster.push_back(b);
+        }
+        cluster.finalise(stream);
+    }
+    s.finalise(stream);
+}
+
+
+// Opens a document and reads its tags, checking that the blocks are intact.
+void read_tagged(std::iostream& stream, tawara::Segment& s,
+        tawara::Tags& tags)
+{
+    stream.seekg(0);
+    tawara::read_tawara_header(stream);
+    EXPECT_EQ(tawara::ids::Segment, tawara::ids::read(stream).first);
+    s.read(stream);
+    EXPECT_EQ("tags", s.info.title());
+    size_t tags_entries(0);
+    BOOST_FOREACH(tawara::SeekHead::value_type const& entry, s.index)
+    {
+        tags_entries += entry.first == tawara::ids::Tags ? 1 : 0;
+    }
+    ASSERT_EQ(1, tags_entries);
+    stream.seekg(s.to_stream_offset(s.index.find(tawara::ids::Tags)->second));
+    EXPECT_EQ(tawara::ids::Tags, tawara::ids::read(stream).first);
+    tags.read(stream);
+
+    tawara::FileCluster::TrackSet all;
+    size_t count(0);
+    for (tawara::Segment::FilteredBlockIterator
+            block(s.blocks_begin_file(stream, all));
+            block != s.blocks_end_file(stream, all); ++block, ++count)
+    {
+        EXPECT_EQ(10 + count % 4, (*block)[0]->size());
+    }
+    EXPECT_EQ(8, count);
+}
+
+
+TEST(TagUpdate, WriteTags)
+{
+    tawara::Tags tags;
+    tags.push_back(make_tag("first"));
+    std::stringstream stream;
+    write_tagged(stream, 4096, tags, 100);
+
+    tawara::Segment s;
+    tawara::Tags read;
+    read_tagged(stream, s, read);
+    EXPECT_TRUE(tags == read);
+    EXPECT_LT(s.index.find(tawara::ids::Tags)->second,
+            s.index.find(tawara::ids::Cluster)->second);
+}
+
+
+TEST(TagUpdate, InPlace)
+{
+    tawara::Tags tags;
+    tags.push_back(make_tag("first"));
+    std::stringstream stream;
+    write_tagged(stream, 4096, tags, 100);
+    std::streamsize size(stream.str().size());
+    tawara::Segment before;
+    tawara::Tags read;
+    read_tagged(stream, before, read);
+
+    // Grow into the padding, then shrink again
+    tags.push_back(make_tag("second"));
+    stream.seekg(0);
+    tawara::update_tags(stream, tags);
+    EXPECT_EQ(size, stream.str().size());
+    tawara::Segment s;
+    read_tagged(stream, s, read);
+    EXPECT_TRUE(tags == read);
+    EXPECT_EQ(before.index.find(tawara::ids::Tags)->second,
+            s.index.find(tawara::ids::Tags)->second);
+
+    tags.erase(tags.begin());
+    stream.seekg(0);
+    tawara::update_tags(stream, tags);
+    EXPECT_EQ(size, stream.str().size());
+    read_tagged(stream, s, read);
+    EXPECT_TRUE(tags == read);
+    EXPECT_EQ(before.index.find(tawara::ids::Tags)->second,
+            s.index.find(tawara::ids::Tags)->second);
+}
+
+
+TEST(TagUpdate, IntoSegmentPadding)
+{
+    tawara::Tags tags;
+    tags.push_back(make_tag("first"));
+    std::stringstream stream;
+    write_tagged(stream, 4096, tags, 0);
+    std::streamsize size(stream.str().size());
+
+    tags[0].simple_tags()[0].string(std::string(500, 'a'));
+    stream.seekg(0);
+    tawara::update_tags(stream, tags);
+    EXPECT_EQ(size, stream.str().size());
+    tawara::Segment s;
+    tawara::Tags read;
+    read_tagged(stream, s, read);
+    EXPECT_TRUE(tags == read);
+    EXPECT_LT(s.index.find(tawara::ids::Tags)->second,
+            s.index.find(tawara::ids::Tracks)->second);
+}
+
+
+TEST(TagUpdate, AtEnd)
+{
+    tawara::Tags tags;
+    tags.push_back(make_tag("first"));
+    std::stringstream stream;
+    write_tagged(stream, 10, tags, 0);
+    std::streamsize size(stream.str().size());
+
+    tags.push_back(make_tag("second"));
+    stream.seekg(0);
+    tawara::update_tags(stream, tags, 64);
+    EXPECT_LT(size, stream.str().size());
+    tawara::Segment s;
+    tawara::Tags read;
+    read_tagged(stream, s, read);
+    EXPECT_TRUE(tags == read);
+    EXPECT_GT(s.index.find(tawara::ids::Tags)->second,
+            s.index.find(tawara::ids::Cluster)->second);
+
+    // The padding left after the moved tags is used by the next update
+    size = stream.str().size();
+    tags.push_back(make_tag("third"));
+    stream.seekg(0);
+    tawara::update_tags(stream, tags);
+    EXPECT_EQ(size, stream.str().size());
+    read_tagged(stream, s, read);
+    EXPECT_TRUE(tags == read);
+}
+
+
+TEST(TagUpdate, Empty)
+{
+    tawara::Tags tags;
+    tags.push_back(make_tag("first"));
+    std::stringstream stream;
+    write_tagged(stream, 4096, tags, 0);
+    tags.clear();
+    stream.seekg(0);
+    EXPECT_THROW(tawara::update_tags(stream, tags), tawara::NoTags);
+}
+
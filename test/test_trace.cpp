@@ -0,0 +1,207 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <sstream>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/memory_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/simple_block.h>
+#include <tawara/trace.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
+#include <tawara/uint_element.h>
+
+#include "test_utils.h"
+
+
+void record_event(tawara::TraceEvent const& event, void* data)
+{
+    static_cast<std::vector<tawara::TraceEvent>*>(data)->push_back(event);
+}
+
+
+class TraceTest : public ::testing::Test
+{
+    public:
+        virtual void SetUp()
+        {
+            tawara::set_trace_callback(record_event, &events);
+        }
+
+        virtual void TearDown()
+        {
+            tawara::set_trace_callback(0);
+        }
+
+        // Count the events of a type for an element ID
+        int count(tawara::TraceEvent::Type type, uint32_t id) const
+        {
+            int result(0);
+            for (size_t ii(0); ii < events.size(); ++ii)
+            {
+                if (events[ii].type == type && events[ii].id == id)
+                {
+                    ++result;
+                }
+            }
+            return result;
+        }
+
+        std::vector<tawara::TraceEvent> events;
+};
+
+
+TEST_F(TraceTest, Element)
+{
+    std::stringstream stream;
+    stream << "ab";
+    tawara::UIntElement e(0x80, 42);
+    std::streamsize written(e.write(stream));
+    if (!tawara::tracing_available())
+    {
+        EXPECT_TRUE(events.empty());
+        return;
+    }
+    ASSERT_EQ(2, events.size());
+    EXPECT_EQ(tawara::TraceEvent::ELEMENT_WRITE_BEGIN, events[0].type);
+    EXPECT_EQ(0x80, events[0].id);
+    EXPECT_EQ(2, events[0].offset);
+    EXPECT_EQ(tawara::TraceEvent::ELEMENT_WRITE_END, events[1].type);
+    EXPECT_EQ(2, events[1].offset);
+    EXPECT_EQ(written, events[1].size);
+
+    events.clear();
+    stream.seekg(2);
+    tawara::ids::read(stream);
+    tawara::UIntElement r(0x80, 0);
+    std::streamsize read_bytes(r.read(stream));
+    ASSERT_EQ(2, events.size());
+    EXPECT_EQ(tawara::TraceEvent::ELEMENT_READ_BEGIN, events[0].type);
+    EXPECT_EQ(2, events[0].offset);
+    EXPECT_EQ(r.size() - 2, events[0].size);
+    EXPECT_EQ(tawara::TraceEvent::ELEMENT_READ_END, events[1].type);
+    EXPECT_EQ(tawara::ids::size(0x80) + read_bytes, events[1].size);
+
+    // No events once the callback is removed
+    events.clear();
+    tawara::set_trace_callback(0);
+    e.write(stream);
+    EXPECT_TRUE(events.empty());
+}
+
+
+TEST_F(TraceTest, Clusters)
+{
+    std::stringstream stream;
+    tawara::EBMLElement ebml_el;
+    ebml_el.write(stream);
+    tawara::Segment s;
+    s.write(stream);
+    tawara::Tracks tracks;
+    tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(1, 1, "A")));
+    s.index.insert(std::make_pair(tracks.id(),
+                s.to_segment_offset(stream.tellp())));
+    tracks.write(stream);
+    std::vector<std::streamoff> offsets;
+    for (int ii(0); ii < 2; ++ii)
+    {
+        tawara::MemoryCluster cluster(ii * 100);
+        offsets.push_back(stream.tellp());
+        if (ii == 0)
+        {
+            s.index.insert(std::make_pair(cluster.id(),
+                        s.to_segment_offset(stream.tellp())));
+        }
+        cluster.write(stream);
+        tawara::BlockElement::Ptr b(new tawara::SimpleBlock(1, 0));
+        b->push_back(test_utils::make_blob(10));
+        cluster.push_back(b);
+        cluster.finalise(stream);
+    }
+    s.finalise(stream);
+    if (!tawara::tracing_available())
+    {
+        EXPECT_TRUE(events.empty());
+        return;
+    }
+    EXPECT_EQ(2, count(tawara::TraceEvent::CLUSTER_OPEN,
+                tawara::ids::Cluster));
+    EXPECT_EQ(2, count(tawara::TraceEvent::CLUSTER_FINALISE_BEGIN,
+                tawara::ids::Cluster));
+    EXPECT_EQ(2, count(tawara::TraceEvent::CLUSTER_FINALISE_END,
+                tawara::ids::Cluster));
+    EXPECT_EQ(1, count(tawara::TraceEvent::ELEMENT_WRITE_END,
+                tawara::ids::Tracks));
+    // The finalise of the second cluster is the last cluster event
+    tawara::TraceEvent last;
+    for (size_t ii(0); ii < events.size(); ++ii)
+    {
+        if (events[ii].type == tawara::TraceEvent::CLUSTER_FINALISE_END)
+        {
+            last = events[ii];
+        }
+    }
+    EXPECT_EQ(offsets[1], last.offset);
+
+    events.clear();
+    stream.seekg(0);
+    tawara::ids::read(stream);
+    ebml_el.read(stream);
+    tawara::ids::read(stream);
+    tawara::Segment r;
+    r.read(stream);
+    events.clear();
+    int clusters(0);
+    for (tawara::Segment::MemClusterIterator cluster(r.clusters_begin_mem(stream));
+            cluster != r.clusters_end_mem(stream); ++cluster)
+    {
+        ++clusters;
+    }
+    EXPECT_EQ(2, clusters);
+    EXPECT_LE(2, count(tawara::TraceEvent::SEEK, tawara::ids::Cluster));
+    EXPECT_LE(2, count(tawara::TraceEvent::CLUSTER_OPEN,
+                tawara::ids::Cluster));
+    EXPECT_LE(2, count(tawara::TraceEvent::ELEMENT_READ_END,
+                tawara::ids::SimpleBlock));
+    // A seek to each cluster comes before it is opened
+    ASSERT_FALSE(events.empty());
+    EXPECT_EQ(tawara::TraceEvent::SEEK, events[0].type);
+    EXPECT_EQ(offsets[0], events[0].offset);
+}
@@ -0,0 +1,133 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <gtest/gtest.h>
+#include <stdexcept>
+#include <tawara/track_entry.h>
+#include <tawara/track_table.h>
+#include <tawara/tracks.h>
+
+#include "test_utils.h"
+
+
+TEST(TrackTable, Create)
+{
+    tawara::TrackTable t;
+    EXPECT_TRUE(t.empty());
+    EXPECT_EQ(0, t.count());
+    EXPECT_TRUE(t.begin() == t.end());
+    EXPECT_TRUE(t.find(1) == 0);
+    EXPECT_THROW(t.at(1), std::out_of_range);
+}
+
+
+TEST(TrackTable, Lookup)
+{
+    tawara::Tracks tracks;
+    tawara::TrackEntry::Ptr t1(new tawara::TrackEntry(1, 10, "A"));
+    t1->name("first");
+    tawara::TrackEntry::Ptr t2(new tawara::TrackEntry(3, 30, "B"));
+    t2->name("second");
+    // Too large to store densely
+    tawara::TrackEntry::Ptr t3(new tawara::TrackEntry(100000, 50, "C"));
+    t3->name("first");
+    tracks.insert(t1);
+    tracks.insert(t2);
+    tracks.insert(t3);
+
+    tawara::TrackTable t(tracks);
+    EXPECT_FALSE(t.empty());
+    EXPECT_EQ(3, t.count());
+    ASSERT_TRUE(t.find(1) != 0);
+    EXPECT_EQ(t1, t.find(1)->track);
+    EXPECT_EQ(10, t.find(1)->uid);
+    EXPECT_TRUE(t.find(0) == 0);
+    EXPECT_TRUE(t.find(2) == 0);
+    EXPECT_EQ(t2, t.at(3).track);
+    EXPECT_EQ(t3, t.at(100000).track);
+    EXPECT_EQ(100000, t.at(100000).number);
+    EXPECT_TRUE(t.find(99999) == 0);
+    EXPECT_THROW(t.at(4), std::out_of_range);
+
+    ASSERT_TRUE(t.find_uid(30) != 0);
+    EXPECT_EQ(3, t.find_uid(30)->number);
+    EXPECT_EQ(100000, t.find_uid(50)->number);
+    EXPECT_TRUE(t.find_uid(3) == 0);
+
+    // Duplicate names find the lowest track number
+    ASSERT_TRUE(t.find_name("first") != 0);
+    EXPECT_EQ(1, t.find_name("first")->number);
+    EXPECT_EQ(3, t.find_name("second")->number);
+    EXPECT_TRUE(t.find_name("third") == 0);
+
+    // Entries are in track number order
+    tawara::TrackTable::const_iterator it(t.begin());
+    EXPECT_EQ(1, it->number);
+    ++it;
+    EXPECT_EQ(3, it->number);
+    ++it;
+    EXPECT_EQ(100000, it->number);
+    ++it;
+    EXPECT_TRUE(it == t.end());
+}
+
+
+TEST(TrackTable, DerivedValues)
+{
+    tawara::Tracks tracks;
+    tawara::TrackEntry::Ptr t1(new tawara::TrackEntry(1, 1, "A"));
+    t1->timecode_scale(0.5);
+    t1->default_duration(40000000);
+    tawara::TrackEntry::Ptr t2(new tawara::TrackEntry(2, 2, "B"));
+    tracks.insert(t1);
+    tracks.insert(t2);
+
+    tawara::TrackTable t(tracks, 2000000);
+    EXPECT_DOUBLE_EQ(1000000, t.at(1).timecode_scale);
+    EXPECT_EQ(40000000, t.at(1).default_duration);
+    EXPECT_DOUBLE_EQ(2000000, t.at(2).timecode_scale);
+    EXPECT_EQ(0, t.at(2).default_duration);
+
+    // Copies are independent of the original
+    tawara::TrackTable copy;
+    copy = t;
+    t = tawara::TrackTable();
+    EXPECT_EQ(2, copy.count());
+    EXPECT_EQ(t2, copy.at(2).track);
+}
+
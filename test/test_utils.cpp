@@ -38,7 +38,14 @@
 
 #include "test_utils.h"
 
+#include <boost/foreach.hpp>
 #include <gtest/gtest.h>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/file_cluster.h>
+#include <tawara/simple_block.h>
+#include <tawara/track_entry.h>
+#include <tawara/tracks.h>
 
 
 ::testing::AssertionResult test_utils::std_buffers_eq(char const* b1_expr,
@@ -168,3 +175,101 @@ boost::shared_ptr<std::vector<char> > test_utils::make_blob(size_t size)
     return result;
 }
 
+
+
+test_utils::TestDocument::TestDocument()
+    : track_count(2), uid_base(0), tracks_last(false), cluster_count(3),
+    first_cluster(0), cluster_step(100), cluster_blocks(6), cues(false)
+{
+}
+
+
+void test_utils::TestDocument::write(std::iostream& stream)
+{
+    tawara::EBMLElement ebml_el;
+    ebml_el.write(stream);
+    segment.write(stream);
+    tawara::Tracks tracks;
+    for (unsigned int ii(1); ii <= track_count; ++ii)
+    {
+        tracks.insert(tawara::TrackEntry::Ptr(new tawara::TrackEntry(ii,
+                        uid_base + ii, std::string(1, 'A' + ii - 1))));
+    }
+    if (!tracks_last)
+    {
+        write_indexed(stream, tracks);
+    }
+    BOOST_FOREACH(ElPtr el, head)
+    {
+        write_indexed(stream, *el);
+    }
+
+    tawara::Cues cue_points;
+    for (unsigned int ii(0); ii < cluster_count; ++ii)
+    {
+        ClusterPtr cluster(make_cluster(ii,
+                    first_cluster + ii * cluster_step));
+        cluster->stats(segment.stats());
+        uint64_t pos(segment.to_segment_offset(stream.tellp()));
+        if (ii == 0)
+        {
+            segment.index.insert(std::make_pair(cluster->id(), pos));
+        }
+        tawara::CuePoint point(cluster->timecode());
+        point.push_back(tawara::CueTrackPosition(1, pos));
+        cue_points.insert(point);
+        cluster->write(stream);
+        fill_cluster(*cluster, ii);
+        cluster->finalise(stream);
+    }
+
+    if (tracks_last)
+    {
+        write_indexed(stream, tracks);
+    }
+    if (cues)
+    {
+        write_indexed(stream, cue_points);
+    }
+    BOOST_FOREACH(ElPtr el, tail)
+    {
+        write_indexed(stream, *el);
+    }
+    segment.finalise(stream);
+}
+
+
+test_utils::TestDocument::ClusterPtr test_utils::TestDocument::make_cluster(
+        unsigned int, uint64_t timecode)
+{
+    return ClusterPtr(new tawara::FileCluster(timecode));
+}
+
+
+void test_utils::TestDocument::fill_cluster(tawara::Cluster& cluster,
+        unsigned int index)
+{
+    for (unsigned int ii(0); ii < cluster_blocks; ++ii)
+    {
+        cluster.push_back(make_block(index, ii));
+    }
+}
+
+
+tawara::BlockElement::Ptr test_utils::TestDocument::make_block(
+        unsigned int cluster, unsigned int block)
+{
+    tawara::BlockElement::Ptr b(new tawara::SimpleBlock(
+                block % track_count + 1, block * 10));
+    b->push_back(make_blob(10 + cluster * cluster_blocks + block));
+    return b;
+}
+
+
+void test_utils::TestDocument::write_indexed(std::iostream& stream,
+        tawara::Element& element)
+{
+    segment.index.insert(std::make_pair(element.id(),
+                segment.to_segment_offset(stream.tellp())));
+    element.write(stream);
+}
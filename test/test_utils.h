@@ -44,8 +44,11 @@
 #include <gtest/gtest.h>
 #include <stdint.h>
 #include <string>
+#include <tawara/block_element.h>
+#include <tawara/cluster.h>
 #include <tawara/element.h>
 #include <tawara/prim_element.h>
+#include <tawara/segment.h>
 #include <vector>
 
 
@@ -100,6 +103,65 @@ template<typename T1, typename T2>
 // each time this function is called.
 boost::shared_ptr<std::vector<char> > make_blob(size_t size);
 
+
+// Writes a test document: an EBML header and a segment holding its tracks,
+// any extra level 1 elements and a run of clusters. By default there are
+// two tracks, named A and B, and three clusters 100 apart, each holding six
+// simple blocks 10 apart that alternate between the tracks. The frame of
+// each block is a blob whose size identifies the block. Tests change the
+// members and override the virtual methods for the parts they exercise.
+class TestDocument
+{
+    public:
+        typedef boost::shared_ptr<tawara::Cluster> ClusterPtr;
+
+        TestDocument();
+        virtual ~TestDocument() {}
+
+        // Writes the document to a stream.
+        void write(std::iostream& stream);
+
+        // The segment to write. Its info, padding and statistics can be set
+        // before writing; its statistics are also given to each cluster.
+        tawara::Segment segment;
+        // The number of tracks. Track n has the UID uid_base + n.
+        unsigned int track_count;
+        uint64_t uid_base;
+        // Write the tracks after the clusters instead of before them.
+        bool tracks_last;
+        // The number of clusters, the timecode of the first cluster and the
+        // timecode step between clusters.
+        unsigned int cluster_count;
+        uint64_t first_cluster;
+        uint64_t cluster_step;
+        // The number of blocks written in each cluster by fill_cluster().
+        unsigned int cluster_blocks;
+        // Write cues after the clusters, with a cue point for track 1 at the
+        // start of each cluster.
+        bool cues;
+        // Level 1 elements written before and after the clusters. Those
+        // after the clusters follow the tracks and the cues.
+        std::vector<ElPtr> head;
+        std::vector<ElPtr> tail;
+
+    protected:
+        // Makes the cluster with the given index. The default makes a
+        // FileCluster.
+        virtual ClusterPtr make_cluster(unsigned int index,
+                uint64_t timecode);
+        // Adds the blocks to a cluster. The default adds cluster_blocks
+        // blocks made by make_block().
+        virtual void fill_cluster(tawara::Cluster& cluster,
+                unsigned int index);
+        // Makes a block of a cluster. The default makes a simple block.
+        virtual tawara::BlockElement::Ptr make_block(unsigned int cluster,
+                unsigned int block);
+
+    private:
+        // Writes an element and adds it to the segment's index.
+        void write_indexed(std::iostream& stream, tawara::Element& element);
+};
+
 }; // test_utils
 
 #endif // TAWARA_TEST_UTILS_H_
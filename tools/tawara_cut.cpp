@@ -0,0 +1,88 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <tawara/cut.h>
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 5)
+    {
+        std::cerr << "Usage: " << argv[0] <<
+            " <input file> <output file> <start> <end> [<track> ...]\n" <<
+            "Start and end times are in seconds from the start of the "
+            "segment.\n";
+        return 1;
+    }
+
+    std::ifstream input(argv[1], std::ios::in | std::ios::binary);
+    if (!input)
+    {
+        std::cerr << "Could not open " << argv[1] << '\n';
+        return 1;
+    }
+    std::fstream output(argv[2], std::ios::in | std::ios::out |
+            std::ios::trunc | std::ios::binary);
+    if (!output)
+    {
+        std::cerr << "Could not open " << argv[2] << '\n';
+        return 1;
+    }
+    // Times are given in seconds, but Tawara uses nanoseconds.
+    int64_t start(static_cast<int64_t>(std::atof(argv[3]) * 1e9));
+    int64_t end(static_cast<int64_t>(std::atof(argv[4]) * 1e9));
+    if (end <= start)
+    {
+        std::cerr << "The end time must be after the start time.\n";
+        return 1;
+    }
+    // Any remaining arguments are the tracks to keep.
+    tawara::FileCluster::TrackSet tracks;
+    for (int ii(5); ii < argc; ++ii)
+    {
+        tracks.insert(std::strtoull(argv[ii], 0, 10));
+    }
+
+    tawara::cut(input, output, start, end, tracks);
+
+    return 0;
+}
+
@@ -0,0 +1,100 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <boost/foreach.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <tawara/exceptions.h>
+#include <tawara/fsck.h>
+
+#include "bench_utils.h"
+
+
+int main(int argc, char** argv)
+{
+    unsigned int threads(0);
+    if (argc == 4 && std::strcmp(argv[2], "-j") == 0)
+    {
+        threads = std::atoi(argv[3]);
+    }
+    else if (argc != 2)
+    {
+        std::cerr << "Usage: " << argv[0] << " <file> [-j <threads>]\n" <<
+            "Checks the structure of a file and prints a JSON report. By "
+            "default, one thread is used per processor core.\n";
+        return 1;
+    }
+
+    tawara::FsckReport report;
+    try
+    {
+        report = tawara::fsck(argv[1], threads);
+    }
+    catch (tawara::ReadError&)
+    {
+        std::cerr << "Could not open " << argv[1] << '\n';
+        return 1;
+    }
+
+    std::cout << "{\n  \"file\": ";
+    bench_utils::write_json_string(std::cout, argv[1]);
+    std::cout << ",\n  \"ok\": " << (report.ok() ? "true" : "false") <<
+        ",\n  \"clusters\": " << report.clusters <<
+        ",\n  \"blocks\": " << report.blocks <<
+        ",\n  \"frames\": " << report.frames <<
+        ",\n  \"crcs\": " << report.crcs <<
+        ",\n  \"problems\": [";
+    bool first(true);
+    BOOST_FOREACH(tawara::FsckProblem const& problem, report.problems)
+    {
+        std::cout << (first ? "\n" : ",\n") << "    {\"pos\": " <<
+            problem.pos << ", \"check\": ";
+        bench_utils::write_json_string(std::cout, problem.check);
+        std::cout << ", \"error\": ";
+        bench_utils::write_json_string(std::cout, problem.error);
+        std::cout << '}';
+        first = false;
+    }
+    std::cout << (first ? "]\n}\n" : "\n  ]\n}\n");
+
+    return report.ok() ? 0 : 2;
+}
+
@@ -0,0 +1,663 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include <algorithm>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+#include <boost/foreach.hpp>
+#include <cctype>
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#if !defined(_WIN32)
+    #include <fcntl.h>
+    #include <unistd.h>
+#endif
+#include <limits>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <tawara/cues.h>
+#include <tawara/ebml_element.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/io_stats.h>
+#include <tawara/lace_packer.h>
+#include <tawara/memory_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/tracks.h>
+#include <tawara/track_entry.h>
+#include <vector>
+
+#include "bench_utils.h"
+
+namespace bpt = boost::posix_time;
+
+
+// Number of distinct frames generated for each track. Frames are reused from
+// this pool so that generating data does not limit the writing speed.
+static std::size_t const gen_pool_frames(256);
+
+
+enum SizeDist
+{
+    SIZE_CONST,
+    SIZE_UNIFORM,
+    SIZE_EXP
+};
+
+
+struct GenTrack
+{
+    double rate;
+    std::size_t frame_size;
+    SizeDist dist;
+    unsigned int lace;
+    uint64_t number;
+    // Time between frames, in nanoseconds
+    uint64_t period;
+    // Index of the next frame
+    uint64_t next;
+    std::vector<tawara::Block::FramePtr> pool;
+    boost::shared_ptr<tawara::LacePacker> packer;
+};
+
+
+struct GenStats
+{
+    uint64_t clusters;
+    uint64_t blocks;
+    uint64_t frames;
+    uint64_t frame_bytes;
+};
+
+
+// Latency measurement and durability settings.
+struct GenIO
+{
+    tawara::IOStats::Ptr stats;
+    boost::shared_ptr<tawara::StatsDumper> dumper;
+    // Sync every this many clusters, or never if 0
+    unsigned int sync_every;
+    // File descriptor for syncing to disk, or -1 to only flush
+    int fd;
+};
+
+
+// Parses a size with an optional K, M, G or T suffix (powers of 1024).
+bool parse_size(char const* str, uint64_t& size)
+{
+    char* end(0);
+    double value(std::strtod(str, &end));
+    if (end == str || value < 0)
+    {
+        return false;
+    }
+    struct Multiplier
+    {
+        char suffix;
+        double value;
+    };
+    static Multiplier const multipliers[] = {
+        {'K', 1024.0},
+        {'M', 1024.0 * 1024},
+        {'G', 1024.0 * 1024 * 1024},
+        {'T', 1024.0 * 1024 * 1024 * 1024}};
+    for (std::size_t ii(0);
+            ii < sizeof(multipliers) / sizeof(multipliers[0]); ++ii)
+    {
+        if (std::toupper(static_cast<unsigned char>(*end)) ==
+                multipliers[ii].suffix)
+        {
+            value *= multipliers[ii].value;
+            ++end;
+            break;
+        }
+    }
+    if (*end != '\0')
+    {
+        return false;
+    }
+    size = static_cast<uint64_t>(value);
+    return true;
+}
+
+
+// Parses a track specification: <rate>:<size>[:<dist>[:<lace>]]
+bool parse_track(char const* spec, GenTrack& track)
+{
+    std::vector<std::string> fields;
+    std::istringstream ss(spec);
+    std::string field;
+    while (std::getline(ss, field, ':'))
+    {
+        fields.push_back(field);
+    }
+    if (fields.size() < 2 || fields.size() > 4)
+    {
+        return false;
+    }
+    track.rate = std::atof(fields[0].c_str());
+    uint64_t size(0);
+    if (track.rate <= 0 || track.rate > 1e9 ||
+            !parse_size(fields[1].c_str(), size) || size == 0)
+    {
+        return false;
+    }
+    track.frame_size = size;
+    track.dist = SIZE_CONST;
+    if (fields.size() > 2)
+    {
+        if (fields[2] == "uniform")
+        {
+            track.dist = SIZE_UNIFORM;
+        }
+        else if (fields[2] == "exp")
+        {
+            track.dist = SIZE_EXP;
+        }
+        else if (fields[2] != "const")
+        {
+            return false;
+        }
+    }
+    track.lace = 1;
+    if (fields.size() > 3)
+    {
+        int lace(std::atoi(fields[3].c_str()));
+        if (lace < 1 || lace > 256)
+        {
+            return false;
+        }
+        track.lace = lace;
+    }
+    track.period = static_cast<uint64_t>(1e9 / track.rate);
+    track.next = 0;
+    return true;
+}
+
+
+// Fills a track's frame pool with frames drawn from its size distribution.
+void make_pool(GenTrack& track, bench_utils::Random& rng)
+{
+    for (std::size_t ii(0); ii < gen_pool_frames; ++ii)
+    {
+        std::size_t size(track.frame_size);
+        if (track.dist == SIZE_UNIFORM)
+        {
+            // Between half and one and a half times the mean
+            size = track.frame_size / 2 + rng.next() % (track.frame_size + 1);
+        }
+        else if (track.dist == SIZE_EXP)
+        {
+            // Exponential, capped at sixteen times the mean
+            size = static_cast<std::size_t>(-std::log(1.0 - rng.unit()) *
+                    track.frame_size);
+            size = std::min(size, track.frame_size * 16);
+        }
+        size = std::max(size, static_cast<std::size_t>(1));
+        tawara::Block::FramePtr frame(new tawara::Block::Frame(size));
+        for (std::size_t jj(0); jj < size; ++jj)
+        {
+            (*frame)[jj] = rng.next() & 0xFF;
+        }
+        track.pool.push_back(frame);
+    }
+}
+
+
+// Writes the blocks completed by the packers into a cluster.
+void push_block(tawara::Cluster& cluster, tawara::BlockElement::Ptr block,
+        GenStats& stats)
+{
+    if (block)
+    {
+        cluster.push_back(block);
+        ++stats.blocks;
+    }
+}
+
+
+template<typename ClusterType>
+void write_clusters(std::iostream& stream, tawara::Segment& segment,
+        std::vector<GenTrack>& tracks, tawara::Cues& cues,
+        uint64_t max_bytes, uint64_t max_time, uint64_t cluster_time,
+        uint64_t cluster_bytes, unsigned int cue_every, bool finalise,
+        GenStats& stats, GenIO& io)
+{
+    uint64_t const scale(segment.info.timecode_scale());
+    uint64_t const report_every(1ULL << 30);
+    uint64_t next_report(report_every);
+    bpt::ptime start(bpt::microsec_clock::universal_time());
+    bool done(false);
+    while (!done)
+    {
+        // The cluster starts at the time of the next frame
+        uint64_t first(std::numeric_limits<uint64_t>::max());
+        BOOST_FOREACH(GenTrack const& track, tracks)
+        {
+            first = std::min(first, track.next * track.period);
+        }
+        if (first >= max_time)
+        {
+            break;
+        }
+        uint64_t cluster_tc(first / scale);
+        ClusterType cluster(cluster_tc);
+        cluster.stats(io.stats);
+        std::streamoff cluster_start(stream.tellp());
+        std::streamsize pos(segment.to_segment_offset(cluster_start));
+        if (stats.clusters == 0)
+        {
+            segment.index.insert(std::make_pair(cluster.id(), pos));
+        }
+        if (cue_every != 0 && stats.clusters % cue_every == 0)
+        {
+            tawara::CuePoint cp(cluster_tc);
+            BOOST_FOREACH(GenTrack const& track, tracks)
+            {
+                cp.push_back(tawara::CueTrackPosition(track.number, pos));
+            }
+            cues.insert(cp);
+        }
+        cluster.write(stream);
+
+        uint64_t bytes(0);
+        while (true)
+        {
+            GenTrack* track(&tracks[0]);
+            BOOST_FOREACH(GenTrack& t, tracks)
+            {
+                if (t.next * t.period < track->next * track->period)
+                {
+                    track = &t;
+                }
+            }
+            uint64_t time(track->next * track->period);
+            if (time >= max_time)
+            {
+                done = true;
+                break;
+            }
+            if (time >= cluster_tc * scale + cluster_time ||
+                    bytes >= cluster_bytes)
+            {
+                break;
+            }
+            tawara::Block::FramePtr frame(
+                    track->pool[track->next % track->pool.size()]);
+            int16_t tc((time + scale / 2) / scale - cluster_tc);
+            push_block(cluster, track->packer->add(frame, tc), stats);
+            ++track->next;
+            ++stats.frames;
+            stats.frame_bytes += frame->size();
+            bytes += frame->size();
+        }
+        BOOST_FOREACH(GenTrack& track, tracks)
+        {
+            push_block(cluster, track.packer->flush(), stats);
+        }
+        ++stats.clusters;
+
+        if (!finalise && (done || static_cast<uint64_t>(cluster_start) + bytes >=
+                    max_bytes))
+        {
+            // Simulate a crash: the last cluster is never finalised
+            done = true;
+            break;
+        }
+        cluster.finalise(stream);
+        if (io.sync_every != 0 && stats.clusters % io.sync_every == 0)
+        {
+            tawara::sync(stream, io.fd, io.stats);
+        }
+        if (io.dumper)
+        {
+            io.dumper->poll();
+        }
+        uint64_t written(stream.tellp());
+        if (written >= max_bytes)
+        {
+            done = true;
+        }
+        if (written >= next_report)
+        {
+            double seconds((bpt::microsec_clock::universal_time() -
+                        start).total_microseconds() / 1e6);
+            std::cerr << written / (1024 * 1024) << " MiB written, " <<
+                std::fixed << std::setprecision(1) <<
+                written / seconds / 1e6 << " MB/s\n";
+            std::cerr.unsetf(std::ios::fixed);
+            next_report = (written / report_every + 1) * report_every;
+        }
+    }
+}
+
+
+void usage(char const* name)
+{
+    std::cerr << "Usage: " << name << " <file> [options]\n" <<
+        "Generates a synthetic recording for load and scale testing.\n"
+        "  -S <size>  Stop once the file reaches this size, with an optional "
+        "K, M, G or T suffix (default 1G).\n"
+        "  -d <secs>  Stop after this much recorded time.\n"
+        "  -t <rate>:<size>[:<dist>[:<lace>]]\n"
+        "             Add a track producing frames at <rate> Hz with a mean "
+        "size of <size> bytes. <dist> is the frame size distribution: const "
+        "(default), uniform (half to one and a half times the size) or exp "
+        "(exponential). Up to <lace> frames (default 1, at most 256) are "
+        "stored in each block. May be given more than once; the default is "
+        "-t 1000:64:const:32 -t 100:1K:uniform -t 30:64K:exp.\n"
+        "  -c <ms>    Maximum cluster duration (default 1000).\n"
+        "  -b <size>  Maximum cluster size (default 8M).\n"
+        "  -x <n>     Add a cue point every <n> clusters, or no Cues if 0 "
+        "(default 1).\n"
+        "  -T <ns>    Timecode scale (default 1000000).\n"
+        "  -m         Use MemoryCluster rather than FileCluster.\n"
+        "  -n         Do not finalise, as if the writer crashed: the last "
+        "cluster and the segment are left unfinalised and no Cues are "
+        "written.\n"
+        "  -s <seed>  Seed for the generated data (default 1).\n"
+        "  -F <n>     Flush and fsync the file every <n> clusters.\n"
+        "  -l         Print I/O statistics and write, finalise and sync "
+        "latency histograms when done.\n"
+        "  -L <secs>  As -l, and also print them to stderr every <secs> "
+        "seconds, covering the latest interval.\n";
+}
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 2 || argv[1][0] == '-')
+    {
+        usage(argv[0]);
+        return 1;
+    }
+    uint64_t max_bytes(1ULL << 30);
+    uint64_t max_time(std::numeric_limits<uint64_t>::max());
+    uint64_t cluster_ms(1000);
+    uint64_t cluster_bytes(8 * 1024 * 1024);
+    unsigned int cue_every(1);
+    uint64_t scale(1000000);
+    uint64_t seed(1);
+    bool memory(false), finalise(true), latency(false);
+    double dump_secs(0);
+    GenIO io;
+    io.sync_every = 0;
+    io.fd = -1;
+    std::vector<GenTrack> tracks;
+    for (int ii(2); ii < argc; ++ii)
+    {
+        bool ok(true);
+        char const* value(ii + 1 < argc ? argv[ii + 1] : 0);
+        if (std::strcmp(argv[ii], "-m") == 0)
+        {
+            memory = true;
+            continue;
+        }
+        else if (std::strcmp(argv[ii], "-n") == 0)
+        {
+            finalise = false;
+            continue;
+        }
+        else if (std::strcmp(argv[ii], "-l") == 0)
+        {
+            latency = true;
+            continue;
+        }
+        else if (!value)
+        {
+            ok = false;
+        }
+        else if (std::strcmp(argv[ii], "-S") == 0)
+        {
+            ok = parse_size(value, max_bytes);
+        }
+        else if (std::strcmp(argv[ii], "-d") == 0)
+        {
+            double seconds(std::atof(value));
+            ok = seconds > 0;
+            max_time = static_cast<uint64_t>(seconds * 1e9);
+        }
+        else if (std::strcmp(argv[ii], "-t") == 0)
+        {
+            GenTrack track;
+            ok = parse_track(value, track);
+            tracks.push_back(track);
+        }
+        else if (std::strcmp(argv[ii], "-c") == 0)
+        {
+            cluster_ms = std::strtoull(value, 0, 10);
+            ok = cluster_ms > 0;
+        }
+        else if (std::strcmp(argv[ii], "-b") == 0)
+        {
+            ok = parse_size(value, cluster_bytes) && cluster_bytes > 0;
+        }
+        else if (std::strcmp(argv[ii], "-x") == 0)
+        {
+            cue_every = std::strtoul(value, 0, 10);
+        }
+        else if (std::strcmp(argv[ii], "-T") == 0)
+        {
+            scale = std::strtoull(value, 0, 10);
+            ok = scale > 0;
+        }
+        else if (std::strcmp(argv[ii], "-s") == 0)
+        {
+            seed = std::strtoull(value, 0, 10);
+        }
+        else if (std::strcmp(argv[ii], "-F") == 0)
+        {
+            io.sync_every = std::strtoul(value, 0, 10);
+            ok = io.sync_every > 0;
+        }
+        else if (std::strcmp(argv[ii], "-L") == 0)
+        {
+            dump_secs = std::atof(value);
+            ok = dump_secs > 0;
+            latency = true;
+        }
+        else
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            usage(argv[0]);
+            return 1;
+        }
+        ++ii;
+    }
+    if (tracks.empty())
+    {
+        char const* defaults[] = {"1000:64:const:32", "100:1K:uniform",
+            "30:64K:exp"};
+        BOOST_FOREACH(char const* spec, defaults)
+        {
+            GenTrack track;
+            parse_track(spec, track);
+            tracks.push_back(track);
+        }
+    }
+    // Block timecodes are signed 16-bit offsets from the cluster timecode
+    uint64_t cluster_time(cluster_ms * 1000000);
+    if (cluster_time / scale >= 32767)
+    {
+        std::cerr << "The cluster duration is too long for the timecode "
+            "scale.\n";
+        return 1;
+    }
+
+    // A large buffer lets the writers keep up with the disk
+    std::vector<char> buffer(1 << 20);
+    std::fstream stream;
+    stream.rdbuf()->pubsetbuf(&buffer[0], buffer.size());
+    stream.open(argv[1], std::ios::in | std::ios::out | std::ios::trunc |
+            std::ios::binary);
+    if (!stream)
+    {
+        std::cerr << "Could not open " << argv[1] << '\n';
+        return 1;
+    }
+#if !defined(_WIN32)
+    if (io.sync_every != 0)
+    {
+        // Any descriptor of the file can be used to sync it
+        io.fd = ::open(argv[1], O_WRONLY);
+    }
+#endif
+    if (latency)
+    {
+        io.stats.reset(new tawara::IOStats);
+        if (dump_secs > 0)
+        {
+            io.dumper.reset(new tawara::StatsDumper(io.stats, std::cerr,
+                        bpt::microseconds(static_cast<int64_t>(
+                                dump_secs * 1e6)), true));
+        }
+    }
+
+    bench_utils::Random rng(seed);
+    tawara::Segment segment;
+    segment.stats(io.stats);
+    segment.info.timecode_scale(scale);
+    segment.info.title("Synthetic recording");
+    segment.info.writing_app("tawara_gen");
+    tawara::Tracks tracks_el;
+    for (std::size_t ii(0); ii < tracks.size(); ++ii)
+    {
+        GenTrack& track(tracks[ii]);
+        track.number = ii + 1;
+        make_pool(track, rng);
+        std::size_t largest(0);
+        BOOST_FOREACH(tawara::Block::FramePtr frame, track.pool)
+        {
+            largest = std::max(largest, frame->size());
+        }
+        tawara::TrackEntry::Ptr entry(new tawara::TrackEntry(track.number,
+                    track.number, "binary"));
+        std::ostringstream name;
+        name << "Track " << track.number << " (" << track.rate << " Hz)";
+        entry->name(name.str());
+        entry->default_duration(track.period);
+        entry->lacing(track.lace > 1);
+        tracks_el.insert(entry);
+        track.packer.reset(new tawara::LacePacker(*entry, scale, track.lace,
+                    track.lace * largest, std::numeric_limits<int16_t>::max()));
+    }
+
+    GenStats stats = {0, 0, 0, 0};
+    bpt::ptime start(bpt::microsec_clock::universal_time());
+    try
+    {
+        tawara::EBMLElement ebml_el;
+        ebml_el.write(stream);
+        segment.write(stream);
+        segment.index.insert(std::make_pair(tracks_el.id(),
+                    segment.to_segment_offset(stream.tellp())));
+        tracks_el.write(stream);
+
+        tawara::Cues cues;
+        if (memory)
+        {
+            write_clusters<tawara::MemoryCluster>(stream, segment, tracks,
+                    cues, max_bytes, max_time, cluster_time, cluster_bytes,
+                    cue_every, finalise, stats, io);
+        }
+        else
+        {
+            write_clusters<tawara::FileCluster>(stream, segment, tracks,
+                    cues, max_bytes, max_time, cluster_time, cluster_bytes,
+                    cue_every, finalise, stats, io);
+        }
+        if (finalise)
+        {
+            if (!cues.empty())
+            {
+                segment.index.insert(std::make_pair(cues.id(),
+                            segment.to_segment_offset(stream.tellp())));
+                cues.write(stream);
+            }
+            uint64_t end(0);
+            BOOST_FOREACH(GenTrack const& track, tracks)
+            {
+                end = std::max(end, track.next * track.period);
+            }
+            segment.info.duration(static_cast<double>(end) / scale);
+            segment.finalise(stream);
+        }
+        if (io.sync_every != 0)
+        {
+            tawara::sync(stream, io.fd, io.stats);
+        }
+        stream.seekp(0, std::ios::end);
+    }
+    catch (tawara::TawaraError&)
+    {
+        std::cerr << "Error writing " << argv[1] << '\n';
+        return 1;
+    }
+    uint64_t written(stream.tellp());
+    stream.close();
+#if !defined(_WIN32)
+    if (io.fd >= 0)
+    {
+        ::close(io.fd);
+    }
+#endif
+    double seconds((bpt::microsec_clock::universal_time() - start).
+            total_microseconds() / 1e6);
+
+    std::cout << "Wrote " << written << " bytes to " << argv[1] <<
+        (finalise ? "" : " (not finalised)") << '\n' <<
+        "\tClusters: " << stats.clusters << '\n' <<
+        "\tBlocks: " << stats.blocks << '\n' <<
+        "\tFrames: " << stats.frames << " (" << stats.frame_bytes <<
+        " bytes)\n" << std::fixed << std::setprecision(2) <<
+        "\tTime: " << seconds << " s (" << written / seconds / 1e6 <<
+        " MB/s)\n";
+    if (io.stats)
+    {
+        std::cout << (io.dumper ? "Since the last dump:\n" : "") <<
+            *io.stats;
+    }
+    return 0;
+}
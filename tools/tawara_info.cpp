@@ -41,11 +41,19 @@
 #include <boost/date_time/gregorian/gregorian.hpp>
 #include <boost/date_time/posix_time/posix_time.hpp>
 #include <boost/foreach.hpp>
+#include <cstdlib>
+#include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
 #include <tawara/tawara_config.h>
 #include <tawara/ebml_element.h>
 #include <tawara/el_ids.h>
+#include <tawara/io_stats.h>
 #include <tawara/memory_cluster.h>
+#include <tawara/profile.h>
 #include <tawara/segment.h>
 #include <tawara/simple_block.h>
 #include <tawara/tawara_impl.h>
@@ -55,17 +63,146 @@
 namespace bpt = boost::posix_time;
 
 
+void print_stats(tawara::IOStats const& stats)
+{
+    std::cerr << "I/O statistics:\n" << stats;
+}
+
+
+// Prints a size in bytes using the largest fitting binary unit.
+std::string format_size(uint64_t size)
+{
+    char const* units[] = {"B", "KiB", "MiB", "GiB", "TiB"};
+    int unit(0);
+    while (size >= 1024 && size % 1024 == 0 && unit < 4)
+    {
+        size /= 1024;
+        ++unit;
+    }
+    std::ostringstream result;
+    result << size << ' ' << units[unit];
+    return result.str();
+}
+
+
+// Prints the statistics gathered by a header-only scan of the clusters.
+void print_profile(tawara::ProfileReport const& report,
+        tawara::Tracks const& tracks)
+{
+    // Timecodes are converted to milliseconds
+    double const ms(report.timecode_scale / 1e6);
+    std::cerr << std::fixed << std::setprecision(3);
+    std::cerr << "Profile:\n";
+    typedef std::map<uint64_t, tawara::TrackProfile>::value_type Track;
+    BOOST_FOREACH(Track const& track, report.tracks)
+    {
+        tawara::TrackProfile const& tp(track.second);
+        std::cerr << "\tTrack " << track.first;
+        tawara::Tracks::const_iterator entry(tracks.find(track.first));
+        if (entry != tracks.end())
+        {
+            std::cerr << " (" << entry->second->name() << ')';
+        }
+        else
+        {
+            std::cerr << " (not in Tracks)";
+        }
+        double seconds(tp.span() * ms / 1000);
+        std::cerr << "\n\t\tBlocks: " << tp.blocks << '\n';
+        std::cerr << "\t\tBytes: " << tp.bytes << '\n';
+        std::cerr << "\t\tDuration: " << seconds << " s\n";
+        if (seconds > 0)
+        {
+            // Laced blocks are counted once, so this is not a frame rate
+            std::cerr << "\t\tBlock rate: " << tp.gaps / seconds <<
+                " blocks/s, " << tp.bytes / seconds / 1e3 << " kB/s\n";
+        }
+        if (tp.gaps != 0)
+        {
+            std::cerr << "\t\tGap (ms): min " << tp.min_gap * ms <<
+                ", mean " << tp.mean_gap() * ms << ", max " <<
+                tp.max_gap * ms << '\n';
+            std::cerr << "\t\tJitter (ms): " << tp.jitter() * ms << '\n';
+        }
+        std::cerr << "\t\tLacing: none " <<
+            tp.lacing[tawara::Block::LACING_NONE] << ", EBML " <<
+            tp.lacing[tawara::Block::LACING_EBML] << ", fixed " <<
+            tp.lacing[tawara::Block::LACING_FIXED] << '\n';
+    }
+    std::cerr << "\tCluster sizes:\n";
+    for (std::size_t ii(0); ii < report.cluster_sizes.size(); ++ii)
+    {
+        if (report.cluster_sizes[ii] != 0)
+        {
+            std::cerr << "\t\t" << format_size(1ULL << ii) << " to " <<
+                format_size(2ULL << ii) << ": " << report.cluster_sizes[ii] <<
+                '\n';
+        }
+    }
+    typedef std::map<std::streamsize, std::string>::value_type Error;
+    BOOST_FOREACH(Error const& error, report.errors)
+    {
+        std::cerr << "\tError at " << error.first << ": " << error.second <<
+            '\n';
+    }
+    std::cerr << "\tScanned " << report.clusters << " clusters (" <<
+        report.bad_clusters << " unreadable), " << report.blocks <<
+        " blocks, " << report.bytes << " bytes in " << report.seconds <<
+        " s (" << report.throughput() / 1e6 << " MB/s, threads: " <<
+        report.threads << ")\n";
+    std::cerr.unsetf(std::ios::fixed);
+}
+
+
 int main(int argc, char** argv)
 {
-    if (argc != 2)
+    bool show_stats(false), show_profile(false);
+    unsigned int threads(0);
+    char* file_name(0);
+    for (int ii(1); ii < argc; ++ii)
+    {
+        if (std::string(argv[ii]) == "-s")
+        {
+            show_stats = true;
+        }
+        else if (std::string(argv[ii]) == "-p")
+        {
+            show_profile = true;
+        }
+        else if (std::string(argv[ii]) == "-j" && ii + 1 < argc)
+        {
+            threads = std::strtoul(argv[++ii], 0, 10);
+        }
+        else if (file_name == 0)
+        {
+            file_name = argv[ii];
+        }
+        else
+        {
+            file_name = 0;
+            break;
+        }
+    }
+    if (file_name == 0)
     {
-        std::cerr << "Usage: " << argv[0] << " <file name>\n";
+        std::cerr << "Usage: " << argv[0] <<
+            " [-s] [-p [-j threads]] <file name>\n";
+        std::cerr << "\t-s\tPrint the I/O statistics of reading the file\n";
+        std::cerr << "\t-p\tPrint per-track statistics from a parallel scan "
+            "of the block headers, instead of listing the clusters\n";
+        std::cerr << "\t-j\tThe number of threads for -p (default: one "
+            "per core)\n";
         return 1;
     }
 
     // Open the file and check for the EBML header. This confirms that the file
-    // is an EBML file, and is a Tawara document.
-    std::ifstream stream(argv[1], std::ios::in);
+    // is an EBML file, and is a Tawara document. If statistics are wanted,
+    // all reads go through a counting buffer.
+    std::ifstream file(file_name, std::ios::in | std::ios::binary);
+    tawara::IOStats::Ptr stats(new tawara::IOStats);
+    tawara::CountingStreamBuf counter(file.rdbuf(), stats);
+    std::istream stream(show_stats ?
+            static_cast<std::streambuf*>(&counter) : file.rdbuf());
     tawara::ids::ReadResult id = tawara::ids::read(stream);
     if (id.first != tawara::ids::EBML)
     {
@@ -103,6 +240,10 @@ int main(int argc, char** argv)
         return 1;
     }
     tawara::Segment segment;
+    if (show_stats)
+    {
+        segment.stats(stats);
+    }
     segment.read(stream);
     // Inspect the segment for some interesting information.
     std::cerr << "Segment information:\n\tUUID: ";
@@ -119,7 +260,7 @@ int main(int argc, char** argv)
     // The segment's date is stored as the number of seconds since the start of
     // the millenium. Boost::Date_Time is invaluable here.
     bpt::ptime basis(boost::gregorian::date(2001, 1, 1));
-    bpt::ptime start(basis + bpt::seconds(segment.info.date() / 1e9) +
+    bpt::ptime start(basis + bpt::seconds(segment.info.date() / 1000000000) +
             bpt::nanoseconds(segment.info.date() % 1000000000));
     std::cerr << "\tDate: " << start << " (" << segment.info.date() << ")\n";
     std::cerr << "\tTitle: " << segment.info.title() << '\n';
@@ -142,6 +283,10 @@ int main(int argc, char** argv)
     if (tracks.empty())
     {
         std::cerr << "No tracks found.\n";
+        if (show_stats)
+        {
+            print_stats(*stats);
+        }
         return 0;
     }
     std::cerr << "Tracks:\n";
@@ -154,6 +299,21 @@ int main(int argc, char** argv)
             track.second->codec_id() << ")\n\n";
     }
 
+    // The profile only reads the headers of the clusters and blocks, using
+    // several threads, so it is much faster than iterating over the blocks.
+    if (show_profile)
+    {
+        print_profile(tawara::profile(file_name, threads), tracks);
+        if (show_stats)
+        {
+            // The profile's threads open the file themselves, so only the
+            // reads made so far are counted.
+            std::cerr << '\n';
+            print_stats(*stats);
+        }
+        return 0;
+    }
+
     // Now we will iterate over every cluster in the file and print out some
     // interesting statistics.
     std::cerr << "Clusters:\n";
@@ -187,6 +347,11 @@ int main(int argc, char** argv)
         }
     }
 
+    if (show_stats)
+    {
+        std::cerr << '\n';
+        print_stats(*stats);
+    }
     return 0;
 }
 
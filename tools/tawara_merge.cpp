@@ -0,0 +1,98 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+#include <boost/foreach.hpp>
+#include <boost/shared_ptr.hpp>
+#include <fstream>
+#include <iostream>
+#include <tawara/merge.h>
+#include <vector>
+
+
+int main(int argc, char** argv)
+{
+    if (argc < 3)
+    {
+        std::cerr << "Usage: " << argv[0] <<
+            " <output file> <input file> [<input file> ...]\n";
+        return 1;
+    }
+
+    // Open all the input files. Each will be read in a single pass, with
+    // only the next block of each kept in memory.
+    std::vector<boost::shared_ptr<std::ifstream> > files;
+    std::vector<std::istream*> inputs;
+    for (int ii(2); ii < argc; ++ii)
+    {
+        boost::shared_ptr<std::ifstream> file(new std::ifstream(argv[ii],
+                    std::ios::in | std::ios::binary));
+        if (!*file)
+        {
+            std::cerr << "Could not open " << argv[ii] << '\n';
+            return 1;
+        }
+        files.push_back(file);
+        inputs.push_back(file.get());
+    }
+    std::fstream output(argv[1], std::ios::in | std::ios::out |
+            std::ios::trunc | std::ios::binary);
+    if (!output)
+    {
+        std::cerr << "Could not open " << argv[1] << '\n';
+        return 1;
+    }
+
+    // Merge the blocks of all the inputs into the output in time order.
+    std::vector<tawara::TrackNumberMap> tracks(tawara::merge(inputs,
+                output));
+
+    // Report where each input's tracks ended up.
+    for (size_t ii(0); ii < tracks.size(); ++ii)
+    {
+        std::cerr << argv[ii + 2] << ":\n";
+        BOOST_FOREACH(tawara::TrackNumberMap::value_type const& track,
+                tracks[ii])
+        {
+            std::cerr << "\tTrack " << track.first << " -> " <<
+                track.second << '\n';
+        }
+    }
+
+    return 0;
+}
+
@@ -0,0 +1,198 @@
+/*
+ * Software License Agreement (BSD License)
+ *
+ *  Copyright (c) 2011, 2012, Geoffrey Biggs, geoffrey.biggs@aist.go.jp
+ *     RT-Synthesis Research Group
+ *     Intelligent Systems Research Institute,
+ *     National Institute of Advanced Industrial Science and Technology (AIST),
+ *     Japan
+ *  All rights reserved.
+ *
+ *  Redistribution and use in source and binary forms, with or without
+ *  modification, are permitted provided that the following conditions
+ *  are met:
+ *
+ *   * Redistributions of source code must retain the above copyright
+ *     notice, this list of conditions and the following disclaimer.
+ *   * Redistributions in binary form must reproduce the above
+ *     copyright notice, this list of conditions and the following
+ *     disclaimer in the documentation and/or other materials provided
+ *     with the distribution.
+ *   * Neither the name of Geoffrey Biggs nor AIST, nor the names of its
+ *     contributors may be used to endorse or promote products derived
+ *     from this software without specific prior written permission.
+ *
+ *  THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ *  "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT
+ *  LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ *  FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE
+ *  COPYRIGHT OWNER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT,
+ *  INCIDENTAL, SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING,
+ *  BUT NOT LIMITED TO, PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES;
+ *  LOSS OF USE, DATA, OR PROFITS; OR BUSINESS INTERRUPTION) HOWEVER
+ *  CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT, STRICT
+ *  LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN
+ *  ANY WAY OUT OF THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE
+ *  POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+
+#include <algorithm>
+#include <boost/foreach.hpp>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <tawara/compression.h>
+#include <tawara/ebml_element.h>
+#include <tawara/el_ids.h>
+#include <tawara/exceptions.h>
+#include <tawara/file_cluster.h>
+#include <tawara/segment.h>
+#include <tawara/tracks.h>
+#include <vector>
+
+
+// Training is not improved by using more frames than this.
+static std::size_t const max_sample_bytes(32 * 1024 * 1024);
+
+
+// Gets the total size of a set of frames when compressed individually, as
+// they would be if each was stored in its own block.
+std::size_t compressed_size(std::vector<std::vector<char> > const& samples,
+        tawara::Compression algorithm,
+        tawara::CompressionDictionary const* dict)
+{
+    std::size_t total(0);
+    std::vector<char> compressed;
+    BOOST_FOREACH(std::vector<char> const& sample, samples)
+    {
+        if (sample.empty())
+        {
+            // Empty frames take no space either way
+            continue;
+        }
+        if (dict)
+        {
+            dict->compress(algorithm, &sample[0], sample.size(), compressed);
+        }
+        else
+        {
+            tawara::compress(algorithm, &sample[0], sample.size(),
+                    compressed);
+        }
+        // Frames that do not compress are stored as they are
+        total += std::min(compressed.size(), sample.size());
+    }
+    return total;
+}
+
+
+int main(int argc, char** argv)
+{
+    std::size_t max_size(16384);
+    if (argc == 6 && std::strcmp(argv[4], "-s") == 0)
+    {
+        max_size = std::strtoul(argv[5], 0, 10);
+    }
+    else if (argc != 4)
+    {
+        std::cerr << "Usage: " << argv[0] <<
+            " <file> <track> <dictionary> [-s <size>]\n" <<
+            "Trains a compression dictionary from the frames of a track and "
+            "writes it to a file. The default maximum size is 16384 bytes. "
+            "Set it as the track's dictionary when recording (see "
+            "TrackEntry::dictionary()).\n";
+        return 1;
+    }
+    uint64_t track(std::strtoull(argv[2], 0, 10));
+
+    std::ifstream stream(argv[1], std::ios::in | std::ios::binary);
+    tawara::Segment segment;
+    tawara::Tracks tracks;
+    try
+    {
+        tawara::read_tawara_header(stream);
+        if (tawara::ids::read(stream).first != tawara::ids::Segment)
+        {
+            std::cerr << "Segment element not found\n";
+            return 1;
+        }
+        segment.read(stream);
+        tawara::SeekHead::const_iterator tracks_pos(
+                segment.index.find(tawara::ids::Tracks));
+        if (tracks_pos == segment.index.end())
+        {
+            std::cerr << "No tracks found.\n";
+            return 1;
+        }
+        stream.seekg(segment.to_stream_offset(tracks_pos->second));
+        tawara::ids::read(stream);
+        tracks.read(stream);
+    }
+    catch (tawara::TawaraError&)
+    {
+        std::cerr << argv[1] << " is not a readable Tawara document.\n";
+        return 1;
+    }
+    tawara::Tracks::const_iterator entry(tracks.find(track));
+    if (entry == tracks.end())
+    {
+        std::cerr << "Track " << track << " not found.\n";
+        return 1;
+    }
+    std::vector<std::vector<char> > samples;
+    std::size_t sample_bytes(0);
+    for (tawara::Segment::FileClusterIterator cluster(
+                segment.clusters_begin_file(stream));
+            cluster != segment.clusters_end_file(stream) &&
+            sample_bytes < max_sample_bytes; ++cluster)
+    {
+        for (tawara::FileCluster::Iterator block(cluster->begin());
+                block != cluster->end(); ++block)
+        {
+            if (block->track_number() != track)
+            {
+                continue;
+            }
+            BOOST_FOREACH(tawara::Block::value_type const& frame, *block)
+            {
+                samples.push_back(*frame);
+                sample_bytes += frame->size();
+            }
+        }
+    }
+    if (samples.empty())
+    {
+        std::cerr << "Track " << track << " has no frames.\n";
+        return 1;
+    }
+
+    tawara::CompressionDictionary dict(tawara::train_dictionary(samples,
+                max_size));
+    std::ofstream output(argv[3], std::ios::out | std::ios::binary);
+    output.write(dict.data().empty() ? 0 : &dict.data()[0],
+            dict.data().size());
+    if (!output)
+    {
+        std::cerr << "Could not write " << argv[3] << '\n';
+        return 1;
+    }
+
+    // Report how well the frames compress with and without the dictionary
+    tawara::Compression algorithm(entry->second->compression());
+    if (algorithm == tawara::COMPRESSION_NONE)
+    {
+        algorithm = tawara::COMPRESSION_LZ4;
+    }
+    std::size_t plain(compressed_size(samples, algorithm, 0));
+    std::size_t with_dict(compressed_size(samples, algorithm, &dict));
+    std::cerr << "Frames: " << samples.size() << '\n' <<
+        "Frame bytes: " << sample_bytes << '\n' <<
+        "Dictionary size: " << dict.data().size() << '\n' <<
+        "Compressed without dictionary: " << plain << '\n' <<
+        "Compressed with dictionary: " << with_dict << '\n';
+    return 0;
+}
+